@@ -69,6 +69,29 @@ int main(){
 	*ispr1_reg |= (1<< (usart_irq_nb%32));
 
 
+	//============== Step 1b: priority of the interrupt ==============
+
+	/*
+	 * Without this step every IRQ stays at priority 0 (reset value),
+	 * so no interrupt can preempt another one
+	 *
+	 * 	- priority is done via NVIC_IPR registers
+	 * 		-> see section 4.2.7 in the generic user guide
+	 * 	- each IRQ has 1 byte, so IPR0 holds IRQ 0..3, IPR1 IRQ 4..7,...
+	 * 		-> the register is byte accessible, so we can directly
+	 * 		point to the byte of IRQ 39 : 0xE000E400 + 39
+	 * 	- only the upper 4 bits of the byte are implemented on stm32f4
+	 * 		-> priority 2 is written as (2 << 4)
+	 *
+	 * 	In the gpio project, all the priorities are written from one
+	 * 	table (irq_priority_plan.h) by NVIC_ApplyPriorityPlan()
+	 * */
+
+	uint8_t *ipr_usart3 = (uint8_t*)(0xE000E400 + usart_irq_nb);
+
+	*ipr_usart3 = (2 << 4);
+
+
 	//============== Step 2: enabling the interrupt ==============
 
 	/*
@@ -133,6 +156,7 @@ void USART3_IRQHandler(void){
  *  	-> for NVIC peripherals, we have many registers such as:
  *  	ISPR : pending the interrupt in the pending state
  *  	ISER (to enable the interrupt)
+ *  	IPR (priority of the interrupt, 1 byte per IRQ)
  *
  *  	-> we have 8 of these registers, since we
  *  	have 240 interrupts in the cortex M archi
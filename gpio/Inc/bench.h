@@ -0,0 +1,57 @@
+
+/*
+ * Benchmarks of the drivers, selected in main_gpio.c with RUN_SOFT
+ *
+ * Each benchmark stores its results in a global volatile struct,
+ * read them in debug mode (Live Expressions window) after the run
+ *
+ * */
+
+#pragma once
+
+#include <stdint.h>
+
+void bench_usart_run(void);
+void bench_usart_dma_run(void);
+void bench_telemetry_run(void);
+void bench_format_run(void);
+void bench_dma_memcpy_run(void);
+void bench_spi_run(void);
+void bench_i2c_run(void);
+void bench_adc_run(void);
+void bench_timer_run(void);
+void bench_pwm_dma_run(void);
+void bench_patgen_run(void);
+void bench_logic_run(void);
+void bench_capture_run(void);
+void bench_ccm_run(void);
+void bench_ramfunc_run(void);
+void bench_dvfs_run(void);
+void bench_clock_gate_run(void);
+void bench_power_run(void);
+void bench_mem_pool_run(void);
+void bench_arena_run(void);
+
+// USART2 pins (PA2 TX, PA3 RX, AF7), shared by the USART benchmarks
+void bench_usart2_pins(void);
+
+/*
+ * Idle loop of the CPU load measures (bench.c): counts its iterations
+ * until done() returns 1 or duration cycles are over (DWT). done = 0:
+ * duration only, duration = 0: no limit
+ * */
+uint32_t bench_idle(uint32_t duration, uint8_t (*done)(void));
+
+// 100 - 100 * loops / ref_loops, 0 if the loop ran as fast as the reference
+uint32_t bench_cpu_load(uint32_t loops, uint32_t ref_loops);
+
+// Best / worst case of one operation, in cycles
+typedef struct{
+	uint32_t min;
+	uint32_t max;
+} bench_stat;
+
+// min = 0xFFFFFFFF, max = 0: the first sample sets both
+void bench_stat_reset(volatile bench_stat *pStat);
+
+void bench_stat_add(volatile bench_stat *pStat, uint32_t cycles);
@@ -0,0 +1,66 @@
+/*
+ * Helpers shared by the benchmarks (bench.h)
+ *
+ * CPU load of a driver: an idle loop counts its iterations while the
+ * driver works, then the same loop runs during the same time with
+ * nothing else going on (reference):
+ *
+ * 	cpu_load_pct = 100 - 100 * loops / ref_loops
+ *
+ * */
+
+#include "stm32f407G.h"
+#include "dwt_counter.h"
+#include "bench.h"
+
+
+uint32_t bench_idle(uint32_t duration, uint8_t (*done)(void)){
+
+	uint32_t loops = 0;
+	uint32_t start = DWT_GetCycles();
+
+	// same work in every iteration for both uses, so the loops compare
+	while (1){
+
+		if (done && done())
+			break;
+
+		if (duration != 0 && (DWT_GetCycles() - start) >= duration)
+			break;
+
+		loops++;
+
+	} /* End while */
+
+	return loops;
+
+} /* End bench_idle() */
+
+
+uint32_t bench_cpu_load(uint32_t loops, uint32_t ref_loops){
+
+	if (loops >= ref_loops)
+		return 0;
+
+	return 100 - (uint32_t)(((uint64_t)loops * 100) / ref_loops);
+
+} /* End bench_cpu_load() */
+
+
+void bench_stat_reset(volatile bench_stat *pStat){
+
+	pStat->min = 0xFFFFFFFF;
+	pStat->max = 0;
+
+} /* End bench_stat_reset() */
+
+
+void bench_stat_add(volatile bench_stat *pStat, uint32_t cycles){
+
+	if (cycles < pStat->min)
+		pStat->min = cycles;
+
+	if (cycles > pStat->max)
+		pStat->max = cycles;
+
+} /* End bench_stat_add() */
@@ -0,0 +1,139 @@
+
+/*
+ * Goal: timer triggered ADC scan into DMA ping-pong buffers,
+ * check that the CPU only works once per block, never per sample
+ *
+ * 	ADC1 scans PA1 (channel 1) and PC1 (channel 11), triggered by
+ * 	TIM2 at BENCH_ADC_RATE scans/s -> 2 x BENCH_ADC_RATE samples/s
+ *
+ * 	For BENCH_ADC_TIME cycles, an idle loop counts its iterations
+ * 	while the blocks come in, the callback sums its block (stands
+ * 	for the processing) and measures its own duration
+ *
+ * 		- samples_per_s: blocks * BlockLen / measured time
+ * 		- cpu_load_pct = 100 - 100 * loops / loops of the same idle
+ * 		  loop during the same time with the ADC stopped
+ * 		- cb_cycles_max: longest callback (must stay far below the
+ * 		  time of one block, BENCH_ADC_BLOCK / 2 sample periods)
+ *
+ * 	With the reset clocks (HSI 16 MHz, ADCCLK 8 MHz) 400 kS/s is
+ * 	about the limit for 2 channels at 15 cycles sampling. With
+ * 	PCLK2 = 84 MHz and ADCCLK = 21 MHz (168 MHz core), 3 cycles
+ * 	sampling gives 1.4 MS/s on one ADC
+ *
+ * Results in bench_adc (Live Expressions)
+ *
+ * */
+
+#include <string.h>
+#include "stm32f407G.h"
+#include "adc_driver.h"
+#include "rcc_driver.h"
+#include "dwt_counter.h"
+#include "mem_sections.h"
+#include "bench.h"
+
+#define BENCH_ADC_RATE  200000U      // scans per second
+#define BENCH_ADC_BLOCK 512          // samples per block (256 scans)
+#define BENCH_ADC_TIME  16000000U    // measure window, in cycles
+
+typedef struct{
+	uint32_t scan_rate;          // real rate of the timer
+	uint32_t samples_per_s;
+	uint32_t blocks;
+	uint32_t overruns;
+	uint32_t cpu_load_pct;
+	uint32_t cb_cycles_max;
+	uint32_t block_cycles;       // time between 2 callbacks
+	uint16_t mean[2];            // last block, per channel
+	uint8_t init_ok;
+} bench_adc_result;
+
+volatile bench_adc_result bench_adc;
+
+static uint16_t adc_buf0[BENCH_ADC_BLOCK] __attribute__((aligned(4)));
+static uint16_t adc_buf1[BENCH_ADC_BLOCK] __attribute__((aligned(4)));
+
+__ccm_bss ADC_Handle_t adc1;
+
+void DMA2_Stream4_IRQHandler(void){
+
+	DMA_IRQHandling(&adc1.dma);
+
+} /* End DMA2_Stream4_IRQHandler() */
+
+void ADC_IRQHandler(void){
+
+	ADC_IRQHandling(&adc1);
+
+} /* End ADC_IRQHandler() */
+
+
+static void bench_adc_block(ADC_Handle_t *pADCHandle, const uint16_t *pBlock, uint16_t Len){
+
+	uint32_t start = DWT_GetCycles();
+	uint32_t sum[2] = {0, 0};
+
+	for (uint16_t i = 0; i < Len; i += 2){
+		sum[0] += pBlock[i];
+		sum[1] += pBlock[i + 1];
+	}
+
+	bench_adc.mean[0] = sum[0] / (Len / 2);
+	bench_adc.mean[1] = sum[1] / (Len / 2);
+
+	uint32_t cycles = DWT_GetCycles() - start;
+
+	if (cycles > bench_adc.cb_cycles_max)
+		bench_adc.cb_cycles_max = cycles;
+
+} /* End bench_adc_block() */
+
+
+void bench_adc_run(void){
+
+	DWT_CycleCounterInit();
+	SystemCoreClockUpdate();
+
+	memset(&adc1, 0, sizeof(adc1));
+
+	adc1.pADCx = ADC1;
+	adc1.ADC_Config.ADC_Channels[0] = 1;    // PA1
+	adc1.ADC_Config.ADC_Channels[1] = 11;   // PC1
+	adc1.ADC_Config.ADC_NbChannels = 2;
+	adc1.ADC_Config.ADC_SampleTime = ADC_SMP_15;
+	adc1.ADC_Config.ADC_Resolution = ADC_RES_12BITS;
+	// ADCCLK 36 MHz max: /2 on HSI (8 MHz), /4 at 168 MHz (21 MHz)
+	adc1.ADC_Config.ADC_Prescaler = (RCC_GetPCLK2Value() / 2 > 36000000U) ? ADC_DIV4 : ADC_DIV2;
+	adc1.ADC_Config.pTriggerTIMx = TIM2;
+	adc1.ADC_Config.ADC_ScanRate = BENCH_ADC_RATE;
+	adc1.pBuf0 = adc_buf0;
+	adc1.pBuf1 = adc_buf1;
+	adc1.BlockLen = BENCH_ADC_BLOCK;
+	adc1.Callback = bench_adc_block;
+
+	if (ADC_Init(&adc1) != DRV_OK)
+		return;
+
+	bench_adc.init_ok = 1;
+	bench_adc.scan_rate = adc1.ScanRate;
+
+	// reference first: same loop, same time, nothing running
+	uint32_t ref_loops = bench_idle(BENCH_ADC_TIME, 0);
+
+	ADC_Start(&adc1);
+
+	uint32_t loops = bench_idle(BENCH_ADC_TIME, 0);
+
+	ADC_Stop(&adc1);
+
+	uint32_t blocks = adc1.blocks;
+
+	bench_adc.blocks = blocks;
+	bench_adc.overruns = adc1.overruns;
+	bench_adc.samples_per_s =
+		(uint32_t)((uint64_t)blocks * BENCH_ADC_BLOCK * SystemCoreClock / BENCH_ADC_TIME);
+	bench_adc.block_cycles = blocks ? BENCH_ADC_TIME / blocks : 0;
+	bench_adc.cpu_load_pct = bench_cpu_load(loops, ref_loops);
+
+} /* End bench_adc_run() */
@@ -0,0 +1,221 @@
+/*
+ * Goal: per frame scratch buffers from arenas (arena.h) vs malloc()
+ *
+ * 	BENCH_AR_FRAMES frames of BENCH_AR_N samples, each frame:
+ * 		- block of q15 samples (a sine, stands for an ADC block) in
+ * 		  the SRAM arena, DMA aligned
+ * 		- float work buffers in the CCM arena: conversion, moving
+ * 		  average of BENCH_AR_TAPS, back to q15
+ * 		- inner scope (mark / rewind): the result packed in a DMA
+ * 		  aligned buffer, copied by DMA2 stream 7 (FIFO, bursts of 4)
+ * 		  to tx_buf, compared to the CPU result
+ * 		- rewind of both arenas: the offsets must be back to 0
+ *
+ * 	Checks and numbers:
+ * 		- arena_alloc / malloc_alloc: min / max cycles of one call
+ * 		  (the malloc() of the same sizes, then freed)
+ * 		- misaligned: buffers not aligned as asked -> 0
+ * 		- leaks: frames which did not end at offset 0 -> 0
+ * 		- dma_ok: frames whose DMA copy matches
+ * 		- high_water of each arena, failed = 1 (one request too large
+ * 		  on purpose, 0 returned)
+ *
+ * Results in bench_arena (Live Expressions)
+ *
+ * */
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "stm32f407G.h"
+#include "arena.h"
+#include "dma_driver.h"
+#include "rcc_driver.h"
+#include "dwt_counter.h"
+#include "bench.h"
+
+#define BENCH_AR_FRAMES  64
+#define BENCH_AR_N       256
+#define BENCH_AR_TAPS    8
+#define BENCH_AR_PI      3.14159265f
+
+typedef struct{
+	bench_stat arena_alloc;
+	bench_stat malloc_alloc;
+	uint32_t misaligned;
+	uint32_t leaks;
+	uint32_t dma_ok;
+	uint32_t dsp_high_water;
+	uint32_t io_high_water;
+	uint32_t failed;
+	uint32_t frame_cycles;       // last frame, DMA wait included
+	uint32_t errors;
+} bench_arena_result;
+
+volatile bench_arena_result bench_arena;
+
+ARENA_STORAGE_CCM(dsp_storage, 4 * 1024);   // CPU only work buffers
+ARENA_STORAGE(io_storage, 2 * 1024);        // DMA buffers
+
+static Arena_t dsp, io;
+
+static int16_t tx_buf[BENCH_AR_N] __attribute__((aligned(ARENA_ALIGN_DMA)));
+
+static DMA_Handle_t dma_ar;
+
+void DMA2_Stream7_IRQHandler(void){
+
+	DMA_IRQHandling(&dma_ar);
+
+} /* End DMA2_Stream7_IRQHandler() */
+
+
+static void *bench_ar_alloc(Arena_t *pArena, uint32_t Size, uint32_t Align){
+
+	uint32_t start = DWT_GetCycles();
+	void *p = Arena_Alloc(pArena, Size, Align);
+	bench_stat_add(&bench_arena.arena_alloc, DWT_GetCycles() - start);
+
+	// same request to the heap, for the comparison
+	start = DWT_GetCycles();
+	void *pHeap = malloc(Size);
+	bench_stat_add(&bench_arena.malloc_alloc, DWT_GetCycles() - start);
+	free(pHeap);
+
+	if (p && ((uint32_t)p & (Align - 1)))
+		bench_arena.misaligned++;
+
+	return p;
+
+} /* End bench_ar_alloc() */
+
+
+static void bench_ar_frame(uint32_t Frame){
+
+	uint32_t dsp_mark = Arena_Mark(&dsp);
+	uint32_t io_mark = Arena_Mark(&io);
+
+	int16_t *pIn = bench_ar_alloc(&io, BENCH_AR_N * sizeof(int16_t), ARENA_ALIGN_DMA);
+	float *pX = bench_ar_alloc(&dsp, BENCH_AR_N * sizeof(float), ARENA_ALIGN_WORD);
+	float *pY = bench_ar_alloc(&dsp, BENCH_AR_N * sizeof(float), ARENA_ALIGN_WORD);
+
+	if (!pIn || !pX || !pY){
+		bench_arena.errors++;
+		goto rewind;
+	}
+
+	// input block, the phase moves with the frame
+	for (uint32_t i = 0; i < BENCH_AR_N; ++i)
+		pIn[i] = (int16_t)(16000.0f * sinf(2 * BENCH_AR_PI * (i + Frame * 7) / 64.0f));
+
+	for (uint32_t i = 0; i < BENCH_AR_N; ++i)
+		pX[i] = pIn[i] / 32768.0f;
+
+	// moving average, the first taps on a partial window
+	float acc = 0;
+
+	for (uint32_t i = 0; i < BENCH_AR_N; ++i){
+
+		acc += pX[i];
+
+		if (i >= BENCH_AR_TAPS)
+			acc -= pX[i - BENCH_AR_TAPS];
+
+		pY[i] = acc / BENCH_AR_TAPS;
+
+	}
+
+	// inner scope: output packing, given back before the end of the frame
+	uint32_t pack_mark = Arena_Mark(&io);
+
+	int16_t *pOut = bench_ar_alloc(&io, BENCH_AR_N * sizeof(int16_t), ARENA_ALIGN_DMA);
+
+	if (pOut == 0){
+		bench_arena.errors++;
+		goto rewind;
+	}
+
+	for (uint32_t i = 0; i < BENCH_AR_N; ++i)
+		pOut[i] = (int16_t)(pY[i] * 32767.0f);
+
+	memset(tx_buf, 0, sizeof(tx_buf));
+
+	if (DMA_MemCopy(&dma_ar, tx_buf, pOut, BENCH_AR_N * sizeof(int16_t) / 4) != DRV_OK){
+		bench_arena.errors++;
+		goto rewind;
+	}
+
+	while (DMA_IsBusy(&dma_ar));
+
+	if (memcmp(tx_buf, pOut, sizeof(tx_buf)) == 0)
+		bench_arena.dma_ok++;
+
+	Arena_Rewind(&io, pack_mark);
+
+rewind:
+	Arena_Rewind(&dsp, dsp_mark);
+	Arena_Rewind(&io, io_mark);
+
+} /* End bench_ar_frame() */
+
+
+void bench_arena_run(void){
+
+	DWT_CycleCounterInit();
+	SystemCoreClockUpdate();
+
+	if (Arena_Init(&dsp, dsp_storage, sizeof(dsp_storage)) != DRV_OK ||
+		Arena_Init(&io, io_storage, sizeof(io_storage)) != DRV_OK){
+		bench_arena.errors++;
+		return;
+	}
+
+	// memory to memory, words, bursts of 4: the arena keeps it in 32 bytes blocks
+	dma_ar.pDMAx = DMA2;
+	dma_ar.Stream = 7;
+	dma_ar.DMA_Config.DMA_Channel = 0;
+	dma_ar.DMA_Config.DMA_Direction = DMA_DIR_MEM_TO_MEM;
+	dma_ar.DMA_Config.DMA_PeriphInc = ON;
+	dma_ar.DMA_Config.DMA_MemInc = ON;
+	dma_ar.DMA_Config.DMA_PeriphDataSize = DMA_SIZE_WORD;
+	dma_ar.DMA_Config.DMA_MemDataSize = DMA_SIZE_WORD;
+	dma_ar.DMA_Config.DMA_Circular = OFF;
+	dma_ar.DMA_Config.DMA_DoubleBuffer = OFF;
+	dma_ar.DMA_Config.DMA_Priority = DMA_PRIO_HIGH;
+	dma_ar.DMA_Config.DMA_HalfTransferIT = OFF;
+	dma_ar.DMA_Config.DMA_FIFOMode = ON;
+	dma_ar.DMA_Config.DMA_FIFOThreshold = DMA_FIFO_FULL;
+	dma_ar.DMA_Config.DMA_MemBurst = DMA_BURST_INC4;
+	dma_ar.DMA_Config.DMA_PeriphBurst = DMA_BURST_INC4;
+	dma_ar.Callback = 0;
+
+	if (DMA_Init(&dma_ar) != DRV_OK){
+		bench_arena.errors++;
+		return;
+	}
+
+	bench_stat_reset(&bench_arena.arena_alloc);
+	bench_stat_reset(&bench_arena.malloc_alloc);
+
+	for (uint32_t f = 0; f < BENCH_AR_FRAMES; ++f){
+
+		uint32_t start = DWT_GetCycles();
+
+		bench_ar_frame(f);
+
+		bench_arena.frame_cycles = DWT_GetCycles() - start;
+
+		if (Arena_Mark(&dsp) != 0 || Arena_Mark(&io) != 0)
+			bench_arena.leaks++;
+
+	}
+
+	// too large on purpose: refused, counted in failed
+	if (Arena_Alloc(&io, sizeof(io_storage) + 1, ARENA_ALIGN_WORD) != 0)
+		bench_arena.errors++;
+
+	bench_arena.dsp_high_water = dsp.high_water;
+	bench_arena.io_high_water = io.high_water;
+	bench_arena.failed = dsp.failed + io.failed;
+
+} /* End bench_arena_run() */
@@ -0,0 +1,126 @@
+
+/*
+ * Goal: frequency and duty of an external signal with no CPU work
+ * per edge (input capture + DMA, input_capture.c)
+ *
+ * 	Source: TIM4 CH1 PWM on PD12 (green LED), duty BENCH_IC_DUTY,
+ * 	for each frequency of bench_ic_freqs[]
+ * 	Input: TIM2 CH1 on PA15 (AF1), jumper PD12 -> PA15
+ *
+ * 	For each frequency, after BENCH_IC_TIME cycles:
+ * 		- freq_mhz / duty: IC_Read() over the last BENCH_IC_BATCH
+ * 		  periods (less at the lowest frequency)
+ * 		- read_cycles: cost of IC_Read(), the same at 10 Hz and
+ * 		  at 100 kHz
+ * 		- cpu_load_pct: idle loop with / without the capture running,
+ * 		  only the bus cycles of the DMA are left
+ *
+ * Results in bench_capture (Live Expressions)
+ *
+ * */
+
+#include "stm32f407G.h"
+#include "gpio_driver.h"
+#include "timer_driver.h"
+#include "input_capture.h"
+#include "rcc_driver.h"
+#include "dwt_counter.h"
+#include "bench.h"
+
+#define BENCH_IC_NB_FREQ  4
+#define BENCH_IC_DUTY     2500         // 25 %
+#define BENCH_IC_PAIRS    256
+#define BENCH_IC_BATCH    64
+#define BENCH_IC_TIME     8000000U
+
+typedef struct{
+	uint32_t tick_rate;
+	uint32_t pwm_freq[BENCH_IC_NB_FREQ];     // real frequency of TIM4
+	uint32_t freq_mhz[BENCH_IC_NB_FREQ];     // measured, 0.001 Hz
+	uint16_t duty[BENCH_IC_NB_FREQ];         // measured, 0.01 %
+	uint32_t periods[BENCH_IC_NB_FREQ];
+	uint32_t read_cycles[BENCH_IC_NB_FREQ];
+	uint32_t cpu_load_pct;                   // at the highest frequency
+	uint8_t init_ok;
+} bench_capture_result;
+
+volatile bench_capture_result bench_capture;
+
+static const uint32_t bench_ic_freqs[BENCH_IC_NB_FREQ] = {10, 1000, 20000, 100000};
+
+static uint32_t ic_buf[2 * BENCH_IC_PAIRS];
+
+IC_Handle_t ic2;
+
+
+void bench_capture_run(void){
+
+	DWT_CycleCounterInit();
+	SystemCoreClockUpdate();
+
+	// ---- capture ----
+	ic2.pTIMx = TIM2;
+	ic2.pGPIOx = GPIOA;
+	ic2.PinNumber = GPIO_PIN_15;
+	ic2.PuPd = NO_PULLUP;
+	ic2.Filter = 0;
+	ic2.TickRate = TIM_GetClock(TIM2);
+	ic2.Timeout = ic2.TickRate / 2;
+	ic2.pBuffer = ic_buf;
+	ic2.BufferLen = BENCH_IC_PAIRS;
+
+	if (IC_Init(&ic2) != DRV_OK)
+		return;
+
+	bench_capture.init_ok = 1;
+	bench_capture.tick_rate = ic2.RealTickRate;
+
+	// ---- source ----
+	TIM_Handle_t tim4;
+
+	tim4.pTIMx = TIM4;
+	tim4.TIM_Config.TIM_OnePulse = OFF;
+	tim4.TIM_Config.TIM_UpdateIT = OFF;
+	tim4.Callback = 0;
+
+	uint32_t ref_loops = bench_idle(BENCH_IC_TIME, 0);
+	uint32_t loops = ref_loops;
+
+	for (int f = 0; f < BENCH_IC_NB_FREQ; ++f){
+
+		tim4.TIM_Config.TIM_Frequency = bench_ic_freqs[f];
+
+		if (TIM_Init(&tim4) != DRV_OK)
+			continue;
+
+		TIM_PWMInit(&tim4, 1, TIM_PWM_MODE1, TIM_POL_HIGH, GPIOD, GPIO_PIN_12);
+		TIM_SetDuty(&tim4, 1, BENCH_IC_DUTY);
+		TIM_Start(&tim4);
+
+		bench_capture.pwm_freq[f] = tim4.Frequency;
+
+		if (IC_Start(&ic2) != DRV_OK){
+			TIM_Stop(&tim4);
+			break;
+		}
+
+		loops = bench_idle(BENCH_IC_TIME, 0);
+
+		IC_Measure_t m;
+		uint32_t start = DWT_GetCycles();
+
+		IC_Read(&ic2, &m, BENCH_IC_BATCH);
+
+		bench_capture.read_cycles[f] = DWT_GetCycles() - start;
+		bench_capture.freq_mhz[f] = m.Frequency_mHz;
+		bench_capture.duty[f] = m.Duty;
+		bench_capture.periods[f] = m.Periods;
+
+		IC_Stop(&ic2);
+		TIM_Stop(&tim4);
+
+	} /* End for frequencies */
+
+	bench_capture.cpu_load_pct = bench_cpu_load(loops, ref_loops);
+
+} /* End bench_capture_run() */
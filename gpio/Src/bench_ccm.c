@@ -0,0 +1,169 @@
+
+/*
+ * Goal: CPU data in CCM RAM vs SRAM1 while a DMA loads the bus matrix
+ *
+ * 	DMA2 stream 6 copies BENCH_CCM_DMA_WORDS words from SRAM1 to SRAM1
+ * 	again and again (memory to memory, bursts of 4, restarted from its
+ * 	transfer complete callback). Meanwhile the CPU runs the same
+ * 	read-modify-write loop over a table:
+ *
+ * 		- in SRAM1 (.bss): the core and the DMA share the SRAM1 port
+ * 		  of the bus matrix, the core waits when the DMA has it
+ * 		- in CCM (__ccm_bss): the core reaches it on its D-bus, the
+ * 		  DMA never gets there
+ *
+ * 	Each case is measured with the DMA stopped, then running:
+ * 	slowdown_pct = 100 * (cycles with DMA / cycles without - 1)
+ * 	The CCM slowdown must stay near 0 (only the DMA interrupt, once
+ * 	per copy), SRAM1 shows the cost of the arbitration
+ *
+ * Results in bench_ccm (Live Expressions)
+ *
+ * */
+
+#include "stm32f407G.h"
+#include "dma_driver.h"
+#include "mem_sections.h"
+#include "rcc_driver.h"
+#include "dwt_counter.h"
+#include "bench.h"
+
+#define BENCH_CCM_WORDS      1024     // table of the CPU loop
+#define BENCH_CCM_LOOPS      64
+#define BENCH_CCM_DMA_WORDS  4096     // 16 KB per copy
+
+typedef struct{
+	uint32_t sram_idle_cycles;
+	uint32_t sram_dma_cycles;
+	uint32_t ccm_idle_cycles;
+	uint32_t ccm_dma_cycles;
+	uint32_t sram_slowdown_pct;
+	uint32_t ccm_slowdown_pct;
+	uint32_t dma_copies;
+	uint8_t ccm_dma_refused;     // DMA_Start() on a CCM address -> DRV_ERROR
+} bench_ccm_result;
+
+volatile bench_ccm_result bench_ccm;
+
+static uint32_t work_sram[BENCH_CCM_WORDS];
+static __ccm_bss uint32_t work_ccm[BENCH_CCM_WORDS];
+
+static uint32_t dma_src[BENCH_CCM_DMA_WORDS] __attribute__((aligned(16)));
+static uint32_t dma_dst[BENCH_CCM_DMA_WORDS] __attribute__((aligned(16)));
+
+static __ccm_bss DMA_Handle_t dma_load;
+static __ccm_bss volatile uint8_t dma_loading;
+static __ccm_bss volatile uint32_t dma_copies;
+
+void DMA2_Stream6_IRQHandler(void){
+
+	DMA_IRQHandling(&dma_load);
+
+} /* End DMA2_Stream6_IRQHandler() */
+
+
+static void bench_ccm_reload(DMA_Handle_t *pDMAHandle, uint8_t event){
+
+	if (event != DMA_EVENT_TRANSFER_COMPLETE)
+		return;
+
+	dma_copies++;
+
+	if (dma_loading)
+		DMA_MemCopy(pDMAHandle, dma_dst, dma_src, BENCH_CCM_DMA_WORDS);
+
+} /* End bench_ccm_reload() */
+
+
+static uint32_t bench_ccm_work(uint32_t *pTable){
+
+	__vo uint32_t *p = pTable;
+	uint32_t acc = 0;
+	uint32_t start = DWT_GetCycles();
+
+	for (int l = 0; l < BENCH_CCM_LOOPS; ++l){
+		for (int i = 0; i < BENCH_CCM_WORDS; ++i){
+			acc += p[i];
+			p[i] = acc;
+		}
+	}
+
+	return DWT_GetCycles() - start;
+
+} /* End bench_ccm_work() */
+
+
+static void bench_ccm_load(uint8_t ON_OFF){
+
+	if (ON_OFF == ON){
+		dma_loading = 1;
+		DMA_MemCopy(&dma_load, dma_dst, dma_src, BENCH_CCM_DMA_WORDS);
+		return;
+	}
+
+	dma_loading = 0;
+	while (DMA_IsBusy(&dma_load));
+
+} /* End bench_ccm_load() */
+
+
+static uint32_t bench_ccm_pct(uint32_t with, uint32_t without){
+
+	if (with <= without)
+		return 0;
+
+	return (uint32_t)(((uint64_t)(with - without) * 100) / without);
+
+} /* End bench_ccm_pct() */
+
+
+void bench_ccm_run(void){
+
+	DWT_CycleCounterInit();
+	SystemCoreClockUpdate();
+
+	dma_load.pDMAx = DMA2;
+	dma_load.Stream = 6;
+	dma_load.DMA_Config.DMA_Channel = 0;
+	dma_load.DMA_Config.DMA_Direction = DMA_DIR_MEM_TO_MEM;
+	dma_load.DMA_Config.DMA_PeriphInc = ON;
+	dma_load.DMA_Config.DMA_MemInc = ON;
+	dma_load.DMA_Config.DMA_PeriphDataSize = DMA_SIZE_WORD;
+	dma_load.DMA_Config.DMA_MemDataSize = DMA_SIZE_WORD;
+	dma_load.DMA_Config.DMA_Circular = OFF;
+	dma_load.DMA_Config.DMA_DoubleBuffer = OFF;
+	dma_load.DMA_Config.DMA_Priority = DMA_PRIO_VERY_HIGH;
+	dma_load.DMA_Config.DMA_HalfTransferIT = OFF;
+	dma_load.DMA_Config.DMA_FIFOMode = ON;
+	dma_load.DMA_Config.DMA_FIFOThreshold = DMA_FIFO_FULL;
+	dma_load.DMA_Config.DMA_MemBurst = DMA_BURST_INC4;
+	dma_load.DMA_Config.DMA_PeriphBurst = DMA_BURST_INC4;
+	dma_load.Callback = bench_ccm_reload;
+
+	if (DMA_Init(&dma_load) != DRV_OK)
+		return;
+
+	bench_ccm.ccm_dma_refused =
+		(DMA_MemCopy(&dma_load, work_ccm, dma_src, BENCH_CCM_WORDS) == DRV_ERROR);
+
+	// ---- SRAM1 table ----
+	bench_ccm.sram_idle_cycles = bench_ccm_work(work_sram);
+
+	bench_ccm_load(ON);
+	bench_ccm.sram_dma_cycles = bench_ccm_work(work_sram);
+	bench_ccm_load(OFF);
+
+	// ---- CCM table ----
+	bench_ccm.ccm_idle_cycles = bench_ccm_work(work_ccm);
+
+	bench_ccm_load(ON);
+	bench_ccm.ccm_dma_cycles = bench_ccm_work(work_ccm);
+	bench_ccm_load(OFF);
+
+	bench_ccm.sram_slowdown_pct = bench_ccm_pct(bench_ccm.sram_dma_cycles,
+												bench_ccm.sram_idle_cycles);
+	bench_ccm.ccm_slowdown_pct = bench_ccm_pct(bench_ccm.ccm_dma_cycles,
+											   bench_ccm.ccm_idle_cycles);
+	bench_ccm.dma_copies = dma_copies;
+
+} /* End bench_ccm_run() */
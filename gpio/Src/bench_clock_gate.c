@@ -0,0 +1,129 @@
+
+/*
+ * Goal: reference counted clock gating (clock_gate.h)
+ *
+ * 	1) Sharing: two users of GPIOD (GPIO_PeriClockControl ON twice).
+ * 	   The first one turns it OFF: GPIOD must still work (MODER
+ * 	   written and read back). The second one turns it OFF: the
+ * 	   port is gated, its registers read 0
+ *
+ * 	2) Current: every existing enable bit of RCC set by hand, like
+ * 	   code which leaves all the clocks on, for BENCH_CG_SECONDS
+ * 	   (green LED on), then CLK_GateUnused() and the same time again
+ * 	   (green LED off). Read IDD with an ammeter on JP1 during both
+ * 	   phases: the difference is the current of the gated clocks
+ *
+ * 	3) Cost of CLK_Acquire() + CLK_Release() in cycles
+ *
+ * Results in bench_clock_gate (Live Expressions)
+ *
+ * */
+
+#include "stm32f407G.h"
+#include "gpio_driver.h"
+#include "clock_gate.h"
+#include "rcc_driver.h"
+#include "dwt_counter.h"
+#include "bench.h"
+
+#define BENCH_CG_SECONDS  5
+#define BENCH_CG_MODER    (1U << (2 * 14))   // PD14 output
+
+typedef struct{
+	uint8_t shared_ok;           // GPIOD alive after the first OFF
+	uint8_t gated_ok;            // GPIOD gated after the second OFF
+	uint32_t enabled_before[CLK_NB_BUSES];
+	uint32_t enabled_after[CLK_NB_BUSES];
+	uint32_t live[CLK_NB_BUSES];
+	uint32_t gated;              // bits cleared by CLK_GateUnused()
+	uint32_t acquire_release_cycles;
+} bench_clock_gate_result;
+
+volatile bench_clock_gate_result bench_clock_gate;
+
+static const uint32_t bench_cg_valid[CLK_NB_BUSES] = {
+	CLK_AHB1_VALID, CLK_AHB2_VALID, CLK_AHB3_VALID, CLK_APB1_VALID, CLK_APB2_VALID
+};
+
+
+static void bench_cg_idle(uint32_t Seconds){
+
+	uint32_t start = DWT_GetCycles();
+	uint32_t cycles = SystemCoreClock * Seconds;
+
+	while ((DWT_GetCycles() - start) < cycles);
+
+} /* End bench_cg_idle() */
+
+
+static void bench_cg_enabled(volatile uint32_t *pMasks){
+
+	for (uint8_t bus = 0; bus < CLK_NB_BUSES; ++bus)
+		pMasks[bus] = CLK_GetEnabledMask(bus);
+
+} /* End bench_cg_enabled() */
+
+
+void bench_clock_gate_run(void){
+
+	DWT_CycleCounterInit();
+	SystemCoreClockUpdate();
+
+	// ---- 1) sharing ----
+	GPIO_PeriClockControl(GPIOD, ON);      // user 1
+	GPIO_PeriClockControl(GPIOD, ON);      // user 2
+
+	GPIO_PeriClockControl(GPIOD, OFF);     // user 1 is done
+
+	GPIOD->MODER = BENCH_CG_MODER;
+	bench_clock_gate.shared_ok = (GPIOD->MODER == BENCH_CG_MODER);
+
+	GPIO_PeriClockControl(GPIOD, OFF);     // user 2 is done
+
+	bench_clock_gate.gated_ok = (GPIOD->MODER == 0) &&
+								(CLK_GetRefCount(CLK_AHB1, CLK_AHB1_GPIOD) == 0);
+
+	// ---- 2) current, all on then gated ----
+	RCC->AHB1ENR |= CLK_AHB1_VALID;
+	RCC->AHB2ENR |= CLK_AHB2_VALID;
+	RCC->AHB3ENR |= CLK_AHB3_VALID;
+	RCC->APB1ENR |= CLK_APB1_VALID;
+	RCC->APB2ENR |= CLK_APB2_VALID;
+
+	bench_cg_enabled(bench_clock_gate.enabled_before);
+
+	// green LED (PD12): the only clock held by the bench
+	GPIO_Handle_t led;
+
+	led.gpio_reg_x = GPIOD;
+	led.gpio_pin_conf.GPIO_PinNumber = GPIO_PIN_12;
+	led.gpio_pin_conf.GPIO_PinMode = OUT;
+	led.gpio_pin_conf.GPIO_PinSpeed = LOW;
+	led.gpio_pin_conf.GPIO_PinOPType = PUSH_PULL;
+	led.gpio_pin_conf.GPIO_PinPuPdControl = NO_PULLUP;
+
+	GPIO_PeriClockControl(GPIOD, ON);
+	GPIO_Init(&led);
+
+	GPIO_WriteToOutputPin(GPIOD, GPIO_PIN_12, ON);
+	bench_cg_idle(BENCH_CG_SECONDS);
+
+	bench_clock_gate.gated = CLK_GateUnused();
+
+	GPIO_WriteToOutputPin(GPIOD, GPIO_PIN_12, OFF);
+	bench_cg_idle(BENCH_CG_SECONDS);
+
+	bench_cg_enabled(bench_clock_gate.enabled_after);
+
+	for (uint8_t bus = 0; bus < CLK_NB_BUSES; ++bus)
+		bench_clock_gate.live[bus] = CLK_GetLiveMask(bus) & bench_cg_valid[bus];
+
+	// ---- 3) cost ----
+	uint32_t start = DWT_GetCycles();
+
+	CLK_Acquire(CLK_APB1, 4);              // TIM6
+	CLK_Release(CLK_APB1, 4);
+
+	bench_clock_gate.acquire_release_cycles = DWT_GetCycles() - start;
+
+} /* End bench_clock_gate_run() */
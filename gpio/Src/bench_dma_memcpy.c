@@ -0,0 +1,112 @@
+
+/*
+ * Goal: memory to memory copy, memcpy() vs DMA2 (stream 0)
+ *
+ * For each size:
+ * 	- cycles_memcpy: the CPU does the whole copy
+ * 	- cycles_dma_setup: time to start the DMA, the only CPU cost
+ * 	- cycles_dma_total: from the start to the end of the transfer
+ * 	  (the CPU is free during cycles_dma_total - cycles_dma_setup)
+ *
+ * 	DMA: word size, FIFO full threshold, 4 beats bursts on both sides
+ * 	(buffers aligned on 16 bytes so no burst crosses a 1 KB boundary)
+ *
+ * Expected: memcpy wins for small blocks (setup cost), the DMA frees
+ * the CPU for large ones even when the raw time is close
+ *
+ * Results in bench_dma_memcpy (Live Expressions)
+ *
+ * */
+
+#include <string.h>
+#include "stm32f407G.h"
+#include "dma_driver.h"
+#include "dwt_counter.h"
+#include "bench.h"
+
+static const uint16_t bench_sizes[] = {64, 256, 1024, 4096};
+
+#define NB_BENCH_SIZES (sizeof(bench_sizes)/sizeof(bench_sizes[0]))
+#define BENCH_MAX_SIZE 4096
+
+typedef struct{
+	uint32_t size;
+	uint32_t cycles_memcpy;
+	uint32_t cycles_dma_setup;
+	uint32_t cycles_dma_total;
+	uint8_t dma_ok;            // destination checked after the copy
+} bench_dma_memcpy_result;
+
+volatile bench_dma_memcpy_result bench_dma_memcpy[NB_BENCH_SIZES];
+
+static uint8_t src_buf[BENCH_MAX_SIZE] __attribute__((aligned(16)));
+static uint8_t dst_buf[BENCH_MAX_SIZE] __attribute__((aligned(16)));
+
+static DMA_Handle_t dma_m2m;
+
+void DMA2_Stream0_IRQHandler(void){
+
+	DMA_IRQHandling(&dma_m2m);
+
+} /* End DMA2_Stream0_IRQHandler() */
+
+
+void bench_dma_memcpy_run(void){
+
+	DWT_CycleCounterInit();
+
+	for (int i = 0; i < BENCH_MAX_SIZE; ++i)
+		src_buf[i] = (uint8_t)(i * 7 + 1);
+
+	dma_m2m.pDMAx = DMA2;
+	dma_m2m.Stream = 0;
+	dma_m2m.DMA_Config.DMA_Channel = 0;
+	dma_m2m.DMA_Config.DMA_Direction = DMA_DIR_MEM_TO_MEM;
+	dma_m2m.DMA_Config.DMA_PeriphInc = ON;     // the source is PAR
+	dma_m2m.DMA_Config.DMA_MemInc = ON;
+	dma_m2m.DMA_Config.DMA_PeriphDataSize = DMA_SIZE_WORD;
+	dma_m2m.DMA_Config.DMA_MemDataSize = DMA_SIZE_WORD;
+	dma_m2m.DMA_Config.DMA_Circular = OFF;
+	dma_m2m.DMA_Config.DMA_DoubleBuffer = OFF;
+	dma_m2m.DMA_Config.DMA_Priority = DMA_PRIO_HIGH;
+	dma_m2m.DMA_Config.DMA_HalfTransferIT = OFF;
+	dma_m2m.DMA_Config.DMA_FIFOMode = ON;
+	dma_m2m.DMA_Config.DMA_FIFOThreshold = DMA_FIFO_FULL;
+	dma_m2m.DMA_Config.DMA_MemBurst = DMA_BURST_INC4;
+	dma_m2m.DMA_Config.DMA_PeriphBurst = DMA_BURST_INC4;
+	dma_m2m.Callback = 0;
+
+	if (DMA_Init(&dma_m2m) != DRV_OK)
+		return;
+
+	for (int k = 0; k < NB_BENCH_SIZES; ++k){
+
+		uint16_t size = bench_sizes[k];
+
+		bench_dma_memcpy[k].size = size;
+
+		// ---- memcpy ----
+		uint32_t start = DWT_GetCycles();
+
+		memcpy(dst_buf, src_buf, size);
+
+		bench_dma_memcpy[k].cycles_memcpy = DWT_GetCycles() - start;
+
+		// ---- DMA ----
+		memset(dst_buf, 0, size);
+
+		start = DWT_GetCycles();
+
+		DMA_MemCopy(&dma_m2m, dst_buf, src_buf, size / 4); // nb of words
+
+		uint32_t setup = DWT_GetCycles() - start;
+
+		while (DMA_IsBusy(&dma_m2m));
+
+		bench_dma_memcpy[k].cycles_dma_total = DWT_GetCycles() - start;
+		bench_dma_memcpy[k].cycles_dma_setup = setup;
+		bench_dma_memcpy[k].dma_ok = (memcmp(dst_buf, src_buf, size) == 0);
+
+	} /* End for sizes */
+
+} /* End bench_dma_memcpy_run() */
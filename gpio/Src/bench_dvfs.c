@@ -0,0 +1,178 @@
+
+/*
+ * Goal: switch between the clock profiles of dvfs.h and check that the
+ * drivers follow
+ *
+ * 	Notifiers registered: SysTick 1 kHz time base, USART2 115200 baud
+ * 	(PA2 / PA3), TIM4 PWM 1 kHz on PD13 (orange LED) at 25 % duty.
+ * 	The profiles are visited in the order of bench_dvfs_steps, at each
+ * 	step:
+ *
+ * 		- cost of the switch (DVFS_Stats_t): cycles and us
+ * 		- tick_ms: length of SysTick_DelayMs(100) measured with DWT
+ * 		  at the new clock -> 100 (+1 at most)
+ * 		- baud: PCLK1 / BRR read back -> 115200 within 0.1 %
+ * 		- pwm_hz / duty_pct: TIM4 read back -> 1000 Hz, 25 %
+ * 		- a line "profile <name>" on USART2 (terminal at 115200)
+ *
+ * 	busy_refused: a switch asked while USART2 still sends must be
+ * 	refused by its notifier (DRV_BUSY), the clock staying as it is
+ *
+ * Results in bench_dvfs (Live Expressions)
+ *
+ * */
+
+#include <string.h>
+
+#include "stm32f407G.h"
+#include "gpio_driver.h"
+#include "dvfs.h"
+#include "systick.h"
+#include "usart_driver.h"
+#include "timer_driver.h"
+#include "rcc_driver.h"
+#include "dwt_counter.h"
+#include "bench.h"
+
+#define BENCH_DVFS_BAUD     115200
+#define BENCH_DVFS_PWM_HZ   1000
+#define BENCH_DVFS_STEPS    5
+
+typedef struct{
+	uint32_t hclk;
+	uint8_t status;           // drv_status of DVFS_SetProfile()
+	uint32_t cost_cycles;
+	uint32_t cost_us;
+	uint32_t tick_ms;
+	uint32_t baud;
+	uint32_t pwm_hz;
+	uint32_t duty_pct;
+} bench_dvfs_step;
+
+typedef struct{
+	bench_dvfs_step step[BENCH_DVFS_STEPS];
+	uint8_t busy_refused;
+	uint8_t profile_after_refusal;
+} bench_dvfs_result;
+
+volatile bench_dvfs_result bench_dvfs;
+
+static const uint8_t bench_dvfs_steps[BENCH_DVFS_STEPS] = {
+	DVFS_HIGH, DVFS_LOW, DVFS_MID, DVFS_HIGH, DVFS_LOW
+};
+
+static uint8_t dvfs_tx_storage[256];
+static uint8_t dvfs_rx_storage[16];
+
+extern USART_Handle_t usart2_handle;   // bench_usart.c, with USART2_IRQHandler()
+extern TIM_Handle_t tim4;              // bench_timer.c, with TIM4_IRQHandler()
+
+static DVFS_Notifier_t nb_systick = {.Callback = SysTick_DVFSNotify};
+static DVFS_Notifier_t nb_usart2 = {.Callback = USART_DVFSNotify, .pContext = &usart2_handle};
+static DVFS_Notifier_t nb_tim4 = {.Callback = TIM_DVFSNotify, .pContext = &tim4};
+
+void SysTick_Handler(void){
+
+	SysTick_IRQHandling();
+
+} /* End SysTick_Handler() */
+
+
+static void bench_dvfs_print(const char *pText){
+
+	USART_Write(&usart2_handle, (const uint8_t*)pText, strlen(pText));
+
+} /* End bench_dvfs_print() */
+
+
+static void bench_dvfs_check(volatile bench_dvfs_step *pStep){
+
+	pStep->hclk = SystemCoreClock;
+
+	// time base
+	uint32_t start = DWT_GetCycles();
+
+	SysTick_DelayMs(100);
+
+	pStep->tick_ms = (DWT_GetCycles() - start) / (SystemCoreClock / 1000);
+
+	// USART2, oversampling by 16: BRR = PCLK1 / baud
+	pStep->baud = RCC_GetPCLK1Value() / USART2->BRR;
+
+	// TIM4 channel 2
+	pStep->pwm_hz = tim4.Frequency;
+	pStep->duty_pct = (TIM4->CCR[1] * 100 + (TIM4->ARR + 1) / 2) / (TIM4->ARR + 1);
+
+	bench_dvfs_print("profile ");
+	bench_dvfs_print(DVFS_GetProfileInfo(DVFS_GetProfile())->Name);
+	bench_dvfs_print("\r\n");
+
+	while (!USART_TxIdle(&usart2_handle));
+
+} /* End bench_dvfs_check() */
+
+
+void bench_dvfs_run(void){
+
+	DWT_CycleCounterInit();
+	SystemCoreClockUpdate();
+
+	// ---- drivers ----
+	SysTick_Init(1000);
+
+	bench_usart2_pins();
+
+	usart2_handle.pUSARTx = USART2;
+	usart2_handle.USART_Config.USART_Mode = USART_MODE_TXRX;
+	usart2_handle.USART_Config.USART_Baud = BENCH_DVFS_BAUD;
+	usart2_handle.USART_Config.USART_NoOfStopBits = USART_STOPBITS_1;
+	usart2_handle.USART_Config.USART_WordLength = USART_WORDLEN_8BITS;
+	usart2_handle.USART_Config.USART_ParityControl = USART_PARITY_DISABLE;
+	usart2_handle.USART_Config.USART_HWFlowControl = USART_HW_FLOW_NONE;
+	usart2_handle.pTxBuffer = dvfs_tx_storage;
+	usart2_handle.TxBufferSize = sizeof(dvfs_tx_storage);
+	usart2_handle.pRxBuffer = dvfs_rx_storage;
+	usart2_handle.RxBufferSize = sizeof(dvfs_rx_storage);
+
+	if (USART_Init(&usart2_handle) != DRV_OK)
+		return;
+
+	tim4.pTIMx = TIM4;
+	tim4.TIM_Config.TIM_Frequency = BENCH_DVFS_PWM_HZ;
+	tim4.TIM_Config.TIM_OnePulse = OFF;
+	tim4.TIM_Config.TIM_UpdateIT = OFF;
+	tim4.Callback = 0;
+
+	if (TIM_Init(&tim4) != DRV_OK)
+		return;
+
+	TIM_PWMInit(&tim4, 2, TIM_PWM_MODE1, TIM_POL_HIGH, GPIOD, GPIO_PIN_13);
+	TIM_SetDuty(&tim4, 2, TIM_DUTY_MAX / 4);
+	TIM_Start(&tim4);
+
+	DVFS_Register(&nb_systick);
+	DVFS_Register(&nb_usart2);
+	DVFS_Register(&nb_tim4);
+
+	// ---- profiles ----
+	for (uint8_t i = 0; i < BENCH_DVFS_STEPS; ++i){
+
+		uint8_t level = bench_dvfs_steps[i];
+
+		bench_dvfs.step[i].status = DVFS_SetProfile(level);
+		bench_dvfs.step[i].cost_cycles = DVFS_GetStats(level)->last_cycles;
+		bench_dvfs.step[i].cost_us = DVFS_GetStats(level)->last_us;
+
+		bench_dvfs_check(&bench_dvfs.step[i]);
+
+	}
+
+	// ---- refusal: USART2 busy ----
+	bench_dvfs_print("a line long enough to still be sent during the switch\r\n");
+
+	bench_dvfs.busy_refused = (DVFS_SetProfile(DVFS_HIGH) == DRV_BUSY);
+	bench_dvfs.profile_after_refusal = DVFS_GetProfile();
+
+	while (!USART_TxIdle(&usart2_handle));
+
+} /* End bench_dvfs_run() */
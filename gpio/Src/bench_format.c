@@ -0,0 +1,166 @@
+
+/*
+ * Goal: cost of newlib snprintf() vs format.h on the same log messages
+ *
+ * 	3 messages, each one built BENCH_FMT_LOOPS times with both methods:
+ * 		0) "adc ch=3 raw=-1234\n"               (integers)
+ * 		1) "reg 0x4002000C = 0x0000A5F0\n"       (hex)
+ * 		2) "vbat=3.300 V temp=-12.50 C\n"         (fixed point)
+ *
+ * 	- cycles per message (DWT)
+ * 	- heap taken by each method: _sbrk(0) before / after (newlib may
+ * 	  allocate its reentrancy buffers on the first call)
+ * 	- same_text: 1 when both methods give the same string
+ *
+ * Flash size is read in the .map file (Debug/gpio.map) after the build:
+ * 	- newlib: _svfprintf_r / _vfiprintf_r, _dtoa_r, __ssputs_r,...
+ * 	- format.o: .text of the Fmt_xxx functions
+ *
+ * Results in bench_format (Live Expressions)
+ *
+ * */
+
+#include <stdio.h>
+#include <string.h>
+#include <stddef.h>
+#include "stm32f407G.h"
+#include "format.h"
+#include "dwt_counter.h"
+#include "bench.h"
+
+#define BENCH_FMT_LOOPS 100
+#define BENCH_FMT_NB_MSG 3
+
+typedef struct{
+	uint32_t cycles_snprintf[BENCH_FMT_NB_MSG];
+	uint32_t cycles_fmt[BENCH_FMT_NB_MSG];
+	uint32_t heap_snprintf;
+	uint32_t heap_fmt;
+	uint8_t same_text[BENCH_FMT_NB_MSG];
+} bench_format_result;
+
+volatile bench_format_result bench_format;
+
+extern void *_sbrk(ptrdiff_t incr);
+
+static char line_libc[64];
+static char line_fmt[64];
+
+// inputs, volatile so the compiler can't format them at build time
+static __vo int32_t in_raw = -1234;
+static __vo uint32_t in_reg = 0x4002000C;
+static __vo uint32_t in_val = 0xA5F0;
+static __vo int32_t in_mv = 3300;           // millivolts
+static __vo int32_t in_temp_q8 = -12 * 256 - 128; // -12.5 in Q8
+
+
+static void bench_msg_snprintf(int msg){
+
+	switch (msg){
+
+	case 0:
+		snprintf(line_libc, sizeof(line_libc), "adc ch=%u raw=%ld\n",
+				 3, (long)in_raw);
+		break;
+
+	case 1:
+		snprintf(line_libc, sizeof(line_libc), "reg 0x%08lX = 0x%08lX\n",
+				 (unsigned long)in_reg, (unsigned long)in_val);
+		break;
+
+	default: {
+		// no %f: it would pull _printf_float and a double conversion
+		int32_t mv = in_mv;
+		int32_t t = in_temp_q8;
+		uint32_t t_mag = (t < 0) ? -(uint32_t)t : (uint32_t)t;
+
+		snprintf(line_libc, sizeof(line_libc), "vbat=%ld.%03ld V temp=%s%lu.%02lu C\n",
+				 (long)(mv / 1000), (long)(mv % 1000), (t < 0) ? "-" : "",
+				 (unsigned long)(t_mag >> 8),
+				 (unsigned long)(((t_mag & 0xFF) * 100 + 128) >> 8));
+		break;
+	}
+
+	} /* End switch */
+
+} /* End bench_msg_snprintf() */
+
+
+static void bench_msg_fmt(int msg){
+
+	Fmt_Buffer_t f;
+
+	Fmt_Init(&f, line_fmt, sizeof(line_fmt));
+
+	switch (msg){
+
+	case 0:
+		Fmt_Str(&f, "adc ch=");
+		Fmt_Uint(&f, 3);
+		Fmt_Str(&f, " raw=");
+		Fmt_Int(&f, in_raw);
+		Fmt_Char(&f, '\n');
+		break;
+
+	case 1:
+		Fmt_Str(&f, "reg 0x");
+		Fmt_Hex(&f, in_reg, 8);
+		Fmt_Str(&f, " = 0x");
+		Fmt_Hex(&f, in_val, 8);
+		Fmt_Char(&f, '\n');
+		break;
+
+	default:
+		Fmt_Str(&f, "vbat=");
+		Fmt_Decimal(&f, in_mv, 3);
+		Fmt_Str(&f, " V temp=");
+		Fmt_Fixed(&f, in_temp_q8, 8, 2);
+		Fmt_Str(&f, " C\n");
+		break;
+
+	} /* End switch */
+
+} /* End bench_msg_fmt() */
+
+
+void bench_format_run(void){
+
+	DWT_CycleCounterInit();
+
+	// ---- heap used by the first calls ----
+	uint8_t *heap = _sbrk(0);
+
+	for (int msg = 0; msg < BENCH_FMT_NB_MSG; ++msg)
+		bench_msg_snprintf(msg);
+
+	bench_format.heap_snprintf = (uint8_t*)_sbrk(0) - heap;
+
+	heap = _sbrk(0);
+
+	for (int msg = 0; msg < BENCH_FMT_NB_MSG; ++msg)
+		bench_msg_fmt(msg);
+
+	bench_format.heap_fmt = (uint8_t*)_sbrk(0) - heap;
+
+	// ---- cycles ----
+	for (int msg = 0; msg < BENCH_FMT_NB_MSG; ++msg){
+
+		uint32_t start = DWT_GetCycles();
+
+		for (int i = 0; i < BENCH_FMT_LOOPS; ++i)
+			bench_msg_snprintf(msg);
+
+		bench_format.cycles_snprintf[msg] = (DWT_GetCycles() - start) / BENCH_FMT_LOOPS;
+
+		start = DWT_GetCycles();
+
+		for (int i = 0; i < BENCH_FMT_LOOPS; ++i)
+			bench_msg_fmt(msg);
+
+		bench_format.cycles_fmt[msg] = (DWT_GetCycles() - start) / BENCH_FMT_LOOPS;
+
+		bench_format.same_text[msg] = (strcmp(line_libc, line_fmt) == 0);
+
+	} /* End for msg */
+
+} /* End bench_format_run() */
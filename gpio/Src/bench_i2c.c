@@ -0,0 +1,209 @@
+
+/*
+ * Goal: CPU load of the I2C driver at 400 kHz vs a polling driver
+ *
+ * 	Target: CS43L22 audio DAC of the Discovery board (I2C1, address 0x4A,
+ * 	its reset pin PD4 must be high), BENCH_I2C_REGS registers read from
+ * 	0x01 (chip ID) with auto increment (bit 7 of the register address)
+ *
+ * 	1) polling: the usual blocking sequence, every flag is waited for
+ * 	   -> 100 % of the CPU during the transfer, gives the duration
+ * 	2) interrupt + DMA: BENCH_I2C_NB transactions queued at once, an
+ * 	   idle loop counts its iterations until the queue is empty
+ * 	   cpu_load_pct = 100 - 100 * loops / loops of the same idle loop
+ * 	   during the same time with nothing else running
+ *
+ * 	chip_id_ok: bits [7:3] of register 0x01 = 11100b, same data both ways
+ *
+ * Results in bench_i2c (Live Expressions)
+ *
+ * Hardware: I2C1 SCL = PB6, SDA = PB9 (AF4), CS43L22 reset = PD4
+ *
+ * */
+
+#include <string.h>
+#include "stm32f407G.h"
+#include "gpio_driver.h"
+#include "i2c_driver.h"
+#include "rcc_driver.h"
+#include "dwt_counter.h"
+#include "bench.h"
+
+#define CS43L22_ADDR      0x4A
+#define CS43L22_REG_ID    0x01
+#define CS43L22_AUTO_INC  0x80
+
+#define BENCH_I2C_REGS 16
+#define BENCH_I2C_NB   8
+
+typedef struct{
+	uint32_t cycles_polling;       // one transaction
+	uint32_t cycles_irq_dma;       // BENCH_I2C_NB transactions
+	uint32_t cpu_load_pct_polling; // 100 by construction
+	uint32_t cpu_load_pct_irq_dma;
+	uint8_t chip_id_ok;
+	uint8_t same_data;
+	uint32_t errors;
+} bench_i2c_result;
+
+volatile bench_i2c_result bench_i2c;
+
+static const uint8_t reg_start = CS43L22_AUTO_INC | CS43L22_REG_ID;
+static uint8_t regs_polled[BENCH_I2C_REGS];
+static uint8_t regs_irq[BENCH_I2C_NB][BENCH_I2C_REGS];
+
+static I2C_Transaction_t trans[BENCH_I2C_NB];
+
+I2C_Handle_t i2c1;
+
+void I2C1_EV_IRQHandler(void){
+
+	I2C_EV_IRQHandling(&i2c1);
+
+} /* End I2C1_EV_IRQHandler() */
+
+void I2C1_ER_IRQHandler(void){
+
+	I2C_ER_IRQHandling(&i2c1);
+
+} /* End I2C1_ER_IRQHandler() */
+
+void DMA1_Stream0_IRQHandler(void){
+
+	DMA_IRQHandling(&i2c1.rx_dma);
+
+} /* End DMA1_Stream0_IRQHandler() */
+
+
+#define WAIT_SR1(bit) while (!(I2C1->SR1 & (1 << (bit))))
+
+/*
+ * Baseline: blocking register read, method of section 27.3.3
+ * for N > 2 bytes (same sequence as most polling drivers)
+ * */
+static void bench_i2c_read_polling(uint8_t addr, uint8_t reg, uint8_t *pBuf, uint32_t len){
+
+	// write the register address
+	I2C1->CR1 |= (1 << I2C_CR1_START);
+	WAIT_SR1(I2C_SR1_SB);
+	I2C1->DR = addr << 1;
+	WAIT_SR1(I2C_SR1_ADDR);
+	(void)I2C1->SR2;
+	WAIT_SR1(I2C_SR1_TXE);
+	I2C1->DR = reg;
+	WAIT_SR1(I2C_SR1_BTF);
+
+	// repeated START, read
+	I2C1->CR1 |= (1 << I2C_CR1_START);
+	WAIT_SR1(I2C_SR1_SB);
+	I2C1->DR = (addr << 1) | 1;
+	WAIT_SR1(I2C_SR1_ADDR);
+	I2C1->CR1 |= (1 << I2C_CR1_ACK);
+	(void)I2C1->SR2;
+
+	uint32_t i = 0;
+
+	for (; i + 3 < len; ++i){
+		WAIT_SR1(I2C_SR1_RXNE);
+		pBuf[i] = I2C1->DR;
+	}
+
+	// 3 bytes left: N-2 in DR, N-1 in the shift register
+	WAIT_SR1(I2C_SR1_BTF);
+	I2C1->CR1 &= ~(1 << I2C_CR1_ACK);
+	pBuf[i++] = I2C1->DR;
+	WAIT_SR1(I2C_SR1_BTF);
+	I2C1->CR1 |= (1 << I2C_CR1_STOP);
+	pBuf[i++] = I2C1->DR;
+	WAIT_SR1(I2C_SR1_RXNE);
+	pBuf[i] = I2C1->DR;
+
+	while (I2C1->CR1 & (1 << I2C_CR1_STOP));
+
+} /* End bench_i2c_read_polling() */
+
+
+static uint8_t bench_i2c_done(void){
+
+	return I2C_Idle(&i2c1);
+
+} /* End bench_i2c_done() */
+
+
+void bench_i2c_run(void){
+
+	DWT_CycleCounterInit();
+	SystemCoreClockUpdate();
+
+	// CS43L22 out of reset
+	GPIO_Handle_t rst;
+
+	GPIO_PeriClockControl(GPIOD, ON);
+	rst.gpio_reg_x = GPIOD;
+	rst.gpio_pin_conf.GPIO_PinNumber = GPIO_PIN_4;
+	rst.gpio_pin_conf.GPIO_PinMode = OUT;
+	rst.gpio_pin_conf.GPIO_PinSpeed = LOW;
+	rst.gpio_pin_conf.GPIO_PinOPType = PUSH_PULL;
+	rst.gpio_pin_conf.GPIO_PinPuPdControl = NO_PULLUP;
+	GPIO_Init(&rst);
+	GPIO_WriteToOutputPin(GPIOD, GPIO_PIN_4, 1);
+
+	i2c1.pI2Cx = I2C1;
+	i2c1.I2C_Config.I2C_Speed = I2C_SPEED_400K;
+	i2c1.I2C_Config.pSCLPort = GPIOB;
+	i2c1.I2C_Config.SCLPin = GPIO_PIN_6;
+	i2c1.I2C_Config.pSDAPort = GPIOB;
+	i2c1.I2C_Config.SDAPin = GPIO_PIN_9;
+
+	if (I2C_Init(&i2c1) != DRV_OK)
+		return;
+
+	// ---- 1) polling, interrupts of the I2C off ----
+	uint32_t cr2 = I2C1->CR2;
+
+	I2C1->CR2 &= ~((1 << I2C_CR2_ITEVTEN) | (1 << I2C_CR2_ITERREN));
+
+	uint32_t start = DWT_GetCycles();
+
+	bench_i2c_read_polling(CS43L22_ADDR, reg_start, regs_polled, BENCH_I2C_REGS);
+
+	uint32_t polled = DWT_GetCycles() - start;
+
+	I2C1->CR2 = cr2;
+
+	bench_i2c.cycles_polling = polled;
+	bench_i2c.cpu_load_pct_polling = 100;
+	bench_i2c.chip_id_ok = ((regs_polled[0] >> 3) == 0x1C);
+
+	// ---- 2) interrupt + DMA ----
+	memset(trans, 0, sizeof(trans));
+
+	start = DWT_GetCycles();
+
+	for (int k = 0; k < BENCH_I2C_NB; ++k){
+		trans[k].Address = CS43L22_ADDR;
+		trans[k].pWrite = &reg_start;
+		trans[k].WriteLen = 1;
+		trans[k].pRead = regs_irq[k];
+		trans[k].ReadLen = BENCH_I2C_REGS;
+		I2C_Submit(&i2c1, &trans[k]);
+	}
+
+	uint32_t loops = bench_idle(0, bench_i2c_done);
+	uint32_t total = DWT_GetCycles() - start;
+
+	// reference: same loop, same time, no transfer
+	uint32_t ref_loops = bench_idle(total, 0);
+
+	bench_i2c.cycles_irq_dma = total;
+	bench_i2c.cpu_load_pct_irq_dma = bench_cpu_load(loops, ref_loops);
+
+	bench_i2c.same_data = 1;
+
+	for (int k = 0; k < BENCH_I2C_NB; ++k)
+		if (trans[k].Status != DRV_OK || memcmp(regs_irq[k], regs_polled, BENCH_I2C_REGS))
+			bench_i2c.same_data = 0;
+
+	bench_i2c.errors = i2c1.errors;
+
+} /* End bench_i2c_run() */
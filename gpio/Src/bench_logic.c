@@ -0,0 +1,169 @@
+
+/*
+ * Goal: the board as its own logic analyzer, timer paced DMA reads of
+ * GPIOE_IDR while the pattern generator drives the same pins
+ *
+ * 	- TIM8 + DMA2 stream 1: counting pattern 0..255 on PE8..PE15 in
+ * 	  loop at BENCH_LA_PG_RATE words/s (pattern_gen.c, the handle
+ * 	  and its IRQ handler are the ones of bench_patgen.c)
+ * 	- TIM1 + DMA2 stream 5: PE8..PE15 sampled at BENCH_LA_RATE, so
+ * 	  each value is seen BENCH_LA_RATE / BENCH_LA_PG_RATE times
+ * 	- trigger: rising edge of PE15 (value 127 -> 128), EXTI15_10,
+ * 	  BENCH_LA_POST samples after it, counted by TIM7
+ *
+ * 	Checks on the capture:
+ * 		- steps: samples where the value is neither the previous one
+ * 		  nor the previous + 1 -> must be 0 (no missed sample)
+ * 		- edge_ok: the sample at the trigger is 128 and the one before
+ * 		  is 127, after the search back of LA_FindEdge()
+ * 		- trig_shift: EXTI latency, in samples
+ * 		- raw_bytes / vcd_bytes: size of the exports (Output only
+ * 		  counts here, give it Retarget_Write() to get the files)
+ *
+ * Results in bench_logic (Live Expressions)
+ *
+ * */
+
+#include "stm32f407G.h"
+#include "gpio_driver.h"
+#include "pattern_gen.h"
+#include "logic_capture.h"
+#include "rcc_driver.h"
+#include "dwt_counter.h"
+#include "mem_sections.h"
+#include "bench.h"
+
+#define BENCH_LA_RATE     4000000U
+#define BENCH_LA_PG_RATE  1000000U
+#define BENCH_LA_LEN      4096        // samples (bytes)
+#define BENCH_LA_POST     1024
+#define BENCH_LA_FIRST    8
+
+typedef struct{
+	uint32_t sample_rate;        // real rate of TIM1
+	uint32_t pg_rate;
+	uint16_t count;
+	uint16_t pre;
+	uint16_t post;
+	uint16_t trig_shift;
+	uint32_t steps;
+	uint8_t edge_ok;
+	uint32_t raw_bytes;
+	uint32_t vcd_bytes;
+	uint32_t capture_cycles;     // LA_Arm() -> Done
+	uint32_t errors;
+} bench_logic_result;
+
+volatile bench_logic_result bench_logic;
+
+static uint8_t la_buf[BENCH_LA_LEN] __attribute__((aligned(4)));
+static uint32_t pg_words[256] __attribute__((aligned(16)));
+
+extern PatGen_Handle_t patgen;   // bench_patgen.c, with DMA2_Stream1_IRQHandler()
+
+__ccm_bss LA_Handle_t la;
+
+void TIM7_IRQHandler(void){
+
+	TIM_IRQHandling(&la.post_tim);
+
+} /* End TIM7_IRQHandler() */
+
+void EXTI15_10_IRQHandler(void){
+
+	LA_TriggerIRQHandling(&la);
+
+} /* End EXTI15_10_IRQHandler() */
+
+
+static uint32_t bench_la_count(const uint8_t *pData, uint32_t Len){
+
+	(void)pData;
+
+	return Len;
+
+} /* End bench_la_count() */
+
+
+void bench_logic_run(void){
+
+	DWT_CycleCounterInit();
+	SystemCoreClockUpdate();
+
+	// ---- pattern ----
+	for (uint32_t i = 0; i < 256; ++i)
+		pg_words[i] = PatGen_Word(i, 8, BENCH_LA_FIRST);
+
+	patgen.pTIMx = TIM8;
+	patgen.pGPIOx = GPIOE;
+	patgen.Rate = BENCH_LA_PG_RATE;
+	patgen.Loop = ON;
+	patgen.StopWord = PatGen_Word(0, 8, BENCH_LA_FIRST);
+	patgen.Done = 0;
+
+	PatGen_PinsInit(&patgen, BENCH_LA_FIRST, 8);
+
+	if (PatGen_Init(&patgen) != DRV_OK)
+		return;
+
+	bench_logic.pg_rate = patgen.RealRate;
+
+	// ---- capture ----
+	la.pTIMx = TIM1;
+	la.pPostTIMx = TIM7;
+	la.pGPIOx = GPIOE;
+	la.FirstPin = BENCH_LA_FIRST;
+	la.Width = 8;
+	la.SampleRate = BENCH_LA_RATE;
+	la.pBuffer = la_buf;
+	la.BufferLen = BENCH_LA_LEN;
+	la.PostSamples = BENCH_LA_POST;
+	la.pTrigPort = GPIOE;
+	la.TrigPin = GPIO_PIN_15;
+	la.TrigEdge = INT_RISING_EDGE;
+	la.Done = 0;
+
+	if (LA_Init(&la) != DRV_OK)
+		return;
+
+	bench_logic.sample_rate = la.RealRate;
+
+	PatGen_Start(&patgen, pg_words, 256);
+
+	uint32_t start = DWT_GetCycles();
+
+	LA_Arm(&la);
+
+	while (la.state != LA_DONE);
+
+	bench_logic.capture_cycles = DWT_GetCycles() - start;
+
+	PatGen_Stop(&patgen);
+
+	// ---- checks ----
+	uint32_t steps = 0;
+
+	for (uint16_t i = 1; i < la.count; ++i){
+
+		uint8_t prev = LA_GetSample(&la, i - 1);
+		uint8_t cur = LA_GetSample(&la, i);
+
+		if (cur != prev && cur != (uint8_t)(prev + 1))
+			steps++;
+
+	}
+
+	bench_logic.count = la.count;
+	bench_logic.pre = la.trigger;
+	bench_logic.post = la.count - la.trigger;
+	bench_logic.trig_shift = la.trig_shift;
+	bench_logic.steps = steps;
+	bench_logic.edge_ok = (la.trigger > 0) &&
+						  (LA_GetSample(&la, la.trigger) == 128) &&
+						  (LA_GetSample(&la, la.trigger - 1) == 127);
+
+	bench_logic.raw_bytes = LA_ExportRaw(&la, bench_la_count);
+	bench_logic.vcd_bytes = LA_ExportVCD(&la, bench_la_count);
+	bench_logic.errors = la.errors + patgen.errors;
+
+} /* End bench_logic_run() */
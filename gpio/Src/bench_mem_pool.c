@@ -0,0 +1,237 @@
+/*
+ * Goal: malloc() vs the fixed size pools of mem_pool.h
+ *
+ * 	1) Time: BENCH_MP_STEPS steps over BENCH_MP_LIVE slots, each step
+ * 	   frees one slot (pseudo random) and allocates it again with a
+ * 	   random size of 8..BENCH_MP_MAX bytes. Same sequence with
+ * 	   malloc() / free() and with Mem_Alloc() / Mem_Free(): min / max
+ * 	   cycles of each call. The heap gets fragmented, the max of
+ * 	   malloc() grows with it, the pools stay flat
+ * 	2) ISR safety: TIM6 at BENCH_MP_IRQ_HZ allocates and frees blocks
+ * 	   of the 32 bytes class in its ISR while the main loop does the
+ * 	   same: each owner fills its block with a pattern and checks it
+ * 	   before the free. corrupted must be 0, used back to 0 at the end
+ *
+ * Results in bench_mem_pool (Live Expressions)
+ *
+ * */
+
+#include <stdlib.h>
+#include "stm32f407G.h"
+#include "mem_pool.h"
+#include "timer_driver.h"
+#include "rcc_driver.h"
+#include "dwt_counter.h"
+#include "bench.h"
+
+#define BENCH_MP_STEPS    2000
+#define BENCH_MP_LIVE     8
+#define BENCH_MP_MAX      500
+#define BENCH_MP_IRQ_HZ   20000
+#define BENCH_MP_LOOPS    100000
+
+typedef struct{
+	bench_stat malloc_alloc;
+	bench_stat malloc_free;
+	bench_stat pool_alloc;
+	bench_stat pool_free;
+	uint32_t malloc_failed;
+	uint32_t pool_failed;
+	uint32_t isr_allocs;
+	uint32_t main_allocs;
+	uint32_t corrupted;          // pattern changed while owned
+	uint32_t used[MEM_NB_CLASSES];
+	uint32_t peak[MEM_NB_CLASSES];
+	uint32_t exhausted[MEM_NB_CLASSES];
+	uint32_t errors;
+} bench_mem_pool_result;
+
+volatile bench_mem_pool_result bench_mem_pool;
+
+static TIM_Handle_t mp_tim;
+static uint32_t mp_seed;
+
+void TIM6_DAC_IRQHandler(void){
+
+	TIM_IRQHandling(&mp_tim);
+
+} /* End TIM6_DAC_IRQHandler() */
+
+
+static uint32_t bench_mp_rand(void){
+
+	mp_seed = mp_seed * 1664525U + 1013904223U;
+
+	return mp_seed >> 8;
+
+} /* End bench_mp_rand() */
+
+
+// Fill with a pattern of the owner, check it is intact before the free
+static void bench_mp_fill(uint32_t *pBlock, uint32_t Tag){
+
+	for (int i = 0; i < 8; ++i)
+		pBlock[i] = Tag ^ i;
+
+} /* End bench_mp_fill() */
+
+static uint8_t bench_mp_check(const uint32_t *pBlock, uint32_t Tag){
+
+	for (int i = 0; i < 8; ++i){
+		if (pBlock[i] != (Tag ^ i))
+			return 0;
+	}
+
+	return 1;
+
+} /* End bench_mp_check() */
+
+
+static void bench_mp_isr(TIM_Handle_t *pTIMHandle){
+
+	uint32_t *pA = Mem_Alloc(32);
+	uint32_t *pB = Mem_Alloc(32);
+
+	if (pA)
+		bench_mp_fill(pA, 0x15A00000U);
+	if (pB)
+		bench_mp_fill(pB, 0x15B00000U);
+
+	if (pA && !bench_mp_check(pA, 0x15A00000U))
+		bench_mem_pool.corrupted++;
+	if (pB && !bench_mp_check(pB, 0x15B00000U))
+		bench_mem_pool.corrupted++;
+
+	if (pA){
+		Mem_Free(pA);
+		bench_mem_pool.isr_allocs++;
+	}
+
+	if (pB){
+		Mem_Free(pB);
+		bench_mem_pool.isr_allocs++;
+	}
+
+} /* End bench_mp_isr() */
+
+
+static void bench_mp_time(uint8_t UsePool){
+
+	void *slots[BENCH_MP_LIVE] = {0};
+
+	volatile bench_stat *pAlloc = UsePool ? &bench_mem_pool.pool_alloc : &bench_mem_pool.malloc_alloc;
+	volatile bench_stat *pFree = UsePool ? &bench_mem_pool.pool_free : &bench_mem_pool.malloc_free;
+
+	bench_stat_reset(pAlloc);
+	bench_stat_reset(pFree);
+
+	mp_seed = 12345;
+
+	for (uint32_t n = 0; n < BENCH_MP_STEPS; ++n){
+
+		uint32_t s = bench_mp_rand() % BENCH_MP_LIVE;
+		uint32_t size = 8 + bench_mp_rand() % (BENCH_MP_MAX - 8);
+		uint32_t start;
+
+		if (slots[s]){
+
+			start = DWT_GetCycles();
+
+			if (UsePool)
+				Mem_Free(slots[s]);
+			else
+				free(slots[s]);
+
+			bench_stat_add(pFree, DWT_GetCycles() - start);
+
+		}
+
+		start = DWT_GetCycles();
+		slots[s] = UsePool ? Mem_Alloc(size) : malloc(size);
+		bench_stat_add(pAlloc, DWT_GetCycles() - start);
+
+		if (slots[s] == 0){
+			if (UsePool)
+				bench_mem_pool.pool_failed++;
+			else
+				bench_mem_pool.malloc_failed++;
+		}
+
+	}
+
+	for (uint32_t s = 0; s < BENCH_MP_LIVE; ++s){
+
+		if (slots[s] == 0)
+			continue;
+
+		if (UsePool)
+			Mem_Free(slots[s]);
+		else
+			free(slots[s]);
+
+	}
+
+} /* End bench_mp_time() */
+
+
+void bench_mem_pool_run(void){
+
+	DWT_CycleCounterInit();
+	SystemCoreClockUpdate();
+
+	if (Mem_Init() != DRV_OK){
+		bench_mem_pool.errors++;
+		return;
+	}
+
+	// 1) Time
+	bench_mp_time(0);
+	bench_mp_time(1);
+
+	// 2) ISR safety
+	mp_tim.pTIMx = TIM6;
+	mp_tim.TIM_Config.TIM_Frequency = BENCH_MP_IRQ_HZ;
+	mp_tim.TIM_Config.TIM_OnePulse = OFF;
+	mp_tim.TIM_Config.TIM_UpdateIT = ON;
+	mp_tim.Callback = bench_mp_isr;
+
+	if (TIM_Init(&mp_tim) != DRV_OK){
+		bench_mem_pool.errors++;
+		return;
+	}
+
+	TIM_Start(&mp_tim);
+
+	for (uint32_t n = 0; n < BENCH_MP_LOOPS; ++n){
+
+		uint32_t *pBlock = Mem_Alloc(32);
+
+		if (pBlock == 0)
+			continue;
+
+		bench_mp_fill(pBlock, n);
+
+		if (!bench_mp_check(pBlock, n))
+			bench_mem_pool.corrupted++;
+
+		Mem_Free(pBlock);
+		bench_mem_pool.main_allocs++;
+
+	}
+
+	TIM_Stop(&mp_tim);
+
+	for (uint8_t c = 0; c < MEM_NB_CLASSES; ++c){
+
+		const MemPool_t *pPool = Mem_GetPool(c);
+
+		bench_mem_pool.used[c] = pPool->used;
+		bench_mem_pool.peak[c] = pPool->peak;
+		bench_mem_pool.exhausted[c] = pPool->exhausted;
+
+		if (pPool->used || pPool->bad_frees)
+			bench_mem_pool.errors++;
+
+	}
+
+} /* End bench_mem_pool_run() */
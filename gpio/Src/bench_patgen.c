@@ -0,0 +1,127 @@
+
+/*
+ * Goal: output rate of a parallel bus, CPU loops vs timer paced DMA
+ *
+ * 	8 bits bus on PE8..PE15 (free pins on the Discovery board),
+ * 	BENCH_PG_WORDS words of a counting pattern:
+ *
+ * 	1) CPU, GPIO_WriteToOutputPort(): read-modify-write of ODR to keep
+ * 	   PE0..PE7 (the function writes the whole port)
+ * 	2) CPU, precomputed BSRR words stored in a loop: the best a CPU
+ * 	   loop can do, with 100 % of the CPU
+ * 	3) DMA to BSRR paced by TIM8, one shot, for each rate of
+ * 	   bench_pg_rates[]: words_per_s measured from Start() to Done,
+ * 	   it follows the asked rate until the DMA saturates
+ *
+ * 	A logic analyzer on PE8..PE15 shows the pattern (PulseView, see
+ * 	the notes at the end of main_gpio.c)
+ *
+ * Results in bench_patgen (Live Expressions)
+ *
+ * */
+
+#include "stm32f407G.h"
+#include "gpio_driver.h"
+#include "pattern_gen.h"
+#include "rcc_driver.h"
+#include "dwt_counter.h"
+#include "mem_sections.h"
+#include "bench.h"
+
+#define BENCH_PG_WORDS  1024
+#define BENCH_PG_FIRST  8
+#define BENCH_PG_NB_RATES 5
+
+typedef struct{
+	uint32_t cpu_odr_words_per_s;
+	uint32_t cpu_bsrr_words_per_s;
+	uint32_t asked_rate[BENCH_PG_NB_RATES];
+	uint32_t real_rate[BENCH_PG_NB_RATES];       // timer, after rounding
+	uint32_t dma_words_per_s[BENCH_PG_NB_RATES]; // measured
+	uint32_t errors;
+} bench_patgen_result;
+
+volatile bench_patgen_result bench_patgen;
+
+static const uint32_t bench_pg_rates[BENCH_PG_NB_RATES] =
+	{500000, 1000000, 2000000, 4000000, 8000000};
+
+static uint8_t pattern[BENCH_PG_WORDS];
+static uint32_t words[BENCH_PG_WORDS] __attribute__((aligned(16)));
+
+__ccm_bss PatGen_Handle_t patgen;
+
+void DMA2_Stream1_IRQHandler(void){
+
+	DMA_IRQHandling(&patgen.dma);
+
+} /* End DMA2_Stream1_IRQHandler() */
+
+
+static uint32_t bench_pg_rate(uint32_t cycles){
+
+	return (uint32_t)((uint64_t)BENCH_PG_WORDS * SystemCoreClock / cycles);
+
+} /* End bench_pg_rate() */
+
+
+void bench_patgen_run(void){
+
+	DWT_CycleCounterInit();
+	SystemCoreClockUpdate();
+
+	for (int i = 0; i < BENCH_PG_WORDS; ++i)
+		pattern[i] = (uint8_t)i;
+
+	PatGen_Encode(pattern, BENCH_PG_WORDS, 8, BENCH_PG_FIRST, words);
+
+	patgen.pTIMx = TIM8;
+	patgen.pGPIOx = GPIOE;
+	patgen.Loop = OFF;
+	patgen.StopWord = PatGen_Word(0, 8, BENCH_PG_FIRST);
+	patgen.Done = 0;
+
+	PatGen_PinsInit(&patgen, BENCH_PG_FIRST, 8);
+
+	// ---- 1) CPU, ODR ----
+	uint32_t start = DWT_GetCycles();
+
+	for (int i = 0; i < BENCH_PG_WORDS; ++i){
+		uint16_t odr = GPIOE->ODR & 0x00FF;
+		GPIO_WriteToOutputPort(GPIOE, odr | ((uint16_t)pattern[i] << BENCH_PG_FIRST));
+	}
+
+	bench_patgen.cpu_odr_words_per_s = bench_pg_rate(DWT_GetCycles() - start);
+
+	// ---- 2) CPU, BSRR words ----
+	start = DWT_GetCycles();
+
+	for (int i = 0; i < BENCH_PG_WORDS; ++i)
+		GPIOE->BSRR = words[i];
+
+	bench_patgen.cpu_bsrr_words_per_s = bench_pg_rate(DWT_GetCycles() - start);
+
+	// ---- 3) DMA, one shot per rate ----
+	for (int r = 0; r < BENCH_PG_NB_RATES; ++r){
+
+		patgen.Rate = bench_pg_rates[r];
+		bench_patgen.asked_rate[r] = bench_pg_rates[r];
+
+		if (PatGen_Init(&patgen) != DRV_OK)
+			continue;   // rate above the timer clock / 2
+
+		bench_patgen.real_rate[r] = patgen.RealRate;
+
+		start = DWT_GetCycles();
+
+		PatGen_Start(&patgen, words, BENCH_PG_WORDS);
+
+		while (patgen.running);
+
+		bench_patgen.dma_words_per_s[r] = bench_pg_rate(DWT_GetCycles() - start);
+
+	} /* End for rates */
+
+	bench_patgen.errors = patgen.errors;
+
+} /* End bench_patgen_run() */
@@ -0,0 +1,174 @@
+/*
+ * Goal: wake latency of the low-power modes (power.h), and the clock
+ * back as it was (168 MHz on the PLL) after each STOP
+ *
+ * 	1) RTC wake up after BENCH_PWR_MS for SLEEP, STOP and STOP_LP:
+ * 	   clock_ok when SystemCoreClock and RCC_CFGR are back, restore_us
+ * 	   from PWR_GetLatency() (HSE start + PLL lock)
+ * 	2) EXTI wake up: user button (PA0, GPIO_Init() INT_RISING_EDGE)
+ * 	   in STOP, BENCH_PWR_BUTTON_MS of RTC as timeout. button_woke = 1
+ * 	   if the press came first (green LED on while waiting)
+ * 	3) PWR_ChooseMode() for a few deadlines, with the measured times
+ * 	4) BENCH_PWR_STANDBY = 1: STANDBY, woken by the RTC, the board
+ * 	   restarts; at the next run from_standby = 1 and
+ * 	   standby_restore_us is the reset to main() time
+ *
+ * 	The debugger can lose the connection in STOP: connect again after
+ * 	the run, the results stay in RAM
+ *
+ * Results in bench_power (Live Expressions)
+ *
+ * */
+
+#include "stm32f407G.h"
+#include "gpio_driver.h"
+#include "nvic_driver.h"
+#include "power.h"
+#include "rcc_driver.h"
+#include "dwt_counter.h"
+#include "bench.h"
+
+#define BENCH_PWR_MS         100
+#define BENCH_PWR_BUTTON_MS  5000
+#define BENCH_PWR_STANDBY    0
+
+static const uint32_t bench_pwr_deadlines[] = {10, 100, 5000, 10000};
+
+#define BENCH_PWR_NB_DEADLINES (sizeof(bench_pwr_deadlines) / sizeof(bench_pwr_deadlines[0]))
+
+typedef struct{
+	uint8_t clock_ok[PWR_MODE_STANDBY];
+	uint32_t restore_us[PWR_MODE_STANDBY];
+	uint32_t total_us[PWR_MODE_STANDBY];   // wakeup_us + restore_us
+	uint32_t rtc_wakeups;
+	uint8_t button_woke;
+	uint8_t chosen[BENCH_PWR_NB_DEADLINES];
+	uint8_t from_standby;
+	uint32_t standby_restore_us;
+	uint32_t errors;
+} bench_power_result;
+
+volatile bench_power_result bench_power;
+
+static volatile uint8_t pwr_button;
+
+
+void RTC_WKUP_IRQHandler(void){
+
+	PWR_RTCWakeupIRQHandling();
+	bench_power.rtc_wakeups++;
+
+} /* End RTC_WKUP_IRQHandler() */
+
+
+static void bench_pwr_button_cb(uint8_t PinNumber, void *pContext){
+
+	pwr_button = 1;
+
+} /* End bench_pwr_button_cb() */
+
+
+static void bench_pwr_rtc(uint8_t Mode){
+
+	uint32_t hclk = SystemCoreClock;
+	uint32_t cfgr = RCC->CFGR;
+
+	if (PWR_RTCWakeupStart(BENCH_PWR_MS) != DRV_OK){
+		bench_power.errors++;
+		return;
+	}
+
+	if (PWR_Enter(Mode) != DRV_OK)
+		bench_power.errors++;
+
+	PWR_RTCWakeupStop();
+
+	const PWR_Latency_t *pLat = PWR_GetLatency(Mode);
+
+	bench_power.clock_ok[Mode] = (SystemCoreClock == hclk) && (RCC->CFGR == cfgr);
+	bench_power.restore_us[Mode] = pLat->restore_us;
+	bench_power.total_us[Mode] = pLat->wakeup_us + pLat->restore_us;
+
+} /* End bench_pwr_rtc() */
+
+
+static void bench_pwr_button(void){
+
+	GPIO_Handle_t button, led;
+
+	button.gpio_reg_x = GPIOA;
+	button.gpio_pin_conf.GPIO_PinNumber = GPIO_PIN_0;
+	button.gpio_pin_conf.GPIO_PinMode = INT_RISING_EDGE;
+	button.gpio_pin_conf.GPIO_PinSpeed = LOW;
+	button.gpio_pin_conf.GPIO_PinPuPdControl = NO_PULLUP;   // external pull-down
+
+	led.gpio_reg_x = GPIOD;
+	led.gpio_pin_conf.GPIO_PinNumber = GPIO_PIN_12;
+	led.gpio_pin_conf.GPIO_PinMode = OUT;
+	led.gpio_pin_conf.GPIO_PinSpeed = LOW;
+	led.gpio_pin_conf.GPIO_PinOPType = PUSH_PULL;
+	led.gpio_pin_conf.GPIO_PinPuPdControl = NO_PULLUP;
+
+	GPIO_PeriClockControl(GPIOA, ON);
+	GPIO_PeriClockControl(GPIOD, ON);
+	GPIO_Init(&button);
+	GPIO_Init(&led);
+
+	// handler in bench_ramfunc.c, it calls the dispatcher
+	GPIO_EXTIRegister(GPIO_PIN_0, bench_pwr_button_cb, 0);
+	EXTI->PR = GPIO_EXTI_LINE_0;
+	NVIC_IRQInterruptConfig(IRQ_NO_EXTI0, ON);
+
+	pwr_button = 0;
+	GPIO_WriteToOutputPin(GPIOD, GPIO_PIN_12, 1);
+
+	if (PWR_RTCWakeupStart(BENCH_PWR_BUTTON_MS) != DRV_OK)
+		bench_power.errors++;
+
+	if (PWR_Enter(PWR_MODE_STOP) != DRV_OK)
+		bench_power.errors++;
+
+	PWR_RTCWakeupStop();
+
+	GPIO_WriteToOutputPin(GPIOD, GPIO_PIN_12, 0);
+	NVIC_IRQInterruptConfig(IRQ_NO_EXTI0, OFF);
+
+	bench_power.button_woke = pwr_button;
+
+} /* End bench_pwr_button() */
+
+
+void bench_power_run(void){
+
+	DWT_CycleCounterInit();
+	SystemCoreClockUpdate();
+
+	bench_power.from_standby = PWR_StandbyReset();
+
+	if (bench_power.from_standby)
+		bench_power.standby_restore_us = PWR_GetLatency(PWR_MODE_STANDBY)->restore_us;
+
+	if (PWR_RTCWakeupInit() != DRV_OK){
+		bench_power.errors++;
+		return;
+	}
+
+	// 1) RTC wake up
+	bench_pwr_rtc(PWR_MODE_SLEEP);
+	bench_pwr_rtc(PWR_MODE_STOP);
+	bench_pwr_rtc(PWR_MODE_STOP_LP);
+
+	// 2) EXTI wake up
+	bench_pwr_button();
+
+	// 3) Mode per deadline
+	for (uint32_t i = 0; i < BENCH_PWR_NB_DEADLINES; ++i)
+		bench_power.chosen[i] = PWR_ChooseMode(bench_pwr_deadlines[i], 1);
+
+	// 4) STANDBY, once
+#if (BENCH_PWR_STANDBY == 1)
+	if (!bench_power.from_standby && PWR_RTCWakeupStart(BENCH_PWR_MS) == DRV_OK)
+		PWR_Enter(PWR_MODE_STANDBY);
+#endif
+
+} /* End bench_power_run() */
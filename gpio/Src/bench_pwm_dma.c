@@ -0,0 +1,200 @@
+
+/*
+ * Goal: PWM duty cycles streamed by the DMA, no CPU per period / per bit
+ *
+ * 	1) waveform: TIM1 CH1 (PE9) at BENCH_WAVE_PWM_HZ, a 64 points sine
+ * 	   table played in a loop (TIM_DMA_CONTINUOUS), with a RC low pass
+ * 	   on PE9 (1 kOhm, 10 nF) the sine is seen on a scope at
+ * 	   BENCH_WAVE_PWM_HZ / 64. wave_frames: loops of the table
+ * 	2) WS2812 strip of BENCH_WS_LEDS LEDs on TIM3 CH1 (PB4), double
+ * 	   buffer: a rainbow moves by one LED per frame, the main loop
+ * 	   encodes the next frame in the buffer given back by FrameDone
+ * 		- encode_cycles: CPU cost of one frame (once per frame)
+ * 		- frames_per_s: ~ 800000 / FrameLen
+ * 	   cpu_load_pct of both together, idle loop as in the other
+ * 	   benchmarks (only the encoding and the ISRs take CPU)
+ *
+ * Results in bench_pwm_dma (Live Expressions)
+ *
+ * Hardware: PE9 (TIM1 CH1, AF1), PB4 (TIM3 CH1, AF2) -> DIN of the strip
+ *
+ * */
+
+#include "stm32f407G.h"
+#include "gpio_driver.h"
+#include "timer_driver.h"
+#include "ws2812.h"
+#include "rcc_driver.h"
+#include "dwt_counter.h"
+#include "bench.h"
+
+#define BENCH_WAVE_PWM_HZ 100000
+#define BENCH_WAVE_POINTS 64
+#define BENCH_WS_LEDS     30
+#define BENCH_PWM_TIME    16000000U
+
+typedef struct{
+	uint32_t wave_pwm_steps;     // ARR + 1 of TIM1
+	uint32_t wave_frames;
+	uint16_t ws_t0h;
+	uint16_t ws_t1h;
+	uint32_t ws_frames;
+	uint32_t frames_per_s;
+	uint32_t encode_cycles;
+	uint32_t cpu_load_pct;
+	uint32_t dma_errors;
+} bench_pwm_dma_result;
+
+volatile bench_pwm_dma_result bench_pwm_dma;
+
+// sin(), 0..1000, scaled to the timer period at run time
+static const uint16_t sine_permil[BENCH_WAVE_POINTS] = {
+	 500,  549,  598,  645,  691,  736,  778,  817,
+	 854,  887,  916,  941,  962,  978,  990,  998,
+	1000,  998,  990,  978,  962,  941,  916,  887,
+	 854,  817,  778,  736,  691,  645,  598,  549,
+	 500,  451,  402,  355,  309,  264,  222,  183,
+	 146,  113,   84,   59,   38,   22,   10,    2,
+	   0,    2,   10,   22,   38,   59,   84,  113,
+	 146,  183,  222,  264,  309,  355,  402,  451,
+};
+
+static uint16_t wave[BENCH_WAVE_POINTS];
+
+static uint16_t ws_frame[2][WS2812_FRAME_LEN(BENCH_WS_LEDS)];
+static uint8_t ws_rgb[BENCH_WS_LEDS * 3];
+
+static const uint16_t *__vo ws_free;   // frame to refill, set by FrameDone
+
+TIM_Handle_t tim1;
+TIM_Handle_t tim3;
+WS2812_Handle_t strip;
+
+void DMA2_Stream5_IRQHandler(void){
+
+	DMA_IRQHandling(&tim1.dma);
+
+} /* End DMA2_Stream5_IRQHandler() */
+
+void DMA1_Stream2_IRQHandler(void){
+
+	DMA_IRQHandling(&tim3.dma);
+
+} /* End DMA1_Stream2_IRQHandler() */
+
+
+static void bench_ws_done(TIM_Handle_t *pTIMHandle, const uint16_t *pFrame){
+
+	ws_free = pFrame;
+
+} /* End bench_ws_done() */
+
+
+// Rainbow: hue moving with the frame number, 1/8 brightness
+static void bench_ws_colors(uint32_t shift){
+
+	for (int i = 0; i < BENCH_WS_LEDS; ++i){
+
+		uint32_t h = ((i + shift) * 768 / BENCH_WS_LEDS) % 768;
+		uint8_t r, g, b;
+		uint8_t x = h & 0xFF;
+
+		if (h < 256)      { r = 255 - x; g = x;       b = 0; }
+		else if (h < 512) { r = 0;       g = 255 - x; b = x; }
+		else              { r = x;       g = 0;       b = 255 - x; }
+
+		ws_rgb[3 * i]     = r >> 3;
+		ws_rgb[3 * i + 1] = g >> 3;
+		ws_rgb[3 * i + 2] = b >> 3;
+
+	} /* End for LEDs */
+
+} /* End bench_ws_colors() */
+
+
+void bench_pwm_dma_run(void){
+
+	DWT_CycleCounterInit();
+	SystemCoreClockUpdate();
+
+	// ---- reference idle loop, nothing running ----
+	uint32_t loops = 0;
+	uint32_t ref_loops = bench_idle(BENCH_PWM_TIME, 0);
+
+	// ---- 1) sine on TIM1 CH1 ----
+	tim1.pTIMx = TIM1;
+	tim1.TIM_Config.TIM_Frequency = BENCH_WAVE_PWM_HZ;
+	tim1.TIM_Config.TIM_OnePulse = OFF;
+	tim1.TIM_Config.TIM_UpdateIT = OFF;
+
+	if (TIM_Init(&tim1) != DRV_OK ||
+		TIM_PWMInit(&tim1, 1, TIM_PWM_MODE1, TIM_POL_HIGH, GPIOE, GPIO_PIN_9) != DRV_OK ||
+		TIM_DMAInit(&tim1, 1, TIM_DMA_CONTINUOUS) != DRV_OK)
+		return;
+
+	uint32_t period = TIM1->ARR + 1;
+
+	for (int i = 0; i < BENCH_WAVE_POINTS; ++i)
+		wave[i] = (uint16_t)(sine_permil[i] * period / 1000);
+
+	bench_pwm_dma.wave_pwm_steps = period;
+
+	TIM_Start(&tim1);
+	TIM_DMAStart(&tim1, wave, 0, BENCH_WAVE_POINTS);
+
+	// ---- 2) WS2812 strip, double buffer ----
+	strip.pTIMHandle = &tim3;
+	tim3.pTIMx = TIM3;
+	tim3.FrameDone = bench_ws_done;
+	strip.Channel = 1;
+	strip.pGPIOx = GPIOB;
+	strip.PinNumber = GPIO_PIN_4;
+	strip.NbLeds = BENCH_WS_LEDS;
+	strip.Mode = TIM_DMA_DOUBLE;
+
+	if (WS2812_Init(&strip) != DRV_OK)
+		return;
+
+	bench_pwm_dma.ws_t0h = strip.T0H;
+	bench_pwm_dma.ws_t1h = strip.T1H;
+
+	uint32_t shift = 0;
+
+	for (int k = 0; k < 2; ++k){
+		bench_ws_colors(shift++);
+		WS2812_Encode(&strip, ws_rgb, ws_frame[k]);
+	}
+
+	ws_free = 0;
+	WS2812_Stream(&strip, ws_frame[0], ws_frame[1]);
+
+	// ---- idle loop, the frames are refilled in between ----
+	uint32_t start = DWT_GetCycles();
+
+	while ((DWT_GetCycles() - start) < BENCH_PWM_TIME){
+
+		if (ws_free){
+
+			uint16_t *pFrame = (uint16_t*)ws_free;
+			uint32_t t = DWT_GetCycles();
+
+			ws_free = 0;
+			bench_ws_colors(shift++);
+			WS2812_Encode(&strip, ws_rgb, pFrame);
+
+			bench_pwm_dma.encode_cycles = DWT_GetCycles() - t;
+
+		} /* End if frame to refill */
+
+		loops++;
+
+	} /* End while */
+
+	bench_pwm_dma.wave_frames = tim1.frames;
+	bench_pwm_dma.ws_frames = tim3.frames;
+	bench_pwm_dma.frames_per_s =
+		(uint32_t)((uint64_t)tim3.frames * SystemCoreClock / BENCH_PWM_TIME);
+	bench_pwm_dma.dma_errors = tim1.dma_errors + tim3.dma_errors;
+	bench_pwm_dma.cpu_load_pct = bench_cpu_load(loops, ref_loops);
+
+} /* End bench_pwm_dma_run() */
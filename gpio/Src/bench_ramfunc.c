@@ -0,0 +1,249 @@
+
+/*
+ * Goal: jitter of code run from flash vs from SRAM (__ramfunc)
+ *
+ * 	At 168 MHz (5 wait states) the ART cache makes a flash function
+ * 	fast when it ran just before, slow when other code evicted it.
+ * 	Each case below runs BENCH_RF_RUNS times, the ART caches being
+ * 	reset (ICRST / DCRST, section 3.5.2) before one run out of two:
+ * 	the cold runs stand for an ISR coming after a long other work
+ *
+ * 		- loop: CRC-8 of 16 bytes, PD13 written per byte, same body
+ * 		  compiled once in flash and once as a __ramfunc
+ * 		- toggle: GPIO_ToggleOutputPin() (flash, ODR read-modify-write)
+ * 		  vs GPIO_FastToggle() (SRAM, BSRR)
+ * 		- exti: EXTI0 raised by software (SWIER) -> callback of
+ * 		  GPIO_EXTIDispatch(), handler, dispatcher and callback in SRAM
+ *
+ * 	For each: min / max cycles and jitter = max - min. Expected: the
+ * 	flash min is the lowest (I-bus + warm ART), the SRAM jitter is
+ * 	the lowest (the code is always fetched the same way)
+ *
+ * Results in bench_ramfunc (Live Expressions)
+ *
+ * */
+
+#include "stm32f407G.h"
+#include "gpio_driver.h"
+#include "nvic_driver.h"
+#include "mem_sections.h"
+#include "rcc_driver.h"
+#include "dwt_counter.h"
+#include "bench.h"
+
+#define BENCH_RF_RUNS   64
+#define BENCH_RF_LEN    16
+
+typedef struct{
+	bench_stat loop_flash;
+	bench_stat loop_ram;
+	bench_stat toggle_flash;
+	bench_stat toggle_ram;
+	bench_stat exti_ram;         // SWIER write -> callback
+
+	// max - min of each case above, written once all are measured
+	uint32_t jitter_loop_flash;
+	uint32_t jitter_loop_ram;
+	uint32_t jitter_toggle_flash;
+	uint32_t jitter_toggle_ram;
+	uint32_t jitter_exti_ram;
+
+	uint32_t ramfunc_bytes;      // size of .ramfunc
+	uint8_t crc_ok;              // both loops give the same CRC
+} bench_ramfunc_result;
+
+volatile bench_ramfunc_result bench_ramfunc;
+
+// linker script, .ramfunc
+extern uint32_t _sramfunc;
+extern uint32_t _eramfunc;
+
+static const uint8_t rf_data[BENCH_RF_LEN] = {
+	0x31, 0x32, 0x33, 0x34, 0x35, 0x36, 0x37, 0x38,
+	0x39, 0xA5, 0x5A, 0xFF, 0x00, 0x12, 0x80, 0x7E
+};
+
+static __ccm_bss volatile uint32_t rf_irq_stamp;
+static __ccm_bss volatile uint8_t rf_irq_done;
+
+typedef uint32_t (*bench_rf_fn)(const uint8_t *pData, uint32_t Len);
+
+
+// Same code for both copies, the attribute only changes the section
+static inline __attribute__((always_inline))
+uint32_t bench_rf_body(const uint8_t *pData, uint32_t Len){
+
+	uint32_t crc = 0xFF;
+
+	for (uint32_t i = 0; i < Len; ++i){
+
+		crc ^= pData[i];
+
+		for (int b = 0; b < 8; ++b)
+			crc = (crc & 0x80) ? ((crc << 1) ^ 0x07) & 0xFF : (crc << 1) & 0xFF;
+
+		GPIOD->BSRR = (crc & 1) ? (1 << 13) : (1 << (13 + 16));
+	}
+
+	return crc;
+
+} /* End bench_rf_body() */
+
+
+static __attribute__((noinline)) uint32_t bench_rf_loop_flash(const uint8_t *pData, uint32_t Len){
+
+	return bench_rf_body(pData, Len);
+
+} /* End bench_rf_loop_flash() */
+
+
+static __ramfunc uint32_t bench_rf_loop_ram(const uint8_t *pData, uint32_t Len){
+
+	return bench_rf_body(pData, Len);
+
+} /* End bench_rf_loop_ram() */
+
+
+static __attribute__((noinline)) uint32_t bench_rf_toggle_flash(const uint8_t *pData, uint32_t Len){
+
+	GPIO_ToggleOutputPin(GPIOD, GPIO_PIN_13);
+
+	return 0;
+
+} /* End bench_rf_toggle_flash() */
+
+
+static __ramfunc uint32_t bench_rf_toggle_ram(const uint8_t *pData, uint32_t Len){
+
+	GPIO_FastToggle(GPIOD, (1 << GPIO_PIN_13));
+
+	return 0;
+
+} /* End bench_rf_toggle_ram() */
+
+
+static __ramfunc void bench_rf_exti_cb(uint8_t PinNumber, void *pContext){
+
+	rf_irq_stamp = DWT->CYCCNT;
+	rf_irq_done = 1;
+
+} /* End bench_rf_exti_cb() */
+
+
+__ramfunc void EXTI0_IRQHandler(void){
+
+	GPIO_EXTIDispatch(GPIO_EXTI_LINE_0);
+
+} /* End EXTI0_IRQHandler() */
+
+
+/*
+ * Reset of the ART instruction and data caches: only possible with the
+ * caches off (ICRST / DCRST are ignored while ICEN / DCEN are set)
+ * */
+static void bench_rf_art_flush(void){
+
+	uint32_t acr = FLASH->ACR;
+
+	FLASH->ACR = acr & ~((1 << FLASH_ACR_ICEN) | (1 << FLASH_ACR_DCEN));
+	FLASH->ACR |= (1 << FLASH_ACR_ICRST) | (1 << FLASH_ACR_DCRST);
+	FLASH->ACR &= ~((1 << FLASH_ACR_ICRST) | (1 << FLASH_ACR_DCRST));
+	FLASH->ACR = acr;
+
+} /* End bench_rf_art_flush() */
+
+
+static uint32_t bench_rf_measure(bench_rf_fn fn, volatile bench_stat *pStat){
+
+	uint32_t crc = 0;
+
+	bench_stat_reset(pStat);
+
+	for (int r = 0; r < BENCH_RF_RUNS; ++r){
+
+		if (r & 1)
+			bench_rf_art_flush();
+
+		uint32_t start = DWT_GetCycles();
+		crc = fn(rf_data, BENCH_RF_LEN);
+		bench_stat_add(pStat, DWT_GetCycles() - start);
+
+	}
+
+	return crc;
+
+} /* End bench_rf_measure() */
+
+
+static void bench_rf_exti(volatile bench_stat *pStat){
+
+	bench_stat_reset(pStat);
+
+	GPIO_EXTIRegister(GPIO_PIN_0, bench_rf_exti_cb, 0);
+
+	EXTI->PR = GPIO_EXTI_LINE_0;
+	EXTI->IMR |= GPIO_EXTI_LINE_0;
+	NVIC_IRQInterruptConfig(IRQ_NO_EXTI0, ON);
+
+	for (int r = 0; r < BENCH_RF_RUNS; ++r){
+
+		if (r & 1)
+			bench_rf_art_flush();
+
+		rf_irq_done = 0;
+
+		uint32_t start = DWT_GetCycles();
+		EXTI->SWIER = GPIO_EXTI_LINE_0;
+
+		while (!rf_irq_done);
+
+		bench_stat_add(pStat, rf_irq_stamp - start);
+
+	}
+
+	NVIC_IRQInterruptConfig(IRQ_NO_EXTI0, OFF);
+	EXTI->IMR &= ~GPIO_EXTI_LINE_0;
+
+	GPIO_EXTIRegister(GPIO_PIN_0, 0, 0);
+
+} /* End bench_rf_exti() */
+
+
+void bench_ramfunc_run(void){
+
+	DWT_CycleCounterInit();
+	SystemCoreClockUpdate();
+
+	// PD13 (orange LED) as output, written by the loops
+	GPIO_Handle_t led;
+
+	led.gpio_reg_x = GPIOD;
+	led.gpio_pin_conf.GPIO_PinNumber = GPIO_PIN_13;
+	led.gpio_pin_conf.GPIO_PinMode = OUT;
+	led.gpio_pin_conf.GPIO_PinSpeed = HIGH;
+	led.gpio_pin_conf.GPIO_PinOPType = PUSH_PULL;
+	led.gpio_pin_conf.GPIO_PinPuPdControl = NO_PULLUP;
+
+	GPIO_PeriClockControl(GPIOD, ON);
+	GPIO_Init(&led);
+
+	bench_ramfunc.ramfunc_bytes = (uint32_t)&_eramfunc - (uint32_t)&_sramfunc;
+
+	uint32_t crc_flash = bench_rf_measure(bench_rf_loop_flash, &bench_ramfunc.loop_flash);
+	uint32_t crc_ram = bench_rf_measure(bench_rf_loop_ram, &bench_ramfunc.loop_ram);
+
+	bench_ramfunc.crc_ok = (crc_flash == crc_ram);
+
+	bench_rf_measure(bench_rf_toggle_flash, &bench_ramfunc.toggle_flash);
+	bench_rf_measure(bench_rf_toggle_ram, &bench_ramfunc.toggle_ram);
+
+	bench_rf_exti(&bench_ramfunc.exti_ram);
+
+	// jitter once every case is done, no extra work inside the runs
+	bench_ramfunc.jitter_loop_flash = bench_ramfunc.loop_flash.max - bench_ramfunc.loop_flash.min;
+	bench_ramfunc.jitter_loop_ram = bench_ramfunc.loop_ram.max - bench_ramfunc.loop_ram.min;
+	bench_ramfunc.jitter_toggle_flash = bench_ramfunc.toggle_flash.max - bench_ramfunc.toggle_flash.min;
+	bench_ramfunc.jitter_toggle_ram = bench_ramfunc.toggle_ram.max - bench_ramfunc.toggle_ram.min;
+	bench_ramfunc.jitter_exti_ram = bench_ramfunc.exti_ram.max - bench_ramfunc.exti_ram.min;
+
+} /* End bench_ramfunc_run() */
@@ -0,0 +1,173 @@
+
+/*
+ * Goal: SPI1 DMA throughput at each prescaler setting
+ *
+ * 	1) sanity check on the LIS3DSH accelerometer of the Discovery board:
+ * 	   2 chained transactions with the CS (PE3) kept low in between,
+ * 	   command 0x8F (read WHO_AM_I) then 1 byte read -> 0x3F expected
+ * 	2) for DIV2 .. DIV256: BENCH_SPI_BYTES full duplex, as 4 chained
+ * 	   transactions, no CS (the accelerometer stays deselected)
+ * 		- bytes_per_s: measured
+ * 		- ideal_bytes_per_s: fPCLK2 / divider / 8
+ * 		- efficiency_pct: gaps between frames and between transactions
+ * 	   put a jumper between PA6 (MISO) and PA7 (MOSI) to get rx_ok = 1
+ *
+ * Results in bench_spi (Live Expressions)
+ *
+ * Hardware: SPI1 SCK = PA5, MISO = PA6, MOSI = PA7 (AF5)
+ *
+ * */
+
+#include <string.h>
+#include "stm32f407G.h"
+#include "gpio_driver.h"
+#include "spi_driver.h"
+#include "rcc_driver.h"
+#include "dwt_counter.h"
+#include "bench.h"
+
+#define BENCH_SPI_BYTES 4096
+#define BENCH_SPI_CHUNKS 4
+#define BENCH_SPI_NB_DIV 8
+
+#define LIS3DSH_WHO_AM_I 0x0F
+#define LIS3DSH_READ     0x80
+
+typedef struct{
+	uint8_t who_am_i;
+	uint32_t bytes_per_s[BENCH_SPI_NB_DIV];
+	uint32_t ideal_bytes_per_s[BENCH_SPI_NB_DIV];
+	uint32_t efficiency_pct[BENCH_SPI_NB_DIV];
+	uint32_t submit_cycles;    // CPU cost of queueing the 4 transactions
+	uint8_t rx_ok;             // with the MISO-MOSI jumper
+} bench_spi_result;
+
+volatile bench_spi_result bench_spi;
+
+static uint8_t tx_buf[BENCH_SPI_BYTES];
+static uint8_t rx_buf[BENCH_SPI_BYTES];
+
+static SPI_Transaction_t trans[BENCH_SPI_CHUNKS];
+
+SPI_Handle_t spi1;
+
+void DMA2_Stream2_IRQHandler(void){
+
+	DMA_IRQHandling(&spi1.rx_dma);
+
+} /* End DMA2_Stream2_IRQHandler() */
+
+void DMA2_Stream3_IRQHandler(void){
+
+	DMA_IRQHandling(&spi1.tx_dma);
+
+} /* End DMA2_Stream3_IRQHandler() */
+
+
+static void bench_spi1_pins(void){
+
+	GPIO_Handle_t pin;
+
+	GPIO_PeriClockControl(GPIOA, ON);
+
+	pin.gpio_reg_x = GPIOA;
+	pin.gpio_pin_conf.GPIO_PinMode = ALT;
+	pin.gpio_pin_conf.GPIO_PinSpeed = VERY;
+	pin.gpio_pin_conf.GPIO_PinOPType = PUSH_PULL;
+	pin.gpio_pin_conf.GPIO_PinPuPdControl = NO_PULLUP;
+	pin.gpio_pin_conf.GPIO_PinAltFunMode = 5;
+
+	for (uint8_t p = GPIO_PIN_5; p <= GPIO_PIN_7; ++p){
+		pin.gpio_pin_conf.GPIO_PinNumber = p;
+		GPIO_Init(&pin);
+	}
+
+	SPI_CSPinInit(GPIOE, GPIO_PIN_3);
+
+} /* End bench_spi1_pins() */
+
+
+void bench_spi_run(void){
+
+	DWT_CycleCounterInit();
+	SystemCoreClockUpdate();
+
+	bench_spi1_pins();
+
+	spi1.pSPIx = SPI1;
+	spi1.SPI_Config.SPI_Prescaler = SPI_DIV16;
+	spi1.SPI_Config.SPI_FrameSize = SPI_FRAME_8BITS;
+	spi1.SPI_Config.SPI_Mode = SPI_MODE_3;   // LIS3DSH: CPOL = 1, CPHA = 1
+	spi1.SPI_Config.SPI_LSBFirst = OFF;
+
+	if (SPI_Init(&spi1) != DRV_OK)
+		return;
+
+	// ---- 1) WHO_AM_I, command then data under the same CS ----
+	static const uint8_t cmd = LIS3DSH_READ | LIS3DSH_WHO_AM_I;
+	static uint8_t who;
+
+	memset(trans, 0, sizeof(trans));
+
+	trans[0].pCSPort = GPIOE;
+	trans[0].CSPin = GPIO_PIN_3;
+	trans[0].KeepCS = ON;
+	trans[0].pTx = &cmd;
+	trans[0].Len = 1;
+
+	trans[1].pCSPort = GPIOE;
+	trans[1].CSPin = GPIO_PIN_3;
+	trans[1].KeepCS = OFF;
+	trans[1].pRx = &who;
+	trans[1].Len = 1;
+
+	SPI_Submit(&spi1, &trans[0]);
+	SPI_Submit(&spi1, &trans[1]);
+
+	while (!SPI_Idle(&spi1));
+
+	bench_spi.who_am_i = who;
+
+	// ---- 2) throughput per prescaler ----
+	for (int i = 0; i < BENCH_SPI_BYTES; ++i)
+		tx_buf[i] = (uint8_t)(i * 13 + 5);
+
+	uint32_t pclk = RCC_GetPCLK2Value();
+	uint32_t chunk = BENCH_SPI_BYTES / BENCH_SPI_CHUNKS;
+
+	for (uint8_t div = SPI_DIV2; div <= SPI_DIV256; ++div){
+
+		SPI_SetPrescaler(&spi1, div);
+		memset(rx_buf, 0, sizeof(rx_buf));
+		memset(trans, 0, sizeof(trans));
+
+		for (int k = 0; k < BENCH_SPI_CHUNKS; ++k){
+			trans[k].pTx = &tx_buf[k * chunk];
+			trans[k].pRx = &rx_buf[k * chunk];
+			trans[k].Len = chunk;
+		}
+
+		uint32_t start = DWT_GetCycles();
+
+		for (int k = 0; k < BENCH_SPI_CHUNKS; ++k)
+			SPI_Submit(&spi1, &trans[k]);
+
+		if (div == SPI_DIV2)
+			bench_spi.submit_cycles = DWT_GetCycles() - start;
+
+		while (!SPI_Idle(&spi1));
+
+		uint32_t cycles = DWT_GetCycles() - start;
+
+		uint32_t ideal = pclk / (2U << div) / 8;
+
+		bench_spi.bytes_per_s[div] =
+			(uint32_t)((uint64_t)BENCH_SPI_BYTES * SystemCoreClock / cycles);
+		bench_spi.ideal_bytes_per_s[div] = ideal;
+		bench_spi.efficiency_pct[div] = bench_spi.bytes_per_s[div] * 100 / ideal;
+
+	} /* End for prescalers */
+
+	bench_spi.rx_ok = (memcmp(tx_buf, rx_buf, BENCH_SPI_BYTES) == 0);
+
+} /* End bench_spi_run() */
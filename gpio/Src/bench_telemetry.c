@@ -0,0 +1,110 @@
+
+/*
+ * Goal: samples per second on the same link, printf text vs telemetry
+ *
+ * 	1) text: printf("%lu,%u,%d\n", timestamp, channel, sample) per sample
+ * 	2) telemetry: Telemetry_Send() of BENCH_TLM_BATCH int16 samples
+ *
+ * Both go through the retarget (retarget.h) into a RAM log, so only the
+ * CPU cost and the size are measured, not the wait on the link.
+ *
+ * Results in bench_telemetry (Live Expressions):
+ * 	- cycles and bytes per sample for each method
+ * 	- samples per second at BENCH_TLM_BAUD (10 bits per byte on the line)
+ * 	- gain_x100: telemetry samples/s * 100 / text samples/s
+ *
+ * */
+
+#include <stdio.h>
+#include "stm32f407G.h"
+#include "retarget.h"
+#include "telemetry.h"
+#include "rcc_driver.h"
+#include "dwt_counter.h"
+#include "bench.h"
+
+#define BENCH_TLM_SAMPLES 512
+#define BENCH_TLM_BATCH   16
+#define BENCH_TLM_BAUD    921600
+#define BENCH_TLM_CHANNEL 3
+
+typedef struct{
+	uint32_t cycles_per_sample_text;
+	uint32_t cycles_per_sample_tlm;
+	uint32_t bytes_per_sample_text_x100;
+	uint32_t bytes_per_sample_tlm_x100;
+	uint32_t samples_per_s_text;
+	uint32_t samples_per_s_tlm;
+	uint32_t gain_x100;
+} bench_telemetry_result;
+
+volatile bench_telemetry_result bench_telemetry;
+
+static int16_t samples[BENCH_TLM_SAMPLES];
+
+static uint8_t stdio_buf[512];
+static char ram_log[2048];
+static Retarget_RamLog_t ram_log_handle;
+
+static Retarget_Handle_t stdio_handle;
+static Telemetry_Handle_t tlm_handle;
+
+
+void bench_telemetry_run(void){
+
+	DWT_CycleCounterInit();
+	SystemCoreClockUpdate();
+
+	// a slow sine-like ramp, negative values included
+	for (int i = 0; i < BENCH_TLM_SAMPLES; ++i)
+		samples[i] = (int16_t)((i % 128) * 250 - 16000);
+
+	stdio_handle.pBuffer = stdio_buf;
+	stdio_handle.BufferSize = sizeof(stdio_buf);
+	stdio_handle.Buffering = RETARGET_BUF_FULL;
+	stdio_handle.Policy = RETARGET_POLICY_OVERWRITE;
+	Retarget_RamLogBackend(&stdio_handle, &ram_log_handle, ram_log, sizeof(ram_log));
+	Retarget_Init(&stdio_handle);
+
+	tlm_handle.Output = Retarget_Write;
+	Telemetry_Init(&tlm_handle);
+
+	// ---- 1) printf text ----
+	uint32_t bytes_before = stdio_handle.bytes_out + stdio_handle.fill;
+	uint32_t start = DWT_GetCycles();
+
+	for (int i = 0; i < BENCH_TLM_SAMPLES; ++i)
+		printf("%lu,%u,%d\n", (unsigned long)DWT_GetCycles(),
+			   BENCH_TLM_CHANNEL, samples[i]);
+
+	uint32_t text_cycles = DWT_GetCycles() - start;
+	uint32_t text_bytes = stdio_handle.bytes_out + stdio_handle.fill - bytes_before;
+
+	// ---- 2) telemetry records ----
+	Retarget_Flush();
+	bytes_before = stdio_handle.bytes_out + stdio_handle.fill;
+	start = DWT_GetCycles();
+
+	for (int i = 0; i < BENCH_TLM_SAMPLES; i += BENCH_TLM_BATCH)
+		Telemetry_Send(&tlm_handle, BENCH_TLM_CHANNEL, TELEMETRY_I16,
+					   &samples[i], BENCH_TLM_BATCH);
+
+	uint32_t tlm_cycles = DWT_GetCycles() - start;
+	uint32_t tlm_bytes = stdio_handle.bytes_out + stdio_handle.fill - bytes_before;
+
+	// ---- results ----
+	uint32_t link_bytes_per_s = BENCH_TLM_BAUD / 10;
+
+	bench_telemetry.cycles_per_sample_text = text_cycles / BENCH_TLM_SAMPLES;
+	bench_telemetry.cycles_per_sample_tlm = tlm_cycles / BENCH_TLM_SAMPLES;
+	bench_telemetry.bytes_per_sample_text_x100 = text_bytes * 100 / BENCH_TLM_SAMPLES;
+	bench_telemetry.bytes_per_sample_tlm_x100 = tlm_bytes * 100 / BENCH_TLM_SAMPLES;
+
+	bench_telemetry.samples_per_s_text =
+		(uint32_t)((uint64_t)link_bytes_per_s * BENCH_TLM_SAMPLES / text_bytes);
+	bench_telemetry.samples_per_s_tlm =
+		(uint32_t)((uint64_t)link_bytes_per_s * BENCH_TLM_SAMPLES / tlm_bytes);
+
+	bench_telemetry.gain_x100 = text_bytes * 100 / tlm_bytes;
+
+} /* End bench_telemetry_run() */
@@ -0,0 +1,152 @@
+
+/*
+ * Goal: hardware timing instead of empty for loops and software toggling
+ *
+ * 	1) TIM_DelayUs() on TIM6 (one pulse mode), measured with the DWT
+ * 	   for 1 us .. 10 ms: delay_cycles[] vs the expected cycles
+ * 	   (the fixed part is the cost of the function call and setup)
+ * 	2) one pulse on TIM7 at BENCH_TIM_PULSE_HZ: the counter must stop
+ * 	   by itself after one period (one_pulse_ok), one_pulse_cycles
+ * 	   is the time until CEN went back to 0
+ * 	3) the 4 LEDs on TIM4 PWM at BENCH_TIM_PWM_HZ, fixed duty on the
+ * 	   orange, red and blue LEDs (12.5 %, 50 %, 100 %), the green one
+ * 	   breathes: its duty is changed in the update callback every
+ * 	   BENCH_TIM_STEP periods. cpu_load_pct with an idle loop, as in
+ * 	   the other benchmarks: only the callbacks take CPU
+ *
+ * Results in bench_timer (Live Expressions), the LEDs keep running
+ *
+ * Hardware: LEDs PD12..PD15 = TIM4 CH1..CH4 (AF2)
+ *
+ * */
+
+#include "stm32f407G.h"
+#include "gpio_driver.h"
+#include "timer_driver.h"
+#include "rcc_driver.h"
+#include "dwt_counter.h"
+#include "mem_sections.h"
+#include "bench.h"
+
+#define BENCH_TIM_NB_DELAY  5
+#define BENCH_TIM_PULSE_HZ  1000
+#define BENCH_TIM_PWM_HZ    1000
+#define BENCH_TIM_STEP      4        // periods per duty step
+#define BENCH_TIM_TIME      16000000U
+
+typedef struct{
+	uint32_t delay_us[BENCH_TIM_NB_DELAY];
+	uint32_t delay_cycles[BENCH_TIM_NB_DELAY];
+	uint32_t expected_cycles[BENCH_TIM_NB_DELAY];
+	uint32_t one_pulse_cycles;
+	uint8_t one_pulse_ok;
+	uint32_t pwm_freq;
+	uint32_t pwm_steps;          // ARR + 1, duty resolution
+	uint32_t updates;
+	uint32_t cpu_load_pct;
+} bench_timer_result;
+
+volatile bench_timer_result bench_timer;
+
+static const uint32_t delays[BENCH_TIM_NB_DELAY] = {1, 10, 100, 1000, 10000};
+
+__ccm_bss TIM_Handle_t tim4;
+
+void TIM4_IRQHandler(void){
+
+	TIM_IRQHandling(&tim4);
+
+} /* End TIM4_IRQHandler() */
+
+
+// Triangle 0 -> 100 % -> 0 on the green LED, in 100 steps each way
+static void bench_timer_breathe(TIM_Handle_t *pTIMHandle){
+
+	static uint16_t step;
+
+	if (pTIMHandle->updates % BENCH_TIM_STEP)
+		return;
+
+	step = (step + 1) % 200;
+
+	uint16_t level = (step < 100) ? step : 200 - step;
+
+	TIM_SetDuty(pTIMHandle, 1, level * (TIM_DUTY_MAX / 100));
+
+} /* End bench_timer_breathe() */
+
+
+void bench_timer_run(void){
+
+	DWT_CycleCounterInit();
+	SystemCoreClockUpdate();
+
+	// ---- 1) delays ----
+	for (int i = 0; i < BENCH_TIM_NB_DELAY; ++i){
+
+		uint32_t start = DWT_GetCycles();
+
+		TIM_DelayUs(TIM6, delays[i]);
+
+		bench_timer.delay_cycles[i] = DWT_GetCycles() - start;
+		bench_timer.delay_us[i] = delays[i];
+		bench_timer.expected_cycles[i] =
+			(uint32_t)((uint64_t)delays[i] * SystemCoreClock / 1000000);
+
+	} /* End for delays */
+
+	// ---- 2) one pulse ----
+	TIM_Handle_t tim7;
+
+	tim7.pTIMx = TIM7;
+	tim7.TIM_Config.TIM_Frequency = BENCH_TIM_PULSE_HZ;
+	tim7.TIM_Config.TIM_OnePulse = ON;
+	tim7.TIM_Config.TIM_UpdateIT = OFF;
+	tim7.Callback = 0;
+
+	if (TIM_Init(&tim7) == DRV_OK){
+
+		uint32_t start = DWT_GetCycles();
+
+		TIM_StartOnePulse(&tim7);
+
+		while (TIM7->CR1 & (1 << TIM_CR1_CEN));
+
+		bench_timer.one_pulse_cycles = DWT_GetCycles() - start;
+
+		// stopped, back to 0, and it stays there
+		bench_idle(1000, 0);
+		bench_timer.one_pulse_ok = (TIM7->CNT == 0);
+
+	} /* End if TIM7 */
+
+	// ---- 3) PWM on the LEDs ----
+	tim4.pTIMx = TIM4;
+	tim4.TIM_Config.TIM_Frequency = BENCH_TIM_PWM_HZ;
+	tim4.TIM_Config.TIM_OnePulse = OFF;
+	tim4.TIM_Config.TIM_UpdateIT = ON;
+	tim4.Callback = bench_timer_breathe;
+
+	if (TIM_Init(&tim4) != DRV_OK)
+		return;
+
+	for (uint8_t ch = 1; ch <= 4; ++ch)
+		TIM_PWMInit(&tim4, ch, TIM_PWM_MODE1, TIM_POL_HIGH, GPIOD, GPIO_PIN_12 + ch - 1);
+
+	TIM_SetDuty(&tim4, 2, TIM_DUTY_MAX / 8);
+	TIM_SetDuty(&tim4, 3, TIM_DUTY_MAX / 2);
+	TIM_SetDuty(&tim4, 4, TIM_DUTY_MAX);
+
+	bench_timer.pwm_freq = tim4.Frequency;
+	bench_timer.pwm_steps = TIM4->ARR + 1;
+
+	uint32_t ref_loops = bench_idle(BENCH_TIM_TIME, 0);
+
+	TIM_Start(&tim4);
+
+	uint32_t loops = bench_idle(BENCH_TIM_TIME, 0);
+
+	bench_timer.updates = tim4.updates;
+	bench_timer.cpu_load_pct = bench_cpu_load(loops, ref_loops);
+
+} /* End bench_timer_run() */
@@ -0,0 +1,162 @@
+
+/*
+ * Goal: measure the CPU cost of the interrupt driven USART driver
+ *
+ * Method:
+ * 	1) send BENCH_NB_BYTES with USART_Write() and, while the bytes
+ * 	   are going out, count the iterations of an idle loop
+ * 	2) run the same idle loop during the same nb of cycles
+ * 	   without any transfer (reference)
+ * 	3) cpu load (%) = 100 - 100 * loops_during_transfer / loops_reference
+ *
+ * 	-> the lower the load, the more CPU is left to the application
+ * 	   (a blocking polling driver is at 100%)
+ *
+ * Hardware: USART2, TX = PA2, RX = PA3 (AF7)
+ * 	put a jumper between PA2 and PA3 to also check the RX side
+ * 	(rx_bytes must then be equal to nb_bytes)
+ *
+ * */
+
+#include "stm32f407G.h"
+#include "gpio_driver.h"
+#include "usart_driver.h"
+#include "rcc_driver.h"
+#include "dwt_counter.h"
+#include "bench.h"
+
+#define BENCH_NB_BYTES 4096
+#define BENCH_CHUNK    64
+
+static const uint32_t bench_bauds[] = {115200, 921600, 2000000};
+
+#define NB_BENCH_BAUDS (sizeof(bench_bauds)/sizeof(bench_bauds[0]))
+
+typedef struct{
+	uint32_t baud;
+	uint32_t nb_bytes;
+	uint32_t total_cycles;     // from 1st USART_Write() to last stop bit
+	uint32_t loops_transfer;
+	uint32_t loops_reference;
+	uint32_t cpu_load_pct;
+	uint32_t rx_bytes;         // with PA2-PA3 jumper
+	uint32_t rx_dropped;
+} bench_usart_result;
+
+volatile bench_usart_result bench_usart[NB_BENCH_BAUDS];
+
+static uint8_t usart2_tx_storage[1024];
+static uint8_t usart2_rx_storage[1024];
+
+USART_Handle_t usart2_handle;
+
+void USART2_IRQHandler(void){
+
+	USART_IRQHandling(&usart2_handle);
+
+} /* End USART2_IRQHandler() */
+
+
+void bench_usart2_pins(void){
+
+	GPIO_Handle_t usart_pins;
+
+	usart_pins.gpio_reg_x = GPIOA;
+	usart_pins.gpio_pin_conf.GPIO_PinMode = ALT;
+	usart_pins.gpio_pin_conf.GPIO_PinAltFunMode = 7;
+	usart_pins.gpio_pin_conf.GPIO_PinSpeed = VERY;
+	usart_pins.gpio_pin_conf.GPIO_PinOPType = PUSH_PULL;
+	usart_pins.gpio_pin_conf.GPIO_PinPuPdControl = PULLUP;
+
+	GPIO_PeriClockControl(GPIOA, ON);
+
+	usart_pins.gpio_pin_conf.GPIO_PinNumber = GPIO_PIN_2; // TX
+	GPIO_Init(&usart_pins);
+
+	usart_pins.gpio_pin_conf.GPIO_PinNumber = GPIO_PIN_3; // RX
+	GPIO_Init(&usart_pins);
+
+} /* End bench_usart2_pins() */
+
+
+static void bench_usart_one(uint32_t baud, volatile bench_usart_result *res){
+
+	static uint8_t pattern[BENCH_CHUNK];
+	uint8_t rx_chunk[BENCH_CHUNK];
+
+	for (int i = 0; i < BENCH_CHUNK; ++i)
+		pattern[i] = (uint8_t)('A' + (i % 26));
+
+	usart2_handle.pUSARTx = USART2;
+	usart2_handle.USART_Config.USART_Mode = USART_MODE_TXRX;
+	usart2_handle.USART_Config.USART_Baud = baud;
+	usart2_handle.USART_Config.USART_NoOfStopBits = USART_STOPBITS_1;
+	usart2_handle.USART_Config.USART_WordLength = USART_WORDLEN_8BITS;
+	usart2_handle.USART_Config.USART_ParityControl = USART_PARITY_DISABLE;
+	usart2_handle.USART_Config.USART_HWFlowControl = USART_HW_FLOW_NONE;
+	usart2_handle.pTxBuffer = usart2_tx_storage;
+	usart2_handle.TxBufferSize = sizeof(usart2_tx_storage);
+	usart2_handle.pRxBuffer = usart2_rx_storage;
+	usart2_handle.RxBufferSize = sizeof(usart2_rx_storage);
+
+	USART_DeInit(USART2);
+	if (USART_Init(&usart2_handle) != DRV_OK)
+		return;
+
+	uint32_t sent = 0, received = 0, loops = 0;
+
+	// 1) transfer + idle loop
+	uint32_t start = DWT_GetCycles();
+
+	while (sent < BENCH_NB_BYTES || !USART_TxIdle(&usart2_handle)){
+
+		if (sent < BENCH_NB_BYTES){
+			uint32_t len = BENCH_NB_BYTES - sent;
+			if (len > BENCH_CHUNK)
+				len = BENCH_CHUNK;
+			sent += USART_Write(&usart2_handle, pattern, len);
+		}
+
+		received += USART_Read(&usart2_handle, rx_chunk, sizeof(rx_chunk));
+
+		loops++;
+
+	} /* End while transfer */
+
+	uint32_t total = DWT_GetCycles() - start;
+
+	// 2) same loop shape, same duration, no transfer
+	uint32_t ref_loops = 0;
+	start = DWT_GetCycles();
+
+	while ((DWT_GetCycles() - start) < total){
+
+		received += USART_Read(&usart2_handle, rx_chunk, sizeof(rx_chunk));
+
+		ref_loops++;
+
+	} /* End while reference */
+
+	res->baud = baud;
+	res->nb_bytes = BENCH_NB_BYTES;
+	res->total_cycles = total;
+	res->loops_transfer = loops;
+	res->loops_reference = ref_loops;
+	res->cpu_load_pct = bench_cpu_load(loops, ref_loops);
+	res->rx_bytes = received;
+	res->rx_dropped = usart2_handle.rx_dropped;
+
+} /* End bench_usart_one() */
+
+
+void bench_usart_run(void){
+
+	DWT_CycleCounterInit();
+	SystemCoreClockUpdate();
+
+	bench_usart2_pins();
+
+	for (int i = 0; i < NB_BENCH_BAUDS; ++i)
+		bench_usart_one(bench_bauds[i], &bench_usart[i]);
+
+} /* End bench_usart_run() */
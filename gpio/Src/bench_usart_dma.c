@@ -0,0 +1,175 @@
+
+/*
+ * Goal: CPU cost per kilobyte sent, DMA path vs byte wise _write loop
+ *
+ * 	1) putchar loop: what _write() in syscalls.c does, one call per byte,
+ * 	   each call waits for TXE then writes DR -> the CPU is busy during
+ * 	   the whole transfer
+ * 	2) DMA queue: BENCH_NB_KB descriptors of 1 KB submitted at once,
+ * 	   CPU cycles used = total - (idle loops * cycles of one idle loop)
+ * 	3) DMA double buffer: same measure, the callback refills the buffer
+ *
+ * Results in bench_usart_dma (Live Expressions), in cycles per KB
+ *
+ * Hardware: USART2 TX = PA2 (AF7), 921600 baud
+ *
+ * */
+
+#include "stm32f407G.h"
+#include "gpio_driver.h"
+#include "usart_driver.h"
+#include "usart_dma.h"
+#include "rcc_driver.h"
+#include "dwt_counter.h"
+#include "bench.h"
+
+#define BENCH_BAUD   921600
+#define BENCH_NB_KB  4
+
+typedef struct{
+	uint32_t cycles_per_kb_putchar;
+	uint32_t cycles_per_kb_dma_queue;
+	uint32_t cycles_per_kb_dma_dbuf;
+	uint32_t wall_cycles_per_kb;     // duration of 1 KB on the line
+	uint32_t dma_tx_bytes;
+} bench_usart_dma_result;
+
+volatile bench_usart_dma_result bench_usart_dma;
+
+static uint8_t tx_block[BENCH_NB_KB][1024];
+static USART_TxDesc_t tx_desc[BENCH_NB_KB];
+
+USART_DMA_Handle_t usart2_dma;
+
+static __vo uint32_t dbuf_done;
+
+void DMA1_Stream6_IRQHandler(void){
+
+	DMA_IRQHandling(&usart2_dma.tx_dma);
+
+} /* End DMA1_Stream6_IRQHandler() */
+
+
+// Same job as __io_putchar() called by _write() for every byte
+static void bench_putchar(uint8_t ch){
+
+	while (!(USART2->SR & (1 << USART_SR_TXE)));
+	USART2->DR = ch;
+
+} /* End bench_putchar() */
+
+
+static void bench_dbuf_refill(USART_DMA_Handle_t *pHandle, uint8_t FreeBuffer){
+
+	// the application would write the next samples in tx_block[FreeBuffer]
+	dbuf_done++;
+
+} /* End bench_dbuf_refill() */
+
+
+static uint8_t bench_queue_done(void){
+
+	return USART_DMA_TxIdle(&usart2_dma) && (USART2->SR & (1 << USART_SR_TC));
+
+} /* End bench_queue_done() */
+
+static uint8_t bench_dbuf_done(void){
+
+	return dbuf_done >= BENCH_NB_KB;
+
+} /* End bench_dbuf_done() */
+
+static uint8_t bench_never(void){
+
+	return 0;
+
+} /* End bench_never() */
+
+
+void bench_usart_dma_run(void){
+
+	DWT_CycleCounterInit();
+	SystemCoreClockUpdate();
+
+	bench_usart2_pins();
+
+	for (int k = 0; k < BENCH_NB_KB; ++k)
+		for (int i = 0; i < 1024; ++i)
+			tx_block[k][i] = (uint8_t)('a' + (i % 26));
+
+	USART_Handle_t uart;
+
+	uart.pUSARTx = USART2;
+	uart.USART_Config.USART_Mode = USART_MODE_ONLY_TX;
+	uart.USART_Config.USART_Baud = BENCH_BAUD;
+	uart.USART_Config.USART_NoOfStopBits = USART_STOPBITS_1;
+	uart.USART_Config.USART_WordLength = USART_WORDLEN_8BITS;
+	uart.USART_Config.USART_ParityControl = USART_PARITY_DISABLE;
+	uart.USART_Config.USART_HWFlowControl = USART_HW_FLOW_NONE;
+	uart.pTxBuffer = 0;   // TX goes through the DMA
+	uart.pRxBuffer = 0;
+
+	USART_DeInit(USART2);
+	USART_Init(&uart);
+
+	// ---- 1) byte wise loop ----
+	uint32_t start = DWT_GetCycles();
+
+	for (int k = 0; k < BENCH_NB_KB; ++k)
+		for (int i = 0; i < 1024; ++i)
+			bench_putchar(tx_block[k][i]);
+
+	while (!(USART2->SR & (1 << USART_SR_TC)));
+
+	uint32_t total = DWT_GetCycles() - start;
+
+	bench_usart_dma.cycles_per_kb_putchar = total / BENCH_NB_KB;
+	bench_usart_dma.wall_cycles_per_kb = total / BENCH_NB_KB;
+
+	// reference: nb of idle loops during the same time, nothing else running
+	uint32_t ref_loops = bench_idle(total, bench_never);
+
+	USART_DMA_TxInit(&usart2_dma, USART2);
+
+	// ---- 2) DMA queue ----
+	start = DWT_GetCycles();
+
+	for (int k = 0; k < BENCH_NB_KB; ++k){
+		tx_desc[k].pData = tx_block[k];
+		tx_desc[k].Len = 1024;
+		tx_desc[k].Done = 0;
+		USART_DMA_Submit(&usart2_dma, &tx_desc[k]);
+	}
+
+	uint32_t loops = bench_idle(0, bench_queue_done);
+	uint32_t dma_total = DWT_GetCycles() - start;
+
+	/*
+	 * cycles of one idle loop = total / ref_loops
+	 * CPU cycles used by the driver = dma_total - loops * total / ref_loops
+	 * */
+	uint32_t idle_cycles = (uint32_t)(((uint64_t)loops * total) / ref_loops);
+
+	bench_usart_dma.cycles_per_kb_dma_queue =
+		(dma_total > idle_cycles ? dma_total - idle_cycles : 0) / BENCH_NB_KB;
+
+	// ---- 3) DMA double buffer ----
+	dbuf_done = 0;
+	start = DWT_GetCycles();
+
+	USART_DMA_StartDoubleBuffer(&usart2_dma, tx_block[0], tx_block[1],
+								1024, bench_dbuf_refill);
+
+	loops = bench_idle(0, bench_dbuf_done);
+	dma_total = DWT_GetCycles() - start;
+
+	USART_DMA_StopDoubleBuffer(&usart2_dma);
+
+	idle_cycles = (uint32_t)(((uint64_t)loops * total) / ref_loops);
+
+	bench_usart_dma.cycles_per_kb_dma_dbuf =
+		(dma_total > idle_cycles ? dma_total - idle_cycles : 0) / BENCH_NB_KB;
+
+	bench_usart_dma.dma_tx_bytes = usart2_dma.tx_bytes;
+
+} /* End bench_usart_dma_run() */
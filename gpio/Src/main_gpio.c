@@ -3,10 +3,40 @@
 
 #include "stm32f407G.h"
 #include "gpio_driver.h"
+#include "nvic_driver.h"
+#include "startup_time.h"
+#include "dwt_counter.h"
+#include "bench.h"
 
-#define CYCLE 1e5
+// Same debounce as the old busy loop: 1e5 turns, about 87 ms on HSI 16 MHz
+#define DEBOUNCE_MS 87
 
 #define RUN_SOFT 1
+/*
+	RUN_SOFT selects what main() runs:
+	0 -> reset GPIO port D
+	1 -> toggle the LED with the user button
+	2 -> USART benchmark (bench_usart.c)
+	3 -> USART DMA benchmark (bench_usart_dma.c)
+	4 -> printf text vs binary telemetry (bench_telemetry.c)
+	5 -> snprintf vs format.h (bench_format.c)
+	6 -> memcpy vs DMA memory to memory (bench_dma_memcpy.c)
+	7 -> SPI1 DMA throughput per prescaler (bench_spi.c)
+	8 -> I2C1 CPU load, interrupt + DMA vs polling (bench_i2c.c)
+	9 -> timer triggered ADC scan, DMA ping-pong (bench_adc.c)
+	10 -> timer delays, one pulse and PWM on the LEDs (bench_timer.c)
+	11 -> DMA fed PWM, sine waveform and WS2812 strip (bench_pwm_dma.c)
+	12 -> parallel bus, CPU loops vs DMA to BSRR (bench_patgen.c)
+	13 -> on-chip logic analyzer, DMA reads of IDR (bench_logic.c)
+	14 -> frequency / duty by input capture + DMA (bench_capture.c)
+	15 -> CPU data in CCM vs SRAM1 under DMA load (bench_ccm.c)
+	16 -> jitter of code in flash vs SRAM, __ramfunc (bench_ramfunc.c)
+	17 -> clock profiles switched at run time, drivers re-timed (bench_dvfs.c)
+	18 -> reference counted peripheral clock gating (bench_clock_gate.c)
+	19 -> wake latency of SLEEP / STOP / STANDBY, clock restore (bench_power.c)
+	20 -> malloc vs fixed size pools, allocations from an ISR (bench_mem_pool.c)
+	21 -> per frame scratch buffers from arenas, mark / rewind (bench_arena.c)
+*/
 
 #define BUTTON_HIGH 1
 /*
@@ -19,21 +49,39 @@
 */
 
 
+// Reset to main() time in us (startup_time.h), in Live Expressions
+volatile uint32_t startup_time_us;
+
+
 void delay(){
 
-	for(int i=0; i<CYCLE; i++){
+	/*
+	 * Counted in core cycles (DWT), not in loop turns: the same time
+	 * on HSI 16 MHz and at 168 MHz (RCC_STARTUP_168MHZ in rcc_driver.h)
+	 * */
+	uint32_t start = DWT_GetCycles();
+	uint32_t cycles = (SystemCoreClock / 1000) * DEBOUNCE_MS;
 
-	}
+	while ((DWT_GetCycles() - start) < cycles);
 
 } /* End delay*()*/
 
 int main(void){
 
+// The clock is already set by SystemInit() (RCC_STARTUP_168MHZ in rcc_driver.h)
+startup_time_us = Startup_GetTimeUs();
+
+// All the IRQ priorities are written once, from irq_priority_plan.h
+NVIC_ApplyPriorityPlan();
+
 // Goal: toggling a LED when pressing user button
 
 
 #if (RUN_SOFT==1)
 
+// cycle counter for the debounce delay()
+DWT_CycleCounterInit();
+
 // Instantiate structures for button and LED
 GPIO_Handle_t gpio_button, gpio_led;
 
@@ -93,6 +141,106 @@ GPIO_Init(&gpio_led);
 GPIO_DeInit(GPIOD);
 #endif
 
+#if (RUN_SOFT == 2)
+bench_usart_run();
+while(1);
+#endif
+
+#if (RUN_SOFT == 3)
+bench_usart_dma_run();
+while(1);
+#endif
+
+#if (RUN_SOFT == 4)
+bench_telemetry_run();
+while(1);
+#endif
+
+#if (RUN_SOFT == 5)
+bench_format_run();
+while(1);
+#endif
+
+#if (RUN_SOFT == 6)
+bench_dma_memcpy_run();
+while(1);
+#endif
+
+#if (RUN_SOFT == 7)
+bench_spi_run();
+while(1);
+#endif
+
+#if (RUN_SOFT == 8)
+bench_i2c_run();
+while(1);
+#endif
+
+#if (RUN_SOFT == 9)
+bench_adc_run();
+while(1);
+#endif
+
+#if (RUN_SOFT == 10)
+bench_timer_run();
+while(1);
+#endif
+
+#if (RUN_SOFT == 11)
+bench_pwm_dma_run();
+while(1);
+#endif
+
+#if (RUN_SOFT == 12)
+bench_patgen_run();
+while(1);
+#endif
+
+#if (RUN_SOFT == 13)
+bench_logic_run();
+while(1);
+#endif
+
+#if (RUN_SOFT == 14)
+bench_capture_run();
+while(1);
+#endif
+
+#if (RUN_SOFT == 15)
+bench_ccm_run();
+while(1);
+#endif
+
+#if (RUN_SOFT == 16)
+bench_ramfunc_run();
+while(1);
+#endif
+
+#if (RUN_SOFT == 17)
+bench_dvfs_run();
+while(1);
+#endif
+
+#if (RUN_SOFT == 18)
+bench_clock_gate_run();
+while(1);
+#endif
+
+#if (RUN_SOFT == 19)
+bench_power_run();
+while(1);
+#endif
+
+#if (RUN_SOFT == 20)
+bench_mem_pool_run();
+while(1);
+#endif
+
+#if (RUN_SOFT == 21)
+bench_arena_run();
+while(1);
+#endif
+
 
 
 }/* End main()*/
@@ -105,7 +253,8 @@ GPIO_DeInit(GPIOD);
  Download pulseview for linux in https://sigrok.org/wiki/Downloads
 
 
-	for 5e5 -> delay = 433 ms
+	for 5e5 -> delay = 433 ms  (old loop delay() on HSI 16 MHz, before
+	                            DWT; at 168 MHz the same loop is ~10x shorter)
 	
 
 
@@ -35,17 +35,18 @@ static uint8_t *__sbrk_heap_end = NULL;
  *
  * @verbatim
  * ############################################################################
- * #  .data  #  .bss  #       newlib heap       #          MSP stack          #
- * #         #        #                         # Reserved by _Min_Stack_Size #
+ * #  .data  #  .bss  #                   newlib heap                         #
  * ############################################################################
- * ^-- RAM start      ^-- _end                             _estack, RAM end --^
+ * ^-- RAM start      ^-- _end                                      _eram --^
  * @endverbatim
  *
  * This implementation starts allocating at the '_end' linker symbol
- * The '_Min_Stack_Size' linker symbol reserves a memory for the MSP stack
- * The implementation considers '_estack' linker symbol to be RAM end
- * NOTE: If the MSP stack, at any point during execution, grows larger than the
- * reserved size, please increase the '_Min_Stack_Size'.
+ * The MSP stack is at the top of the CCM RAM ('_estack', mem_sections.h),
+ * so the heap can take the RAM up to its end, the '_eram' linker symbol
+ *
+ * Not for ISRs and real-time paths: malloc() time depends on the
+ * fragmentation and newlib locks the heap. Use the fixed size pools
+ * of mem_pool.h there (Mem_Alloc() / MemPool_Alloc())
  *
  * @param incr Memory size
  * @return Pointer to allocated memory
@@ -53,10 +54,8 @@ static uint8_t *__sbrk_heap_end = NULL;
 void *_sbrk(ptrdiff_t incr)
 {
   extern uint8_t _end; /* Symbol defined in the linker script */
-  extern uint8_t _estack; /* Symbol defined in the linker script */
-  extern uint32_t _Min_Stack_Size; /* Symbol defined in the linker script */
-  const uint32_t stack_limit = (uint32_t)&_estack - (uint32_t)&_Min_Stack_Size;
-  const uint8_t *max_heap = (uint8_t *)stack_limit;
+  extern uint8_t _eram; /* Symbol defined in the linker script */
+  const uint8_t *max_heap = &_eram;
   uint8_t *prev_heap_end;
 
   /* Initialize heap end at first call */
@@ -65,7 +64,7 @@ void *_sbrk(ptrdiff_t incr)
     __sbrk_heap_end = &_end;
   }
 
-  /* Protect heap from growing into the reserved MSP stack */
+  /* Protect heap from growing out of the RAM */
   if (__sbrk_heap_end + incr > max_heap)
   {
     errno = ENOMEM;
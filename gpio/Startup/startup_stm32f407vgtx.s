@@ -30,23 +30,39 @@
 .global g_pfnVectors
 .global Default_Handler
 
-/* start address for the initialization values of the .data section.
-defined in linker script */
-.word _sidata
-/* start address for the .data section. defined in linker script */
-.word _sdata
-/* end address for the .data section. defined in linker script */
-.word _edata
-/* start address for the .bss section. defined in linker script */
-.word _sbss
-/* end address for the .bss section. defined in linker script */
-.word _ebss
+/* Init tables, built by the linker script (STM32F407VGTX_FLASH.ld):
+   copy table: {load address, start, end} per region (.data, .ccmram, .ramfunc)
+   zero table: {start, end} per region (.bss, .ccmbss) */
+.word __copy_table_start__
+.word __copy_table_end__
+.word __zero_table_start__
+.word __zero_table_end__
+
+/* Reset to main() time, read in debug mode or with startup.h:
+   Startup_ClockCycles: cycles spent in SystemInit() (clock setup)
+   Startup_Cycles: cycles from the reset to the call of main() */
+  .section .bss.Startup_Cycles,"aw",%nobits
+  .align 2
+  .global Startup_Cycles
+  .global Startup_ClockCycles
+Startup_Cycles:
+  .space 4
+Startup_ClockCycles:
+  .space 4
 
 /**
  * @brief  This is the code that gets called when the processor first
  *          starts execution following a reset event. Only the absolutely
  *          necessary set is performed, after which the application
  *          supplied main() routine is called.
+ *
+ *          - DWT CYCCNT started first, to time the reset to main()
+ *          - SystemInit() raises the clock (if RCC_STARTUP_168MHZ),
+ *            so the copies below run at 168 MHz, not on HSI
+ *          - every region of the tables is moved by 16 bytes bursts
+ *            (LDM / STM of 4 registers: one instruction fetch for 4
+ *            words), then word by word for the end. The regions are
+ *            4 bytes aligned (ALIGN(4) in the linker script)
  * @param  None
  * @retval : None
 */
@@ -57,42 +73,97 @@ defined in linker script */
 Reset_Handler:
   ldr   r0, =_estack
   mov   sp, r0          /* set stack pointer */
+
+/* Start the cycle counter: TRCENA in DEMCR, CYCCNT = 0, CYCCNTENA */
+  ldr r0, =0xE000EDFC
+  ldr r1, [r0]
+  orr r1, r1, #0x01000000
+  str r1, [r0]
+  ldr r0, =0xE0001000
+  movs r1, #0
+  str r1, [r0, #4]
+  ldr r1, [r0]
+  orr r1, r1, #1
+  str r1, [r0]
+
 /* Call the clock system initialization function.*/
   bl  SystemInit
-
-/* Copy the data segment initializers from flash to SRAM */
-  ldr r0, =_sdata
-  ldr r1, =_edata
-  ldr r2, =_sidata
+  ldr r0, =0xE0001004
+  ldr r9, [r0]          /* kept until .bss is cleared */
+
+/* Copy the regions of the copy table from flash to RAM / CCM */
+  ldr r4, =__copy_table_start__
+  ldr r5, =__copy_table_end__
+
+CopyRegion:
+  cmp r4, r5
+  bhs CopyDone
+  ldmia r4!, {r0, r1, r2}     /* r0 = load, r1 = start, r2 = end */
+  subs r2, r2, r1             /* bytes to copy */
+
+CopyBurst:
+  subs r2, r2, #16
+  bcc CopyTail
+  ldmia r0!, {r3, r6, r7, r8}
+  stmia r1!, {r3, r6, r7, r8}
+  b CopyBurst
+
+CopyTail:
+  adds r2, r2, #16
+
+CopyWord:
+  subs r2, r2, #4
+  bcc CopyRegion
+  ldr r3, [r0], #4
+  str r3, [r1], #4
+  b CopyWord
+
+CopyDone:
+
+/* Zero fill the regions of the zero table */
+  ldr r4, =__zero_table_start__
+  ldr r5, =__zero_table_end__
   movs r3, #0
-  b LoopCopyDataInit
+  movs r6, #0
+  movs r7, #0
+  mov r8, r3
 
-CopyDataInit:
-  ldr r4, [r2, r3]
-  str r4, [r0, r3]
-  adds r3, r3, #4
+ZeroRegion:
+  cmp r4, r5
+  bhs ZeroDone
+  ldmia r4!, {r1, r2}         /* r1 = start, r2 = end */
+  subs r2, r2, r1
 
-LoopCopyDataInit:
-  adds r4, r0, r3
-  cmp r4, r1
-  bcc CopyDataInit
+ZeroBurst:
+  subs r2, r2, #16
+  bcc ZeroTail
+  stmia r1!, {r3, r6, r7, r8}
+  b ZeroBurst
 
-/* Zero fill the bss segment. */
-  ldr r2, =_sbss
-  ldr r4, =_ebss
-  movs r3, #0
-  b LoopFillZerobss
+ZeroTail:
+  adds r2, r2, #16
+
+ZeroWord:
+  subs r2, r2, #4
+  bcc ZeroRegion
+  str r3, [r1], #4
+  b ZeroWord
 
-FillZerobss:
-  str  r3, [r2]
-  adds r2, r2, #4
+ZeroDone:
 
-LoopFillZerobss:
-  cmp r2, r4
-  bcc FillZerobss
+/* SystemCoreClock was written by SystemInit() before the .data copy */
+  bl SystemCoreClockUpdate
 
 /* Call static constructors */
   bl __libc_init_array
+
+/* Reset to main() time, stored now that .bss is cleared */
+  ldr r0, =0xE0001004
+  ldr r1, [r0]
+  ldr r0, =Startup_Cycles
+  str r1, [r0]
+  str r9, [r0, #4]
+
 /* Call the application's entry point.*/
   bl main
 
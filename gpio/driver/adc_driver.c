@@ -0,0 +1,494 @@
+#include "adc_driver.h"
+#include "gpio_driver.h"
+#include "rcc_driver.h"
+#include "timer_driver.h"
+#include "nvic_driver.h"
+#include "clock_gate.h"
+#include "dvfs.h"
+
+
+// =============== Clock and DMA request of each ADC ===============
+
+/*
+ * 	- bit: position in RCC_APB2ENR (section 7.3.14)
+ * 	- DMA: table 43 of the reference manual, DMA2 only. ADC1 uses
+ * 	  stream 4 (stream 0 is kept for the memory to memory copies)
+ * */
+
+typedef struct{
+	ADC_RegDef_t *base;
+	uint8_t bit;
+	uint8_t stream;
+	uint8_t channel;
+} ADC_Map;
+
+static const ADC_Map adc_map[] = {
+	{ADC1,  8, 4, 0},
+	{ADC2,  9, 3, 1},
+	{ADC3, 10, 1, 2}
+};
+
+#define NB_ADC (sizeof(adc_map)/sizeof(adc_map[0]))
+
+// Clocks held by the driver until ADC_DeInit() (clock_gate.h)
+static uint32_t adc_clk_held;             // APB2 bits of the 3 ADCs
+static uint32_t adc_port_held;            // GPIO ports of the analog pins
+
+static const ADC_Map *ADC_FindMap(ADC_RegDef_t *pADCx){
+
+	for (int i = 0; i < NB_ADC; ++i) {
+		if (adc_map[i].base == pADCx)
+			return &adc_map[i];
+	}
+
+	return 0;
+
+} /* End ADC_FindMap() */
+
+
+/*
+ * Timers whose TRGO can start the regular group
+ * (EXTSEL values, section 13.13.3)
+ * */
+
+typedef struct{
+	TIM_RegDef_t *tim;
+	uint8_t extsel;
+} ADC_Trigger;
+
+static const ADC_Trigger adc_trigger[] = {
+	{TIM2,  6},
+	{TIM3,  8},
+	{TIM8, 14}
+};
+
+#define NB_TRIGGER (sizeof(adc_trigger)/sizeof(adc_trigger[0]))
+
+static const ADC_Trigger *ADC_FindTrigger(TIM_RegDef_t *pTIMx){
+
+	for (int i = 0; i < NB_TRIGGER; ++i) {
+		if (adc_trigger[i].tim == pTIMx)
+			return &adc_trigger[i];
+	}
+
+	return 0;
+
+} /* End ADC_FindTrigger() */
+
+
+/*
+ * Analog pins (datasheet, table 7): ADC1 and ADC2 share the same
+ * pins, ADC3 has channels 4..8, 9, 14 and 15 on port F
+ * */
+
+typedef struct{
+	GPIO_RegDef_t *port;
+	uint8_t pin;
+} ADC_Pin;
+
+static const ADC_Pin adc12_pins[16] = {
+	{GPIOA, 0}, {GPIOA, 1}, {GPIOA, 2}, {GPIOA, 3},
+	{GPIOA, 4}, {GPIOA, 5}, {GPIOA, 6}, {GPIOA, 7},
+	{GPIOB, 0}, {GPIOB, 1}, {GPIOC, 0}, {GPIOC, 1},
+	{GPIOC, 2}, {GPIOC, 3}, {GPIOC, 4}, {GPIOC, 5}
+};
+
+static const ADC_Pin adc3_pins[16] = {
+	{GPIOA, 0}, {GPIOA, 1}, {GPIOA, 2}, {GPIOA, 3},
+	{GPIOF, 6}, {GPIOF, 7}, {GPIOF, 8}, {GPIOF, 9},
+	{GPIOF, 10}, {GPIOF, 3}, {GPIOC, 0}, {GPIOC, 1},
+	{GPIOC, 2}, {GPIOC, 3}, {GPIOF, 4}, {GPIOF, 5}
+};
+
+// ADCCLK cycles of each SMPx value
+static const uint16_t adc_smp_cycles[8] = {3, 15, 28, 56, 84, 112, 144, 480};
+
+#define ADCCLK_MAX 36000000U
+
+// One conversion: sampling + 12 / 10 / 8 / 6 cycles (resolution)
+static uint32_t ADC_ConvCycles(const ADC_Config_t *pConf){
+
+	return adc_smp_cycles[pConf->ADC_SampleTime & 0x7] + 12 - 2 * (pConf->ADC_Resolution & 0x3);
+
+} /* End ADC_ConvCycles() */
+
+
+/*
+ * End of one block: in double buffer mode CT already points to the
+ * buffer the DMA fills now, the one just filled is the other one
+ * */
+static void ADC_DMACallback(DMA_Handle_t *pDMAHandle, uint8_t event){
+
+	ADC_Handle_t *pADCHandle = (ADC_Handle_t*)pDMAHandle->pContext;
+
+	if (event == DMA_EVENT_ERROR){
+		// the ADC sees it as an overrun, ADC_IRQHandling() restarts
+		pADCHandle->dma_errors++;
+		return;
+	}
+
+	if (event != DMA_EVENT_TRANSFER_COMPLETE)
+		return;
+
+	const uint16_t *pBlock = (DMA_GetCurrentTarget(pDMAHandle) == 1) ?
+							 pADCHandle->pBuf0 : pADCHandle->pBuf1;
+
+	pADCHandle->blocks++;
+
+	if (pADCHandle->Callback)
+		pADCHandle->Callback(pADCHandle, pBlock, pADCHandle->BlockLen);
+
+} /* End ADC_DMACallback() */
+
+
+/*
+ * Trigger timer: one update event per scan, TRGO = update
+ * Returns the real rate, 0 if the rate can't be made
+ * */
+static uint32_t ADC_TriggerConfig(const ADC_Trigger *trig, uint32_t Rate){
+
+	TIM_RegDef_t *pTIMx = trig->tim;
+
+	TIM_ClockHold(pTIMx);
+
+	// stopped, and no trigger sent while TIM_SetFrequency() loads PSC
+	pTIMx->CR1 = 0;
+	TIM_SetTrgo(pTIMx, TIM_TRGO_RESET);
+
+	uint32_t rate = TIM_SetFrequency(pTIMx, Rate);
+
+	TIM_SetTrgo(pTIMx, TIM_TRGO_UPDATE);
+
+	return rate;
+
+} /* End ADC_TriggerConfig() */
+
+// =========================================================
+
+
+void ADC_PeriClockControl(ADC_RegDef_t *pADCx, uint8_t ON_OFF){
+
+	const ADC_Map *map = ADC_FindMap(pADCx);
+
+	if (map == 0)
+		return;
+
+	CLK_PeriClockControl(CLK_APB2, map->bit, ON_OFF);
+
+} /* End ADC_PeriClockControl() */
+
+
+void ADC_DeInit(void){
+
+	// ADCRST, bit 8 of RCC_APB2RSTR, common to the 3 ADCs
+	RCC->APB2RSTR |= (1 << 8);
+	RCC->APB2RSTR &= ~(1 << 8);
+
+	CLK_DropAll(&adc_clk_held, CLK_APB2);
+	CLK_DropAll(&adc_port_held, CLK_AHB1);
+
+} /* End ADC_DeInit() */
+
+
+drv_status ADC_PinInit(ADC_RegDef_t *pADCx, uint8_t Channel){
+
+	if (Channel > ADC_CHANNEL_VBAT)
+		return DRV_ERROR;
+
+	if (Channel >= ADC_CHANNEL_TEMP)
+		return DRV_OK;   // internal channel, no pin
+
+	const ADC_Pin *p = (pADCx == ADC3) ? &adc3_pins[Channel] : &adc12_pins[Channel];
+
+	GPIO_Handle_t pin;
+
+	GPIO_ClockHold(p->port, &adc_port_held);
+
+	pin.gpio_reg_x = p->port;
+	pin.gpio_pin_conf.GPIO_PinNumber = p->pin;
+	pin.gpio_pin_conf.GPIO_PinMode = ANALOG;
+	pin.gpio_pin_conf.GPIO_PinSpeed = LOW;
+	pin.gpio_pin_conf.GPIO_PinOPType = PUSH_PULL;
+	pin.gpio_pin_conf.GPIO_PinPuPdControl = NO_PULLUP;
+	pin.gpio_pin_conf.GPIO_PinAltFunMode = 0;
+
+	GPIO_Init(&pin);
+
+	return DRV_OK;
+
+} /* End ADC_PinInit() */
+
+
+drv_status ADC_Init(ADC_Handle_t *pADCHandle){
+
+	ADC_RegDef_t *pADCx = pADCHandle->pADCx;
+	ADC_Config_t *pConf = &pADCHandle->ADC_Config;
+
+	const ADC_Map *map = ADC_FindMap(pADCx);
+	const ADC_Trigger *trig = ADC_FindTrigger(pConf->pTriggerTIMx);
+
+	uint8_t nb = pConf->ADC_NbChannels;
+
+	if (map == 0 || trig == 0 || nb == 0 || nb > ADC_MAX_CHANNELS)
+		return DRV_ERROR;
+
+	// whole scans in a block, even length for the FIFO word packing
+	if (pADCHandle->BlockLen == 0 || (pADCHandle->BlockLen % nb) != 0 ||
+		(pADCHandle->BlockLen & 1) || pADCHandle->pBuf0 == 0 || pADCHandle->pBuf1 == 0)
+		return DRV_ERROR;
+
+	pADCHandle->blocks = 0;
+	pADCHandle->overruns = 0;
+	pADCHandle->dma_errors = 0;
+
+	// 1. ADCCLK and time of one scan
+	uint32_t adcclk = RCC_GetPCLK2Value() / (2 * ((pConf->ADC_Prescaler & 0x3) + 1));
+
+	if (adcclk > ADCCLK_MAX)
+		return DRV_ERROR;
+
+	uint32_t conv = ADC_ConvCycles(pConf);
+
+	/*
+	 * 2. Trigger timer, then check that the scan is over before the
+	 *    next trigger (a trigger during a scan is ignored, so the
+	 *    rate would silently be divided by 2)
+	 * */
+	uint32_t rate = ADC_TriggerConfig(trig, pConf->ADC_ScanRate);
+
+	if (rate == 0 || (uint64_t)nb * conv * rate >= adcclk)
+		return DRV_ERROR;
+
+	pADCHandle->ScanRate = rate;
+
+	// 3. Pins in ANALOG mode
+	for (int i = 0; i < nb; ++i) {
+		if (ADC_PinInit(pADCx, pConf->ADC_Channels[i]) != DRV_OK)
+			return DRV_ERROR;
+	}
+
+	// 4. ADC, one reference held until ADC_DeInit()
+	CLK_Hold(&adc_clk_held, CLK_APB2, map->bit);
+
+	pADCx->CR2 = 0;
+
+	ADC_COMMON->CCR &= ~((0x3 << ADC_CCR_ADCPRE) | (1 << ADC_CCR_TSVREFE) | (1 << ADC_CCR_VBATE));
+	ADC_COMMON->CCR |= ((uint32_t)(pConf->ADC_Prescaler & 0x3) << ADC_CCR_ADCPRE);
+
+	pADCx->CR1 = (1 << ADC_CR1_SCAN) | (1 << ADC_CR1_OVRIE) |
+				 ((uint32_t)(pConf->ADC_Resolution & 0x3) << ADC_CR1_RES);
+
+	/*
+	 * Sequence: SQ1..SQ6 in SQR3, SQ7..SQ12 in SQR2, SQ13..SQ16 in SQR1,
+	 * 5 bits each, L = number of conversions - 1
+	 * Sampling time: channels 0..9 in SMPR2, 10..18 in SMPR1, 3 bits each
+	 * */
+	uint32_t sqr[3] = {0, 0, (uint32_t)(nb - 1) << ADC_SQR1_L};
+	uint32_t smpr1 = 0, smpr2 = 0;
+	uint32_t smp = pConf->ADC_SampleTime & 0x7;
+
+	for (int i = 0; i < nb; ++i) {
+
+		uint8_t ch = pConf->ADC_Channels[i];
+
+		sqr[i / 6] |= ((uint32_t)ch << (5 * (i % 6)));
+
+		if (ch < 10)
+			smpr2 |= (smp << (3 * ch));
+		else
+			smpr1 |= (smp << (3 * (ch - 10)));
+
+		if (ch == ADC_CHANNEL_TEMP || ch == ADC_CHANNEL_VREFINT)
+			ADC_COMMON->CCR |= (1 << ADC_CCR_TSVREFE);
+		else if (ch == ADC_CHANNEL_VBAT)
+			ADC_COMMON->CCR |= (1 << ADC_CCR_VBATE);
+
+	} /* End for channels */
+
+	pADCx->SQR3 = sqr[0];
+	pADCx->SQR2 = sqr[1];
+	pADCx->SQR1 = sqr[2];
+	pADCx->SMPR1 = smpr1;
+	pADCx->SMPR2 = smpr2;
+
+	/*
+	 * CR2: trigger on the rising edge of the timer TRGO, DMA requests
+	 * for every conversion (DDS = 1), ADON now so the ADC is stable
+	 * (tSTAB, 3 us) long before ADC_Start()
+	 * */
+	pADCx->CR2 = (1 << ADC_CR2_DMA) | (1 << ADC_CR2_DDS) |
+				 ((uint32_t)trig->extsel << ADC_CR2_EXTSEL) |
+				 (0x1 << ADC_CR2_EXTEN) | (1 << ADC_CR2_ADON);
+
+	/*
+	 * 5. DMA stream: 16 bits from DR, packed 2 by 2 by the FIFO into
+	 *    32 bits writes, double buffer, very high priority (a late
+	 *    read of DR is an overrun)
+	 * */
+	DMA_Handle_t *pDMA = &pADCHandle->dma;
+
+	pDMA->pDMAx = DMA2;
+	pDMA->Stream = map->stream;
+	pDMA->DMA_Config.DMA_Channel = map->channel;
+	pDMA->DMA_Config.DMA_Direction = DMA_DIR_PERIPH_TO_MEM;
+	pDMA->DMA_Config.DMA_PeriphInc = OFF;
+	pDMA->DMA_Config.DMA_MemInc = ON;
+	pDMA->DMA_Config.DMA_PeriphDataSize = DMA_SIZE_HALFWORD;
+	pDMA->DMA_Config.DMA_MemDataSize = DMA_SIZE_WORD;
+	pDMA->DMA_Config.DMA_Circular = ON;
+	pDMA->DMA_Config.DMA_DoubleBuffer = ON;
+	pDMA->DMA_Config.DMA_Priority = DMA_PRIO_VERY_HIGH;
+	pDMA->DMA_Config.DMA_HalfTransferIT = OFF;
+	pDMA->DMA_Config.DMA_FIFOMode = ON;
+	pDMA->DMA_Config.DMA_FIFOThreshold = DMA_FIFO_1_4;
+	pDMA->DMA_Config.DMA_MemBurst = DMA_BURST_SINGLE;
+	pDMA->DMA_Config.DMA_PeriphBurst = DMA_BURST_SINGLE;
+	pDMA->Callback = ADC_DMACallback;
+	pDMA->pContext = pADCHandle;
+
+	// DRV_BUSY: the stream is taken by another driver (dma_driver.h)
+	drv_status status = DMA_Init(pDMA);
+
+	if (status != DRV_OK)
+		return status;
+
+	NVIC_IRQInterruptConfig(IRQ_NO_ADC, ON);
+
+	return DRV_OK;
+
+} /* End ADC_Init() */
+
+
+drv_status ADC_Start(ADC_Handle_t *pADCHandle){
+
+	ADC_RegDef_t *pADCx = pADCHandle->pADCx;
+	TIM_RegDef_t *pTIMx = pADCHandle->ADC_Config.pTriggerTIMx;
+
+	// the scan no longer fits in the trigger period (ADC_DVFSNotify())
+	if (pADCHandle->ScanRate == 0)
+		return DRV_ERROR;
+
+	/*
+	 * NDTR counts peripheral items (half words), so BlockLen samples
+	 * per buffer. DMA bit toggled: fresh request state in the ADC
+	 * */
+	pADCx->CR2 &= ~(1 << ADC_CR2_DMA);
+	pADCx->SR &= ~(1 << ADC_SR_OVR);
+
+	if (DMA_Start(&pADCHandle->dma, (uint32_t)&pADCx->DR, (uint32_t)pADCHandle->pBuf0,
+				  (uint32_t)pADCHandle->pBuf1, pADCHandle->BlockLen) != DRV_OK)
+		return DRV_ERROR;
+
+	pADCx->CR2 |= (1 << ADC_CR2_DMA);
+
+	// from now on, every update of the timer starts one scan
+	pTIMx->CNT = 0;
+	pTIMx->CR1 |= (1 << TIM_CR1_CEN);
+
+	return DRV_OK;
+
+} /* End ADC_Start() */
+
+
+void ADC_Stop(ADC_Handle_t *pADCHandle){
+
+	ADC_RegDef_t *pADCx = pADCHandle->pADCx;
+
+	// no trigger anymore, then wait for the end of the scan in progress
+	pADCHandle->ADC_Config.pTriggerTIMx->CR1 &= ~(1 << TIM_CR1_CEN);
+
+	// blocks hold whole scans: NDTR is a multiple of the scan length between scans
+	uint8_t nb = pADCHandle->ADC_Config.ADC_NbChannels;
+
+	for (uint32_t t = 0; t < 100000; ++t) {
+		if ((DMA_GetRemaining(&pADCHandle->dma) % nb) == 0)
+			break;
+	}
+
+	DMA_Release(&pADCHandle->dma);
+	pADCx->CR2 &= ~(1 << ADC_CR2_DMA);
+
+} /* End ADC_Stop() */
+
+
+/*
+ * Overrun: the ADC stopped its DMA requests and ignores the triggers
+ * until OVR is cleared. Recovery of section 13.8.1: restart the DMA
+ * stream, clear OVR, the next trigger starts again from SQ1. The
+ * samples of the block in progress are lost (not given to Callback)
+ * */
+void ADC_IRQHandling(ADC_Handle_t *pADCHandle){
+
+	ADC_RegDef_t *pADCx = pADCHandle->pADCx;
+
+	if (!(pADCx->SR & (1 << ADC_SR_OVR)))
+		return;   // IRQ shared by the 3 ADCs, not this one
+
+	pADCHandle->overruns++;
+
+	DMA_Stop(&pADCHandle->dma);
+
+	pADCx->CR2 &= ~(1 << ADC_CR2_DMA);
+	pADCx->SR &= ~(1 << ADC_SR_OVR);
+
+	// refused (stream taken by another handle): sampling stops, ADC_Stop() as usual
+	if (DMA_Start(&pADCHandle->dma, (uint32_t)&pADCx->DR, (uint32_t)pADCHandle->pBuf0,
+				  (uint32_t)pADCHandle->pBuf1, pADCHandle->BlockLen) != DRV_OK){
+		pADCHandle->ADC_Config.pTriggerTIMx->CR1 &= ~(1 << TIM_CR1_CEN);
+		pADCHandle->dma_errors++;
+		return;
+	}
+
+	pADCx->CR2 |= (1 << ADC_CR2_DMA);
+
+} /* End ADC_IRQHandling() */
+
+
+/*
+ * Clock change (dvfs.h): ADCCLK comes from PCLK2 and the trigger
+ * timer from its APB timer clock, both move. Refused while sampling
+ * (trigger timer running), ADC_Stop() first.
+ * 	- ADCPRE: the prescaler of the config, or the next larger one when
+ * 	  ADCCLK would go above 36 MHz
+ * 	- trigger timer computed again for ADC_ScanRate
+ * If the scan no longer fits in the trigger period at the new clock,
+ * ScanRate is set to 0 and ADC_Start() refuses to run
+ * */
+drv_status ADC_DVFSNotify(uint8_t Event, void *pContext){
+
+	ADC_Handle_t *pADCHandle = pContext;
+	ADC_Config_t *pConf = &pADCHandle->ADC_Config;
+
+	const ADC_Trigger *trig = ADC_FindTrigger(pConf->pTriggerTIMx);
+
+	if (trig == 0)
+		return DRV_ERROR;
+
+	if (Event == DVFS_PRE_CHANGE)
+		return (trig->tim->CR1 & (1 << TIM_CR1_CEN)) ? DRV_BUSY : DRV_OK;
+
+	if (Event != DVFS_POST_CHANGE)
+		return DRV_OK;
+
+	uint32_t pclk2 = RCC_GetPCLK2Value();
+	uint8_t pre = pConf->ADC_Prescaler & 0x3;
+
+	while (pre < ADC_DIV8 && pclk2 / (2 * (pre + 1)) > ADCCLK_MAX)
+		pre++;
+
+	uint32_t adcclk = pclk2 / (2 * (pre + 1));
+
+	ADC_COMMON->CCR = (ADC_COMMON->CCR & ~(0x3 << ADC_CCR_ADCPRE)) | ((uint32_t)pre << ADC_CCR_ADCPRE);
+
+	uint32_t rate = ADC_TriggerConfig(trig, pConf->ADC_ScanRate);
+
+	if (rate == 0 || (uint64_t)pConf->ADC_NbChannels * ADC_ConvCycles(pConf) * rate >= adcclk){
+		pADCHandle->ScanRate = 0;
+		return DRV_ERROR;
+	}
+
+	pADCHandle->ScanRate = rate;
+
+	return DRV_OK;
+
+} /* End ADC_DVFSNotify() */
@@ -0,0 +1,142 @@
+
+#pragma once
+
+#include "stm32f407G.h"
+#include "dma_driver.h"
+
+/*
+ * ADC driver: timer triggered scan, DMA into ping-pong buffers
+ *
+ * Goal: sample N channels at a fixed rate with no CPU work per sample
+ *
+ * 	- a timer (TIM2, TIM3 or TIM8) gives one update event per sample
+ * 	  period, its TRGO output starts one scan of the regular sequence
+ * 	  (external trigger of the ADC, section 13.6)
+ * 	- scan mode converts ADC_Channels[0..NbChannels-1] in a row, each
+ * 	  result goes to DR and makes a DMA request (DMA = 1, DDS = 1 so
+ * 	  the requests never stop after the first DMA transfer)
+ * 	- the DMA stream runs in double buffer mode: it fills pBuf0, then
+ * 	  pBuf1, then pBuf0 again,... and the callback is called at the end
+ * 	  of each block with the buffer just filled, while the DMA already
+ * 	  writes the other one. The callback must be done before the DMA
+ * 	  comes back, that is BlockLen / NbChannels sample periods
+ * 	- the DMA FIFO packs 2 samples in one word write to the SRAM,
+ * 	  half of the bus accesses on the memory side
+ *
+ * 	Samples are interleaved: pBlock[k * NbChannels + i] is channel
+ * 	ADC_Channels[i] of scan k
+ *
+ * 	Max rate: ADCCLK = PCLK2 / prescaler (max 36 MHz, datasheet), one
+ * 	conversion is (sampling + 12) ADCCLK cycles at 12 bits:
+ * 		- 3 cycles sampling, ADCCLK 36 MHz -> 2.4 MS/s
+ * 		- 3 cycles sampling, reset clocks (PCLK2 = 16 MHz, /2) -> 533 kS/s
+ * 	ADC_Init() refuses a rate which leaves no time for the scan
+ *
+ * 	Overrun (OVR): the DMA did not read DR in time (bus too busy, or
+ * 	the stream stopped), the ADC stops the DMA requests. The IRQ
+ * 	handler counts it and restarts the stream (section 13.8.1). If
+ * 	the stream can't be started again, the trigger timer is stopped
+ * 	and dma_errors counts it
+ *
+ * 	DMA streams (table 43): ADC1 -> DMA2 stream 4 ch 0,
+ * 	ADC2 -> DMA2 stream 3 ch 1, ADC3 -> DMA2 stream 1 ch 2
+ *
+ * IRQ handlers, example ADC1 (ADC1, ADC2 and ADC3 share the ADC IRQ):
+ *
+ * 		void DMA2_Stream4_IRQHandler(void){ DMA_IRQHandling(&adc1.dma); }
+ * 		void ADC_IRQHandler(void){ ADC_IRQHandling(&adc1); }
+ *
+ * */
+
+#define ADC_MAX_CHANNELS 16   // length of the regular sequence
+
+// channels 16, 17 and 18 are internal: temperature sensor, VREFINT, VBAT
+#define ADC_CHANNEL_TEMP    16
+#define ADC_CHANNEL_VREFINT 17
+#define ADC_CHANNEL_VBAT    18
+
+// ------------ Coding states for ADC configuration ------------
+
+// SMPx bits, sampling time in ADCCLK cycles
+typedef enum ADC_SampleTime {ADC_SMP_3, ADC_SMP_15, ADC_SMP_28, ADC_SMP_56,
+							 ADC_SMP_84, ADC_SMP_112, ADC_SMP_144,
+							 ADC_SMP_480} adc_smp;
+
+// RES bits of CR1
+typedef enum ADC_Resolution {ADC_RES_12BITS, ADC_RES_10BITS,
+							 ADC_RES_8BITS, ADC_RES_6BITS} adc_res;
+
+// ADCPRE bits of ADC_CCR: ADCCLK = PCLK2 / 2, 4, 6 or 8
+typedef enum ADC_Prescaler {ADC_DIV2, ADC_DIV4, ADC_DIV6, ADC_DIV8} adc_pre;
+
+
+typedef struct{
+
+	uint8_t ADC_Channels[ADC_MAX_CHANNELS];  // scan order, 0..18
+	uint8_t ADC_NbChannels;
+	uint8_t ADC_SampleTime;       // same for all the channels
+	uint8_t ADC_Resolution;
+	uint8_t ADC_Prescaler;
+
+	TIM_RegDef_t *pTriggerTIMx;   // TIM2, TIM3 or TIM8
+	uint32_t ADC_ScanRate;        // scans per second (Hz)
+
+} ADC_Config_t;
+
+
+typedef struct ADC_Handle ADC_Handle_t;
+
+// pBlock: the buffer just filled, Len samples (BlockLen)
+typedef void (*adc_block_cb_t)(ADC_Handle_t *pADCHandle,
+							   const uint16_t *pBlock, uint16_t Len);
+
+struct ADC_Handle{
+
+	ADC_RegDef_t *pADCx;
+	// ADC1, ADC2 or ADC3
+
+	ADC_Config_t ADC_Config;
+
+	// Ping-pong buffers, BlockLen samples each (even, multiple of
+	// ADC_NbChannels), 4 bytes aligned
+	uint16_t *pBuf0;
+	uint16_t *pBuf1;
+	uint16_t BlockLen;
+
+	adc_block_cb_t Callback;      // called from the DMA ISR
+	void *pContext;
+
+	// Filled by the driver
+	DMA_Handle_t dma;
+
+	uint32_t ScanRate;            // real rate, after rounding of the timer, 0: see ADC_DVFSNotify()
+
+	__vo uint32_t blocks;         // statistics
+	__vo uint32_t overruns;
+	__vo uint32_t dma_errors;
+
+};
+
+
+// ================== API ==================
+
+void ADC_PeriClockControl(ADC_RegDef_t *pADCx, uint8_t ON_OFF);
+
+// Resets the 3 ADCs (only one reset bit for all of them), gives back
+// the clocks of the ADCs and of their pins held by ADC_Init()
+void ADC_DeInit(void);
+
+// Pin of a channel in ANALOG mode (nothing to do for 16..18)
+drv_status ADC_PinInit(ADC_RegDef_t *pADCx, uint8_t Channel);
+
+// ADC, DMA and trigger timer, also the pins, nothing runs yet
+drv_status ADC_Init(ADC_Handle_t *pADCHandle);
+
+drv_status ADC_Start(ADC_Handle_t *pADCHandle);
+
+void ADC_Stop(ADC_Handle_t *pADCHandle);
+
+void ADC_IRQHandling(ADC_Handle_t *pADCHandle);
+
+// dvfs_callback_t, pContext = the ADC_Handle_t: ADCCLK and scan rate after a clock change
+drv_status ADC_DVFSNotify(uint8_t Event, void *pContext);
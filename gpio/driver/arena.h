@@ -0,0 +1,138 @@
+/*
+ * Goal: scratch memory for one frame of processing (DSP block,
+ * protocol message), taken and given back all at once
+ *
+ * 	- an arena = one static array and an offset: an allocation
+ * 	  aligns the offset and moves it, a few cycles, no list, no
+ * 	  free of a single buffer
+ * 	- Arena_Mark() saves the offset, Arena_Rewind() goes back to it:
+ * 	  everything allocated since the mark is given back at once.
+ * 	  Marks nest like scopes (frame -> filter stage -> encoder)
+ * 	- alignment power of 2 given at each call: ARENA_ALIGN_WORD for
+ * 	  float / q15 SIMD loads (LDRD, LDM need words), ARENA_ALIGN_DMA
+ * 	  for the DMA buffers (a 4 beats burst of words must not cross a
+ * 	  1 KB boundary, section 10.3.11: 32 bytes blocks never do)
+ * 	- several independent arenas: one in CCM (mem_sections.h) for the
+ * 	  CPU only work buffers, one in SRAM for the DMA buffers,...
+ * 	- high_water: largest offset reached, to size the storage.
+ * 	  failed: allocations refused (arena full, 0 returned)
+ * 	- no lock: an arena belongs to one context (main loop or one
+ * 	  ISR). An ISR needs its own arena, or mem_pool.h
+ *
+ * 		ARENA_STORAGE(dsp_storage, 4096);
+ * 		Arena_t dsp;
+ *
+ * 		Arena_Init(&dsp, dsp_storage, sizeof(dsp_storage));
+ *
+ * 		uint32_t mark = Arena_Mark(&dsp);
+ * 		float *pWork = Arena_Alloc(&dsp, N * sizeof(float), ARENA_ALIGN_WORD);
+ * 		...
+ * 		Arena_Rewind(&dsp, mark);      // end of the frame
+ *
+ * */
+
+#pragma once
+
+#include <stdint.h>
+#include "stm32f407G.h"
+#include "mem_sections.h"
+
+#define ARENA_ALIGN_WORD  4U
+#define ARENA_ALIGN_DMA   32U
+
+// Storage aligned for the largest alignment, the offsets stay relative
+#define ARENA_STORAGE(name, size) \
+	static uint8_t name[size] __attribute__((aligned(ARENA_ALIGN_DMA)))
+
+// Same in CCM RAM: CPU only buffers, never for the DMA
+#define ARENA_STORAGE_CCM(name, size) \
+	static __ccm_bss uint8_t name[size] __attribute__((aligned(ARENA_ALIGN_DMA)))
+
+typedef struct{
+
+	uint8_t *pBase;          // storage given by the user
+	uint32_t Size;
+	uint32_t offset;         // first free byte
+
+	uint32_t high_water;
+	uint32_t failed;
+
+} Arena_t;
+
+
+static inline drv_status Arena_Init(Arena_t *pArena, void *pStorage, uint32_t Size){
+
+	if (pStorage == 0 || ((uint32_t)pStorage & (ARENA_ALIGN_DMA - 1)))
+		return DRV_ERROR;
+
+	pArena->pBase = pStorage;
+	pArena->Size = Size;
+	pArena->offset = 0;
+	pArena->high_water = 0;
+	pArena->failed = 0;
+
+	return DRV_OK;
+
+} /* End Arena_Init() */
+
+
+/*
+ * Align must be a power of 2, at most ARENA_ALIGN_DMA (the alignment
+ * of the base): aligning the offset then aligns the address. Align 0
+ * means 1, any other value is refused (0 returned, failed + 1)
+ * */
+static inline void *Arena_Alloc(Arena_t *pArena, uint32_t Size, uint32_t Align){
+
+	if (Align == 0)
+		Align = 1;
+
+	if ((Align & (Align - 1)) || Align > ARENA_ALIGN_DMA){
+		pArena->failed++;
+		return 0;
+	}
+
+	uint32_t start = (pArena->offset + Align - 1) & ~(Align - 1);
+
+	if (Size > pArena->Size - start || start > pArena->Size){
+		pArena->failed++;
+		return 0;
+	}
+
+	pArena->offset = start + Size;
+
+	if (pArena->offset > pArena->high_water)
+		pArena->high_water = pArena->offset;
+
+	return pArena->pBase + start;
+
+} /* End Arena_Alloc() */
+
+
+static inline uint32_t Arena_Mark(const Arena_t *pArena){
+
+	return pArena->offset;
+
+} /* End Arena_Mark() */
+
+
+// Gives back everything allocated after the mark
+static inline void Arena_Rewind(Arena_t *pArena, uint32_t Mark){
+
+	if (Mark <= pArena->offset)
+		pArena->offset = Mark;
+
+} /* End Arena_Rewind() */
+
+
+static inline void Arena_Reset(Arena_t *pArena){
+
+	pArena->offset = 0;
+
+} /* End Arena_Reset() */
+
+
+static inline uint32_t Arena_Free(const Arena_t *pArena){
+
+	return pArena->Size - pArena->offset;
+
+} /* End Arena_Free() */
@@ -0,0 +1,190 @@
+#include "clock_gate.h"
+#include "nvic_driver.h"
+
+
+// =============== Enable register of each bus ===============
+
+typedef struct{
+	__vo uint32_t *enr;
+	uint32_t valid;
+	uint32_t keep;
+} CLK_Map;
+
+static const CLK_Map clk_map[CLK_NB_BUSES] = {
+	[CLK_AHB1] = {&RCC->AHB1ENR, CLK_AHB1_VALID, CLK_AHB1_KEEP},
+	[CLK_AHB2] = {&RCC->AHB2ENR, CLK_AHB2_VALID, 0},
+	[CLK_AHB3] = {&RCC->AHB3ENR, CLK_AHB3_VALID, 0},
+	[CLK_APB1] = {&RCC->APB1ENR, CLK_APB1_VALID, 0},
+	[CLK_APB2] = {&RCC->APB2ENR, CLK_APB2_VALID, 0},
+};
+
+static uint8_t clk_refs[CLK_NB_BUSES][32];
+
+
+static uint8_t CLK_IsValid(uint8_t Bus, uint8_t Bit){
+
+	return (Bus < CLK_NB_BUSES) && (Bit < 32) &&
+		   (clk_map[Bus].valid & (1U << Bit));
+
+} /* End CLK_IsValid() */
+
+
+// =============== References ===============
+
+drv_status CLK_Acquire(uint8_t Bus, uint8_t Bit){
+
+	if (!CLK_IsValid(Bus, Bit))
+		return DRV_ERROR;
+
+	uint32_t state = IRQ_EnterCritical(0);
+
+	uint8_t *pRef = &clk_refs[Bus][Bit];
+
+	if (*pRef < 0xFF)
+		(*pRef)++;
+
+	if (*pRef == 1){
+		*clk_map[Bus].enr |= (1U << Bit);
+		(void)*clk_map[Bus].enr;    // 2 cycles before the first access
+	}
+
+	IRQ_ExitCritical(state);
+
+	return DRV_OK;
+
+} /* End CLK_Acquire() */
+
+
+void CLK_Release(uint8_t Bus, uint8_t Bit){
+
+	if (!CLK_IsValid(Bus, Bit))
+		return;
+
+	uint32_t state = IRQ_EnterCritical(0);
+
+	uint8_t *pRef = &clk_refs[Bus][Bit];
+
+	// 0: never acquired, 0xFF: saturated, kept on for good
+	if (*pRef != 0 && *pRef != 0xFF){
+
+		(*pRef)--;
+
+		if (*pRef == 0 && !(clk_map[Bus].keep & (1U << Bit)))
+			*clk_map[Bus].enr &= ~(1U << Bit);
+
+	}
+
+	IRQ_ExitCritical(state);
+
+} /* End CLK_Release() */
+
+
+void CLK_PeriClockControl(uint8_t Bus, uint8_t Bit, uint8_t ON_OFF){
+
+	if (ON_OFF == ON)
+		CLK_Acquire(Bus, Bit);
+	else
+		CLK_Release(Bus, Bit);
+
+} /* End CLK_PeriClockControl() */
+
+
+drv_status CLK_Hold(uint32_t *pHeld, uint8_t Bus, uint8_t Bit){
+
+	if (!CLK_IsValid(Bus, Bit))
+		return DRV_ERROR;
+
+	uint32_t state = IRQ_EnterCritical(0);
+
+	if (!(*pHeld & (1U << Bit))){
+		*pHeld |= (1U << Bit);
+		CLK_Acquire(Bus, Bit);
+	}
+
+	IRQ_ExitCritical(state);
+
+	return DRV_OK;
+
+} /* End CLK_Hold() */
+
+
+void CLK_Drop(uint32_t *pHeld, uint8_t Bus, uint8_t Bit){
+
+	if (!CLK_IsValid(Bus, Bit))
+		return;
+
+	uint32_t state = IRQ_EnterCritical(0);
+
+	if (*pHeld & (1U << Bit)){
+		*pHeld &= ~(1U << Bit);
+		CLK_Release(Bus, Bit);
+	}
+
+	IRQ_ExitCritical(state);
+
+} /* End CLK_Drop() */
+
+
+void CLK_DropAll(uint32_t *pHeld, uint8_t Bus){
+
+	for (uint8_t bit = 0; bit < 32; ++bit)
+		CLK_Drop(pHeld, Bus, bit);
+
+} /* End CLK_DropAll() */
+
+
+// =============== Query ===============
+
+uint8_t CLK_GetRefCount(uint8_t Bus, uint8_t Bit){
+
+	return CLK_IsValid(Bus, Bit) ? clk_refs[Bus][Bit] : 0;
+
+} /* End CLK_GetRefCount() */
+
+
+uint32_t CLK_GetLiveMask(uint8_t Bus){
+
+	uint32_t mask = 0;
+
+	if (Bus >= CLK_NB_BUSES)
+		return 0;
+
+	for (uint8_t bit = 0; bit < 32; ++bit){
+		if (clk_refs[Bus][bit])
+			mask |= (1U << bit);
+	}
+
+	return mask;
+
+} /* End CLK_GetLiveMask() */
+
+
+uint32_t CLK_GetEnabledMask(uint8_t Bus){
+
+	return (Bus < CLK_NB_BUSES) ? *clk_map[Bus].enr : 0;
+
+} /* End CLK_GetEnabledMask() */
+
+
+uint32_t CLK_GateUnused(void){
+
+	uint32_t gated = 0;
+
+	for (uint8_t bus = 0; bus < CLK_NB_BUSES; ++bus){
+
+		uint32_t state = IRQ_EnterCritical(0);
+
+		uint32_t off = *clk_map[bus].enr & ~CLK_GetLiveMask(bus) &
+					   ~clk_map[bus].keep & clk_map[bus].valid;
+
+		*clk_map[bus].enr &= ~off;
+
+		IRQ_ExitCritical(state);
+
+		gated += __builtin_popcount(off);
+
+	}
+
+	return gated;
+
+} /* End CLK_GateUnused() */
@@ -0,0 +1,94 @@
+#pragma once
+
+#include "stm32f407G.h"
+
+/*
+ * Peripheral clock manager: one reference counter per enable bit of
+ * RCC_AHB1ENR, AHB2ENR, AHB3ENR, APB1ENR and APB2ENR (sections 7.3.10
+ * to 7.3.14)
+ *
+ * 	Problem: GPIO_PeriClockControl(GPIOD, OFF) from one module stops
+ * 	GPIOD for every other module using it. Here:
+ *
+ * 	- CLK_Acquire(): counter + 1, the bit is set when it goes 0 -> 1
+ * 	- CLK_Release(): counter - 1, the bit is cleared when it goes
+ * 	  1 -> 0, a release without acquire does nothing
+ * 	- the xxx_PeriClockControl() functions of the drivers call them:
+ * 	  ON acquires, OFF releases, one reference per call (255: the
+ * 	  counter stays there, clock on for good). So OFF only stops a
+ * 	  peripheral once every user which turned it ON turned it OFF
+ * 	- the drivers themselves hold one reference per owner (peripheral,
+ * 	  DMA stream, pins of a peripheral) with CLK_Hold(): an Init
+ * 	  called again takes no new one. The DeInit / Stop of the owner
+ * 	  gives it back (CLK_Drop(), CLK_DropAll())
+ * 	- CLK_GateUnused(): clears every enabled bit nobody holds, for
+ * 	  the clocks set directly in RCC (raw GPIOx_CLK_ON(), debugger,
+ * 	  older code). The CCM RAM clock is never cleared: the stack is
+ * 	  there (mem_sections.h)
+ * 	- a peripheral without clock keeps its registers, reads give 0
+ * 	  and writes are lost until the clock comes back
+ * 	- after the bit is set, the enable register is read back: the
+ * 	  clock needs 2 bus cycles before the first access (errata
+ * 	  sheet ES0182, "delay after an RCC peripheral clock enabling")
+ *
+ * 	Thread mode and ISRs may both call it (short PRIMASK section)
+ *
+ * Usage:
+ * 		CLK_Acquire(CLK_AHB1, CLK_AHB1_GPIOD);
+ * 		... GPIOD used ...
+ * 		CLK_Release(CLK_AHB1, CLK_AHB1_GPIOD);
+ * */
+
+typedef enum CLK_Bus {CLK_AHB1, CLK_AHB2, CLK_AHB3, CLK_APB1, CLK_APB2,
+					  CLK_NB_BUSES} clk_bus;
+
+// Some bits, the others are in the drivers' maps
+#define CLK_AHB1_GPIOA        0     // GPIOx: bit = port index
+#define CLK_AHB1_GPIOD        3
+#define CLK_AHB1_BKPSRAM      18
+#define CLK_AHB1_CCMDATARAM   20
+#define CLK_AHB1_DMA1         21
+#define CLK_AHB1_DMA2         22
+#define CLK_APB1_PWR          28
+#define CLK_APB2_SYSCFG       14
+
+// Existing bits of each register on the stm32f407 (the others are reserved)
+#define CLK_AHB1_VALID  0x7E7411FFU
+#define CLK_AHB2_VALID  0x000000F1U
+#define CLK_AHB3_VALID  0x00000001U
+#define CLK_APB1_VALID  0x36FEC9FFU
+#define CLK_APB2_VALID  0x00075F33U
+
+// Never cleared by CLK_GateUnused()
+#define CLK_AHB1_KEEP   (1U << CLK_AHB1_CCMDATARAM)
+
+// ================== API ==================
+
+drv_status CLK_Acquire(uint8_t Bus, uint8_t Bit);
+
+void CLK_Release(uint8_t Bus, uint8_t Bit);
+
+// ON -> CLK_Acquire(), OFF -> CLK_Release(), for the drivers
+void CLK_PeriClockControl(uint8_t Bus, uint8_t Bit, uint8_t ON_OFF);
+
+/*
+ * References of an owner on one bus: *pHeld has a bit set for each
+ * clock it holds, CLK_Hold() only acquires a bit not held yet
+ * */
+drv_status CLK_Hold(uint32_t *pHeld, uint8_t Bus, uint8_t Bit);
+
+void CLK_Drop(uint32_t *pHeld, uint8_t Bus, uint8_t Bit);
+
+// Releases every bit of *pHeld
+void CLK_DropAll(uint32_t *pHeld, uint8_t Bus);
+
+uint8_t CLK_GetRefCount(uint8_t Bus, uint8_t Bit);
+
+// Bits with at least one reference
+uint32_t CLK_GetLiveMask(uint8_t Bus);
+
+// Bits set in the enable register, held or not
+uint32_t CLK_GetEnabledMask(uint8_t Bus);
+
+// Clears the enabled bits without reference, returns how many
+uint32_t CLK_GateUnused(void);
@@ -0,0 +1,405 @@
+#include "dma_driver.h"
+#include "nvic_driver.h"
+#include "clock_gate.h"
+
+
+// =============== Stream helpers ===============
+
+/*
+ * Position of the 6 flags of a stream inside LISR (stream 0..3)
+ * or HISR (stream 4..7), see section 10.5.1
+ * */
+static const uint8_t dma_flag_shift[4] = {0, 6, 16, 22};
+
+static const uint8_t dma1_irq[8] = {
+	IRQ_NO_DMA1_STREAM0, IRQ_NO_DMA1_STREAM1, IRQ_NO_DMA1_STREAM2,
+	IRQ_NO_DMA1_STREAM3, IRQ_NO_DMA1_STREAM4, IRQ_NO_DMA1_STREAM5,
+	IRQ_NO_DMA1_STREAM6, IRQ_NO_DMA1_STREAM7
+};
+
+static const uint8_t dma2_irq[8] = {
+	IRQ_NO_DMA2_STREAM0, IRQ_NO_DMA2_STREAM1, IRQ_NO_DMA2_STREAM2,
+	IRQ_NO_DMA2_STREAM3, IRQ_NO_DMA2_STREAM4, IRQ_NO_DMA2_STREAM5,
+	IRQ_NO_DMA2_STREAM6, IRQ_NO_DMA2_STREAM7
+};
+
+// Clock reference of each stream (bit DMA1EN / DMA2EN), clock_gate.h
+static uint32_t dma_clk_held[2][8];
+
+/*
+ * Handle which configured each stream last (DMA_Init()). The stream
+ * is taken while its clock reference is held: from DMA_Init() or
+ * DMA_Start() to DMA_Release(). See the stream table in dma_driver.h
+ * */
+static DMA_Handle_t *dma_owner[2][8];
+
+static inline DMA_Stream_RegDef_t *DMA_StreamReg(DMA_Handle_t *pDMAHandle){
+
+	return &pDMAHandle->pDMAx->STREAM[pDMAHandle->Stream];
+
+} /* End DMA_StreamReg() */
+
+
+void DMA_PeriClockControl(DMA_RegDef_t *pDMAx, uint8_t ON_OFF){
+
+	// DMA1EN bit 21, DMA2EN bit 22 in RCC_AHB1ENR, one reference per stream user
+	CLK_PeriClockControl(CLK_AHB1, (pDMAx == DMA1) ? CLK_AHB1_DMA1 : CLK_AHB1_DMA2, ON_OFF);
+
+} /* End DMA_PeriClockControl() */
+
+
+// One reference per stream, however many DMA_Init() / DMA_Start()
+static void DMA_ClockHold(DMA_Handle_t *pDMAHandle){
+
+	uint8_t dma2 = (pDMAHandle->pDMAx == DMA2);
+
+	CLK_Hold(&dma_clk_held[dma2][pDMAHandle->Stream & 0x7], CLK_AHB1,
+			 dma2 ? CLK_AHB1_DMA2 : CLK_AHB1_DMA1);
+
+} /* End DMA_ClockHold() */
+
+
+static inline DMA_Handle_t **DMA_Owner(DMA_Handle_t *pDMAHandle){
+
+	return &dma_owner[pDMAHandle->pDMAx == DMA2][pDMAHandle->Stream & 0x7];
+
+} /* End DMA_Owner() */
+
+
+// Stream taken by another handle (configured and clock held)
+static uint8_t DMA_TakenByOther(DMA_Handle_t *pDMAHandle){
+
+	DMA_Handle_t *pOwner = *DMA_Owner(pDMAHandle);
+
+	return pOwner != 0 && pOwner != pDMAHandle &&
+		   dma_clk_held[pDMAHandle->pDMAx == DMA2][pDMAHandle->Stream & 0x7] != 0;
+
+} /* End DMA_TakenByOther() */
+
+
+uint8_t DMA_GetIRQNumber(DMA_RegDef_t *pDMAx, uint8_t Stream){
+
+	return (pDMAx == DMA1) ? dma1_irq[Stream & 0x7] : dma2_irq[Stream & 0x7];
+
+} /* End DMA_GetIRQNumber() */
+
+
+uint32_t DMA_GetFlags(DMA_Handle_t *pDMAHandle){
+
+	uint8_t stream = pDMAHandle->Stream;
+	uint32_t isr = (stream < 4) ? pDMAHandle->pDMAx->LISR : pDMAHandle->pDMAx->HISR;
+
+	return (isr >> dma_flag_shift[stream & 0x3]) & DMA_FLAG_ALL;
+
+} /* End DMA_GetFlags() */
+
+
+void DMA_ClearFlags(DMA_Handle_t *pDMAHandle, uint32_t Flags){
+
+	// IFCR is write 1 to clear, no read-modify-write needed
+	uint8_t stream = pDMAHandle->Stream;
+	uint32_t value = (Flags & DMA_FLAG_ALL) << dma_flag_shift[stream & 0x3];
+
+	if (stream < 4)
+		pDMAHandle->pDMAx->LIFCR = value;
+	else
+		pDMAHandle->pDMAx->HIFCR = value;
+
+} /* End DMA_ClearFlags() */
+
+
+/*
+ * Table 48 "FIFO threshold configurations": the FIFO level which
+ * triggers a burst must be a whole nb of memory bursts
+ * */
+static uint8_t DMA_BurstFitsFIFO(uint8_t Burst, uint8_t DataSize, uint8_t Threshold){
+
+	if (Burst == DMA_BURST_SINGLE)
+		return 1;
+
+	uint32_t burst_bytes = (2U << Burst) << DataSize;   // 4/8/16 beats
+	uint32_t fifo_bytes = 4U * (Threshold + 1);                   // 4..16 bytes
+
+	return (burst_bytes <= fifo_bytes) && ((fifo_bytes % burst_bytes) == 0);
+
+} /* End DMA_BurstFitsFIFO() */
+
+// =========================================================
+
+
+drv_status DMA_Init(DMA_Handle_t *pDMAHandle){
+
+	DMA_Config_t *pConf = &pDMAHandle->DMA_Config;
+
+	if (pDMAHandle->Stream > 7)
+		return DRV_ERROR;
+
+	// memory to memory is only possible on DMA2 (section 10.3.6)
+	if (pConf->DMA_Direction == DMA_DIR_MEM_TO_MEM && pDMAHandle->pDMAx != DMA2)
+		return DRV_ERROR;
+
+	// the DMA forces the FIFO in memory to memory mode, say it in the config
+	uint8_t fifo_on = (pConf->DMA_FIFOMode == ON) ||
+					  (pConf->DMA_Direction == DMA_DIR_MEM_TO_MEM);
+
+	if (fifo_on){
+
+		if (!DMA_BurstFitsFIFO(pConf->DMA_MemBurst, pConf->DMA_MemDataSize,
+							   pConf->DMA_FIFOThreshold) ||
+			!DMA_BurstFitsFIFO(pConf->DMA_PeriphBurst, pConf->DMA_PeriphDataSize,
+							   pConf->DMA_FIFOThreshold))
+			return DRV_ERROR;
+
+	} else if (pConf->DMA_PeriphDataSize != pConf->DMA_MemDataSize){
+
+		// direct mode: the item is written as it was read
+		return DRV_ERROR;
+
+	}
+
+	// the stream belongs to another driver until its DMA_Release()
+	uint32_t state = IRQ_EnterCritical(0);
+
+	if (DMA_TakenByOther(pDMAHandle)){
+		IRQ_ExitCritical(state);
+		return DRV_BUSY;
+	}
+
+	*DMA_Owner(pDMAHandle) = pDMAHandle;
+	DMA_ClockHold(pDMAHandle);
+
+	IRQ_ExitCritical(state);
+
+	DMA_Stream_RegDef_t *pStream = DMA_StreamReg(pDMAHandle);
+
+	/*
+	 * 1. The stream must be disabled before writing its registers,
+	 *    EN reads back 0 only once the current transfer is finished
+	 * */
+	pStream->CR &= ~(1 << DMA_SxCR_EN);
+	while (pStream->CR & (1 << DMA_SxCR_EN));
+
+	DMA_ClearFlags(pDMAHandle, DMA_FLAG_ALL);
+
+	// 2. Build CR
+	uint32_t cr = 0;
+
+	cr |= ((uint32_t)(pConf->DMA_Channel & 0x7) << DMA_SxCR_CHSEL);
+	cr |= ((uint32_t)(pConf->DMA_Direction & 0x3) << DMA_SxCR_DIR);
+	cr |= ((uint32_t)(pConf->DMA_PeriphDataSize & 0x3) << DMA_SxCR_PSIZE);
+	cr |= ((uint32_t)(pConf->DMA_MemDataSize & 0x3) << DMA_SxCR_MSIZE);
+	cr |= ((uint32_t)(pConf->DMA_Priority & 0x3) << DMA_SxCR_PL);
+
+	if (pConf->DMA_PeriphInc == ON)
+		cr |= (1 << DMA_SxCR_PINC);
+	if (pConf->DMA_MemInc == ON)
+		cr |= (1 << DMA_SxCR_MINC);
+	if (pConf->DMA_Circular == ON)
+		cr |= (1 << DMA_SxCR_CIRC);
+	if (pConf->DMA_DoubleBuffer == ON)
+		cr |= (1 << DMA_SxCR_DBM); // DBM also implies circular mode
+
+	// interrupts: transfer complete and errors always, half transfer on demand
+	cr |= (1 << DMA_SxCR_TCIE) | (1 << DMA_SxCR_TEIE) | (1 << DMA_SxCR_DMEIE);
+
+	if (pConf->DMA_HalfTransferIT == ON)
+		cr |= (1 << DMA_SxCR_HTIE);
+
+	// bursts are ignored (forced to single) in direct mode
+	if (fifo_on){
+		cr |= ((uint32_t)(pConf->DMA_MemBurst & 0x3) << DMA_SxCR_MBURST);
+		cr |= ((uint32_t)(pConf->DMA_PeriphBurst & 0x3) << DMA_SxCR_PBURST);
+	}
+
+	pStream->CR = cr;
+
+	/*
+	 * 3. FIFO: DMDIS = 1 turns the FIFO on, FEIE reports its
+	 *    overrun / underrun. Direct mode is the default after reset
+	 * */
+	if (fifo_on)
+		pStream->FCR = (1 << DMA_SxFCR_DMDIS) | (1 << DMA_SxFCR_FEIE) |
+					   ((pConf->DMA_FIFOThreshold & 0x3) << DMA_SxFCR_FTH);
+	else
+		pStream->FCR = 0;
+
+	// 4. IRQ on the NVIC side (priority from irq_priority_plan.h)
+	NVIC_IRQInterruptConfig(DMA_GetIRQNumber(pDMAHandle->pDMAx, pDMAHandle->Stream), ON);
+
+	return DRV_OK;
+
+} /* End DMA_Init() */
+
+
+drv_status DMA_Start(DMA_Handle_t *pDMAHandle, uint32_t PeriphAddr,
+					 uint32_t Mem0Addr, uint32_t Mem1Addr, uint16_t Count){
+
+	DMA_Stream_RegDef_t *pStream = DMA_StreamReg(pDMAHandle);
+
+	/*
+	 * Given back by DMA_Release(), the registers kept the configuration
+	 * unless another handle went through DMA_Init() since: DMA_Init() again
+	 * */
+	uint32_t state = IRQ_EnterCritical(0);
+
+	if (*DMA_Owner(pDMAHandle) != pDMAHandle){
+		IRQ_ExitCritical(state);
+		return DRV_BUSY;
+	}
+
+	DMA_ClockHold(pDMAHandle);
+
+	IRQ_ExitCritical(state);
+
+	if (pStream->CR & (1 << DMA_SxCR_EN))
+		return DRV_BUSY;
+
+	// no DMA path to the CCM RAM (stack, __ccm_data / __ccm_bss variables)
+	if (IS_CCM_ADDR(Mem0Addr) || (Mem1Addr && IS_CCM_ADDR(Mem1Addr)) ||
+		IS_CCM_ADDR(PeriphAddr))
+		return DRV_ERROR;
+
+	/*
+	 * For memory to memory, PAR is the source and M0AR the destination
+	 * (section 10.3.6), for the other directions PAR is the
+	 * data register of the peripheral
+	 * */
+	pStream->PAR = PeriphAddr;
+	pStream->M0AR = Mem0Addr;
+	pStream->M1AR = Mem1Addr;
+	pStream->NDTR = Count;
+
+	// CT = 0: the first transfer always uses M0AR
+	pStream->CR &= ~(1 << DMA_SxCR_CT);
+
+	DMA_ClearFlags(pDMAHandle, DMA_FLAG_ALL);
+
+	pStream->CR |= (1 << DMA_SxCR_EN);
+
+	return DRV_OK;
+
+} /* End DMA_Start() */
+
+
+void DMA_Stop(DMA_Handle_t *pDMAHandle){
+
+	DMA_Stream_RegDef_t *pStream = DMA_StreamReg(pDMAHandle);
+
+	// never stop the transfer of another driver
+	if (*DMA_Owner(pDMAHandle) != pDMAHandle)
+		return;
+
+	pStream->CR &= ~(1 << DMA_SxCR_EN);
+	while (pStream->CR & (1 << DMA_SxCR_EN));
+
+	// disabling the stream sets TCIF, we don't want a callback for that
+	DMA_ClearFlags(pDMAHandle, DMA_FLAG_ALL);
+
+} /* End DMA_Stop() */
+
+
+void DMA_Release(DMA_Handle_t *pDMAHandle){
+
+	// only the owner gives the stream back
+	if (*DMA_Owner(pDMAHandle) != pDMAHandle)
+		return;
+
+	DMA_Stop(pDMAHandle);
+
+	uint8_t dma2 = (pDMAHandle->pDMAx == DMA2);
+
+	CLK_Drop(&dma_clk_held[dma2][pDMAHandle->Stream & 0x7], CLK_AHB1,
+			 dma2 ? CLK_AHB1_DMA2 : CLK_AHB1_DMA1);
+
+} /* End DMA_Release() */
+
+
+uint8_t DMA_IsBusy(DMA_Handle_t *pDMAHandle){
+
+	return (DMA_StreamReg(pDMAHandle)->CR >> DMA_SxCR_EN) & 0x1;
+
+} /* End DMA_IsBusy() */
+
+
+drv_status DMA_MemCopy(DMA_Handle_t *pDMAHandle, void *pDst,
+					   const void *pSrc, uint16_t Count){
+
+	if (pDMAHandle->DMA_Config.DMA_Direction != DMA_DIR_MEM_TO_MEM)
+		return DRV_ERROR;
+
+	// source in PAR, destination in M0AR (section 10.3.6)
+	return DMA_Start(pDMAHandle, (uint32_t)pSrc, (uint32_t)pDst, 0, Count);
+
+} /* End DMA_MemCopy() */
+
+
+uint16_t DMA_GetRemaining(DMA_Handle_t *pDMAHandle){
+
+	return (uint16_t)DMA_StreamReg(pDMAHandle)->NDTR;
+
+} /* End DMA_GetRemaining() */
+
+
+uint8_t DMA_GetCurrentTarget(DMA_Handle_t *pDMAHandle){
+
+	return (DMA_StreamReg(pDMAHandle)->CR >> DMA_SxCR_CT) & 0x1;
+
+} /* End DMA_GetCurrentTarget() */
+
+
+void DMA_SetMemoryAddress(DMA_Handle_t *pDMAHandle,
+						  uint8_t Target, uint32_t Addr){
+
+	/*
+	 * In double buffer mode, the address of the memory not in use
+	 * (the one not pointed by CT) can be changed while the stream runs
+	 * */
+	if (Target == 0)
+		DMA_StreamReg(pDMAHandle)->M0AR = Addr;
+	else
+		DMA_StreamReg(pDMAHandle)->M1AR = Addr;
+
+} /* End DMA_SetMemoryAddress() */
+
+
+void DMA_SetMemoryIncrement(DMA_Handle_t *pDMAHandle, uint8_t ON_OFF){
+
+	// only written while EN = 0, so no need to go through DMA_Init()
+	pDMAHandle->DMA_Config.DMA_MemInc = ON_OFF;
+
+	if (ON_OFF == ON)
+		DMA_StreamReg(pDMAHandle)->CR |= (1 << DMA_SxCR_MINC);
+	else
+		DMA_StreamReg(pDMAHandle)->CR &= ~(1 << DMA_SxCR_MINC);
+
+} /* End DMA_SetMemoryIncrement() */
+
+
+void DMA_IRQHandling(DMA_Handle_t *pDMAHandle){
+
+	uint32_t flags = DMA_GetFlags(pDMAHandle);
+
+	DMA_ClearFlags(pDMAHandle, flags);
+
+	if (pDMAHandle->Callback == 0)
+		return;
+
+	/*
+	 * FIFO error (FEIF) is only reported in FIFO mode (FEIE on):
+	 * in direct mode it is a warning, the transfer goes on
+	 * */
+	uint32_t errors = DMA_FLAG_TEIF | DMA_FLAG_DMEIF;
+
+	if (DMA_StreamReg(pDMAHandle)->FCR & (1 << DMA_SxFCR_FEIE))
+		errors |= DMA_FLAG_FEIF;
+
+	if (flags & errors)
+		pDMAHandle->Callback(pDMAHandle, DMA_EVENT_ERROR);
+
+	if (flags & DMA_FLAG_HTIF)
+		pDMAHandle->Callback(pDMAHandle, DMA_EVENT_HALF_TRANSFER);
+
+	if (flags & DMA_FLAG_TCIF)
+		pDMAHandle->Callback(pDMAHandle, DMA_EVENT_TRANSFER_COMPLETE);
+
+} /* End DMA_IRQHandling() */
@@ -0,0 +1,169 @@
+
+#pragma once
+
+#include "stm32f407G.h"
+
+/*
+ * DMA stream driver
+ *
+ * 	- one DMA_Handle_t per stream used (DMA1/DMA2, stream 0..7)
+ * 	- the channel (request) of each peripheral is given in
+ * 	  tables 42 and 43 of the reference manual, example:
+ * 	  USART2_TX -> DMA1, stream 6, channel 4
+ * 	- the user must call DMA_IRQHandling() from the IRQ handler
+ * 	  of the stream, the callback of the handle is then called
+ * 	  with the event (half transfer, transfer complete, error)
+ *
+ * 	Direct mode vs FIFO mode (section 10.3.12 to 10.3.14):
+ * 		- direct mode (DMA_FIFOMode = OFF): each item read is written
+ * 		  at once, source and destination have the same size, no burst
+ * 		- FIFO mode: a 4 words FIFO sits between both sides, the sizes
+ * 		  can differ (bytes in, words out) and bursts of 4/8/16 beats
+ * 		  take the bus only once for several items
+ * 		- a burst must fit in the FIFO threshold (table 48), this is
+ * 		  checked by DMA_Init(), and must not cross a 1 KB boundary
+ * 		  (keep the buffers aligned on the burst size)
+ * 		- memory to memory (DMA2 only) always uses the FIFO
+ *
+ * 	The CCM RAM (0x10000000, mem_sections.h) is out of reach of both
+ * 	DMAs: DMA_Start() refuses it. The stack is there, so a local
+ * 	array can never be a DMA buffer
+ *
+ * 	One stream, one owner: DMA_Init() gives the stream to the handle
+ * 	until its DMA_Release(). Another handle gets DRV_BUSY from
+ * 	DMA_Init() / DMA_Start(), and its DMA_Stop() / DMA_Release() do
+ * 	nothing. The Init of the drivers gives the DRV_BUSY back.
+ * 	Streams used by the drivers (tables 42 and 43), the ones on the
+ * 	same line can't run at the same time:
+ *
+ * 		DMA1 S0: SPI3_RX, I2C1_RX, UART5_RX, TIM4_CH1 (input capture)
+ * 		DMA1 S1: USART3_RX
+ * 		DMA1 S2: I2C2_RX, I2C3_RX, UART4_RX, TIM3_UP, TIM5_CH1
+ * 		DMA1 S3: SPI2_RX, USART3_TX
+ * 		DMA1 S4: SPI2_TX, UART4_TX, TIM3_CH1
+ * 		DMA1 S5: USART2_RX, TIM2_CH1
+ * 		DMA1 S6: USART2_TX, TIM4_UP
+ * 		DMA1 S7: SPI3_TX, UART5_TX
+ * 		DMA2 S0: memory to memory (bench_dma_memcpy.c)
+ * 		DMA2 S1: ADC3, TIM8_UP, USART6_RX
+ * 		DMA2 S2: SPI1_RX, USART1_RX
+ * 		DMA2 S3: SPI1_TX, ADC2
+ * 		DMA2 S4: ADC1
+ * 		DMA2 S5: TIM1_UP
+ * 		DMA2 S6: USART6_TX, memory to memory (bench_ccm.c)
+ * 		DMA2 S7: USART1_TX, memory to memory (bench_arena.c)
+ *
+ * */
+
+// ------------ Coding states for DMA configuration ------------
+
+// DIR bits [7:6] of SxCR (same order as ref manual)
+typedef enum DMA_Direction {DMA_DIR_PERIPH_TO_MEM, DMA_DIR_MEM_TO_PERIPH,
+							DMA_DIR_MEM_TO_MEM} dma_dir;
+
+// PSIZE / MSIZE
+typedef enum DMA_DataSize {DMA_SIZE_BYTE, DMA_SIZE_HALFWORD,
+						   DMA_SIZE_WORD} dma_size;
+
+// PL bits, priority between the streams of the same controller
+typedef enum DMA_Priority {DMA_PRIO_LOW, DMA_PRIO_MEDIUM,
+						   DMA_PRIO_HIGH, DMA_PRIO_VERY_HIGH} dma_prio;
+
+// FTH bits of SxFCR, FIFO level which triggers the transfer
+typedef enum DMA_FIFOThreshold {DMA_FIFO_1_4, DMA_FIFO_HALF,
+								DMA_FIFO_3_4, DMA_FIFO_FULL} dma_fifo_th;
+
+// MBURST / PBURST, nb of beats of one burst
+typedef enum DMA_Burst {DMA_BURST_SINGLE, DMA_BURST_INC4,
+						DMA_BURST_INC8, DMA_BURST_INC16} dma_burst;
+
+// Events given to the callback
+typedef enum DMA_Event {DMA_EVENT_HALF_TRANSFER, DMA_EVENT_TRANSFER_COMPLETE,
+						DMA_EVENT_ERROR} dma_event;
+
+
+typedef struct{
+
+	uint8_t DMA_Channel;          // 0..7, request mapping
+	uint8_t DMA_Direction;
+	uint8_t DMA_PeriphInc;        // ON / OFF
+	uint8_t DMA_MemInc;           // ON / OFF
+	uint8_t DMA_PeriphDataSize;
+	uint8_t DMA_MemDataSize;
+	uint8_t DMA_Circular;         // ON / OFF
+	uint8_t DMA_DoubleBuffer;     // ON / OFF (M0AR and M1AR used in turn)
+	uint8_t DMA_Priority;
+	uint8_t DMA_HalfTransferIT;   // ON / OFF
+	uint8_t DMA_FIFOMode;         // ON / OFF (OFF = direct mode)
+	uint8_t DMA_FIFOThreshold;    // FIFO mode only
+	uint8_t DMA_MemBurst;         // FIFO mode only
+	uint8_t DMA_PeriphBurst;      // FIFO mode only
+
+} DMA_Config_t;
+
+
+typedef struct DMA_Handle DMA_Handle_t;
+
+typedef void (*dma_callback_t)(DMA_Handle_t *pDMAHandle, uint8_t event);
+
+struct DMA_Handle{
+
+	DMA_RegDef_t *pDMAx;
+	// DMA1 or DMA2
+
+	uint8_t Stream;
+	// 0..7
+
+	DMA_Config_t DMA_Config;
+
+	dma_callback_t Callback;
+	void *pContext;   // free for the owner of the handle (driver, app)
+
+};
+
+
+// ================== API ==================
+
+void DMA_PeriClockControl(DMA_RegDef_t *pDMAx, uint8_t ON_OFF);
+
+drv_status DMA_Init(DMA_Handle_t *pDMAHandle);
+
+drv_status DMA_Start(DMA_Handle_t *pDMAHandle, uint32_t PeriphAddr,
+					 uint32_t Mem0Addr, uint32_t Mem1Addr, uint16_t Count);
+
+void DMA_Stop(DMA_Handle_t *pDMAHandle);
+
+/*
+ * DMA_Stop(), then the clock reference of the stream is given back
+ * (clock_gate.h): the DMA is gated once no stream holds it, and
+ * another handle can take the stream. The registers keep the
+ * configuration, DMA_Start() takes the clock again if no other
+ * handle went through DMA_Init() in between
+ * */
+void DMA_Release(DMA_Handle_t *pDMAHandle);
+
+// 1 while the stream runs (EN goes back to 0 at the end of a normal transfer)
+uint8_t DMA_IsBusy(DMA_Handle_t *pDMAHandle);
+
+// Memory to memory: copy Count items of DMA_MemDataSize from pSrc to pDst
+drv_status DMA_MemCopy(DMA_Handle_t *pDMAHandle, void *pDst,
+					   const void *pSrc, uint16_t Count);
+
+uint16_t DMA_GetRemaining(DMA_Handle_t *pDMAHandle);
+
+// Double buffer mode: which memory (0 -> M0AR, 1 -> M1AR) the DMA uses now
+uint8_t DMA_GetCurrentTarget(DMA_Handle_t *pDMAHandle);
+
+void DMA_SetMemoryAddress(DMA_Handle_t *pDMAHandle,
+						  uint8_t Target, uint32_t Addr);
+
+// MINC of a stopped stream, for a transfer from / to one dummy item
+void DMA_SetMemoryIncrement(DMA_Handle_t *pDMAHandle, uint8_t ON_OFF);
+
+uint32_t DMA_GetFlags(DMA_Handle_t *pDMAHandle);
+
+void DMA_ClearFlags(DMA_Handle_t *pDMAHandle, uint32_t Flags);
+
+uint8_t DMA_GetIRQNumber(DMA_RegDef_t *pDMAx, uint8_t Stream);
+
+void DMA_IRQHandling(DMA_Handle_t *pDMAHandle);
@@ -0,0 +1,188 @@
+#include "dvfs.h"
+#include "dwt_counter.h"
+
+
+// =============== Profiles ===============
+
+// HSE 8 MHz -> 84 MHz, APB1 42 MHz, APB2 84 MHz: 2 wait states
+static const RCC_ClockConfig_t dvfs_clock_84mhz = {
+	.RCC_PLLSource = RCC_PLL_HSE,
+	.RCC_SysClk = 84000000U,
+	.RCC_AHBDiv = 1,
+	.RCC_APB1Div = 2,
+	.RCC_APB2Div = 1
+};
+
+static const DVFS_Profile_t dvfs_profiles[DVFS_NB_PROFILES] = {
+	[DVFS_LOW]  = {"low",  0,                  HSI_VALUE},
+	[DVFS_MID]  = {"mid",  &dvfs_clock_84mhz,  84000000U},
+	[DVFS_HIGH] = {"high", &RCC_Clock168MHz,   168000000U},
+};
+
+static DVFS_Stats_t dvfs_stats[DVFS_NB_PROFILES];
+
+static DVFS_Notifier_t *dvfs_notifiers;
+
+
+// =============== Notifiers ===============
+
+void DVFS_Register(DVFS_Notifier_t *pNotifier){
+
+	DVFS_Notifier_t **pp = &dvfs_notifiers;
+
+	// at the end: the drivers are told in the order of registration
+	while (*pp){
+
+		if (*pp == pNotifier)
+			return;
+
+		pp = &(*pp)->pNext;
+	}
+
+	pNotifier->pNext = 0;
+	*pp = pNotifier;
+
+} /* End DVFS_Register() */
+
+
+void DVFS_Unregister(DVFS_Notifier_t *pNotifier){
+
+	DVFS_Notifier_t **pp = &dvfs_notifiers;
+
+	while (*pp){
+
+		if (*pp == pNotifier){
+			*pp = pNotifier->pNext;
+			pNotifier->pNext = 0;
+			return;
+		}
+
+		pp = &(*pp)->pNext;
+	}
+
+} /* End DVFS_Unregister() */
+
+
+static void DVFS_NotifyAll(uint8_t Event){
+
+	for (DVFS_Notifier_t *p = dvfs_notifiers; p; p = p->pNext)
+		p->Callback(Event, p->pContext);
+
+} /* End DVFS_NotifyAll() */
+
+
+/*
+ * DVFS_PRE_CHANGE to all, stops at the first refusal and gives
+ * DVFS_ABORT_CHANGE to the notifiers before it
+ * */
+static drv_status DVFS_NotifyPre(void){
+
+	for (DVFS_Notifier_t *p = dvfs_notifiers; p; p = p->pNext){
+
+		if (p->Callback(DVFS_PRE_CHANGE, p->pContext) == DRV_OK)
+			continue;
+
+		for (DVFS_Notifier_t *q = dvfs_notifiers; q != p; q = q->pNext)
+			q->Callback(DVFS_ABORT_CHANGE, q->pContext);
+
+		return DRV_BUSY;
+	}
+
+	return DRV_OK;
+
+} /* End DVFS_NotifyPre() */
+
+
+// =============== Switch ===============
+
+/*
+ * Current profile: the clock configured by SystemInit() at reset
+ * (RCC_STARTUP_168MHZ), found back from SystemCoreClock
+ * */
+uint8_t DVFS_GetProfile(void){
+
+	for (uint8_t i = 0; i < DVFS_NB_PROFILES; ++i){
+		if (dvfs_profiles[i].HClk == SystemCoreClock)
+			return i;
+	}
+
+	return DVFS_NB_PROFILES;
+
+} /* End DVFS_GetProfile() */
+
+
+drv_status DVFS_SetProfile(uint8_t Level){
+
+	if (Level >= DVFS_NB_PROFILES)
+		return DRV_ERROR;
+
+	if (DVFS_GetProfile() == Level)
+		return DRV_OK;
+
+	const DVFS_Profile_t *pProfile = &dvfs_profiles[Level];
+	DVFS_Stats_t *pStats = &dvfs_stats[Level];
+	uint32_t old_hz = SystemCoreClock;
+	drv_status status = DRV_OK;
+
+	COREDEBUG_DEMCR |= COREDEBUG_DEMCR_TRCENA;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA;
+
+	uint32_t t0 = DWT_GetCycles();
+
+	// 1. Drivers ready?
+	if (DVFS_NotifyPre() != DRV_OK){
+		pStats->refused++;
+		return DRV_BUSY;
+	}
+
+	uint32_t t1 = DWT_GetCycles();
+
+	// 2. Clock tree, wait states in the safe order
+	if (pProfile->pClock == 0){
+
+		RCC_ClockReset();
+
+	} else if (RCC_ClockConfig(pProfile->pClock) != DRV_OK){
+
+		// known state rather than a half done switch
+		RCC_ClockReset();
+		pStats = &dvfs_stats[DVFS_LOW];
+		status = DRV_ERROR;
+
+	}
+
+	uint32_t t2 = DWT_GetCycles();
+
+	// 3. Dividers recomputed from the new clock
+	DVFS_NotifyAll(DVFS_POST_CHANGE);
+
+	uint32_t t3 = DWT_GetCycles();
+
+	uint32_t new_mhz = SystemCoreClock / 1000000U;
+
+	pStats->switches++;
+	pStats->last_cycles = t3 - t0;
+	pStats->last_us = (t1 - t0) / (old_hz / 1000000U) +
+					  (t2 - t1) / (HSI_VALUE / 1000000U) +
+					  (t3 - t2) / new_mhz;
+
+	if (pStats->last_us > pStats->max_us)
+		pStats->max_us = pStats->last_us;
+
+	return status;
+
+} /* End DVFS_SetProfile() */
+
+
+const DVFS_Profile_t *DVFS_GetProfileInfo(uint8_t Level){
+
+	return (Level < DVFS_NB_PROFILES) ? &dvfs_profiles[Level] : 0;
+
+} /* End DVFS_GetProfileInfo() */
+
+
+const DVFS_Stats_t *DVFS_GetStats(uint8_t Level){
+
+	return (Level < DVFS_NB_PROFILES) ? &dvfs_stats[Level] : 0;
+
+} /* End DVFS_GetStats() */
@@ -0,0 +1,108 @@
+#pragma once
+
+#include "stm32f407G.h"
+#include "rcc_driver.h"
+
+/*
+ * Frequency scaling: switch the clock tree between fixed profiles at
+ * run time (168 MHz for the bursts, 16 MHz when idle) without breaking
+ * the drivers which computed a divider from the old clock
+ *
+ * 	Every driver which turned a clock into a divider at init (USART
+ * 	BRR, timer PSC / ARR, SysTick LOAD, I2C CCR / TRISE, SPI BR, ADC
+ * 	prescaler and trigger timer) registers a notifier, a driver
+ * 	without one must be initialized again after the switch.
+ * 	DVFS_SetProfile():
+ *
+ * 		1. DVFS_PRE_CHANGE to every notifier, in the order of
+ * 		   registration. A notifier may refuse with DRV_BUSY (a frame
+ * 		   being sent): the ones already told get DVFS_ABORT_CHANGE and
+ * 		   the clock stays as it is
+ * 		2. new clock, by RCC_ClockConfig() / RCC_ClockReset(): the
+ * 		   flash wait states are raised BEFORE a faster clock and only
+ * 		   lowered AFTER a slower one
+ * 		3. DVFS_POST_CHANGE to every notifier: SystemCoreClock and the
+ * 		   RCC_GetxxxValue() functions already give the new values,
+ * 		   the drivers recompute their dividers from them
+ *
+ * 	- the RCC part can't fail silently: on an error (HSE missing) the
+ * 	  board goes back to HSI 16 MHz (DVFS_LOW) and the notifiers get
+ * 	  DVFS_POST_CHANGE for it
+ * 	- cost of each switch in DVFS_Stats_t: core cycles (DWT, they
+ * 	  don't have the same length before and after the switch) and an
+ * 	  estimate in us. While the PLL locks again the core runs on HSI,
+ * 	  this part is counted at 16 MHz
+ * 	- call it from thread mode, never from an ISR: the notifiers
+ * 	  refuse the switch while their peripheral is busy (USART frame,
+ * 	  I2C / SPI queue, ADC sampling, timer DMA table), a refused
+ * 	  switch is tried again later
+ * 	- loop delays (for (i = 0; i < N; i++)) can't follow: use
+ * 	  SysTick_DelayMs() (systick.h) or TIM_DelayUs(), which do
+ *
+ * Usage:
+ * 		static DVFS_Notifier_t uart_nb = {.Callback = USART_DVFSNotify,
+ * 										  .pContext = &usart2_handle};
+ * 		DVFS_Register(&uart_nb);
+ * 		DVFS_SetProfile(DVFS_LOW);    // idle
+ * 		DVFS_SetProfile(DVFS_HIGH);   // burst
+ * */
+
+// ------------ Coding states ------------
+
+typedef enum DVFS_Level {DVFS_LOW, DVFS_MID, DVFS_HIGH, DVFS_NB_PROFILES} dvfs_level;
+
+typedef enum DVFS_Event {DVFS_PRE_CHANGE, DVFS_POST_CHANGE,
+						 DVFS_ABORT_CHANGE} dvfs_event;
+
+// Return value only read for DVFS_PRE_CHANGE: DRV_BUSY refuses the switch
+typedef drv_status (*dvfs_callback_t)(uint8_t Event, void *pContext);
+
+
+typedef struct DVFS_Notifier DVFS_Notifier_t;
+
+struct DVFS_Notifier{
+
+	dvfs_callback_t Callback;
+	void *pContext;              // the driver handle, given back to Callback
+
+	// Filled by DVFS_Register()
+	DVFS_Notifier_t *pNext;
+
+};
+
+
+typedef struct{
+
+	const char *Name;
+	const RCC_ClockConfig_t *pClock;   // 0: HSI 16 MHz, PLL and HSE off
+	uint32_t HClk;                     // Hz
+
+} DVFS_Profile_t;
+
+
+// Cost of the last switch TO a profile
+typedef struct{
+
+	uint32_t switches;
+	uint32_t refused;         // DRV_BUSY from a notifier
+	uint32_t last_cycles;     // DWT cycles, notifiers included
+	uint32_t last_us;         // estimate, see above
+	uint32_t max_us;
+
+} DVFS_Stats_t;
+
+
+// ================== API ==================
+
+// Notifier kept by the service (static or global, not on the stack)
+void DVFS_Register(DVFS_Notifier_t *pNotifier);
+
+void DVFS_Unregister(DVFS_Notifier_t *pNotifier);
+
+drv_status DVFS_SetProfile(uint8_t Level);
+
+uint8_t DVFS_GetProfile(void);
+
+const DVFS_Profile_t *DVFS_GetProfileInfo(uint8_t Level);
+
+const DVFS_Stats_t *DVFS_GetStats(uint8_t Level);
@@ -0,0 +1,32 @@
+
+/*
+ * Goal: measure execution time in clock cycles using DWT CYCCNT
+ *
+ * 	DWT_CycleCounterInit();
+ * 	uint32_t start = DWT_GetCycles();
+ * 	... code to measure ...
+ * 	uint32_t cycles = DWT_GetCycles() - start;
+ *
+ * 	- cycles / (SystemCoreClock / 1e6) gives the time in us
+ * 	- the counter wraps after 2^32 cycles (~268 s at 16 MHz),
+ * 	  the unsigned subtraction stays correct across one wrap
+ *
+ * */
+
+#pragma once
+
+#include "stm32f407G.h"
+
+static inline void DWT_CycleCounterInit(void){
+
+	COREDEBUG_DEMCR |= COREDEBUG_DEMCR_TRCENA; // power the trace unit
+	DWT->CYCCNT = 0;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA;
+
+} /* End DWT_CycleCounterInit() */
+
+static inline uint32_t DWT_GetCycles(void){
+
+	return DWT->CYCCNT;
+
+} /* End DWT_GetCycles() */
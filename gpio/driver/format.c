@@ -0,0 +1,169 @@
+#include "format.h"
+
+static const uint32_t fmt_pow10[10] = {
+	1, 10, 100, 1000, 10000, 100000,
+	1000000, 10000000, 100000000, 1000000000
+};
+
+#define FMT_MAX_DECIMALS 9
+
+
+void Fmt_Init(Fmt_Buffer_t *pFmt, char *pBuf, uint32_t Size){
+
+	pFmt->pBuf = pBuf;
+	pFmt->Size = Size;
+	pFmt->len = 0;
+	pFmt->truncated = 0;
+
+	if (Size)
+		pBuf[0] = '\0';
+
+} /* End Fmt_Init() */
+
+
+void Fmt_Char(Fmt_Buffer_t *pFmt, char c){
+
+	// keep 1 place for the '\0'
+	if (pFmt->len + 1 >= pFmt->Size){
+		pFmt->truncated = 1;
+		return;
+	}
+
+	pFmt->pBuf[pFmt->len++] = c;
+	pFmt->pBuf[pFmt->len] = '\0';
+
+} /* End Fmt_Char() */
+
+
+void Fmt_Str(Fmt_Buffer_t *pFmt, const char *pStr){
+
+	while (*pStr)
+		Fmt_Char(pFmt, *pStr++);
+
+} /* End Fmt_Str() */
+
+
+void Fmt_UintPad(Fmt_Buffer_t *pFmt, uint32_t Value, uint8_t Width, char Pad){
+
+	// digits are found from the right, so they are stored reversed first
+	char digits[10];
+	uint8_t n = 0;
+
+	do {
+		digits[n++] = (char)('0' + Value % 10);  // /10 and %10 -> one UMULL
+		Value /= 10;
+	} while (Value);
+
+	while (Width > n){
+		Fmt_Char(pFmt, Pad);
+		Width--;
+	}
+
+	while (n)
+		Fmt_Char(pFmt, digits[--n]);
+
+} /* End Fmt_UintPad() */
+
+
+void Fmt_Uint(Fmt_Buffer_t *pFmt, uint32_t Value){
+
+	Fmt_UintPad(pFmt, Value, 0, ' ');
+
+} /* End Fmt_Uint() */
+
+
+void Fmt_Int(Fmt_Buffer_t *pFmt, int32_t Value){
+
+	// -(uint32_t) also works for INT32_MIN, -Value would overflow
+	if (Value < 0){
+		Fmt_Char(pFmt, '-');
+		Fmt_Uint(pFmt, -(uint32_t)Value);
+	} else {
+		Fmt_Uint(pFmt, (uint32_t)Value);
+	}
+
+} /* End Fmt_Int() */
+
+
+void Fmt_Hex(Fmt_Buffer_t *pFmt, uint32_t Value, uint8_t Digits){
+
+	static const char hex[] = "0123456789ABCDEF";
+
+	if (Digits == 0){
+
+		// smallest nb of digits, at least one
+		Digits = 1;
+		while (Digits < 8 && (Value >> (4 * Digits)))
+			Digits++;
+
+	} else if (Digits > 8){
+		Digits = 8;
+	}
+
+	while (Digits)
+		Fmt_Char(pFmt, hex[(Value >> (4 * --Digits)) & 0xF]);
+
+} /* End Fmt_Hex() */
+
+
+static void Fmt_IntFrac(Fmt_Buffer_t *pFmt, uint8_t Negative, uint32_t IntPart,
+						uint32_t FracPart, uint8_t Decimals){
+
+	if (Negative)
+		Fmt_Char(pFmt, '-');
+
+	Fmt_Uint(pFmt, IntPart);
+
+	if (Decimals){
+		Fmt_Char(pFmt, '.');
+		Fmt_UintPad(pFmt, FracPart, Decimals, '0');
+	}
+
+} /* End Fmt_IntFrac() */
+
+
+void Fmt_Decimal(Fmt_Buffer_t *pFmt, int32_t Value, uint8_t Decimals){
+
+	if (Decimals > FMT_MAX_DECIMALS)
+		Decimals = FMT_MAX_DECIMALS;
+
+	uint32_t mag = (Value < 0) ? -(uint32_t)Value : (uint32_t)Value;
+	uint32_t p = fmt_pow10[Decimals];
+
+	Fmt_IntFrac(pFmt, Value < 0, mag / p, mag % p, Decimals);
+
+} /* End Fmt_Decimal() */
+
+
+void Fmt_Fixed(Fmt_Buffer_t *pFmt, int32_t Value, uint8_t FracBits, uint8_t Decimals){
+
+	if (Decimals > FMT_MAX_DECIMALS)
+		Decimals = FMT_MAX_DECIMALS;
+
+	if (FracBits > 31)
+		FracBits = 31;
+
+	uint32_t mag = (Value < 0) ? -(uint32_t)Value : (uint32_t)Value;
+	uint32_t int_part = mag >> FracBits;
+	uint32_t frac = mag & ((1U << FracBits) - 1);
+	uint32_t p = fmt_pow10[Decimals];
+
+	/*
+	 * frac / 2^FracBits * 10^Decimals, rounded to the nearest:
+	 * 64 bits product (one UMULL), then + 0.5 before the shift
+	 * */
+	uint64_t scaled = (uint64_t)frac * p;
+
+	if (FracBits)
+		scaled = (scaled + (1ULL << (FracBits - 1))) >> FracBits;
+
+	// 0.999 with 2 decimals rounds to 1.00
+	if (scaled >= p){
+		scaled -= p;
+		int_part++;
+	}
+
+	Fmt_IntFrac(pFmt, Value < 0 && (int_part || scaled), int_part,
+				(uint32_t)scaled, Decimals);
+
+} /* End Fmt_Fixed() */
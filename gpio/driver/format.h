@@ -0,0 +1,65 @@
+
+#pragma once
+
+#include <stdint.h>
+
+/*
+ * Goal: format log messages without printf()
+ *
+ * newlib printf() costs several KB of flash, thousands of cycles per
+ * call (the format string is parsed at run time) and may take memory
+ * from the heap (_sbrk). Here each piece of the message is one call:
+ *
+ * 		char line[48];
+ * 		Fmt_Buffer_t f;
+ *
+ * 		Fmt_Init(&f, line, sizeof(line));
+ * 		Fmt_Str(&f, "ch=");
+ * 		Fmt_Uint(&f, ch);
+ * 		Fmt_Str(&f, " v=");
+ * 		Fmt_Decimal(&f, millivolts, 3);   // 3300 -> "3.300"
+ * 		Fmt_Char(&f, '\n');
+ *
+ * 		Retarget_Write((uint8_t*)line, f.len);
+ *
+ * 	- no heap, no varargs (so no float -> double promotion),
+ * 	  the only memory is the buffer given by the caller
+ * 	- the text is cut when the buffer is full (truncated = 1),
+ * 	  it is always terminated by '\0'
+ * 	- reentrant: all the state is in the Fmt_Buffer_t
+ *
+ * */
+
+typedef struct{
+
+	char *pBuf;
+	uint32_t Size;        // including the '\0'
+	uint32_t len;         // chars written, without the '\0'
+	uint8_t truncated;
+
+} Fmt_Buffer_t;
+
+
+// ================== API ==================
+
+void Fmt_Init(Fmt_Buffer_t *pFmt, char *pBuf, uint32_t Size);
+
+void Fmt_Char(Fmt_Buffer_t *pFmt, char c);
+
+void Fmt_Str(Fmt_Buffer_t *pFmt, const char *pStr);
+
+void Fmt_Uint(Fmt_Buffer_t *pFmt, uint32_t Value);
+
+void Fmt_Int(Fmt_Buffer_t *pFmt, int32_t Value);
+
+// Right aligned in Width chars, filled with Pad (' ' or '0')
+void Fmt_UintPad(Fmt_Buffer_t *pFmt, uint32_t Value, uint8_t Width, char Pad);
+
+// Upper case, Digits = 0 -> no leading zeros, no "0x" prefix is added
+void Fmt_Hex(Fmt_Buffer_t *pFmt, uint32_t Value, uint8_t Digits);
+
+// Scaled integer: Value = 3300, Decimals = 3 -> "3.300"
+void Fmt_Decimal(Fmt_Buffer_t *pFmt, int32_t Value, uint8_t Decimals);
+
+// Q format: Value = 0x18000, FracBits = 16, Decimals = 2 -> "1.50" (rounded)
+void Fmt_Fixed(Fmt_Buffer_t *pFmt, int32_t Value, uint8_t FracBits, uint8_t Decimals);
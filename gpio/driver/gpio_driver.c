@@ -1,5 +1,6 @@
 
 #include "gpio_driver.h"
+#include "clock_gate.h"
 
 
 // =============== Clock Functions ===============
@@ -194,13 +195,16 @@ void SYSCFG_CLK_OFF(void) {
 void GPIO_PeriClockControl(GPIO_RegDef_t *pGPIOx,		
 						  uint8_t ON_OFF){
 
+	/*
+	 * The index in gpio_clk_map is the GPIOxEN bit in RCC_AHB1ENR.
+	 * Reference counted (clock_gate.h): OFF only stops the port once
+	 * every module which turned it ON turned it OFF. The raw
+	 * GPIOx_CLK_ON() / GPIOx_CLK_OFF() functions bypass the count
+	 * */
 	   for (int i = 0; i < NB_GPIO_PORTS; ++i) {
 
         if (gpio_clk_map[i].base == pGPIOx) {
-            if (ON_OFF == ON)
-                gpio_clk_map[i].clk_on();
-            else
-                gpio_clk_map[i].clk_off();
+            CLK_PeriClockControl(CLK_AHB1, CLK_AHB1_GPIOA + i, ON_OFF);
             break;
         }
     } /* End for loop for all ports */
@@ -208,6 +212,20 @@ void GPIO_PeriClockControl(GPIO_RegDef_t *pGPIOx,
 
 } /* End GPIO_PeriClockControl() */
 
+
+void GPIO_ClockHold(GPIO_RegDef_t *pGPIOx, uint32_t *pHeld){
+
+	// one reference per port for the owner of *pHeld (clock_gate.h)
+	for (int i = 0; i < NB_GPIO_PORTS; ++i) {
+
+		if (gpio_clk_map[i].base == pGPIOx) {
+			CLK_Hold(pHeld, CLK_AHB1, CLK_AHB1_GPIOA + i);
+			break;
+		}
+	}
+
+} /* End GPIO_ClockHold() */
+
 // =========================================================
 
 
@@ -231,8 +249,33 @@ void GPIO_Init(GPIO_Handle_t *pGPIOHandle){
 
 	switch (pGPIOHandle->gpio_pin_conf.GPIO_PinMode){
 	
+	case ALT:
+
+		uint8_t temp1, temp2;
+		
+		temp1 = pGPIOHandle->gpio_pin_conf.GPIO_PinNumber/8;
+		// this will give us the index of the AFR register
+		// if AFR[0] or AFR[1]
+
+		// Now which bit position in the AFR register
+		temp2 = pGPIOHandle->gpio_pin_conf.GPIO_PinNumber % 8;
+
+		// Clearing the bits in the AFR register first
+		pGPIOHandle->gpio_reg_x->AFR[temp1] &= ~(0xF << (4 * temp2));
+		// 0xF is 1111, so we clear the 4 bits corresponding to the pin number
+
+		// Now we can set the alternate function register  
+		pGPIOHandle->gpio_reg_x->AFR[temp1] |= (pGPIOHandle->gpio_pin_conf.GPIO_PinAltFunMode << (4 * temp2));
+
+		/*
+			An ALT pin also needs MODER = 10 (ALT), and the speed,
+			output type and pull up/down like an output pin,
+			so we continue in the IN/OUT case (no break)
+		*/
+		// fall through
 		case IN:
 		case OUT:
+		case ANALOG:
 		/* In case we input or output mode 
 
 			We configure teh MODER (input or output), and various
@@ -262,6 +305,10 @@ void GPIO_Init(GPIO_Handle_t *pGPIOHandle){
 
 		The mode value will be stored in the GPIOx_MODER register
 
+		- ANALOG (11): the digital input buffer is cut and the pin goes
+		straight to the ADC / DAC, the pull up / pull down are disabled
+		by hardware (section 8.3.12), speed and output type don't matter
+
 	*/
 	
 	// Now we start by other registers, speed, output type, pull up and pull down resistor
@@ -293,25 +340,6 @@ void GPIO_Init(GPIO_Handle_t *pGPIOHandle){
 	pGPIOHandle->gpio_reg_x->PUPDR |= (pGPIOHandle->gpio_pin_conf.GPIO_PinPuPdControl << (2 * pGPIOHandle->gpio_pin_conf.GPIO_PinNumber));
 		break;
 
-	case ALT:
-
-		uint8_t temp1, temp2;
-		
-		temp1 = pGPIOHandle->gpio_pin_conf.GPIO_PinNumber/8;
-		// this will give us the index of the AFR register
-		// if AFR[0] or AFR[1]
-
-		// Now which bit position in the AFR register
-		temp2 = pGPIOHandle->gpio_pin_conf.GPIO_PinNumber % 8;
-
-		// Clearing the bits in the AFR register first
-		pGPIOHandle->gpio_reg_x->AFR[temp1] &= ~(0xF << (4 * temp2));
-		// 0xF is 1111, so we clear the 4 bits corresponding to the pin number
-
-		// Now we can set the alternate function register  
-		pGPIOHandle->gpio_reg_x->AFR[temp1] |= (pGPIOHandle->gpio_pin_conf.GPIO_PinAltFunMode << (4 * temp2));
-
-		break; // End case ALT
 	
 	// ================ Interrupt mode ================
 
@@ -340,10 +368,13 @@ void GPIO_Init(GPIO_Handle_t *pGPIOHandle){
 		// Input is: GPIO_RegDef_t *pGPIO, the address of GPIOx
 		uint8_t portcode = GPIO_BASEADDR_TO_CODE(pGPIOHandle->gpio_reg_x);
 
-		SYSCFG_CLK_ON(); // Enable clock for SYSCFG peripheral
+		// SYSCFG clock only for the write, EXTICR keeps its value without it
+		CLK_Acquire(CLK_APB2, CLK_APB2_SYSCFG);
 
 		SYSCFG->EXTICR[index_extir] |= (portcode << (bit_post_extir * 4));
 
+		CLK_Release(CLK_APB2, CLK_APB2_SYSCFG);
+
 			//Step 3: Now we configure EXTI for falling, rising or both
 
 			switch(pGPIOHandle->gpio_pin_conf.GPIO_PinMode){
@@ -512,8 +543,77 @@ Then we XOR the ODR register with this value */
 
 
 
+// =============== Fast path, from SRAM ===============
+
+__ramfunc void GPIO_FastSet(GPIO_RegDef_t *pGPIOx, uint16_t PinMask){
+
+	// BS bits (0..15): 1 sets the pin, 0 does nothing
+	pGPIOx->BSRR = PinMask;
+
+} /* End GPIO_FastSet() */
+
+
+__ramfunc void GPIO_FastReset(GPIO_RegDef_t *pGPIOx, uint16_t PinMask){
+
+	// BR bits (16..31): 1 resets the pin
+	pGPIOx->BSRR = (uint32_t)PinMask << 16;
+
+} /* End GPIO_FastReset() */
+
+
+__ramfunc void GPIO_FastToggle(GPIO_RegDef_t *pGPIOx, uint16_t PinMask){
+
+	/*
+	 * ODR is only read: the pins of the mask at 1 go to BR, the others
+	 * to BS. A pin out of the mask is never written
+	 * */
+	uint32_t odr = pGPIOx->ODR;
+
+	pGPIOx->BSRR = ((odr & PinMask) << 16) | (~odr & PinMask);
+
+} /* End GPIO_FastToggle() */
+
+
+// =============== EXTI dispatcher ===============
+
+typedef struct{
+	gpio_exti_callback_t Callback;
+	void *pContext;
+} GPIO_EXTIMap;
+
+static __ccm_bss GPIO_EXTIMap gpio_exti_map[16];
+
+
+void GPIO_EXTIRegister(uint8_t PinNumber, gpio_exti_callback_t Callback,
+					   void *pContext){
+
+	if (PinNumber > 15)
+		return;
+
+	// context first: the ISR may run as soon as the callback is set
+	gpio_exti_map[PinNumber].pContext = pContext;
+	gpio_exti_map[PinNumber].Callback = Callback;
+
+} /* End GPIO_EXTIRegister() */
+
+
+__ramfunc void GPIO_EXTIDispatch(uint16_t LineMask){
+
+	uint32_t pending = EXTI->PR & LineMask;
+
+	// rc_w1: writing 1 clears, the lines out of pending are untouched
+	EXTI->PR = pending;
+
+	while (pending){
+
+		// lowest pending line (RBIT + CLZ, no library call)
+		uint8_t line = __builtin_ctz(pending);
 
+		pending &= pending - 1;
 
+		if (gpio_exti_map[line].Callback)
+			gpio_exti_map[line].Callback(line, gpio_exti_map[line].pContext);
 
-						
+	}
 
+} /* End GPIO_EXTIDispatch() */
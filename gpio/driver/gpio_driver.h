@@ -1,4 +1,5 @@
 #include "stm32f407G.h"
+#include "mem_sections.h"
 
 /* Create a structure to configure a pin of a GPIO */
 
@@ -148,6 +149,10 @@ void SYSCFG_CLK_OFF(void);
 void GPIO_PeriClockControl(GPIO_RegDef_t *pGPIOx,	
 						  uint8_t ON_OFF);
 
+// For the drivers: the port held by the owner of *pHeld, once
+// (CLK_Hold(), clock_gate.h), given back with CLK_DropAll(pHeld, CLK_AHB1)
+void GPIO_ClockHold(GPIO_RegDef_t *pGPIOx, uint32_t *pHeld);
+
 void GPIO_Init(GPIO_Handle_t *pGPIOHandle);
 
 void GPIO_DeInit(GPIO_RegDef_t *pGPIOx);
@@ -168,8 +173,56 @@ void GPIO_ToggleOutputPin(GPIO_RegDef_t *pGPIOx,
                          uint8_t PinNumber);
 
 
+// ================== Fast path, from SRAM ==================
+
+/*
+ * Set / reset / toggle several pins of a port in one write to BSRR
+ * (section 8.4.7): no read-modify-write of ODR, so an ISR writing the
+ * other pins of the port between the read and the write loses nothing
+ *
+ * 	PinMask: bit n -> pin n, example (1 << 12) | (1 << 13)
+ *
+ * They run from SRAM (__ramfunc, mem_sections.h): same number of
+ * cycles at each call, whatever the state of the ART cache
+ * */
+__ramfunc void GPIO_FastSet(GPIO_RegDef_t *pGPIOx, uint16_t PinMask);
 
+__ramfunc void GPIO_FastReset(GPIO_RegDef_t *pGPIOx, uint16_t PinMask);
 
+__ramfunc void GPIO_FastToggle(GPIO_RegDef_t *pGPIOx, uint16_t PinMask);
 
 
+// ================== EXTI dispatcher ==================
 
+/*
+ * One callback per EXTI line (0..15), the line number being the pin
+ * number whatever the port (SYSCFG_EXTICR, set by GPIO_Init())
+ *
+ * 	- GPIO_EXTIDispatch() clears the pending bits of LineMask in
+ * 	  EXTI_PR (section 12.3.6), then calls the callbacks from the
+ * 	  lowest line to the highest
+ * 	- it runs from SRAM (__ramfunc): the time from the IRQ to the
+ * 	  callback doesn't depend on the ART cache. The callback runs
+ * 	  from flash unless it is a __ramfunc too
+ * 	- the table of callbacks is in CCM (ISR private state)
+ *
+ * Usage (the handlers stay in the application):
+ * 		GPIO_EXTIRegister(GPIO_PIN_0, button_pressed, 0);
+ * 		void EXTI0_IRQHandler(void){ GPIO_EXTIDispatch(GPIO_EXTI_LINE_0); }
+ * 		void EXTI9_5_IRQHandler(void){ GPIO_EXTIDispatch(GPIO_EXTI_LINES_9_5); }
+ * */
+
+#define GPIO_EXTI_LINE_0      0x0001
+#define GPIO_EXTI_LINE_1      0x0002
+#define GPIO_EXTI_LINE_2      0x0004
+#define GPIO_EXTI_LINE_3      0x0008
+#define GPIO_EXTI_LINE_4      0x0010
+#define GPIO_EXTI_LINES_9_5   0x03E0
+#define GPIO_EXTI_LINES_15_10 0xFC00
+
+typedef void (*gpio_exti_callback_t)(uint8_t PinNumber, void *pContext);
+
+void GPIO_EXTIRegister(uint8_t PinNumber, gpio_exti_callback_t Callback,
+					   void *pContext);
+
+__ramfunc void GPIO_EXTIDispatch(uint16_t LineMask);
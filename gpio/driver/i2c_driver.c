@@ -0,0 +1,664 @@
+#include "i2c_driver.h"
+#include "gpio_driver.h"
+#include "rcc_driver.h"
+#include "nvic_driver.h"
+#include "dwt_counter.h"
+#include "clock_gate.h"
+#include "dvfs.h"
+
+
+// =============== Clock, IRQs and DMA request of each I2C ===============
+
+/*
+ * 	- bit: position in RCC_APB1ENR / RCC_APB1RSTR (sections 7.3.13, 7.3.6)
+ * 	- event and error IRQs: table 61
+ * 	- RX DMA stream / channel: table 42
+ * */
+
+typedef struct{
+	I2C_RegDef_t *base;
+	uint8_t bit;
+	uint8_t irq_ev;
+	uint8_t irq_er;
+	uint8_t rx_stream;
+	uint8_t rx_channel;
+} I2C_Map;
+
+static const I2C_Map i2c_map[] = {
+	{I2C1, 21, IRQ_NO_I2C1_EV, IRQ_NO_I2C1_ER, 0, 1},
+	{I2C2, 22, IRQ_NO_I2C2_EV, IRQ_NO_I2C2_ER, 2, 7},
+	{I2C3, 23, IRQ_NO_I2C3_EV, IRQ_NO_I2C3_ER, 2, 3}
+};
+
+#define NB_I2C (sizeof(i2c_map)/sizeof(i2c_map[0]))
+
+// Clocks held by the driver until I2C_DeInit() (clock_gate.h)
+static uint32_t i2c_clk_held;             // APB1 bits of the I2Cs
+static uint32_t i2c_port_held[NB_I2C];    // GPIO ports of SCL / SDA
+
+#define I2C_AF 4
+
+#define I2C_SR1_ERRORS ((1 << I2C_SR1_BERR) | (1 << I2C_SR1_ARLO) | (1 << I2C_SR1_AF) | \
+						(1 << I2C_SR1_OVR) | (1 << I2C_SR1_TIMEOUT))
+
+static const I2C_Map *I2C_FindMap(I2C_RegDef_t *pI2Cx){
+
+	for (int i = 0; i < NB_I2C; ++i) {
+		if (i2c_map[i].base == pI2Cx)
+			return &i2c_map[i];
+	}
+
+	return 0;
+
+} /* End I2C_FindMap() */
+
+
+static void I2C_PinConfig(GPIO_RegDef_t *pGPIOx, uint8_t PinNumber, uint8_t Mode){
+
+	GPIO_Handle_t pin;
+
+	pin.gpio_reg_x = pGPIOx;
+	pin.gpio_pin_conf.GPIO_PinNumber = PinNumber;
+	pin.gpio_pin_conf.GPIO_PinMode = Mode;
+	pin.gpio_pin_conf.GPIO_PinSpeed = HIGH;
+	pin.gpio_pin_conf.GPIO_PinOPType = OPEN_DRAIN;  // the bus is wired-AND
+	pin.gpio_pin_conf.GPIO_PinPuPdControl = PULLUP;
+	pin.gpio_pin_conf.GPIO_PinAltFunMode = I2C_AF;
+
+	GPIO_Init(&pin);
+
+} /* End I2C_PinConfig() */
+
+
+/*
+ * Registers of the I2C (PE = 0 while configuring), section 27.6
+ *
+ * 	- FREQ: fPCLK1 in MHz, the I2C derives its timings from it
+ * 	- CCR: SCL high (and low) time in PCLK1 periods
+ * 		100 kHz: Thigh = Tlow = CCR * TPCLK1  -> CCR = fPCLK1 / (2 * 100k)
+ * 		400 kHz (DUTY = 0): Tlow = 2 * Thigh  -> CCR = fPCLK1 / (3 * 400k)
+ * 	  rounded up: a truncated CCR gives a clock above the bus speed
+ * 	  (42 MHz / 1.2 MHz = 35: 35 -> 400 kHz, 34 would be 412 kHz)
+ * 	- TRISE: max rise time (1000 ns / 300 ns) in PCLK1 periods + 1
+ * */
+static void I2C_HwConfig(I2C_Handle_t *pI2CHandle){
+
+	I2C_RegDef_t *pI2Cx = pI2CHandle->pI2Cx;
+
+	// software reset clears a BUSY flag left by a glitch on the lines
+	pI2Cx->CR1 = (1 << I2C_CR1_SWRST);
+	pI2Cx->CR1 = 0;
+
+	uint32_t pclk = RCC_GetPCLK1Value();
+	uint32_t freq = pclk / 1000000U;
+
+	pI2Cx->CR2 = (freq << I2C_CR2_FREQ) | (1 << I2C_CR2_ITERREN) | (1 << I2C_CR2_ITEVTEN);
+
+	uint32_t ccr;
+
+	if (pI2CHandle->I2C_Config.I2C_Speed == I2C_SPEED_400K){
+
+		ccr = (pclk + 3 * 400000U - 1) / (3 * 400000U);
+		if (ccr == 0)
+			ccr = 1;
+
+		pI2Cx->CCR = (1 << I2C_CCR_FS) | ccr;
+		pI2Cx->TRISE = (freq * 300U) / 1000U + 1;
+
+	} else {
+
+		ccr = (pclk + 2 * 100000U - 1) / (2 * 100000U);
+		if (ccr < 4)
+			ccr = 4;   // minimum in standard mode
+
+		pI2Cx->CCR = ccr;
+		pI2Cx->TRISE = freq + 1;
+
+	} /* End if-else speed */
+
+	pI2Cx->CR1 = (1 << I2C_CR1_PE);
+
+} /* End I2C_HwConfig() */
+
+
+static drv_status I2C_StartTransaction(I2C_Handle_t *pI2CHandle);
+
+/*
+ * DMA_Start() refuses a CCM buffer (mem_sections.h): nothing is armed,
+ * the caller ends the transaction with DRV_ERROR
+ * */
+static drv_status I2C_PrepareRead(I2C_Handle_t *pI2CHandle, I2C_Transaction_t *pTrans){
+
+	I2C_RegDef_t *pI2Cx = pI2CHandle->pI2Cx;
+
+	if (pTrans->ReadLen >= 2){
+
+		// DMA takes every byte, LAST: NACK after the last one (section 27.3.7)
+		drv_status status = DMA_Start(&pI2CHandle->rx_dma, (uint32_t)&pI2Cx->DR,
+									  (uint32_t)pTrans->pRead, 0, pTrans->ReadLen);
+
+		if (status != DRV_OK)
+			return status;
+
+		pI2Cx->CR2 |= (1 << I2C_CR2_DMAEN) | (1 << I2C_CR2_LAST);
+		pI2Cx->CR1 |= (1 << I2C_CR1_ACK);
+
+	} else {
+
+		// 1 byte: NACK set at ADDR time, read on RXNE by the ISR
+		pI2Cx->CR2 &= ~((1 << I2C_CR2_DMAEN) | (1 << I2C_CR2_LAST));
+
+	}
+
+	return DRV_OK;
+
+} /* End I2C_PrepareRead() */
+
+
+/*
+ * End of the transaction at the head of the queue. End = 1: the bus
+ * is still held (BTF, NACK sent, error), the START of the next
+ * transaction is a repeated START, the STOP is only sent when the
+ * queue is empty. End = 0: the STOP is already requested (1 byte
+ * read) or the I2C is no longer master (arbitration lost)
+ *
+ * Done is called before the end of the bus part: a transaction it
+ * queues also gets the repeated START
+ * */
+static void I2C_Complete(I2C_Handle_t *pI2CHandle, drv_status Status, uint8_t End){
+
+	I2C_RegDef_t *pI2Cx = pI2CHandle->pI2Cx;
+	I2C_Transaction_t *pDone = pI2CHandle->pHead;
+
+	if (pDone == 0)
+		return;
+
+	pI2Cx->CR2 &= ~((1 << I2C_CR2_DMAEN) | (1 << I2C_CR2_LAST) | (1 << I2C_CR2_ITBUFEN));
+
+	if (Status != DRV_OK){
+		DMA_Stop(&pI2CHandle->rx_dma);
+		pI2CHandle->errors++;
+	} else {
+		pI2CHandle->transactions++;
+	}
+
+	pDone->Status = Status;
+
+	pI2CHandle->pHead = pDone->pNext;
+
+	if (pI2CHandle->pHead == 0)
+		pI2CHandle->pTail = 0;
+
+	pI2CHandle->phase = I2C_PHASE_IDLE;
+
+	if (pDone->Done)
+		pDone->Done(pDone);
+
+	// Done queued a transaction on an empty queue, I2C_Submit() started it
+	if (pI2CHandle->phase != I2C_PHASE_IDLE)
+		return;
+
+	if (pI2CHandle->pHead){
+
+		// its read buffer refused by the DMA: ended too, the bus is still ours
+		if (I2C_StartTransaction(pI2CHandle) != DRV_OK)
+			I2C_Complete(pI2CHandle, DRV_ERROR, End);
+
+	} else if (End){
+
+		pI2Cx->CR1 |= (1 << I2C_CR1_STOP);
+
+	}
+
+} /* End I2C_Complete() */
+
+
+/*
+ * START of the transaction at the head of the queue, its phase is
+ * known at SB time. While the STOP of the previous transaction is
+ * still on its way CR1 must not be written (section 27.6.1): the
+ * transaction waits in I2C_PHASE_STOP and I2C_Submit() / I2C_Idle()
+ * start it once the hardware has cleared the STOP bit
+ *
+ * DRV_ERROR: read buffer refused by the DMA, no START sent
+ * */
+static drv_status I2C_StartTransaction(I2C_Handle_t *pI2CHandle){
+
+	I2C_RegDef_t *pI2Cx = pI2CHandle->pI2Cx;
+	I2C_Transaction_t *pTrans = pI2CHandle->pHead;
+
+	if (pI2Cx->CR1 & (1 << I2C_CR1_STOP)){
+		pI2CHandle->phase = I2C_PHASE_STOP;
+		return DRV_OK;
+	}
+
+	if (pTrans->WriteLen == 0 && pTrans->ReadLen &&
+		I2C_PrepareRead(pI2CHandle, pTrans) != DRV_OK)
+		return DRV_ERROR;
+
+	pI2CHandle->index = 0;
+	pI2CHandle->phase = I2C_PHASE_START;
+
+	pI2Cx->CR1 |= (1 << I2C_CR1_START);
+
+	return DRV_OK;
+
+} /* End I2C_StartTransaction() */
+
+
+// Transaction waiting in I2C_PHASE_STOP, started once the STOP is on the bus
+static void I2C_Resume(I2C_Handle_t *pI2CHandle){
+
+	if (pI2CHandle->phase != I2C_PHASE_STOP)
+		return;
+
+	// the STOP is already sent: End = 0
+	if (I2C_StartTransaction(pI2CHandle) != DRV_OK)
+		I2C_Complete(pI2CHandle, DRV_ERROR, 0);
+
+} /* End I2C_Resume() */
+
+
+static void I2C_RxDMACallback(DMA_Handle_t *pDMAHandle, uint8_t event){
+
+	I2C_Handle_t *pI2CHandle = (I2C_Handle_t*)pDMAHandle->pContext;
+
+	if (event == DMA_EVENT_HALF_TRANSFER)
+		return;
+
+	// the NACK of the last byte is already sent (LAST), STOP or repeated START left
+	I2C_Complete(pI2CHandle, (event == DMA_EVENT_ERROR) ? DRV_ERROR : DRV_OK, 1);
+
+} /* End I2C_RxDMACallback() */
+
+
+static void I2C_Delay(uint32_t cycles){
+
+	uint32_t start = DWT_GetCycles();
+
+	while ((DWT_GetCycles() - start) < cycles);
+
+} /* End I2C_Delay() */
+
+// =========================================================
+
+
+void I2C_PeriClockControl(I2C_RegDef_t *pI2Cx, uint8_t ON_OFF){
+
+	const I2C_Map *map = I2C_FindMap(pI2Cx);
+
+	if (map == 0)
+		return;
+
+	CLK_PeriClockControl(CLK_APB1, map->bit, ON_OFF);
+
+} /* End I2C_PeriClockControl() */
+
+
+void I2C_DeInit(I2C_RegDef_t *pI2Cx){
+
+	const I2C_Map *map = I2C_FindMap(pI2Cx);
+
+	if (map == 0)
+		return;
+
+	RCC->APB1RSTR |= (1 << map->bit);
+	RCC->APB1RSTR &= ~(1 << map->bit);
+
+	CLK_Drop(&i2c_clk_held, CLK_APB1, map->bit);
+	CLK_DropAll(&i2c_port_held[map - i2c_map], CLK_AHB1);
+
+} /* End I2C_DeInit() */
+
+
+drv_status I2C_Init(I2C_Handle_t *pI2CHandle){
+
+	I2C_Config_t *pConf = &pI2CHandle->I2C_Config;
+
+	const I2C_Map *map = I2C_FindMap(pI2CHandle->pI2Cx);
+
+	if (map == 0)
+		return DRV_ERROR;
+
+	pI2CHandle->pHead = 0;
+	pI2CHandle->pTail = 0;
+	pI2CHandle->phase = I2C_PHASE_IDLE;
+	pI2CHandle->transactions = 0;
+	pI2CHandle->errors = 0;
+	pI2CHandle->recoveries = 0;
+
+	// 1. RX stream: DR -> memory, 1 byte at a time
+	DMA_Handle_t *pDMA = &pI2CHandle->rx_dma;
+
+	pDMA->pDMAx = DMA1;
+	pDMA->Stream = map->rx_stream;
+	pDMA->DMA_Config.DMA_Channel = map->rx_channel;
+	pDMA->DMA_Config.DMA_Direction = DMA_DIR_PERIPH_TO_MEM;
+	pDMA->DMA_Config.DMA_PeriphInc = OFF;
+	pDMA->DMA_Config.DMA_MemInc = ON;
+	pDMA->DMA_Config.DMA_PeriphDataSize = DMA_SIZE_BYTE;
+	pDMA->DMA_Config.DMA_MemDataSize = DMA_SIZE_BYTE;
+	pDMA->DMA_Config.DMA_Circular = OFF;
+	pDMA->DMA_Config.DMA_DoubleBuffer = OFF;
+	pDMA->DMA_Config.DMA_Priority = DMA_PRIO_MEDIUM;  // 400 kHz: plenty of time
+	pDMA->DMA_Config.DMA_HalfTransferIT = OFF;
+	pDMA->DMA_Config.DMA_FIFOMode = OFF;
+	pDMA->Callback = I2C_RxDMACallback;
+	pDMA->pContext = pI2CHandle;
+
+	// DRV_BUSY: the stream is taken by another driver (dma_driver.h)
+	drv_status status = DMA_Init(pDMA);
+
+	if (status != DRV_OK)
+		return status;
+
+	// 2. Pins and registers
+	GPIO_ClockHold(pConf->pSCLPort, &i2c_port_held[map - i2c_map]);
+	GPIO_ClockHold(pConf->pSDAPort, &i2c_port_held[map - i2c_map]);
+
+	CLK_Hold(&i2c_clk_held, CLK_APB1, map->bit);
+
+	// a slave holding SDA low since the last reset: free the bus first
+	if (!GPIO_ReadFromInputPin(pConf->pSDAPort, pConf->SDAPin)){
+
+		// bus still stuck: no I2C, the clocks and the stream go back
+		if (I2C_BusRecover(pI2CHandle) != DRV_OK){
+			CLK_Drop(&i2c_clk_held, CLK_APB1, map->bit);
+			CLK_DropAll(&i2c_port_held[map - i2c_map], CLK_AHB1);
+			DMA_Release(pDMA);
+			return DRV_ERROR;
+		}
+
+	} else {
+
+		I2C_PinConfig(pConf->pSCLPort, pConf->SCLPin, ALT);
+		I2C_PinConfig(pConf->pSDAPort, pConf->SDAPin, ALT);
+		I2C_HwConfig(pI2CHandle);
+
+	}
+
+	// 3. IRQs, the EV, ER and DMA IRQs must share one preempt level
+	pI2CHandle->ceiling = NVIC_GetCeiling(map->irq_ev);
+
+	NVIC_IRQInterruptConfig(map->irq_ev, ON);
+	NVIC_IRQInterruptConfig(map->irq_er, ON);
+
+	return DRV_OK;
+
+} /* End I2C_Init() */
+
+
+drv_status I2C_BusRecover(I2C_Handle_t *pI2CHandle){
+
+	I2C_Config_t *pConf = &pI2CHandle->I2C_Config;
+
+	if (!I2C_Idle(pI2CHandle))
+		return DRV_BUSY;
+
+	if (!(DWT->CTRL & DWT_CTRL_CYCCNTENA))
+		DWT_CycleCounterInit();
+
+	// half period of a 100 kHz clock
+	uint32_t half = SystemCoreClock / 200000U;
+
+	pI2CHandle->pI2Cx->CR1 &= ~(1 << I2C_CR1_PE);
+
+	/*
+	 * 1. SCL as open drain output (released = high), SDA as input
+	 *    Up to 9 clocks: the slave finishes the byte it was sending
+	 *    and sees a NACK, then it releases SDA (NXP UM10204, 3.1.16)
+	 * */
+	GPIO_WriteToOutputPin(pConf->pSCLPort, pConf->SCLPin, 1);
+	I2C_PinConfig(pConf->pSCLPort, pConf->SCLPin, OUT);
+	I2C_PinConfig(pConf->pSDAPort, pConf->SDAPin, IN);
+
+	for (int i = 0; i < 9 && !GPIO_ReadFromInputPin(pConf->pSDAPort, pConf->SDAPin); ++i){
+
+		GPIO_WriteToOutputPin(pConf->pSCLPort, pConf->SCLPin, 0);
+		I2C_Delay(half);
+		GPIO_WriteToOutputPin(pConf->pSCLPort, pConf->SCLPin, 1);
+		I2C_Delay(half);
+
+	} /* End for clocks */
+
+	// 2. STOP: SDA goes high while SCL is high
+	GPIO_WriteToOutputPin(pConf->pSCLPort, pConf->SCLPin, 0);
+	GPIO_WriteToOutputPin(pConf->pSDAPort, pConf->SDAPin, 0);
+	I2C_PinConfig(pConf->pSDAPort, pConf->SDAPin, OUT);
+	I2C_Delay(half);
+	GPIO_WriteToOutputPin(pConf->pSCLPort, pConf->SCLPin, 1);
+	I2C_Delay(half);
+	GPIO_WriteToOutputPin(pConf->pSDAPort, pConf->SDAPin, 1);
+	I2C_Delay(half);
+
+	uint8_t sda_free = GPIO_ReadFromInputPin(pConf->pSDAPort, pConf->SDAPin);
+
+	// 3. Pins back to the I2C, which forgets the old bus state (SWRST)
+	I2C_PinConfig(pConf->pSCLPort, pConf->SCLPin, ALT);
+	I2C_PinConfig(pConf->pSDAPort, pConf->SDAPin, ALT);
+	I2C_HwConfig(pI2CHandle);
+
+	pI2CHandle->recoveries++;
+
+	return sda_free ? DRV_OK : DRV_ERROR;
+
+} /* End I2C_BusRecover() */
+
+
+drv_status I2C_Submit(I2C_Handle_t *pI2CHandle, I2C_Transaction_t *pTrans){
+
+	if ((pTrans->WriteLen && pTrans->pWrite == 0) ||
+		(pTrans->ReadLen && pTrans->pRead == 0))
+		return DRV_ERROR;
+
+	pTrans->pNext = 0;
+	pTrans->Status = DRV_BUSY;
+
+	drv_status status = DRV_OK;
+
+	uint32_t state = IRQ_EnterCritical(pI2CHandle->ceiling);
+
+	if (pI2CHandle->pTail){
+
+		// a transaction is running, the ISR will start this one
+		pI2CHandle->pTail->pNext = pTrans;
+		pI2CHandle->pTail = pTrans;
+
+	} else {
+
+		pI2CHandle->pHead = pTrans;
+		pI2CHandle->pTail = pTrans;
+
+		status = I2C_StartTransaction(pI2CHandle);
+
+		// refused: not left in the queue, nothing would ever end it
+		if (status != DRV_OK){
+			pI2CHandle->pHead = 0;
+			pI2CHandle->pTail = 0;
+			pTrans->Status = DRV_ERROR;
+		}
+
+	} /* End if-else queue empty */
+
+	I2C_Resume(pI2CHandle);
+
+	IRQ_ExitCritical(state);
+
+	return status;
+
+} /* End I2C_Submit() */
+
+
+uint8_t I2C_Idle(I2C_Handle_t *pI2CHandle){
+
+	// a transaction waiting for the STOP of the previous one
+	if (pI2CHandle->phase == I2C_PHASE_STOP){
+
+		uint32_t state = IRQ_EnterCritical(pI2CHandle->ceiling);
+
+		I2C_Resume(pI2CHandle);
+
+		IRQ_ExitCritical(state);
+
+	}
+
+	return pI2CHandle->pHead == 0;
+
+} /* End I2C_Idle() */
+
+
+void I2C_EV_IRQHandling(I2C_Handle_t *pI2CHandle){
+
+	/*
+	 * Master sequence, see figures 243 (transmitter) and 244 (receiver)
+	 *
+	 * 	SB   -> address + R/W bit in DR
+	 * 	ADDR -> cleared by reading SR1 then SR2
+	 * 	TXE  -> next byte of the write part
+	 * 	BTF  -> write part finished: repeated START (read part, next
+	 * 	        transaction) or STOP
+	 * 	RXNE -> only for a 1 byte read, longer reads go through the DMA
+	 *
+	 * 	BTF stays set until the START / STOP is on the bus, the ISR
+	 * 	may run again meanwhile and finds nothing to do (the next
+	 * 	transaction stays in I2C_PHASE_START until SB)
+	 * */
+
+	I2C_RegDef_t *pI2Cx = pI2CHandle->pI2Cx;
+	I2C_Transaction_t *pTrans = pI2CHandle->pHead;
+
+	uint32_t sr1 = pI2Cx->SR1;
+
+	if (pTrans == 0)
+		return;
+
+	if (sr1 & (1 << I2C_SR1_SB)){
+
+		if (pI2CHandle->phase == I2C_PHASE_START)
+			pI2CHandle->phase = (pTrans->WriteLen || pTrans->ReadLen == 0) ?
+								I2C_PHASE_WRITE : I2C_PHASE_READ;
+
+		pI2Cx->DR = (pTrans->Address << 1) | (pI2CHandle->phase == I2C_PHASE_READ);
+		return;
+
+	} /* End if SB */
+
+	if (sr1 & (1 << I2C_SR1_ADDR)){
+
+		if (pI2CHandle->phase == I2C_PHASE_READ && pTrans->ReadLen == 1){
+
+			/*
+			 * NACK and STOP must be set around the ADDR clear (section 27.3.3),
+			 * a transaction queued after this point waits for the STOP
+			 * */
+			pI2Cx->CR1 &= ~(1 << I2C_CR1_ACK);
+			(void)pI2Cx->SR2;
+			pI2Cx->CR1 |= (1 << I2C_CR1_STOP);
+			pI2Cx->CR2 |= (1 << I2C_CR2_ITBUFEN);
+			return;
+
+		}
+
+		(void)pI2Cx->SR2;
+
+		if (pI2CHandle->phase == I2C_PHASE_WRITE){
+
+			if (pTrans->WriteLen == 0){
+				// address only: the device answered
+				I2C_Complete(pI2CHandle, DRV_OK, 1);
+				return;
+			}
+
+			pI2Cx->CR2 |= (1 << I2C_CR2_ITBUFEN);   // TXE interrupts
+
+		} /* End if write */
+
+		return;
+
+	} /* End if ADDR */
+
+	if (pI2CHandle->phase == I2C_PHASE_WRITE){
+
+		if ((sr1 & (1 << I2C_SR1_TXE)) && pI2CHandle->index < pTrans->WriteLen){
+
+			pI2Cx->DR = pTrans->pWrite[pI2CHandle->index++];
+
+			// last byte written: wait for BTF instead of TXE
+			if (pI2CHandle->index == pTrans->WriteLen)
+				pI2Cx->CR2 &= ~(1 << I2C_CR2_ITBUFEN);
+
+			return;
+
+		}
+
+		if ((sr1 & (1 << I2C_SR1_BTF)) && pI2CHandle->index == pTrans->WriteLen){
+
+			if (pTrans->ReadLen){
+
+				// read buffer refused by the DMA: STOP, the transaction ends in error
+				if (I2C_PrepareRead(pI2CHandle, pTrans) != DRV_OK){
+					I2C_Complete(pI2CHandle, DRV_ERROR, 1);
+					return;
+				}
+
+				pI2CHandle->phase = I2C_PHASE_READ;
+				pI2Cx->CR1 |= (1 << I2C_CR1_START);
+
+			} else {
+
+				I2C_Complete(pI2CHandle, DRV_OK, 1);
+
+			}
+
+		} /* End if BTF */
+
+		return;
+
+	} /* End if write */
+
+	if ((sr1 & (1 << I2C_SR1_RXNE)) && pTrans->ReadLen == 1){
+
+		pTrans->pRead[0] = (uint8_t)pI2Cx->DR;
+		I2C_Complete(pI2CHandle, DRV_OK, 0);
+
+	} /* End if RXNE */
+
+} /* End I2C_EV_IRQHandling() */
+
+
+void I2C_ER_IRQHandling(I2C_Handle_t *pI2CHandle){
+
+	I2C_RegDef_t *pI2Cx = pI2CHandle->pI2Cx;
+
+	uint32_t errors = pI2Cx->SR1 & I2C_SR1_ERRORS;
+
+	if (errors == 0)
+		return;
+
+	// the error flags are cleared by writing 0, the other bits ignore it
+	pI2Cx->SR1 = ~errors & 0xFFFF;
+
+	// after an arbitration lost the I2C is no longer master: no STOP
+	I2C_Complete(pI2CHandle, DRV_ERROR, !(errors & (1 << I2C_SR1_ARLO)));
+
+} /* End I2C_ER_IRQHandling() */
+
+
+/*
+ * Clock change (dvfs.h): FREQ, CCR and TRISE all come from PCLK1,
+ * I2C_HwConfig() computes them again. Only with an empty queue, a
+ * transaction in flight would see its SCL change in the middle
+ * */
+drv_status I2C_DVFSNotify(uint8_t Event, void *pContext){
+
+	I2C_Handle_t *pI2CHandle = pContext;
+
+	if (Event == DVFS_PRE_CHANGE)
+		return I2C_Idle(pI2CHandle) ? DRV_OK : DRV_BUSY;
+
+	if (Event == DVFS_POST_CHANGE)
+		I2C_HwConfig(pI2CHandle);
+
+	return DRV_OK;
+
+} /* End I2C_DVFSNotify() */
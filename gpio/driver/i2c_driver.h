@@ -0,0 +1,145 @@
+
+#pragma once
+
+#include "stm32f407G.h"
+#include "dma_driver.h"
+
+/*
+ * I2C master driver: interrupt state machine + DMA for the reads
+ *
+ * A polling driver waits for every flag (SB, ADDR, TXE, RXNE,...),
+ * at 400 kHz one byte is 22.5 us of CPU spinning. Here:
+ *
+ * 	- each access is a transaction (address, write part, read part),
+ * 	  the write part is sent first, then a repeated START and the read
+ * 	  part (typical "register address then data" access)
+ * 	- I2C_Submit() queues the transaction and returns, the event ISR
+ * 	  (I2C_EV_IRQHandling) moves from one step to the next, the Done
+ * 	  callback is called at the end and the next transaction starts
+ * 	  on a repeated START, the STOP is sent when the queue is empty
+ * 	- a transaction queued once the STOP is already requested (empty
+ * 	  queue, or during a 1 byte read) starts when the hardware has
+ * 	  sent the STOP, from the next I2C_Submit() or I2C_Idle(): wait
+ * 	  for the end with I2C_Idle()
+ * 	- reads of 2 bytes or more are done by the DMA, LAST = 1 makes
+ * 	  the I2C send the NACK of the last byte by itself
+ * 	- a read buffer the DMA can't write (CCM, stack) is refused:
+ * 	  I2C_Submit() returns the error when the queue was empty,
+ * 	  otherwise the transaction ends with Status = DRV_ERROR (STOP
+ * 	  or repeated START for the next one) and the queue goes on
+ * 	- a transaction with no write and no read part only checks that
+ * 	  the device answers (address ACK)
+ * 	- errors (NACK, bus error, arbitration lost) end the transaction
+ * 	  with Status = DRV_ERROR
+ *
+ * Stuck bus: a slave reset in the middle of a read can keep SDA low
+ * forever. I2C_BusRecover() takes the pins back as GPIOs, clocks SCL
+ * up to 9 times until SDA is released, makes a STOP, then gives the
+ * pins back to the I2C. I2C_Init() calls it when the bus is seen busy.
+ *
+ * Pins: GPIO_Init() in ALT mode, AF4, open drain (I2C_Init() does it
+ * 	from the pins given in the config). Discovery: I2C1 SCL = PB6,
+ * 	SDA = PB9 (CS43L22 audio DAC, address 0x4A)
+ *
+ * IRQ handlers, example I2C1:
+ *
+ * 		void I2C1_EV_IRQHandler(void){ I2C_EV_IRQHandling(&i2c1); }
+ * 		void I2C1_ER_IRQHandler(void){ I2C_ER_IRQHandling(&i2c1); }
+ * 		void DMA1_Stream0_IRQHandler(void){ DMA_IRQHandling(&i2c1.rx_dma); }
+ *
+ * */
+
+// ------------ Coding states for I2C configuration ------------
+
+typedef enum I2C_Speed {I2C_SPEED_100K, I2C_SPEED_400K} i2c_speed;
+
+/*
+ * START: requested, the direction is set at SB
+ * STOP: queued while the STOP of the previous transaction is on its way
+ * */
+typedef enum I2C_Phase {I2C_PHASE_IDLE, I2C_PHASE_START, I2C_PHASE_WRITE, I2C_PHASE_READ,
+						I2C_PHASE_STOP} i2c_phase;
+
+
+typedef struct{
+
+	uint8_t I2C_Speed;
+
+	// pins, used by I2C_Init() and by the bus recovery
+	GPIO_RegDef_t *pSCLPort;
+	uint8_t SCLPin;
+	GPIO_RegDef_t *pSDAPort;
+	uint8_t SDAPin;
+
+} I2C_Config_t;
+
+
+typedef struct I2C_Transaction I2C_Transaction_t;
+
+typedef void (*i2c_done_t)(I2C_Transaction_t *pTrans);
+
+struct I2C_Transaction{
+
+	uint8_t Address;           // 7 bits address, not shifted
+	const uint8_t *pWrite;
+	uint16_t WriteLen;
+	uint8_t *pRead;
+	uint16_t ReadLen;
+
+	i2c_done_t Done;           // can be 0, called from the ISR
+	void *pContext;
+
+	// Filled by the driver
+	drv_status Status;
+	I2C_Transaction_t *pNext;
+
+};
+
+
+typedef struct{
+
+	I2C_RegDef_t *pI2Cx;
+	// I2C1, I2C2 or I2C3
+
+	I2C_Config_t I2C_Config;
+
+	// Filled by the driver
+	DMA_Handle_t rx_dma;
+
+	I2C_Transaction_t *__vo pHead;   // transaction in flight
+	I2C_Transaction_t *__vo pTail;
+
+	__vo uint8_t phase;
+	uint16_t index;                  // next byte of the write part
+
+	uint32_t ceiling;
+
+	__vo uint32_t transactions;      // statistics
+	__vo uint32_t errors;
+	__vo uint32_t recoveries;
+
+} I2C_Handle_t;
+
+
+// ================== API ==================
+
+void I2C_PeriClockControl(I2C_RegDef_t *pI2Cx, uint8_t ON_OFF);
+
+drv_status I2C_Init(I2C_Handle_t *pI2CHandle);
+
+void I2C_DeInit(I2C_RegDef_t *pI2Cx);
+
+drv_status I2C_Submit(I2C_Handle_t *pI2CHandle, I2C_Transaction_t *pTrans);
+
+// 1 when no transaction is queued or in flight
+uint8_t I2C_Idle(I2C_Handle_t *pI2CHandle);
+
+// Only when idle: free SDA by clocking SCL, then re-init the I2C
+drv_status I2C_BusRecover(I2C_Handle_t *pI2CHandle);
+
+void I2C_EV_IRQHandling(I2C_Handle_t *pI2CHandle);
+
+void I2C_ER_IRQHandling(I2C_Handle_t *pI2CHandle);
+
+// dvfs_callback_t, pContext = the I2C_Handle_t: same bus speed after a clock change
+drv_status I2C_DVFSNotify(uint8_t Event, void *pContext);
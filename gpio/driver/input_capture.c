@@ -0,0 +1,199 @@
+#include "input_capture.h"
+#include "nvic_driver.h"
+
+
+drv_status IC_Init(IC_Handle_t *pHandle){
+
+	TIM_RegDef_t *pTIMx = pHandle->pTIMx;
+	DMA_Handle_t *pDMA = &pHandle->dma;
+
+	// 32 bits captures only: the differences are taken modulo 2^32
+	if (pTIMx != TIM2 && pTIMx != TIM5)
+		return DRV_ERROR;
+
+	if (pHandle->pBuffer == 0 || pHandle->BufferLen < 4 ||
+		pHandle->BufferLen > 0x7FFF || pHandle->TickRate == 0)
+		return DRV_ERROR;
+
+	if (TIM_GetCaptureDMA(pTIMx, pDMA) != DRV_OK)
+		return DRV_ERROR;
+
+	pHandle->running = 0;
+
+	// 1. Free running counter over the 32 bits at TickRate
+	TIM_ClockHold(pTIMx);
+
+	pTIMx->CR1 = 0;
+	pTIMx->DIER = 0;
+
+	uint32_t psc = TIM_GetClock(pTIMx) / pHandle->TickRate;
+
+	if (psc == 0)
+		return DRV_ERROR;
+
+	if (psc > 0x10000)
+		psc = 0x10000;
+
+	pTIMx->PSC = psc - 1;
+	pTIMx->ARR = 0xFFFFFFFF;
+	pTIMx->CR1 |= (1 << TIM_CR1_URS);
+	pTIMx->EGR = (1 << TIM_EGR_UG);
+
+	pHandle->RealTickRate = TIM_GetClock(pTIMx) / psc;
+
+	// 2. CH1 rising edges, CH2 falling edges, both on TI1 (the CH1 pin)
+	if (TIM_ICInit(pTIMx, 1, TIM_IC_DIRECT, TIM_IC_RISING, pHandle->Filter) != DRV_OK ||
+		TIM_ICInit(pTIMx, 2, TIM_IC_INDIRECT, TIM_IC_FALLING, pHandle->Filter) != DRV_OK)
+		return DRV_ERROR;
+
+	if (TIM_PinInit(pTIMx, pHandle->pGPIOx, pHandle->PinNumber, pHandle->PuPd) != DRV_OK)
+		return DRV_ERROR;
+
+	/*
+	 * 3. DMA burst: each CC1 request makes 2 reads of DMAR, which the
+	 *    timer maps to CCR1 then CCR2 (DBA = offset of CCR1 in words)
+	 * */
+	uint32_t dba = ((uint32_t)&pTIMx->CCR[0] - (uint32_t)&pTIMx->CR1) / 4;
+
+	pTIMx->DCR = (dba << TIM_DCR_DBA) | (1 << TIM_DCR_DBL);
+
+	// 4. Stream: direct mode, a capture is in the buffer as soon as NDTR moves
+	pDMA->DMA_Config.DMA_Direction = DMA_DIR_PERIPH_TO_MEM;
+	pDMA->DMA_Config.DMA_PeriphInc = OFF;
+	pDMA->DMA_Config.DMA_MemInc = ON;
+	pDMA->DMA_Config.DMA_PeriphDataSize = DMA_SIZE_WORD;
+	pDMA->DMA_Config.DMA_MemDataSize = DMA_SIZE_WORD;
+	pDMA->DMA_Config.DMA_Circular = ON;
+	pDMA->DMA_Config.DMA_DoubleBuffer = OFF;
+	pDMA->DMA_Config.DMA_Priority = DMA_PRIO_HIGH;
+	pDMA->DMA_Config.DMA_HalfTransferIT = OFF;
+	pDMA->DMA_Config.DMA_FIFOMode = OFF;
+	pDMA->Callback = 0;
+	pDMA->pContext = pHandle;
+
+	// DRV_BUSY: the stream is taken by another driver (dma_driver.h)
+	drv_status status = DMA_Init(pDMA);
+
+	if (status != DRV_OK)
+		return status;
+
+	// nothing to do per turn of the ring: only TCIF is read
+	NVIC_IRQInterruptConfig(DMA_GetIRQNumber(pDMA->pDMAx, pDMA->Stream), OFF);
+
+	return DRV_OK;
+
+} /* End IC_Init() */
+
+
+/*
+ * The ring must be reachable by the DMA (not in CCM, mem_sections.h):
+ * DMA_Start() refuses it otherwise and the timer is not started
+ * */
+drv_status IC_Start(IC_Handle_t *pHandle){
+
+	TIM_RegDef_t *pTIMx = pHandle->pTIMx;
+
+	if (pHandle->running)
+		return DRV_OK;
+
+	drv_status status = DMA_Start(&pHandle->dma, (uint32_t)&pTIMx->DMAR,
+								  (uint32_t)pHandle->pBuffer, 0, 2 * pHandle->BufferLen);
+
+	if (status != DRV_OK){
+		DMA_Release(&pHandle->dma);
+		return status;
+	}
+
+	pTIMx->CNT = 0;
+	pTIMx->SR = 0;
+	pTIMx->DIER |= (1 << TIM_DIER_CC1DE);
+	pTIMx->CR1 |= (1 << TIM_CR1_CEN);
+
+	pHandle->running = 1;
+
+	return DRV_OK;
+
+} /* End IC_Start() */
+
+
+void IC_Stop(IC_Handle_t *pHandle){
+
+	TIM_RegDef_t *pTIMx = pHandle->pTIMx;
+
+	pTIMx->CR1 &= ~(1 << TIM_CR1_CEN);
+	pTIMx->DIER &= ~(1 << TIM_DIER_CC1DE);
+
+	DMA_Release(&pHandle->dma);
+
+	pHandle->running = 0;
+
+} /* End IC_Stop() */
+
+
+/*
+ * 1. Position: NDTR counts down the words of the ring, a pair is
+ *    complete once both words are written. With the ring full
+ *    (TCIF set once, never cleared) the pair being written is skipped
+ * 2. Sums over the last K periods, modulo 2^32
+ * */
+uint32_t IC_Read(IC_Handle_t *pHandle, IC_Measure_t *pMeasure, uint16_t MaxPeriods){
+
+	const uint32_t *pBuf = pHandle->pBuffer;
+	uint16_t len = pHandle->BufferLen;
+
+	pMeasure->Periods = 0;
+	pMeasure->Period = 0;
+	pMeasure->HighTime = 0;
+	pMeasure->Frequency_mHz = 0;
+	pMeasure->Duty = 0;
+
+	if (!pHandle->running)
+		return 0;
+
+	// 1. Last complete pair and number of pairs usable
+	uint32_t words = (2 * len - DMA_GetRemaining(&pHandle->dma)) % (2 * len);
+	uint16_t next = words / 2;
+	uint16_t avail = (DMA_GetFlags(&pHandle->dma) & DMA_FLAG_TCIF) ? len - 1 : next;
+
+	if (avail < 2)
+		return 0;
+
+	uint16_t newest = (next + len - 1) % len;
+	uint32_t last_rise = pBuf[2 * newest];
+
+	if ((pHandle->pTIMx->CNT - last_rise) > pHandle->Timeout)
+		return 0;
+
+	uint32_t k = avail - 1;
+
+	if (MaxPeriods && k > MaxPeriods)
+		k = MaxPeriods;
+
+	// 2. Sums
+	uint32_t high = 0;
+	uint16_t i = newest;
+
+	for (uint32_t n = 0; n < k; ++n){
+
+		uint16_t prev = (i + len - 1) % len;
+
+		high += pBuf[2 * i + 1] - pBuf[2 * prev];
+		i = prev;
+
+	}
+
+	uint32_t total = last_rise - pBuf[2 * i];
+
+	if (total == 0)
+		return 0;
+
+	pMeasure->Periods = k;
+	pMeasure->Period = total / k;
+	pMeasure->HighTime = high / k;
+	pMeasure->Frequency_mHz =
+		(uint32_t)(((uint64_t)k * pHandle->RealTickRate * 1000) / total);
+	pMeasure->Duty = (uint16_t)(((uint64_t)high * TIM_DUTY_MAX) / total);
+
+	return k;
+
+} /* End IC_Read() */
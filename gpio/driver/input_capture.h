@@ -0,0 +1,86 @@
+#pragma once
+
+#include "stm32f407G.h"
+#include "dma_driver.h"
+#include "timer_driver.h"
+
+/*
+ * Frequency / pulse width meter: input capture on a 32 bits timer,
+ * captures moved by the DMA, no interrupt at all
+ *
+ * 	Counting edges in an EXTI ISR costs one CPU wake up per edge, the
+ * 	load grows with the frequency of the signal. Here:
+ *
+ * 	- TIM2 or TIM5 counts freely at TickRate over the 32 bits (at
+ * 	  84 MHz it turns every 51 s, the differences are modulo 2^32
+ * 	  so they stay right across the overflow)
+ * 	- CH1 captures the rising edges of the pin (TI1), CH2 the falling
+ * 	  edges of the same pin (TI1 too, TIM_IC_INDIRECT)
+ * 	- at each rising edge, the CC1 DMA request reads CCR1 and CCR2 in
+ * 	  one burst (DMA burst mode, DCR / DMAR, section 18.3.19): a pair
+ * 	  {rise, fall} per period goes into the ring buffer, fall being
+ * 	  the falling edge of the period which just ended
+ * 	- IC_Read() works on the last pairs only when it is called:
+ *
+ * 		period = (rise[n] - rise[n - K]) / K
+ * 		high   = sum of (fall[i] - rise[i - 1]), i = n - K + 1 .. n
+ * 		duty   = high / (rise[n] - rise[n - K])
+ *
+ * 	  its cost depends on K (MaxPeriods), not on the frequency
+ *
+ * 	- signal stopped: no new rise since Timeout ticks -> Frequency 0
+ * 	- keep MaxPeriods well below BufferLen: the DMA goes on writing
+ * 	  while IC_Read() reads the oldest pairs
+ * 	- highest frequency: one DMA burst per period, some MHz; the
+ * 	  input filter (Filter, ICxF) removes the glitches of slow inputs
+ *
+ * 	Pins: TIM2_CH1 PA0 / PA5 / PA15 (AF1), TIM5_CH1 PA0 (AF2)
+ * 	DMA: TIM2_CH1 DMA1 stream 5 ch 3, TIM5_CH1 DMA1 stream 2 ch 6
+ *
+ * */
+
+// ------------ Result of a measure ------------
+
+typedef struct{
+
+	uint32_t Periods;        // periods used (0: no signal)
+	uint32_t Period;         // mean period, timer ticks
+	uint32_t HighTime;       // mean high time, timer ticks
+	uint32_t Frequency_mHz;  // mean frequency, 0.001 Hz
+	uint16_t Duty;           // 0..TIM_DUTY_MAX
+
+} IC_Measure_t;
+
+
+typedef struct{
+
+	TIM_RegDef_t *pTIMx;          // TIM2 or TIM5
+	GPIO_RegDef_t *pGPIOx;        // CH1 pin
+	uint8_t PinNumber;
+	uint8_t PuPd;                 // NO_PULLUP, PULLUP (open collector),...
+	uint8_t Filter;               // 0..15 (ICxF)
+	uint32_t TickRate;            // timer ticks per second
+	uint32_t Timeout;             // ticks without edge -> no signal
+
+	uint32_t *pBuffer;            // BufferLen pairs = 2 x BufferLen words
+	uint16_t BufferLen;
+
+	// Filled by the driver
+	DMA_Handle_t dma;
+	uint32_t RealTickRate;
+	uint8_t running;
+
+} IC_Handle_t;
+
+
+// ================== API ==================
+
+drv_status IC_Init(IC_Handle_t *pHandle);
+
+// DRV_ERROR: pBuffer refused by the DMA (CCM), nothing started
+drv_status IC_Start(IC_Handle_t *pHandle);
+
+void IC_Stop(IC_Handle_t *pHandle);
+
+// Up to MaxPeriods of the last periods, returns the periods used
+uint32_t IC_Read(IC_Handle_t *pHandle, IC_Measure_t *pMeasure, uint16_t MaxPeriods);
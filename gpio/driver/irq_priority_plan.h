@@ -0,0 +1,66 @@
+
+/*
+ * Goal: one single place where the priority of every IRQ
+ * used in the project is decided
+ *
+ * Each line of IRQ_PRIORITY_PLAN is:
+ *
+ * 		X(name, preempt priority, sub priority)
+ *
+ * 	- name is the suffix of the IRQ_NO_xxx macro in stm32f407G.h
+ * 	  (EXTI0 -> IRQ_NO_EXTI0, USART3 -> IRQ_NO_USART3,...)
+ * 	- lower number = higher priority (0 is the most urgent)
+ * 	- an IRQ with a lower preempt priority can interrupt the ISR
+ * 	  of an IRQ with a higher one, the sub priority only decides
+ * 	  the order when both are pending at the same time
+ *
+ * The table is checked at compile time in nvic_driver.c
+ * (range of each field and duplicated IRQs), and written
+ * to the NVIC in one pass by NVIC_ApplyPriorityPlan()
+ *
+ * */
+
+#pragma once
+
+/*
+ * Split of the 4 implemented priority bits (NVIC_PRIO_BITS)
+ * between preempt priority and sub priority
+ *
+ * 	2 bits preempt -> 4 preemption levels (0..3)
+ * 	2 bits sub     -> 4 sub levels (0..3)
+ *
+ * */
+#define IRQ_PREEMPT_BITS 2
+#define IRQ_SUB_BITS (NVIC_PRIO_BITS - IRQ_PREEMPT_BITS)
+
+#define IRQ_PRIORITY_PLAN(X) \
+	X(EXTI0,   1, 0)          /* user button                   */ \
+	X(USART2,  2, 0)          /* console / telemetry link      */ \
+	X(DMA1_STREAM5, 2, 0)     /* USART2 RX DMA                 */ \
+	X(DMA1_STREAM6, 2, 0)     /* USART2 TX DMA                 */ \
+	X(USART3,  2, 1)          /* interrupt demo                */ \
+	X(DMA2_STREAM0, 3, 0)     /* memory to memory copies       */ \
+	X(DMA2_STREAM2, 2, 2)     /* SPI1 RX DMA                   */ \
+	X(DMA2_STREAM3, 2, 2)     /* SPI1 TX DMA                   */ \
+	X(I2C1_EV, 2, 3)          /* I2C1 state machine            */ \
+	X(I2C1_ER, 2, 3)          /* I2C1 errors                   */ \
+	X(DMA1_STREAM0, 2, 3)     /* I2C1 RX DMA                   */ \
+	X(DMA2_STREAM4, 1, 1)     /* ADC1 DMA, end of block        */ \
+	X(ADC,     1, 1)          /* ADC overrun                   */ \
+	X(TIM4,    3, 1)          /* LED PWM duty updates          */ \
+	X(DMA2_STREAM5, 2, 1)     /* TIM1 PWM table DMA            */ \
+	X(DMA1_STREAM2, 2, 1)     /* TIM3 PWM table DMA (WS2812)   */ \
+	X(DMA2_STREAM1, 2, 1)     /* TIM8 paced pattern generator  */ \
+	X(EXTI15_10, 1, 2)        /* logic analyzer trigger        */ \
+	X(TIM7,    1, 2)          /* logic analyzer post-trigger   */ \
+	X(DMA2_STREAM6, 3, 0)     /* memory copies, CCM benchmark  */ \
+	X(RTC_WKUP, 1, 3)         /* wake up from STOP / STANDBY   */ \
+	X(TIM6_DAC, 1, 3)         /* pool allocations from an ISR  */ \
+	X(DMA2_STREAM7, 3, 0)     /* arena benchmark DMA copies    */
+
+/*
+ * Note: keep the latency critical IRQs on top (small preempt number),
+ * and give the same preempt level to the IRQs that share data
+ * so they can never interrupt each other
+ *
+ * */
@@ -0,0 +1,452 @@
+#include "logic_capture.h"
+#include "gpio_driver.h"
+#include "nvic_driver.h"
+#include "format.h"
+
+
+// EXTI line -> IRQ (lines 5..9 and 10..15 share one)
+static uint8_t LA_ExtiIRQ(uint8_t Pin){
+
+	if (Pin <= 4)
+		return IRQ_NO_EXTI0 + Pin;
+
+	return (Pin <= 9) ? IRQ_NO_EXTI9_5 : IRQ_NO_EXTI15_10;
+
+} /* End LA_ExtiIRQ() */
+
+
+static uint8_t LA_SampleSize(LA_Handle_t *pHandle){
+
+	return (pHandle->Width == 16) ? 2 : 1;
+
+} /* End LA_SampleSize() */
+
+
+// Sample at a position of the buffer (not in time order)
+static uint16_t LA_Raw(LA_Handle_t *pHandle, uint16_t Pos){
+
+	if (pHandle->Width == 16)
+		return ((const uint16_t*)pHandle->pBuffer)[Pos];
+
+	return ((const uint8_t*)pHandle->pBuffer)[Pos];
+
+} /* End LA_Raw() */
+
+
+/*
+ * The trigger ISR runs some samples after the edge. Search back from
+ * the trigger position for the last sample before the edge, the edge
+ * is the sample after it. Only when the trigger pin is sampled
+ * */
+static void LA_FindEdge(LA_Handle_t *pHandle){
+
+	pHandle->trig_shift = 0;
+
+	if (pHandle->pTrigPort != pHandle->pGPIOx ||
+		pHandle->TrigPin < pHandle->FirstPin ||
+		pHandle->TrigPin >= pHandle->FirstPin + pHandle->Width)
+		return;
+
+	uint8_t bit = pHandle->TrigPin - pHandle->FirstPin;
+	uint16_t last = LA_GetSample(pHandle, pHandle->trigger);
+	uint8_t after = (last >> bit) & 0x1;
+
+	// level before the edge
+	uint8_t before = (pHandle->TrigEdge == INT_RISING_EDGE) ? 0 :
+					 (pHandle->TrigEdge == INT_FALLING_EDGE) ? 1 : !after;
+
+	for (uint16_t n = 1; n <= LA_TRIG_SEARCH && n <= pHandle->trigger; ++n){
+
+		uint16_t s = LA_GetSample(pHandle, pHandle->trigger - n);
+
+		if (((s >> bit) & 0x1) == before){
+			pHandle->trig_shift = n - 1;
+			pHandle->trigger -= n - 1;
+			return;
+		}
+
+	}
+
+} /* End LA_FindEdge() */
+
+
+/*
+ * End of the post-trigger time (TIM6 / TIM7 update ISR)
+ * 	1. sample clock off: no more DMA request, NDTR frozen
+ * 	2. stream off: the FIFO is flushed to the buffer
+ * 	3. positions: NDTR counts down from BufferLen at each sample and
+ * 	   reloads (TCIF) at each turn of the buffer
+ * */
+static void LA_PostCallback(TIM_Handle_t *pTIMHandle){
+
+	LA_Handle_t *pHandle = (LA_Handle_t*)pTIMHandle->pContext;
+
+	if (pHandle->state != LA_TRIGGERED)
+		return;
+
+	pHandle->pTIMx->CR1 &= ~(1 << TIM_CR1_CEN);
+	pHandle->pTIMx->DIER &= ~(1 << TIM_DIER_UDE);
+
+	uint16_t len = pHandle->BufferLen;
+	uint16_t end = (len - DMA_GetRemaining(&pHandle->dma)) % len;
+	uint32_t flags = DMA_GetFlags(&pHandle->dma);
+
+	DMA_Release(&pHandle->dma);
+
+	if (flags & DMA_FLAG_TEIF)
+		pHandle->errors++;
+
+	if (flags & DMA_FLAG_TCIF){
+		pHandle->oldest = end;        // full: the next to write is the oldest
+		pHandle->count = len;
+	} else {
+		pHandle->oldest = 0;
+		pHandle->count = end;
+	}
+
+	uint16_t trig = (len - pHandle->trig_ndtr) % len;
+
+	pHandle->trigger = (trig + len - pHandle->oldest) % len;
+
+	LA_FindEdge(pHandle);
+
+	pHandle->state = LA_DONE;
+
+	if (pHandle->Done)
+		pHandle->Done(pHandle);
+
+} /* End LA_PostCallback() */
+
+
+static void LA_Trigger(LA_Handle_t *pHandle){
+
+	if (pHandle->state != LA_ARMED)
+		return;
+
+	// position first, the rest of the ISR is latency
+	pHandle->trig_ndtr = DMA_GetRemaining(&pHandle->dma);
+	pHandle->state = LA_TRIGGERED;
+
+	TIM_StartOnePulse(&pHandle->post_tim);
+
+	if (pHandle->pTrigPort)
+		EXTI->IMR &= ~(1 << pHandle->TrigPin);
+
+} /* End LA_Trigger() */
+
+// =========================================================
+
+
+drv_status LA_Init(LA_Handle_t *pHandle){
+
+	TIM_RegDef_t *pTIMx = pHandle->pTIMx;
+	DMA_Handle_t *pDMA = &pHandle->dma;
+
+	if (TIM_GetUpdateDMA(pTIMx, pDMA) != DRV_OK || pDMA->pDMAx != DMA2)
+		return DRV_ERROR;
+
+	if ((pHandle->Width != 8 && pHandle->Width != 16) ||
+		(pHandle->Width == 8 && pHandle->FirstPin != 0 && pHandle->FirstPin != 8) ||
+		(pHandle->Width == 16 && pHandle->FirstPin != 0))
+		return DRV_ERROR;
+
+	// word writes to the buffer, by turns of BufferLen samples
+	if (pHandle->pBuffer == 0 || ((uint32_t)pHandle->pBuffer & 0x3) ||
+		pHandle->BufferLen == 0 || (pHandle->BufferLen % 4) ||
+		pHandle->PostSamples == 0 || pHandle->PostSamples >= pHandle->BufferLen)
+		return DRV_ERROR;
+
+	pHandle->state = LA_IDLE;
+	pHandle->errors = 0;
+
+	// 1. Sample clock
+	TIM_ClockHold(pTIMx);
+
+	pTIMx->CR1 = 0;
+	pTIMx->DIER = 0;
+
+	pHandle->RealRate = TIM_SetFrequency(pTIMx, pHandle->SampleRate);
+
+	if (pHandle->RealRate == 0)
+		return DRV_ERROR;
+
+	/*
+	 * 2. Stream: IDR (byte or halfword) to the buffer, in loop. The FIFO
+	 *    packs the samples, the memory side only sees word writes
+	 * */
+	uint8_t size = (pHandle->Width == 16) ? DMA_SIZE_HALFWORD : DMA_SIZE_BYTE;
+
+	pDMA->DMA_Config.DMA_Direction = DMA_DIR_PERIPH_TO_MEM;
+	pDMA->DMA_Config.DMA_PeriphInc = OFF;
+	pDMA->DMA_Config.DMA_MemInc = ON;
+	pDMA->DMA_Config.DMA_PeriphDataSize = size;
+	pDMA->DMA_Config.DMA_MemDataSize = DMA_SIZE_WORD;
+	pDMA->DMA_Config.DMA_Circular = ON;
+	pDMA->DMA_Config.DMA_DoubleBuffer = OFF;
+	pDMA->DMA_Config.DMA_Priority = DMA_PRIO_VERY_HIGH;
+	pDMA->DMA_Config.DMA_HalfTransferIT = OFF;
+	pDMA->DMA_Config.DMA_FIFOMode = ON;
+	pDMA->DMA_Config.DMA_FIFOThreshold = DMA_FIFO_FULL;
+	pDMA->DMA_Config.DMA_MemBurst = DMA_BURST_SINGLE;
+	pDMA->DMA_Config.DMA_PeriphBurst = DMA_BURST_SINGLE;
+	pDMA->Callback = 0;
+	pDMA->pContext = pHandle;
+
+	// DRV_BUSY: the stream is taken by another driver (dma_driver.h)
+	drv_status status = DMA_Init(pDMA);
+
+	if (status != DRV_OK)
+		return status;
+
+	// one IRQ per turn of the buffer is useless: only TCIF is read
+	NVIC_IRQInterruptConfig(DMA_GetIRQNumber(pDMA->pDMAx, pDMA->Stream), OFF);
+
+	// 3. Post-trigger time: one period of PostSamples sample periods
+	uint32_t post_freq = pHandle->RealRate / pHandle->PostSamples;
+
+	if (post_freq == 0)
+		return DRV_ERROR;
+
+	pHandle->post_tim.pTIMx = pHandle->pPostTIMx;
+	pHandle->post_tim.TIM_Config.TIM_Frequency = post_freq;
+	pHandle->post_tim.TIM_Config.TIM_OnePulse = ON;
+	pHandle->post_tim.TIM_Config.TIM_UpdateIT = ON;
+	pHandle->post_tim.Callback = LA_PostCallback;
+	pHandle->post_tim.pContext = pHandle;
+
+	if (TIM_Init(&pHandle->post_tim) != DRV_OK)
+		return DRV_ERROR;
+
+	// 4. Trigger pin: EXTI line configured, masked until LA_Arm()
+	if (pHandle->pTrigPort){
+
+		GPIO_Handle_t pin;
+
+		TIM_PortHold(pHandle->pTIMx, pHandle->pTrigPort);
+
+		pin.gpio_reg_x = pHandle->pTrigPort;
+		pin.gpio_pin_conf.GPIO_PinNumber = pHandle->TrigPin;
+		pin.gpio_pin_conf.GPIO_PinMode = pHandle->TrigEdge;
+		pin.gpio_pin_conf.GPIO_PinSpeed = LOW;
+		pin.gpio_pin_conf.GPIO_PinOPType = PUSH_PULL;
+		pin.gpio_pin_conf.GPIO_PinPuPdControl = NO_PULLUP;
+		pin.gpio_pin_conf.GPIO_PinAltFunMode = 0;
+
+		GPIO_Init(&pin);
+
+		EXTI->IMR &= ~(1 << pHandle->TrigPin);
+
+		NVIC_IRQInterruptConfig(LA_ExtiIRQ(pHandle->TrigPin), ON);
+
+	}
+
+	// ports held with the sampling timer, until TIM_DeInit()
+	TIM_PortHold(pHandle->pTIMx, pHandle->pGPIOx);
+
+	return DRV_OK;
+
+} /* End LA_Init() */
+
+
+drv_status LA_Arm(LA_Handle_t *pHandle){
+
+	TIM_RegDef_t *pTIMx = pHandle->pTIMx;
+
+	if (pHandle->state == LA_ARMED || pHandle->state == LA_TRIGGERED)
+		return DRV_BUSY;
+
+	// high byte of IDR: byte read at IDR + 1
+	uint32_t idr = (uint32_t)&pHandle->pGPIOx->IDR + (pHandle->FirstPin / 8);
+
+	if (DMA_Start(&pHandle->dma, idr, (uint32_t)pHandle->pBuffer, 0,
+				  pHandle->BufferLen) != DRV_OK)
+		return DRV_ERROR;
+
+	pHandle->count = 0;
+	pHandle->trigger = 0;
+	pHandle->trig_shift = 0;
+	pHandle->state = LA_ARMED;
+
+	pTIMx->CNT = 0;
+	pTIMx->SR = 0;
+	pTIMx->DIER |= (1 << TIM_DIER_UDE);
+	pTIMx->CR1 |= (1 << TIM_CR1_CEN);
+
+	// an edge from before the arming must not trigger
+	if (pHandle->pTrigPort){
+		EXTI->PR = (1 << pHandle->TrigPin);
+		EXTI->IMR |= (1 << pHandle->TrigPin);
+	}
+
+	return DRV_OK;
+
+} /* End LA_Arm() */
+
+
+void LA_ForceTrigger(LA_Handle_t *pHandle){
+
+	// the EXTI ISR must not trigger at the same time
+	uint32_t state = IRQ_EnterCritical(pHandle->pTrigPort ?
+									   NVIC_GetCeiling(LA_ExtiIRQ(pHandle->TrigPin)) : 0);
+
+	LA_Trigger(pHandle);
+
+	IRQ_ExitCritical(state);
+
+} /* End LA_ForceTrigger() */
+
+
+void LA_Abort(LA_Handle_t *pHandle){
+
+	if (pHandle->pTrigPort)
+		EXTI->IMR &= ~(1 << pHandle->TrigPin);
+
+	TIM_Stop(&pHandle->post_tim);
+
+	pHandle->pTIMx->CR1 &= ~(1 << TIM_CR1_CEN);
+	pHandle->pTIMx->DIER &= ~(1 << TIM_DIER_UDE);
+
+	DMA_Release(&pHandle->dma);
+
+	pHandle->state = LA_IDLE;
+
+} /* End LA_Abort() */
+
+
+uint16_t LA_GetSample(LA_Handle_t *pHandle, uint16_t Index){
+
+	return LA_Raw(pHandle, (pHandle->oldest + Index) % pHandle->BufferLen);
+
+} /* End LA_GetSample() */
+
+
+/*
+ * Time order: from the oldest sample to the end of the buffer, then
+ * from the start of the buffer (only when it was filled once)
+ * */
+uint32_t LA_ExportRaw(LA_Handle_t *pHandle,
+					  uint32_t (*Output)(const uint8_t *pData, uint32_t Len)){
+
+	if (pHandle->state != LA_DONE)
+		return 0;
+
+	const uint8_t *pBuf = (const uint8_t*)pHandle->pBuffer;
+	uint8_t size = LA_SampleSize(pHandle);
+	uint32_t first = pHandle->count;
+	uint32_t sent = 0;
+
+	if (pHandle->oldest + first > pHandle->BufferLen)
+		first = pHandle->BufferLen - pHandle->oldest;
+
+	sent += Output(pBuf + pHandle->oldest * size, first * size);
+
+	if (first < pHandle->count)
+		sent += Output(pBuf, (pHandle->count - first) * size);
+
+	return sent;
+
+} /* End LA_ExportRaw() */
+
+
+static uint32_t LA_Flush(Fmt_Buffer_t *pFmt,
+						 uint32_t (*Output)(const uint8_t *pData, uint32_t Len)){
+
+	uint32_t sent = Output((const uint8_t*)pFmt->pBuf, pFmt->len);
+
+	pFmt->len = 0;
+	pFmt->pBuf[0] = '\0';
+
+	return sent;
+
+} /* End LA_Flush() */
+
+
+/*
+ * Value Change Dump (IEEE 1364): a header with one 1 bit wire per pin,
+ * then "#<time>" followed by the pins which changed at that time.
+ * Time in ns from the oldest sample, only the changes are written
+ * */
+uint32_t LA_ExportVCD(LA_Handle_t *pHandle,
+					  uint32_t (*Output)(const uint8_t *pData, uint32_t Len)){
+
+	if (pHandle->state != LA_DONE || pHandle->count == 0)
+		return 0;
+
+	char line[96];
+	Fmt_Buffer_t f;
+	uint32_t sent = 0;
+	char port = 'A' + (((uint32_t)pHandle->pGPIOx - GPIOA_BASEADDR) / 0x400);
+
+	Fmt_Init(&f, line, sizeof(line));
+
+	// 1. Header
+	Fmt_Str(&f, "$timescale 1 ns $end\n$scope module la $end\n");
+	sent += LA_Flush(&f, Output);
+
+	for (uint8_t k = 0; k < pHandle->Width; ++k){
+		Fmt_Str(&f, "$var wire 1 ");
+		Fmt_Char(&f, '!' + k);
+		Fmt_Str(&f, " P");
+		Fmt_Char(&f, port);
+		Fmt_Uint(&f, pHandle->FirstPin + k);
+		Fmt_Str(&f, " $end\n");
+		sent += LA_Flush(&f, Output);
+	}
+
+	Fmt_Str(&f, "$upscope $end\n$comment trigger at sample ");
+	Fmt_Uint(&f, pHandle->trigger);
+	Fmt_Str(&f, ", rate ");
+	Fmt_Uint(&f, pHandle->RealRate);
+	Fmt_Str(&f, " Hz $end\n$enddefinitions $end\n");
+	sent += LA_Flush(&f, Output);
+
+	// 2. Values: all the pins at time 0, then only the changes
+	uint16_t prev = ~LA_GetSample(pHandle, 0);
+
+	for (uint16_t i = 0; i < pHandle->count; ++i){
+
+		uint16_t s = LA_GetSample(pHandle, i);
+		uint16_t changed = s ^ prev;
+
+		if (pHandle->Width == 8)
+			changed &= 0xFF;
+
+		if (changed == 0)
+			continue;
+
+		Fmt_Char(&f, '#');
+		Fmt_Uint(&f, (uint32_t)(((uint64_t)i * 1000000000U) / pHandle->RealRate));
+		Fmt_Char(&f, '\n');
+
+		for (uint8_t k = 0; k < pHandle->Width; ++k){
+
+			if (!((changed >> k) & 0x1))
+				continue;
+
+			Fmt_Char(&f, ((s >> k) & 0x1) ? '1' : '0');
+			Fmt_Char(&f, '!' + k);
+			Fmt_Char(&f, '\n');
+
+		}
+
+		sent += LA_Flush(&f, Output);
+		prev = s;
+
+	}
+
+	return sent;
+
+} /* End LA_ExportVCD() */
+
+
+void LA_TriggerIRQHandling(LA_Handle_t *pHandle){
+
+	// EXTI line shared with other pins (5..9, 10..15)
+	if (!(EXTI->PR & (1 << pHandle->TrigPin)))
+		return;
+
+	EXTI->PR = (1 << pHandle->TrigPin);
+
+	LA_Trigger(pHandle);
+
+} /* End LA_TriggerIRQHandling() */
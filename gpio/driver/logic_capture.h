@@ -0,0 +1,118 @@
+#pragma once
+
+#include "stm32f407G.h"
+#include "dma_driver.h"
+#include "timer_driver.h"
+
+/*
+ * On-chip logic analyzer: timer paced DMA sampling of GPIOx_IDR
+ *
+ * 	- a timer (TIM1 or TIM8, the only timer requests of DMA2, the DMA
+ * 	  which reaches the GPIOs, see pattern_gen.h) makes one DMA request
+ * 	  per sample period, the stream copies IDR into a circular buffer:
+ * 	  8 pins (one byte lane of IDR, FirstPin 0 or 8) or the 16 pins
+ * 	- the DMA FIFO packs the samples in 32 bits writes to the SRAM
+ * 	  (4 samples per write in 8 bits mode), so the memory side is not
+ * 	  the limit. Some MHz at 16 MHz HCLK, more at 168 MHz
+ *
+ * 	Trigger and pre-trigger history:
+ * 	- LA_Arm() starts the sampling, the buffer is overwritten in loop,
+ * 	  it always holds the last BufferLen samples. No interrupt per turn
+ * 	  of the buffer: the stream IRQ is left off, its TCIF flag only
+ * 	  tells at the end whether the buffer was filled once
+ * 	- the trigger pin (any port) is an EXTI line, on its edge the ISR
+ * 	  (LA_TriggerIRQHandling) notes the DMA position and starts a basic
+ * 	  timer (TIM6 / TIM7) in one pulse mode for PostSamples periods
+ * 	- at the end of this time LA_PostIRQHandling() stops the sampling:
+ * 	  the buffer holds BufferLen - PostSamples samples before the
+ * 	  trigger and PostSamples after it
+ * 	- the EXTI IRQ comes some samples after the edge (IRQ latency), the
+ * 	  exact position is found back in the samples (LA_TRIG_SEARCH)
+ * 	- keep PostSamples below BufferLen minus the IRQ latency in samples
+ *
+ * 	Export, in time order, to Output() (Retarget_Write(), a file
+ * 	written by the debugger,...):
+ * 	- LA_ExportRaw(): the samples as they are (sigrok "binary" input)
+ * 		sigrok-cli -I binary:numchannels=8:samplerate=2000000 -i cap.bin -o cap.sr
+ * 	- LA_ExportVCD(): Value Change Dump text, opened as is by PulseView
+ * 	  (File -> Import Value Change Dump), trigger given in a comment
+ *
+ * IRQ handlers, example TIM7 / trigger on PE15 (none for the DMA):
+ *
+ * 		void TIM7_IRQHandler(void){ TIM_IRQHandling(&la.post_tim); }
+ * 		void EXTI15_10_IRQHandler(void){ LA_TriggerIRQHandling(&la); }
+ *
+ * */
+
+#define LA_TRIG_SEARCH 64   // samples searched back for the real edge
+
+// ------------ Coding states for the capture ------------
+
+typedef enum LA_State {LA_IDLE, LA_ARMED, LA_TRIGGERED, LA_DONE} la_state;
+
+
+typedef struct LA_Handle LA_Handle_t;
+
+typedef void (*la_done_t)(LA_Handle_t *pHandle);
+
+struct LA_Handle{
+
+	TIM_RegDef_t *pTIMx;         // sample clock: TIM1 or TIM8
+	TIM_RegDef_t *pPostTIMx;     // post-trigger time: TIM6 or TIM7
+	GPIO_RegDef_t *pGPIOx;       // sampled port
+	uint8_t FirstPin;            // 0 or 8 (8 bits), 0 (16 bits)
+	uint8_t Width;               // 8 or 16 pins
+	uint32_t SampleRate;         // samples per second
+
+	void *pBuffer;               // BufferLen samples of Width bits, 4 bytes aligned
+	uint16_t BufferLen;          // multiple of 4
+	uint16_t PostSamples;        // PostSamples / SampleRate <= 1 s
+
+	GPIO_RegDef_t *pTrigPort;    // trigger pin, 0 -> LA_ForceTrigger() only
+	uint8_t TrigPin;
+	uint8_t TrigEdge;            // INT_FALLING_EDGE, INT_RISING_EDGE, INT_FALL_AND_RISE
+
+	la_done_t Done;              // called from the post-trigger ISR
+	void *pContext;
+
+	// Filled by the driver
+	DMA_Handle_t dma;
+	TIM_Handle_t post_tim;
+	uint32_t RealRate;
+
+	__vo uint8_t state;
+	uint16_t trig_ndtr;          // NDTR read in the trigger ISR
+	uint32_t errors;             // DMA transfer errors
+
+	// Result, valid in LA_DONE
+	uint16_t oldest;             // index of the first sample in time
+	uint16_t count;              // samples in the buffer
+	uint16_t trigger;            // position of the trigger, from the oldest
+	uint16_t trig_shift;         // samples between the edge and the trigger ISR
+
+};
+
+
+// ================== API ==================
+
+drv_status LA_Init(LA_Handle_t *pHandle);
+
+// Start the sampling and wait for the trigger
+drv_status LA_Arm(LA_Handle_t *pHandle);
+
+// Trigger now (no trigger pin, or a software condition)
+void LA_ForceTrigger(LA_Handle_t *pHandle);
+
+// Stop at once, whatever the state
+void LA_Abort(LA_Handle_t *pHandle);
+
+// Sample Index (0 = oldest) of a finished capture
+uint16_t LA_GetSample(LA_Handle_t *pHandle, uint16_t Index);
+
+uint32_t LA_ExportRaw(LA_Handle_t *pHandle,
+					  uint32_t (*Output)(const uint8_t *pData, uint32_t Len));
+
+uint32_t LA_ExportVCD(LA_Handle_t *pHandle,
+					  uint32_t (*Output)(const uint8_t *pData, uint32_t Len));
+
+void LA_TriggerIRQHandling(LA_Handle_t *pHandle);
@@ -0,0 +1,252 @@
+#include "mem_pool.h"
+
+/*
+ * LDREX / STREX on a word (PM0214 section 3.4.8)
+ * 	STREX returns 0 when the store is done, 1 when the exclusive
+ * 	access was lost (exception, other LDREX / STREX in between)
+ * */
+static inline uint32_t Mem_LoadEx(__vo uint32_t *pAddr){
+
+	uint32_t value;
+
+	__asm volatile ("ldrex %0, [%1]" : "=r" (value) : "r" (pAddr) : "memory");
+
+	return value;
+
+} /* End Mem_LoadEx() */
+
+static inline uint32_t Mem_StoreEx(__vo uint32_t *pAddr, uint32_t value){
+
+	uint32_t failed;
+
+	__asm volatile ("strex %0, %2, [%1]" : "=&r" (failed) : "r" (pAddr), "r" (value) : "memory");
+
+	return failed;
+
+} /* End Mem_StoreEx() */
+
+static inline void Mem_ClearEx(void){
+
+	__asm volatile ("clrex" : : : "memory");
+
+} /* End Mem_ClearEx() */
+
+static inline uint32_t Mem_AtomicAdd(__vo uint32_t *pAddr, int32_t delta){
+
+	uint32_t value;
+
+	do {
+		value = Mem_LoadEx(pAddr) + delta;
+	} while (Mem_StoreEx(pAddr, value));
+
+	return value;
+
+} /* End Mem_AtomicAdd() */
+
+static inline void Mem_AtomicMax(__vo uint32_t *pAddr, uint32_t value){
+
+	do {
+		if (Mem_LoadEx(pAddr) >= value){
+			Mem_ClearEx();
+			return;
+		}
+	} while (Mem_StoreEx(pAddr, value));
+
+} /* End Mem_AtomicMax() */
+
+
+// =============== One pool ===============
+
+drv_status MemPool_Init(MemPool_t *pPool, void *pStorage,
+						uint32_t BlockSize, uint32_t NbBlocks){
+
+	if (pStorage == 0 || NbBlocks == 0 || ((uint32_t)pStorage & 0x3))
+		return DRV_ERROR;
+
+	BlockSize = MEM_POOL_BLOCK(BlockSize);
+
+	pPool->pStart = pStorage;
+	pPool->pEnd = pPool->pStart + BlockSize * NbBlocks;
+	pPool->BlockSize = BlockSize;
+	pPool->NbBlocks = NbBlocks;
+
+	// each block points to the next one, the last one to 0
+	uint8_t *pBlock = pPool->pStart;
+
+	for (uint32_t i = 0; i < NbBlocks - 1; ++i, pBlock += BlockSize)
+		*(void **)pBlock = pBlock + BlockSize;
+
+	*(void **)pBlock = 0;
+
+	pPool->used = 0;
+	pPool->peak = 0;
+	pPool->allocs = 0;
+	pPool->exhausted = 0;
+	pPool->bad_frees = 0;
+
+	pPool->pFree = pPool->pStart;
+
+	return DRV_OK;
+
+} /* End MemPool_Init() */
+
+
+/*
+ * Pop: the link of the head is read between LDREX and STREX. If an
+ * ISR took the block (and wrote in it) meanwhile, the exception has
+ * cleared the monitor and the STREX fails: the stale link is never
+ * stored (no ABA problem on a single core)
+ * */
+void *MemPool_Alloc(MemPool_t *pPool){
+
+	__vo uint32_t *pHead = (__vo uint32_t *)&pPool->pFree;
+	uint32_t block;
+
+	do {
+
+		block = Mem_LoadEx(pHead);
+
+		if (block == 0){
+			Mem_ClearEx();
+			Mem_AtomicAdd(&pPool->exhausted, 1);
+			return 0;
+		}
+
+	} while (Mem_StoreEx(pHead, *(uint32_t *)block));
+
+	Mem_AtomicMax(&pPool->peak, Mem_AtomicAdd(&pPool->used, 1));
+	Mem_AtomicAdd(&pPool->allocs, 1);
+
+	return (void *)block;
+
+} /* End MemPool_Alloc() */
+
+
+uint8_t MemPool_Owns(const MemPool_t *pPool, const void *pBlock){
+
+	const uint8_t *p = pBlock;
+
+	return (p >= pPool->pStart) && (p < pPool->pEnd) &&
+		   (((uint32_t)(p - pPool->pStart) % pPool->BlockSize) == 0);
+
+} /* End MemPool_Owns() */
+
+
+drv_status MemPool_Free(MemPool_t *pPool, void *pBlock){
+
+	if (!MemPool_Owns(pPool, pBlock)){
+		Mem_AtomicAdd(&pPool->bad_frees, 1);
+		return DRV_ERROR;
+	}
+
+	__vo uint32_t *pHead = (__vo uint32_t *)&pPool->pFree;
+
+	// Push: the link is written before the block becomes the head
+	do {
+		*(uint32_t *)pBlock = Mem_LoadEx(pHead);
+	} while (Mem_StoreEx(pHead, (uint32_t)pBlock));
+
+	Mem_AtomicAdd(&pPool->used, -1);
+
+	return DRV_OK;
+
+} /* End MemPool_Free() */
+
+
+// =============== Size classes ===============
+
+#define MEM_POOL_SECTION_0
+#define MEM_POOL_SECTION_1 __ccm_bss
+
+#define MEM_POOL_CLASS_CHECK(size, count, ccm) \
+	_Static_assert((count) > 0 && (size) > 0, #size ": empty size class"); \
+	_Static_assert((ccm) == 0 || (ccm) == 1, #size ": CCM must be 0 or 1");
+
+MEM_POOL_PLAN(MEM_POOL_CLASS_CHECK)
+
+#undef MEM_POOL_CLASS_CHECK
+
+#define MEM_POOL_CLASS_STORAGE(size, count, ccm) \
+	static MEM_POOL_SECTION_##ccm uint8_t mem_storage_##size[MEM_POOL_BLOCK(size) * (count)] \
+		__attribute__((aligned(8)));
+
+MEM_POOL_PLAN(MEM_POOL_CLASS_STORAGE)
+
+#undef MEM_POOL_CLASS_STORAGE
+
+typedef struct{
+	uint8_t *storage;
+	uint32_t size;
+	uint32_t count;
+} Mem_ClassMap;
+
+#define MEM_POOL_CLASS_MAP(size, count, ccm) {mem_storage_##size, (size), (count)},
+
+static const Mem_ClassMap mem_class_map[MEM_NB_CLASSES] = {
+	MEM_POOL_PLAN(MEM_POOL_CLASS_MAP)
+};
+
+#undef MEM_POOL_CLASS_MAP
+
+static MemPool_t mem_pools[MEM_NB_CLASSES];
+
+
+drv_status Mem_Init(void){
+
+	for (uint8_t c = 0; c < MEM_NB_CLASSES; ++c){
+
+		// Mem_Alloc() takes the first class that fits
+		if (c > 0 && mem_class_map[c].size <= mem_class_map[c - 1].size)
+			return DRV_ERROR;
+
+		if (MemPool_Init(&mem_pools[c], mem_class_map[c].storage,
+						 mem_class_map[c].size, mem_class_map[c].count) != DRV_OK)
+			return DRV_ERROR;
+
+	}
+
+	return DRV_OK;
+
+} /* End Mem_Init() */
+
+
+void *Mem_Alloc(uint32_t Size){
+
+	uint8_t c = 0;
+
+	while (c < MEM_NB_CLASSES && mem_pools[c].BlockSize < Size)
+		c++;
+
+	for (; c < MEM_NB_CLASSES; ++c){
+
+		void *pBlock = MemPool_Alloc(&mem_pools[c]);
+
+		if (pBlock)
+			return pBlock;
+
+	}
+
+	return 0;
+
+} /* End Mem_Alloc() */
+
+
+drv_status Mem_Free(void *pBlock){
+
+	for (uint8_t c = 0; c < MEM_NB_CLASSES; ++c){
+
+		if (MemPool_Owns(&mem_pools[c], pBlock))
+			return MemPool_Free(&mem_pools[c], pBlock);
+
+	}
+
+	return DRV_ERROR;
+
+} /* End Mem_Free() */
+
+
+const MemPool_t *Mem_GetPool(uint8_t Class){
+
+	return (Class < MEM_NB_CLASSES) ? &mem_pools[Class] : 0;
+
+} /* End Mem_GetPool() */
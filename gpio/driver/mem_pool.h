@@ -0,0 +1,110 @@
+#pragma once
+
+#include "stm32f407G.h"
+#include "mem_sections.h"
+
+/*
+ * Goal: fixed size block allocator for the real-time paths, instead of
+ * malloc() (newlib heap over _sbrk(), sysmem.c)
+ *
+ * 	malloc() walks a list of free chunks (time depends on the history),
+ * 	fragments, and takes a lock that an ISR can't wait for. Here:
+ *
+ * 	- a pool = one static array cut in blocks of the same size, the
+ * 	  free blocks are linked through their first word (LIFO list)
+ * 	- alloc = pop the head, free = push it back: O(1), a few cycles,
+ * 	  no fragmentation (any free block fits any request of the pool)
+ * 	- ISR safe without masking the interrupts: the head is swapped with
+ * 	  LDREX / STREX (PM0214 section 3.4.8). An exception between both
+ * 	  clears the exclusive monitor, the STREX fails and the loop
+ * 	  reads the head again: an ISR can alloc / free the same pool at
+ * 	  any time, and no IRQ latency is added
+ * 	- statistics for each pool: used, peak, allocations, exhausted
+ * 	  (alloc with no free block) and bad frees (pointer not on a block)
+ * 	- a double free is not detected: the block would be linked twice
+ *
+ * 	Own pool, for one kind of object (driver descriptors, ...):
+ *
+ * 		MEM_POOL_STORAGE(desc_storage, sizeof(USART_TxDesc_t), 8);
+ * 		MemPool_t desc_pool;
+ *
+ * 		MemPool_Init(&desc_pool, desc_storage, sizeof(USART_TxDesc_t), 8);
+ * 		USART_TxDesc_t *pDesc = MemPool_Alloc(&desc_pool);
+ * 		...
+ * 		MemPool_Free(&desc_pool, pDesc);
+ *
+ * 	Size classes, for buffers of any length up to the largest class:
+ * 	Mem_Init() once, then Mem_Alloc(Size) / Mem_Free(p) (see plan below)
+ * */
+
+// Blocks are multiples of 4 bytes, so the link and LDREX stay aligned
+#define MEM_POOL_BLOCK(size)  ((((size) < 4 ? 4 : (size)) + 3U) & ~3U)
+
+#define MEM_POOL_STORAGE(name, block_size, nb_blocks) \
+	static uint8_t name[MEM_POOL_BLOCK(block_size) * (nb_blocks)] __attribute__((aligned(8)))
+
+
+typedef struct{
+
+	uint8_t *pStart;
+	uint8_t *pEnd;
+	uint32_t BlockSize;
+	uint32_t NbBlocks;
+
+	void *__vo pFree;             // first free block, 0 -> exhausted
+
+	// statistics
+	__vo uint32_t used;
+	__vo uint32_t peak;
+	__vo uint32_t allocs;
+	__vo uint32_t exhausted;
+	__vo uint32_t bad_frees;
+
+} MemPool_t;
+
+
+/*
+ * Size classes of Mem_Alloc(), in increasing block size:
+ *
+ * 		X(block size, nb of blocks, CCM)
+ *
+ * 	- Mem_Alloc(Size) takes the first class with block size >= Size,
+ * 	  the next ones if it is exhausted (counted in the first one)
+ * 	- CCM = 1 puts the storage of the class in CCM RAM (mem_sections.h):
+ * 	  CPU only data. A class which holds DMA buffers (USART messages,
+ * 	  USART_DMA_SendCopy()) must stay in SRAM (CCM = 0)
+ * */
+#define MEM_POOL_PLAN(X) \
+	X(32,   16, 0)          /* descriptors, short messages   */ \
+	X(128,  8,  0)          /* console lines, telemetry      */ \
+	X(512,  4,  0)          /* large frames                  */
+
+#define MEM_POOL_CLASS_ID(size, count, ccm) MEM_CLASS_##size,
+
+enum {
+	MEM_POOL_PLAN(MEM_POOL_CLASS_ID)
+	MEM_NB_CLASSES
+};
+
+#undef MEM_POOL_CLASS_ID
+
+// ================== API ==================
+
+drv_status MemPool_Init(MemPool_t *pPool, void *pStorage,
+						uint32_t BlockSize, uint32_t NbBlocks);
+
+// 0 when no block is free
+void *MemPool_Alloc(MemPool_t *pPool);
+
+drv_status MemPool_Free(MemPool_t *pPool, void *pBlock);
+
+uint8_t MemPool_Owns(const MemPool_t *pPool, const void *pBlock);
+
+// Size classes of MEM_POOL_PLAN
+drv_status Mem_Init(void);
+
+void *Mem_Alloc(uint32_t Size);
+
+drv_status Mem_Free(void *pBlock);
+
+const MemPool_t *Mem_GetPool(uint8_t Class);
@@ -0,0 +1,54 @@
+#pragma once
+
+/*
+ * Goal: choose the memory of a variable, by linker section
+ *
+ * 	CCM RAM, 64 KB at 0x10000000 (section 2.3.1, figure 1):
+ * 		- on the D-bus of the core only, 0 wait state, never on the
+ * 		  bus matrix: the core reads and writes it while the DMAs
+ * 		  use SRAM1 / SRAM2 at full rate, no arbitration
+ * 		- no DMA access at all (DMA_Start() refuses a CCM address),
+ * 		  no code execution (not on the I-bus)
+ * 		- the main stack is at the top of the CCM (_estack in the
+ * 		  linker script): ISR frames and local variables never wait
+ * 		  behind a DMA. So a local array can't be a DMA buffer
+ *
+ * 	Good for CCM: ISR private state (driver handles, counters),
+ * 	tables and hot buffers only used by the CPU (filters, FFT, ...)
+ * 	Must stay in SRAM: DMA buffers (ADC, USART, SPI, pattern tables)
+ *
+ * 		__ccm_data uint32_t gain = 3;      // copied from flash at reset
+ * 		__ccm_bss  ADC_Handle_t adc1;      // cleared at reset
+ *
+ * 	Both are initialized by Reset_Handler (copy / zero tables of the
+ * 	linker script)
+ * */
+
+#define __ccm_data  __attribute__((section(".ccmram")))
+#define __ccm_bss   __attribute__((section(".ccmbss")))
+
+
+/*
+ * Goal: run a function from SRAM, by linker section
+ *
+ * 	At 168 MHz the flash needs 5 wait states (RCC_FlashLatency()). The
+ * 	ART accelerator hides them while the code is in its instruction
+ * 	cache (64 lines of 128 bits, section 3.5.2), a miss costs the wait
+ * 	states again: the time of an ISR depends on what ran before it.
+ * 	From SRAM every fetch costs the same, whatever the history
+ *
+ * 	- .ramfunc is copied from flash at reset (copy table of the
+ * 	  linker script), like .data
+ * 	- SRAM only: the CCM is not on the I-bus, it can't hold code
+ * 	- the fetches use the S-bus, with the data and the DMAs: the best
+ * 	  case is a bit slower than a warm ART, the worst case much better
+ * 	  (bench_ramfunc.c)
+ * 	- long_call: SRAM is too far from flash for a BL, the calls go
+ * 	  through a register
+ * 	- a flash function called from a __ramfunc runs from flash, with
+ * 	  its wait states: keep the callees __ramfunc or inline
+ *
+ * 		__ramfunc void GPIO_EXTIDispatch(uint16_t LineMask);
+ * */
+
+#define __ramfunc   __attribute__((section(".ramfunc"), long_call, noinline))
@@ -0,0 +1,125 @@
+#include "nvic_driver.h"
+
+
+// =============== Compile time checks of the priority plan ===============
+
+_Static_assert(IRQ_PREEMPT_BITS <= NVIC_PRIO_BITS,
+			   "IRQ_PREEMPT_BITS larger than the implemented priority bits");
+
+/*
+ * For each line of the plan:
+ * 	- the preempt priority must fit in IRQ_PREEMPT_BITS
+ * 	- the sub priority must fit in IRQ_SUB_BITS
+ *
+ * Otherwise the value would overflow into the other field
+ * and the IRQ would end up at a different level than the one written
+ * */
+#define IRQ_PLAN_CHECK(name, preempt, sub) \
+	_Static_assert((preempt) < (1 << IRQ_PREEMPT_BITS), \
+				   #name ": preempt priority out of range"); \
+	_Static_assert((sub) < (1 << IRQ_SUB_BITS), \
+				   #name ": sub priority out of range");
+
+IRQ_PRIORITY_PLAN(IRQ_PLAN_CHECK)
+
+#undef IRQ_PLAN_CHECK
+
+/*
+ * An IRQ listed twice would silently get the last priority written,
+ * declaring one enumerator per IRQ turns it into a compile error
+ * ("redeclaration of enumerator IRQ_PLAN_ENTRY_xxx")
+ * */
+#define IRQ_PLAN_UNIQUE(name, preempt, sub) IRQ_PLAN_ENTRY_##name,
+
+enum {
+	IRQ_PRIORITY_PLAN(IRQ_PLAN_UNIQUE)
+	IRQ_PLAN_NB_ENTRIES
+};
+
+#undef IRQ_PLAN_UNIQUE
+
+// =============== Plan table written at boot ===============
+
+typedef struct{
+	uint8_t irq_number;
+	uint8_t ipr_value;   // already encoded (preempt, sub)
+} IRQ_PlanEntry_t;
+
+#define IRQ_PLAN_ENTRY(name, preempt, sub) \
+	{IRQ_NO_##name, NVIC_PRIO_ENCODE(preempt, sub)},
+
+static const IRQ_PlanEntry_t irq_plan_table[IRQ_PLAN_NB_ENTRIES] = {
+	IRQ_PRIORITY_PLAN(IRQ_PLAN_ENTRY)
+};
+
+#undef IRQ_PLAN_ENTRY
+
+// =========================================================
+
+
+void NVIC_IRQInterruptConfig(uint8_t IRQNumber, uint8_t ON_OFF){
+
+	/*
+	 * Same idea as the interrupt demo (3_a_interrupt_conf_example):
+	 * 	- IRQNumber / 32 -> which of the 8 registers
+	 * 	- IRQNumber % 32 -> bit position inside the register
+	 *
+	 * ISER and ICER are "write 1 to act" registers, writing 0 has
+	 * no effect, so no read-modify-write is needed
+	 * */
+
+	if (ON_OFF == ON)
+		NVIC->ISER[IRQNumber / 32] = (1U << (IRQNumber % 32));
+	else
+		NVIC->ICER[IRQNumber / 32] = (1U << (IRQNumber % 32));
+
+} /* End NVIC_IRQInterruptConfig() */
+
+
+void NVIC_IRQPriorityConfig(uint8_t IRQNumber,
+							uint8_t preempt, uint8_t sub){
+
+	/*
+	 * Each IRQ has 1 byte in the IPR registers, so we can write
+	 * the byte directly instead of computing IPRx and the offset
+	 * */
+
+	NVIC->IPR[IRQNumber] = NVIC_PRIO_ENCODE(preempt, sub);
+
+} /* End NVIC_IRQPriorityConfig() */
+
+
+void NVIC_ApplyPriorityPlan(void){
+
+	/*
+	 * 1. Priority grouping in SCB_AIRCR
+	 * 	  -> decides how the IPR byte is split between preempt and sub
+	 * 	  -> the key 0x05FA must be written, otherwise the write is ignored
+	 * */
+
+	uint32_t aircr = SCB->AIRCR;
+
+	aircr &= ~(0xFFFFU << 16);
+	aircr &= ~SCB_AIRCR_PRIGROUP_MASK;
+	aircr |= SCB_AIRCR_VECTKEY | (NVIC_PRIGROUP << SCB_AIRCR_PRIGROUP_POS);
+
+	SCB->AIRCR = aircr;
+
+	// 2. One pass over the plan, the values are already encoded
+	for (int i = 0; i < IRQ_PLAN_NB_ENTRIES; ++i) {
+
+		NVIC->IPR[irq_plan_table[i].irq_number] = irq_plan_table[i].ipr_value;
+
+	} /* End for loop over the plan */
+
+} /* End NVIC_ApplyPriorityPlan() */
+
+
+uint32_t NVIC_GetCeiling(uint8_t IRQNumber){
+
+	// keep only the preempt part of the IPR byte (upper bits)
+	uint8_t preempt_mask = (uint8_t)(0xFF << (8 - IRQ_PREEMPT_BITS));
+
+	return NVIC->IPR[IRQNumber] & preempt_mask;
+
+} /* End NVIC_GetCeiling() */
@@ -0,0 +1,103 @@
+
+#pragma once
+
+#include "stm32f407G.h"
+#include "irq_priority_plan.h"
+
+/*
+ * Encoding of a (preempt, sub) pair into the IPR byte
+ *
+ * 	- the preempt priority occupies the upper bits,
+ * 	  the sub priority the lower bits
+ * 	- only the upper NVIC_PRIO_BITS bits of the byte are implemented,
+ * 	  so the result is shifted by (8 - NVIC_PRIO_BITS)
+ *
+ * Example with 2 preempt bits: (1,0) -> 0b0100 -> 0x40
+ * */
+#define NVIC_PRIO_ENCODE(preempt, sub) \
+	((uint8_t)((((preempt) << IRQ_SUB_BITS) | (sub)) << (8 - NVIC_PRIO_BITS)))
+
+/*
+ * PRIGROUP value for AIRCR, see section 4.3.5 in the generic user guide
+ * 	PRIGROUP = 7 - nb of preempt bits
+ * */
+#define NVIC_PRIGROUP (7 - IRQ_PREEMPT_BITS)
+
+/*
+ * Ceilings used by critical sections
+ *
+ * For every IRQ of the plan, IRQ_CEILING_<name> is the BASEPRI value
+ * that masks this IRQ and every IRQ with the same or lower priority
+ * Example: IRQ_CEILING_USART2 blocks USART2 and USART3 but not EXTI0
+ * */
+#define IRQ_PLAN_CEILING(name, preempt, sub) \
+	IRQ_CEILING_##name = NVIC_PRIO_ENCODE(preempt, 0),
+
+enum {
+	IRQ_PRIORITY_PLAN(IRQ_PLAN_CEILING)
+};
+
+#undef IRQ_PLAN_CEILING
+
+// ================== API ==================
+
+void NVIC_IRQInterruptConfig(uint8_t IRQNumber, uint8_t ON_OFF);
+
+void NVIC_IRQPriorityConfig(uint8_t IRQNumber,
+							uint8_t preempt, uint8_t sub);
+
+void NVIC_ApplyPriorityPlan(void);
+
+/*
+ * Ceiling of an IRQ read back from the NVIC, for drivers that only
+ * know their IRQ number at run time (example: the DMA stream of a USART)
+ * */
+uint32_t NVIC_GetCeiling(uint8_t IRQNumber);
+
+// ================== Critical sections ==================
+
+/*
+ * IRQ_EnterCritical() raises BASEPRI to the ceiling and returns
+ * the previous state, which must be given back to IRQ_ExitCritical()
+ *
+ * 	- BASEPRI_MAX only raises the mask, so nested sections are safe
+ * 	- BASEPRI = 0 means "no masking", so a ceiling of preempt
+ * 	  level 0 can't be done by BASEPRI: in that case we fall back
+ * 	  to PRIMASK (all interrupts off)
+ *
+ * Usage:
+ * 		uint32_t state = IRQ_EnterCritical(IRQ_CEILING_USART2);
+ * 		... touch data shared with USART2 ISR ...
+ * 		IRQ_ExitCritical(state);
+ * */
+
+#define IRQ_CRIT_PRIMASK_FLAG (1U << 31)
+
+static inline uint32_t IRQ_EnterCritical(uint32_t ceiling){
+
+	uint32_t prev;
+
+	if (ceiling == 0){
+		__asm volatile ("MRS %0, primask" : "=r" (prev));
+		__asm volatile ("CPSID i" : : : "memory");
+		return prev | IRQ_CRIT_PRIMASK_FLAG;
+	}
+
+	__asm volatile ("MRS %0, basepri" : "=r" (prev));
+	__asm volatile ("MSR basepri_max, %0" : : "r" (ceiling) : "memory");
+
+	return prev;
+
+} /* End IRQ_EnterCritical() */
+
+static inline void IRQ_ExitCritical(uint32_t prev){
+
+	if (prev & IRQ_CRIT_PRIMASK_FLAG){
+		prev &= ~IRQ_CRIT_PRIMASK_FLAG;
+		__asm volatile ("MSR primask, %0" : : "r" (prev) : "memory");
+		return;
+	}
+
+	__asm volatile ("MSR basepri, %0" : : "r" (prev) : "memory");
+
+} /* End IRQ_ExitCritical() */
@@ -0,0 +1,187 @@
+#include "pattern_gen.h"
+#include "timer_driver.h"
+#include "gpio_driver.h"
+
+
+/*
+ * End of the table
+ * 	- one shot: the stream stopped by itself, stop the timer and
+ * 	  put the bus in its stop state
+ * 	- loop: only counted
+ * */
+static void PatGen_DMACallback(DMA_Handle_t *pDMAHandle, uint8_t event){
+
+	PatGen_Handle_t *pHandle = (PatGen_Handle_t*)pDMAHandle->pContext;
+
+	if (event == DMA_EVENT_ERROR){
+		pHandle->errors++;
+		PatGen_Stop(pHandle);
+		return;
+	}
+
+	if (event != DMA_EVENT_TRANSFER_COMPLETE)
+		return;
+
+	pHandle->loops++;
+
+	if (pHandle->Loop == ON)
+		return;
+
+	PatGen_Stop(pHandle);
+
+	if (pHandle->Done)
+		pHandle->Done(pHandle);
+
+} /* End PatGen_DMACallback() */
+
+// =========================================================
+
+
+drv_status PatGen_Init(PatGen_Handle_t *pHandle){
+
+	TIM_RegDef_t *pTIMx = pHandle->pTIMx;
+
+	if (TIM_GetUpdateDMA(pTIMx, &pHandle->dma) != DRV_OK || pHandle->dma.pDMAx != DMA2)
+		return DRV_ERROR;
+
+	pHandle->running = 0;
+	pHandle->loops = 0;
+	pHandle->errors = 0;
+
+	TIM_ClockHold(pTIMx);
+
+	pTIMx->CR1 = 0;
+	pTIMx->DIER = 0;
+
+	pHandle->RealRate = TIM_SetFrequency(pTIMx, pHandle->Rate);
+
+	return pHandle->RealRate ? DRV_OK : DRV_ERROR;
+
+} /* End PatGen_Init() */
+
+
+void PatGen_PinsInit(PatGen_Handle_t *pHandle, uint8_t FirstPin, uint8_t Width){
+
+	GPIO_Handle_t pin;
+
+	// port held with the pacing timer, until TIM_DeInit()
+	TIM_PortHold(pHandle->pTIMx, pHandle->pGPIOx);
+
+	// stop state first, so the pins never show something else
+	pHandle->pGPIOx->BSRR = pHandle->StopWord;
+
+	pin.gpio_reg_x = pHandle->pGPIOx;
+	pin.gpio_pin_conf.GPIO_PinMode = OUT;
+	pin.gpio_pin_conf.GPIO_PinSpeed = VERY;
+	pin.gpio_pin_conf.GPIO_PinOPType = PUSH_PULL;
+	pin.gpio_pin_conf.GPIO_PinPuPdControl = NO_PULLUP;
+	pin.gpio_pin_conf.GPIO_PinAltFunMode = 0;
+
+	for (uint8_t p = FirstPin; p < FirstPin + Width && p < 16; ++p){
+		pin.gpio_pin_conf.GPIO_PinNumber = p;
+		GPIO_Init(&pin);
+	}
+
+} /* End PatGen_PinsInit() */
+
+
+drv_status PatGen_Start(PatGen_Handle_t *pHandle, const uint32_t *pWords, uint16_t Len){
+
+	TIM_RegDef_t *pTIMx = pHandle->pTIMx;
+	DMA_Handle_t *pDMA = &pHandle->dma;
+
+	if (Len == 0 || pWords == 0)
+		return DRV_ERROR;
+
+	if (pHandle->running)
+		return DRV_BUSY;
+
+	/*
+	 * 1. Stream: 32 bits words to BSRR. FIFO on with bursts of 4
+	 *    words on the memory side when the length allows it (a burst
+	 *    can't be cut by the end of the transfer), single otherwise
+	 * */
+	uint8_t burst = (Len % 4 == 0) ? DMA_BURST_INC4 : DMA_BURST_SINGLE;
+
+	pDMA->DMA_Config.DMA_Direction = DMA_DIR_MEM_TO_PERIPH;
+	pDMA->DMA_Config.DMA_PeriphInc = OFF;
+	pDMA->DMA_Config.DMA_MemInc = ON;
+	pDMA->DMA_Config.DMA_PeriphDataSize = DMA_SIZE_WORD;
+	pDMA->DMA_Config.DMA_MemDataSize = DMA_SIZE_WORD;
+	pDMA->DMA_Config.DMA_Circular = pHandle->Loop;
+	pDMA->DMA_Config.DMA_DoubleBuffer = OFF;
+	pDMA->DMA_Config.DMA_Priority = DMA_PRIO_VERY_HIGH;
+	pDMA->DMA_Config.DMA_HalfTransferIT = OFF;
+	pDMA->DMA_Config.DMA_FIFOMode = ON;
+	pDMA->DMA_Config.DMA_FIFOThreshold = DMA_FIFO_FULL;
+	pDMA->DMA_Config.DMA_MemBurst = burst;
+	pDMA->DMA_Config.DMA_PeriphBurst = DMA_BURST_SINGLE;
+	pDMA->Callback = PatGen_DMACallback;
+	pDMA->pContext = pHandle;
+
+	// DRV_BUSY: the stream is taken by another driver (dma_driver.h)
+	drv_status status = DMA_Init(pDMA);
+
+	if (status != DRV_OK)
+		return status;
+
+	if (DMA_Start(pDMA, (uint32_t)&pHandle->pGPIOx->BSRR, (uint32_t)pWords, 0, Len) != DRV_OK)
+		return DRV_ERROR;
+
+	/*
+	 * 2. Timer: from 0, one request per update event. The first word
+	 *    goes out one period after the start
+	 * */
+	pHandle->running = 1;
+
+	pTIMx->CNT = 0;
+	pTIMx->SR = 0;
+	pTIMx->DIER |= (1 << TIM_DIER_UDE);
+	pTIMx->CR1 |= (1 << TIM_CR1_CEN);
+
+	return DRV_OK;
+
+} /* End PatGen_Start() */
+
+
+void PatGen_Stop(PatGen_Handle_t *pHandle){
+
+	TIM_RegDef_t *pTIMx = pHandle->pTIMx;
+
+	pTIMx->CR1 &= ~(1 << TIM_CR1_CEN);
+	pTIMx->DIER &= ~(1 << TIM_DIER_UDE);
+
+	DMA_Release(&pHandle->dma);
+
+	pHandle->pGPIOx->BSRR = pHandle->StopWord;
+	pHandle->running = 0;
+
+} /* End PatGen_Stop() */
+
+
+uint32_t PatGen_Encode(const uint8_t *pData, uint32_t Len, uint8_t Width,
+					   uint8_t FirstPin, uint32_t *pWords){
+
+	if (Width == 8){
+
+		for (uint32_t i = 0; i < Len; ++i)
+			pWords[i] = PatGen_Word(pData[i], 8, FirstPin);
+
+		return Len;
+
+	}
+
+	if (Width == 4){
+
+		for (uint32_t i = 0; i < Len; ++i){
+			pWords[2 * i]     = PatGen_Word(pData[i] >> 4, 4, FirstPin);
+			pWords[2 * i + 1] = PatGen_Word(pData[i] & 0xF, 4, FirstPin);
+		}
+
+		return 2 * Len;
+
+	}
+
+	return 0;
+
+} /* End PatGen_Encode() */
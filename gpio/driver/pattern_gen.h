@@ -0,0 +1,103 @@
+#pragma once
+
+#include "stm32f407G.h"
+#include "dma_driver.h"
+
+/*
+ * Parallel pattern generator: timer paced DMA to GPIOx_BSRR
+ *
+ * A CPU loop around GPIO_WriteToOutputPort() gives one word every few
+ * cycles at best, with jitter from every interrupt. Here a timer makes
+ * one DMA request per update event, the DMA copies the next 32 bits
+ * word of a table into BSRR: fixed rate, no CPU.
+ *
+ * 	BSRR (section 8.4.7): bits 0..15 set the pins, bits 16..31 reset
+ * 	them, the other pins of the port are not touched. So one word
+ * 	gives the whole state of the bus pins, and the rest of the port
+ * 	(LEDs, chip selects,...) stays free for the CPU. PatGen_Encode()
+ * 	makes these words from bytes or nibbles.
+ *
+ * 	Only DMA2 can write to the GPIOs (AHB1): its peripheral port is on
+ * 	the bus matrix, DMA1 only reaches APB1 (section 10.3.1, figure 32).
+ * 	The DMA2 requests of a timer update event are TIM1_UP (stream 5
+ * 	ch 6) and TIM8_UP (stream 1 ch 7), so the pacing timer is TIM1
+ * 	or TIM8.
+ *
+ * 	- Loop = OFF: the table once, at the end the timer is stopped and
+ * 	  StopWord is written to BSRR (defined stop state, example all the
+ * 	  pins low + strobe high), then Done is called. This happens in the
+ * 	  DMA ISR right after the last word, so the last word only lasts
+ * 	  one full period if it is repeated at the end of the table
+ * 	- Loop = ON: the table again and again until PatGen_Stop(), which
+ * 	  also writes StopWord
+ *
+ * 	The table is read by bursts of 4 words through the DMA FIFO when
+ * 	Len is a multiple of 4 (keep the table aligned on 16 bytes), this
+ * 	leaves the bus free for the CPU in between.
+ *
+ * 	Max rate: each word is an AHB read of the SRAM plus an AHB write
+ * 	of the GPIO for the DMA, with the arbitration in between, the real
+ * 	rate saturates around a few MWords/s (measured in bench_patgen.c).
+ * 	Above it, update events come while the previous request is still
+ * 	pending and are merged: the pattern is played slower, not broken.
+ *
+ * IRQ handler, example TIM8:
+ *
+ * 		void DMA2_Stream1_IRQHandler(void){ DMA_IRQHandling(&patgen.dma); }
+ *
+ * */
+
+typedef struct PatGen_Handle PatGen_Handle_t;
+
+typedef void (*patgen_done_t)(PatGen_Handle_t *pHandle);
+
+struct PatGen_Handle{
+
+	TIM_RegDef_t *pTIMx;       // TIM1 or TIM8
+	GPIO_RegDef_t *pGPIOx;     // port of the bus
+	uint32_t Rate;             // words per second
+	uint8_t Loop;              // ON / OFF
+	uint32_t StopWord;         // written to BSRR at the end / at stop
+
+	patgen_done_t Done;        // one shot only, called from the DMA ISR
+	void *pContext;
+
+	// Filled by the driver
+	DMA_Handle_t dma;
+	uint32_t RealRate;         // after rounding of the timer
+	__vo uint8_t running;
+	__vo uint32_t loops;
+	__vo uint32_t errors;
+
+};
+
+
+// ================== API ==================
+
+// Timer at Rate, DMA stream, nothing runs yet
+drv_status PatGen_Init(PatGen_Handle_t *pHandle);
+
+// Width pins from FirstPin as outputs, very high speed
+void PatGen_PinsInit(PatGen_Handle_t *pHandle, uint8_t FirstPin, uint8_t Width);
+
+drv_status PatGen_Start(PatGen_Handle_t *pHandle, const uint32_t *pWords, uint16_t Len);
+
+void PatGen_Stop(PatGen_Handle_t *pHandle);
+
+/*
+ * Bytes (Width = 8) or nibbles (Width = 4, high nibble first) to BSRR
+ * words on the pins FirstPin .. FirstPin + Width - 1
+ * Returns the number of words written to pWords (Len or 2 * Len)
+ * */
+uint32_t PatGen_Encode(const uint8_t *pData, uint32_t Len, uint8_t Width,
+					   uint8_t FirstPin, uint32_t *pWords);
+
+// One BSRR word: Value on the Width pins from FirstPin
+static inline uint32_t PatGen_Word(uint32_t Value, uint8_t Width, uint8_t FirstPin){
+
+	uint32_t mask = ((1U << Width) - 1) << FirstPin;
+	uint32_t set = (Value << FirstPin) & mask;
+
+	return set | ((mask & ~set) << 16);
+
+} /* End PatGen_Word() */
@@ -0,0 +1,267 @@
+#include "power.h"
+#include "rcc_driver.h"
+#include "nvic_driver.h"
+#include "clock_gate.h"
+#include "startup_time.h"
+#include "dwt_counter.h"
+
+#define PWR_RTC_TIMEOUT 0x20000U
+
+// PWR clock of the RTC wake up (DBP), an Init called again takes no new one
+static uint32_t pwr_rtc_clk_held;
+
+/*
+ * Hardware wake up time (datasheet, low-power mode wakeup timings)
+ * and first estimate of the restore: start up of HSE + lock of the PLL
+ * */
+static PWR_Latency_t pwr_latency[PWR_NB_MODES] = {
+	[PWR_MODE_SLEEP]   = {.wakeup_us = 1,   .max_restore_us = 0},
+	[PWR_MODE_STOP]    = {.wakeup_us = 13,  .max_restore_us = 2200},
+	[PWR_MODE_STOP_LP] = {.wakeup_us = 110, .max_restore_us = 2200},
+	[PWR_MODE_STANDBY] = {.wakeup_us = 318, .max_restore_us = 5000},
+};
+
+
+// =============== Modes ===============
+
+drv_status PWR_Enter(uint8_t Mode){
+
+	drv_status status = DRV_OK;
+
+	if (Mode >= PWR_NB_MODES)
+		return DRV_ERROR;
+
+	PWR_Latency_t *pLat = &pwr_latency[Mode];
+
+	CLK_Acquire(CLK_APB1, CLK_APB1_PWR);
+
+	uint32_t saved_cr = RCC->CR;
+	uint32_t saved_cfgr = RCC->CFGR;
+
+	// the ISR of the wake up source runs after the clock restore
+	uint32_t state = IRQ_EnterCritical(0);
+
+	uint32_t cr = PWR->CR & ~((1 << PWR_CR_LPDS) | (1 << PWR_CR_PDDS) | (1 << PWR_CR_FPDS));
+
+	switch (Mode){
+
+	case PWR_MODE_SLEEP:
+		SCB->SCR &= ~SCB_SCR_SLEEPDEEP;
+		break;
+
+	case PWR_MODE_STOP:
+		PWR->CR = cr;
+		SCB->SCR |= SCB_SCR_SLEEPDEEP;
+		break;
+
+	case PWR_MODE_STOP_LP:
+		PWR->CR = cr | (1 << PWR_CR_LPDS) | (1 << PWR_CR_FPDS);
+		SCB->SCR |= SCB_SCR_SLEEPDEEP;
+		break;
+
+	default:
+		// STANDBY: old wake up flag cleared, else no entry
+		PWR->CR = cr | (1 << PWR_CR_PDDS) | (1 << PWR_CR_CWUF);
+		PWR->CSR |= (1 << PWR_CSR_EWUP);
+		SCB->SCR |= SCB_SCR_SLEEPDEEP;
+		break;
+
+	} /* End switch Mode */
+
+	__asm volatile ("dsb");
+	__asm volatile ("wfi");
+	__asm volatile ("isb");
+
+	uint32_t start = DWT_GetCycles();
+
+	SCB->SCR &= ~SCB_SCR_SLEEPDEEP;
+
+	if (Mode != PWR_MODE_SLEEP)
+		status = RCC_ClockResume(saved_cr, saved_cfgr, PWR_RESTORE_FROM_HSI);
+
+	// restore on HSI: SYSCLK only changes at its very end
+	uint32_t cycles = DWT_GetCycles() - start;
+
+	pLat->restore_us = (Mode == PWR_MODE_SLEEP) ?
+					   cycles / (SystemCoreClock / 1000000U) :
+					   cycles / (HSI_VALUE / 1000000U);
+
+	// the first measure replaces the estimate
+	if (pLat->entries == 0 || pLat->restore_us > pLat->max_restore_us)
+		pLat->max_restore_us = pLat->restore_us;
+
+	pLat->entries++;
+
+	CLK_Release(CLK_APB1, CLK_APB1_PWR);
+
+	IRQ_ExitCritical(state);
+
+	return status;
+
+} /* End PWR_Enter() */
+
+
+uint8_t PWR_ChooseMode(uint32_t DeadlineUs, uint8_t AllowStandby){
+
+	for (int8_t m = PWR_NB_MODES - 1; m > PWR_MODE_SLEEP; --m){
+
+		if (m == PWR_MODE_STANDBY && !AllowStandby)
+			continue;
+
+		if (pwr_latency[m].wakeup_us + pwr_latency[m].max_restore_us <= DeadlineUs)
+			return m;
+
+	}
+
+	return PWR_MODE_SLEEP;
+
+} /* End PWR_ChooseMode() */
+
+
+const PWR_Latency_t *PWR_GetLatency(uint8_t Mode){
+
+	return (Mode < PWR_NB_MODES) ? &pwr_latency[Mode] : 0;
+
+} /* End PWR_GetLatency() */
+
+
+uint8_t PWR_StandbyReset(void){
+
+	uint8_t standby;
+
+	CLK_Acquire(CLK_APB1, CLK_APB1_PWR);
+
+	standby = (PWR->CSR >> PWR_CSR_SBF) & 0x1;
+
+	if (standby){
+
+		PWR->CR |= (1 << PWR_CR_CSBF) | (1 << PWR_CR_CWUF);
+
+		PWR_Latency_t *pLat = &pwr_latency[PWR_MODE_STANDBY];
+
+		pLat->restore_us = Startup_GetTimeUs();
+		pLat->max_restore_us = pLat->restore_us;
+		pLat->entries = 1;
+
+	}
+
+	CLK_Release(CLK_APB1, CLK_APB1_PWR);
+
+	return standby;
+
+} /* End PWR_StandbyReset() */
+
+
+// =============== RTC wakeup timer ===============
+
+static drv_status PWR_WaitRTC(__vo uint32_t *pReg, uint8_t Bit){
+
+	for (uint32_t i = 0; i < PWR_RTC_TIMEOUT; ++i){
+		if ((*pReg >> Bit) & 0x1)
+			return DRV_OK;
+	}
+
+	return DRV_ERROR;
+
+} /* End PWR_WaitRTC() */
+
+
+/*
+ * The RTC is in the backup domain: DBP must be set to write RCC_BDCR
+ * and the RTC, the PWR clock stays held for that. Changing the clock
+ * of the RTC needs a reset of the backup domain (section 7.3.20)
+ * */
+drv_status PWR_RTCWakeupInit(void){
+
+	CLK_Hold(&pwr_rtc_clk_held, CLK_APB1, CLK_APB1_PWR);
+
+	PWR->CR |= (1 << PWR_CR_DBP);
+
+	// 1. LSI, kept running in STOP and STANDBY
+	RCC->CSR |= (1 << RCC_CSR_LSION);
+
+	if (PWR_WaitRTC(&RCC->CSR, RCC_CSR_LSIRDY) != DRV_OK)
+		return DRV_ERROR;
+
+	// 2. RTC on LSI
+	uint8_t sel = (RCC->BDCR >> RCC_BDCR_RTCSEL) & 0x3;
+
+	if (sel != 2){
+
+		if (sel != 0){
+			RCC->BDCR |= (1 << RCC_BDCR_BDRST);
+			RCC->BDCR &= ~(1 << RCC_BDCR_BDRST);
+		}
+
+		RCC->BDCR |= (2U << RCC_BDCR_RTCSEL);
+
+	}
+
+	RCC->BDCR |= (1 << RCC_BDCR_RTCEN);
+
+	// 3. Wakeup timer event on EXTI line 22, rising edge
+	EXTI->IMR |= (1 << EXTI_LINE_RTC_WKUP);
+	EXTI->RTSR |= (1 << EXTI_LINE_RTC_WKUP);
+
+	NVIC_IRQInterruptConfig(IRQ_NO_RTC_WKUP, ON);
+
+	return DRV_OK;
+
+} /* End PWR_RTCWakeupInit() */
+
+
+drv_status PWR_RTCWakeupStart(uint32_t Ms){
+
+	// RTCCLK / 16 (WUCKSEL = 000): 2 kHz with LSI
+	uint32_t ticks = (Ms * (PWR_LSI_HZ / 16)) / 1000;
+
+	if (ticks == 0 || ticks > 0x10000)
+		return DRV_ERROR;
+
+	RTC->WPR = RTC_WPR_KEY1;
+	RTC->WPR = RTC_WPR_KEY2;
+
+	// WUTR can only be written with the timer stopped and WUTWF set
+	RTC->CR &= ~((1 << RTC_CR_WUTE) | (1 << RTC_CR_WUTIE));
+
+	if (PWR_WaitRTC(&RTC->ISR, RTC_ISR_WUTWF) != DRV_OK){
+		RTC->WPR = 0xFF;
+		return DRV_ERROR;
+	}
+
+	RTC->WUTR = ticks - 1;
+	RTC->CR &= ~(0x7U << RTC_CR_WUCKSEL);
+	RTC->ISR &= ~(1 << RTC_ISR_WUTF);
+	RTC->CR |= (1 << RTC_CR_WUTIE) | (1 << RTC_CR_WUTE);
+
+	RTC->WPR = 0xFF;    // any wrong key locks again
+
+	EXTI->PR = (1 << EXTI_LINE_RTC_WKUP);
+
+	return DRV_OK;
+
+} /* End PWR_RTCWakeupStart() */
+
+
+void PWR_RTCWakeupStop(void){
+
+	RTC->WPR = RTC_WPR_KEY1;
+	RTC->WPR = RTC_WPR_KEY2;
+
+	RTC->CR &= ~((1 << RTC_CR_WUTE) | (1 << RTC_CR_WUTIE));
+	RTC->ISR &= ~(1 << RTC_ISR_WUTF);
+
+	RTC->WPR = 0xFF;
+
+	EXTI->PR = (1 << EXTI_LINE_RTC_WKUP);
+
+} /* End PWR_RTCWakeupStop() */
+
+
+void PWR_RTCWakeupIRQHandling(void){
+
+	// WUTF is not write protected (RTC_ISR[13:8])
+	RTC->ISR &= ~(1 << RTC_ISR_WUTF);
+	EXTI->PR = (1 << EXTI_LINE_RTC_WKUP);
+
+} /* End PWR_RTCWakeupIRQHandling() */
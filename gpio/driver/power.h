@@ -0,0 +1,87 @@
+#pragma once
+
+#include "stm32f407G.h"
+
+/*
+ * Power manager: sleep, stop and standby modes (section 5.3), wake up
+ * by an EXTI line or by the wakeup timer of the RTC
+ *
+ * 	Mode           core  clocks            RAM   wake up (datasheet typ.)
+ * 	SLEEP          off   on                kept  some cycles
+ * 	STOP           off   off, main reg.    kept  ~13 us + clock restore
+ * 	STOP_LP        off   off, LP reg.,     kept  ~110 us + clock restore
+ * 	                     flash powered down
+ * 	STANDBY        off   off, 1.2 V off    lost  ~318 us + full reset
+ *
+ * 	- PWR_Enter() masks the interrupts (PRIMASK) before WFI: a pending
+ * 	  interrupt still wakes the core, but its ISR only runs once the
+ * 	  clock is back (PLL as before STOP), at the end of PWR_Enter()
+ * 	- after STOP the core runs on HSI 16 MHz: RCC_ClockResume()
+ * 	  restarts HSE and the PLL from the registers kept in STOP, no new
+ * 	  computation. PWR_RESTORE_FROM_HSI moves the PLL input on HSI and
+ * 	  saves the start up of the crystal (~2 ms), 1 % accuracy instead
+ * 	- EXTI wake up: the line configured by GPIO_Init() (INT_xxx modes,
+ * 	  IMR + edge + SYSCFG) and its IRQ on in the NVIC, nothing else
+ * 	- RTC wake up: PWR_RTCWakeupInit() once (LSI 32 kHz, EXTI line 22),
+ * 	  PWR_RTCWakeupStart() before each PWR_Enter(), 0.5 ms steps
+ * 	- STANDBY never returns: the board restarts from Reset_Handler,
+ * 	  PWR_StandbyReset() in main() tells it. Wake up by the RTC or a
+ * 	  rising edge on WKUP (PA0, user button)
+ * 	- an interrupt already pending (SysTick, EXTI_PR) wakes the core
+ * 	  at once: stop SysTick or accept a wake up per tick
+ * 	- the debugger may lose the connection in STOP / STANDBY, the
+ * 	  results stay in RAM (STOP) for the next connection
+ *
+ * 	Wake latency of each mode (PWR_GetLatency()): the hardware part
+ * 	from the datasheet, plus the clock restore measured with DWT at
+ * 	each wake up (for STANDBY: reset to main(), startup_time.h).
+ * 	PWR_ChooseMode() gives the deepest mode that wakes up in time
+ * 	for a deadline:
+ *
+ * 		PWR_RTCWakeupStart(50);
+ * 		PWR_Enter(PWR_ChooseMode(deadline_us, 0));
+ * */
+
+// 1 -> after STOP the PLL restarts on HSI (fast), 0 -> on HSE as before
+#define PWR_RESTORE_FROM_HSI 0
+
+#define PWR_LSI_HZ          32000U      // RTC clock, +/- 15 % (datasheet)
+
+// ------------ Coding states ------------
+
+typedef enum PWR_Mode {PWR_MODE_SLEEP, PWR_MODE_STOP, PWR_MODE_STOP_LP,
+					   PWR_MODE_STANDBY, PWR_NB_MODES} pwr_mode;
+
+
+typedef struct{
+
+	uint32_t wakeup_us;        // hardware, datasheet typ.
+	uint32_t restore_us;       // last clock restore, measured
+	uint32_t max_restore_us;   // estimate until the first measure
+	uint32_t entries;
+
+} PWR_Latency_t;
+
+// ================== API ==================
+
+// Returns once woken up, clock restored (not for PWR_MODE_STANDBY)
+// DRV_ERROR: HSE or the PLL did not restart, the core runs on HSI
+drv_status PWR_Enter(uint8_t Mode);
+
+// Deepest mode with wakeup_us + max_restore_us <= DeadlineUs
+uint8_t PWR_ChooseMode(uint32_t DeadlineUs, uint8_t AllowStandby);
+
+const PWR_Latency_t *PWR_GetLatency(uint8_t Mode);
+
+// In main(): 1 if this reset is a wake up from STANDBY (flag cleared)
+uint8_t PWR_StandbyReset(void);
+
+drv_status PWR_RTCWakeupInit(void);
+
+// Wake up in Ms (1..32767), periodic until PWR_RTCWakeupStop()
+drv_status PWR_RTCWakeupStart(uint32_t Ms);
+
+void PWR_RTCWakeupStop(void);
+
+// From RTC_WKUP_IRQHandler()
+void PWR_RTCWakeupIRQHandling(void);
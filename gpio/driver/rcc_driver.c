@@ -0,0 +1,521 @@
+#include "rcc_driver.h"
+#include "clock_gate.h"
+
+// Reset value: the MCU starts on HSI
+uint32_t SystemCoreClock = HSI_VALUE;
+
+/*
+ * PWR clock for VOS (clock_gate.h). From SystemInit() the .bss is
+ * cleared after the call: the bit stays set with no holder, like a
+ * raw enable, and the next RCC_ClockConfig() takes the reference
+ * */
+static uint32_t rcc_clk_held;
+
+/*
+ * Prescaler tables, indexed by the value of the field in RCC_CFGR
+ * (see section 7.3.3 in the reference manual)
+ *
+ * 	- HPRE  (4 bits): 0xxx -> /1, 1000 -> /2, ..., 1111 -> /512
+ * 	  (note: /32 does not exist)
+ * 	- PPREx (3 bits): 0xx  -> /1, 100  -> /2, ..., 111  -> /16
+ * */
+static const uint16_t ahb_prescaler[8] = {2, 4, 8, 16, 64, 128, 256, 512};
+static const uint8_t  apb_prescaler[4] = {2, 4, 8, 16};
+
+
+uint32_t RCC_GetSYSCLKValue(void){
+
+	uint32_t sysclk;
+
+	// SWS bits [3:2]: which clock is really used as system clock
+	uint8_t clk_src = (RCC->CFGR >> 2) & 0x3;
+
+	switch (clk_src){
+
+	case 0:
+		sysclk = HSI_VALUE;
+		break;
+
+	case 1:
+		sysclk = HSE_VALUE;
+		break;
+
+	case 2: {
+		/*
+		 * PLL: SYSCLK = (input / M) * N / P
+		 * 	- PLLSRC bit 22: 0 -> HSI, 1 -> HSE
+		 * 	- M bits [5:0], N bits [14:6]
+		 * 	- P bits [17:16]: 00 -> 2, 01 -> 4, 10 -> 6, 11 -> 8
+		 * */
+		uint32_t pllcfgr = RCC->PLLCFGR;
+		uint32_t pll_in  = (pllcfgr & (1U << 22)) ? HSE_VALUE : HSI_VALUE;
+		uint32_t pll_m   = pllcfgr & 0x3F;
+		uint32_t pll_n   = (pllcfgr >> 6) & 0x1FF;
+		uint32_t pll_p   = (((pllcfgr >> 16) & 0x3) + 1) * 2;
+
+		sysclk = ((pll_in / pll_m) * pll_n) / pll_p;
+		break;
+	}
+
+	default:
+		sysclk = HSI_VALUE;
+		break;
+
+	} /* End switch clk_src */
+
+	return sysclk;
+
+} /* End RCC_GetSYSCLKValue() */
+
+
+uint32_t RCC_GetHCLKValue(void){
+
+	uint8_t hpre = (RCC->CFGR >> 4) & 0xF;
+
+	if (hpre < 8)
+		return RCC_GetSYSCLKValue();
+
+	return RCC_GetSYSCLKValue() / ahb_prescaler[hpre - 8];
+
+} /* End RCC_GetHCLKValue() */
+
+
+uint32_t RCC_GetPCLK1Value(void){
+
+	// PPRE1 bits [12:10], APB1 clock (max 42 MHz)
+	uint8_t ppre1 = (RCC->CFGR >> 10) & 0x7;
+
+	if (ppre1 < 4)
+		return RCC_GetHCLKValue();
+
+	return RCC_GetHCLKValue() / apb_prescaler[ppre1 - 4];
+
+} /* End RCC_GetPCLK1Value() */
+
+
+uint32_t RCC_GetPCLK2Value(void){
+
+	// PPRE2 bits [15:13], APB2 clock (max 84 MHz)
+	uint8_t ppre2 = (RCC->CFGR >> 13) & 0x7;
+
+	if (ppre2 < 4)
+		return RCC_GetHCLKValue();
+
+	return RCC_GetHCLKValue() / apb_prescaler[ppre2 - 4];
+
+} /* End RCC_GetPCLK2Value() */
+
+
+/*
+ * The timers get twice the APB clock when the APB prescaler is not 1
+ * (TIMPRE = 0, see the clock tree, figure 21 in the reference manual)
+ * */
+uint32_t RCC_GetTIMCLK1Value(void){
+
+	if (((RCC->CFGR >> 10) & 0x7) < 4)
+		return RCC_GetPCLK1Value();
+
+	return 2 * RCC_GetPCLK1Value();
+
+} /* End RCC_GetTIMCLK1Value() */
+
+
+uint32_t RCC_GetTIMCLK2Value(void){
+
+	if (((RCC->CFGR >> 13) & 0x7) < 4)
+		return RCC_GetPCLK2Value();
+
+	return 2 * RCC_GetPCLK2Value();
+
+} /* End RCC_GetTIMCLK2Value() */
+
+
+void SystemCoreClockUpdate(void){
+
+	SystemCoreClock = RCC_GetHCLKValue();
+
+} /* End SystemCoreClockUpdate() */
+
+
+// =============== Clock configuration ===============
+
+#define RCC_READY_TIMEOUT 0x20000U   // loops, HSE start up is about 2 ms
+
+const RCC_ClockConfig_t RCC_Clock168MHz = {
+	.RCC_PLLSource = RCC_PLL_HSE,
+	.RCC_SysClk = 168000000U,
+	.RCC_AHBDiv = 1,
+	.RCC_APB1Div = 4,
+	.RCC_APB2Div = 2
+};
+
+
+// Divider -> HPRE bits, 0xFF if it doesn't exist
+static uint8_t RCC_AHBBits(uint16_t Div){
+
+	if (Div == 1)
+		return 0;
+
+	for (uint8_t i = 0; i < 8; ++i) {
+		if (ahb_prescaler[i] == Div)
+			return 8 + i;
+	}
+
+	return 0xFF;
+
+} /* End RCC_AHBBits() */
+
+
+// Divider -> PPREx bits, 0xFF if it doesn't exist
+static uint8_t RCC_APBBits(uint8_t Div){
+
+	if (Div == 1)
+		return 0;
+
+	for (uint8_t i = 0; i < 4; ++i) {
+		if (apb_prescaler[i] == Div)
+			return 4 + i;
+	}
+
+	return 0xFF;
+
+} /* End RCC_APBBits() */
+
+
+static drv_status RCC_WaitFlag(__vo uint32_t *pReg, uint8_t Bit, uint8_t Value){
+
+	for (uint32_t i = 0; i < RCC_READY_TIMEOUT; ++i) {
+		if (((*pReg >> Bit) & 0x1) == Value)
+			return DRV_OK;
+	}
+
+	return DRV_ERROR;
+
+} /* End RCC_WaitFlag() */
+
+
+static drv_status RCC_SelectSysClk(uint8_t Source){
+
+	RCC->CFGR = (RCC->CFGR & ~(0x3U << RCC_CFGR_SW)) | ((uint32_t)Source << RCC_CFGR_SW);
+
+	for (uint32_t i = 0; i < RCC_READY_TIMEOUT; ++i) {
+		if (((RCC->CFGR >> RCC_CFGR_SWS) & 0x3) == Source)
+			return DRV_OK;
+	}
+
+	return DRV_ERROR;
+
+} /* End RCC_SelectSysClk() */
+
+
+/*
+ * Wait states, and ART caches reset then enabled. The caches can only
+ * be reset while disabled (section 3.5.2). The new latency is read
+ * back: the flash must use it before the clock changes, DRV_ERROR if
+ * it never shows up
+ * */
+static drv_status RCC_SetFlash(uint8_t Latency){
+
+	FLASH->ACR &= ~((1 << FLASH_ACR_ICEN) | (1 << FLASH_ACR_DCEN));
+	FLASH->ACR |= (1 << FLASH_ACR_ICRST) | (1 << FLASH_ACR_DCRST);
+	FLASH->ACR &= ~((1 << FLASH_ACR_ICRST) | (1 << FLASH_ACR_DCRST));
+
+	FLASH->ACR = ((uint32_t)Latency << FLASH_ACR_LATENCY) | (1 << FLASH_ACR_PRFTEN) |
+				 (1 << FLASH_ACR_ICEN) | (1 << FLASH_ACR_DCEN);
+
+	for (uint32_t i = 0; i < RCC_READY_TIMEOUT; ++i) {
+		if (((FLASH->ACR >> FLASH_ACR_LATENCY) & 0x7) == Latency)
+			return DRV_OK;
+	}
+
+	return DRV_ERROR;
+
+} /* End RCC_SetFlash() */
+
+
+/*
+ * Search, in this order of preference:
+ * 	- VCO input 2 MHz, then down to 1 MHz (M from small to large)
+ * 	- P from 2 to 8 (lowest VCO first, less power)
+ * 	- Q giving exactly 48 MHz, else the first valid solution with
+ * 	  48 MHz at most on the Q output
+ * */
+drv_status RCC_PLLCompute(uint32_t InputHz, uint32_t SysClk, RCC_PLL_t *pPLL){
+
+	uint8_t found = 0;
+
+	if (SysClk == 0 || SysClk > RCC_SYSCLK_MAX)
+		return DRV_ERROR;
+
+	for (uint8_t m = 2; m <= 63; ++m) {
+
+		uint32_t vco_in = InputHz / m;
+
+		if (InputHz % m || vco_in > 2000000U)
+			continue;
+
+		if (vco_in < 1000000U)
+			break;
+
+		for (uint8_t p = 2; p <= 8; p += 2) {
+
+			uint32_t vco = SysClk * p;
+
+			if (vco < 100000000U || vco > 432000000U || vco % vco_in)
+				continue;
+
+			uint32_t n = vco / vco_in;
+
+			if (n < 50 || n > 432)
+				continue;
+
+			// smallest Q keeping the 48 MHz domain at 48 MHz at most
+			uint32_t q = (vco + RCC_USB_CLK - 1) / RCC_USB_CLK;
+
+			if (q < 2)
+				q = 2;
+
+			if (q > 15)
+				continue;
+
+			if (!found || (vco % RCC_USB_CLK == 0 && vco / q == RCC_USB_CLK)){
+				pPLL->M = m;
+				pPLL->N = n;
+				pPLL->P = p;
+				pPLL->Q = q;
+				found = 1;
+			}
+
+			if (vco / q == RCC_USB_CLK && vco % RCC_USB_CLK == 0)
+				return DRV_OK;
+
+		} /* End for p */
+
+	} /* End for m */
+
+	return found ? DRV_OK : DRV_ERROR;
+
+} /* End RCC_PLLCompute() */
+
+
+uint8_t RCC_FlashLatency(uint32_t HClk){
+
+	if (HClk == 0)
+		return 0;
+
+	return (HClk - 1) / 30000000U;
+
+} /* End RCC_FlashLatency() */
+
+
+drv_status RCC_ClockConfig(const RCC_ClockConfig_t *pConfig){
+
+	RCC_PLL_t pll;
+
+	uint32_t pll_in = (pConfig->RCC_PLLSource == RCC_PLL_HSE) ? HSE_VALUE : HSI_VALUE;
+	uint8_t hpre = RCC_AHBBits(pConfig->RCC_AHBDiv);
+	uint8_t ppre1 = RCC_APBBits(pConfig->RCC_APB1Div);
+	uint8_t ppre2 = RCC_APBBits(pConfig->RCC_APB2Div);
+
+	// 1. Parameters
+	if (hpre == 0xFF || ppre1 == 0xFF || ppre2 == 0xFF)
+		return DRV_ERROR;
+
+	if (RCC_PLLCompute(pll_in, pConfig->RCC_SysClk, &pll) != DRV_OK)
+		return DRV_ERROR;
+
+	uint32_t hclk = pConfig->RCC_SysClk / pConfig->RCC_AHBDiv;
+
+	if (hclk > RCC_HCLK_MAX ||
+		hclk / pConfig->RCC_APB1Div > RCC_PCLK1_MAX ||
+		hclk / pConfig->RCC_APB2Div > RCC_PCLK2_MAX)
+		return DRV_ERROR;
+
+	// 2. HSE
+	if (pConfig->RCC_PLLSource == RCC_PLL_HSE){
+
+		RCC->CR |= (1 << RCC_CR_HSEON);
+
+		if (RCC_WaitFlag(&RCC->CR, RCC_CR_HSERDY, 1) != DRV_OK){
+			RCC->CR &= ~(1 << RCC_CR_HSEON);
+			return DRV_ERROR;
+		}
+
+	}
+
+	// 3. Regulator scale 1
+	CLK_Hold(&rcc_clk_held, CLK_APB1, CLK_APB1_PWR);
+	PWR->CR |= (1 << PWR_CR_VOS);
+
+	// 4. On HSI while the PLL is off, the wait states stay as they are
+	RCC->CR |= (1 << RCC_CR_HSION);
+	RCC_WaitFlag(&RCC->CR, RCC_CR_HSIRDY, 1);
+
+	if (RCC_SelectSysClk(0) != DRV_OK)
+		return DRV_ERROR;
+
+	// from here a failure leaves the core on HSI, SystemCoreClock follows
+	SystemCoreClockUpdate();
+
+	RCC->CR &= ~(1 << RCC_CR_PLLON);
+
+	if (RCC_WaitFlag(&RCC->CR, RCC_CR_PLLRDY, 0) != DRV_OK)
+		return DRV_ERROR;
+
+	// 5. PLL, reserved bits of PLLCFGR kept
+	uint32_t pllcfgr = RCC->PLLCFGR;
+
+	pllcfgr &= ~((0x3FU << RCC_PLLCFGR_PLLM) | (0x1FFU << RCC_PLLCFGR_PLLN) |
+				 (0x3U << RCC_PLLCFGR_PLLP) | (1U << RCC_PLLCFGR_PLLSRC) |
+				 (0xFU << RCC_PLLCFGR_PLLQ));
+
+	pllcfgr |= ((uint32_t)pll.M << RCC_PLLCFGR_PLLM) |
+			   ((uint32_t)pll.N << RCC_PLLCFGR_PLLN) |
+			   ((uint32_t)(pll.P / 2 - 1) << RCC_PLLCFGR_PLLP) |
+			   ((uint32_t)pConfig->RCC_PLLSource << RCC_PLLCFGR_PLLSRC) |
+			   ((uint32_t)pll.Q << RCC_PLLCFGR_PLLQ);
+
+	RCC->PLLCFGR = pllcfgr;
+	RCC->CR |= (1 << RCC_CR_PLLON);
+
+	if (RCC_WaitFlag(&RCC->CR, RCC_CR_PLLRDY, 1) != DRV_OK)
+		return DRV_ERROR;
+
+	// scale 1 ready once the PLL runs, still on HSI if it never is
+	if (RCC_WaitFlag(&PWR->CSR, PWR_CSR_VOSRDY, 1) != DRV_OK)
+		return DRV_ERROR;
+
+	// 6. Wait states for the new clock, then prescalers, then switch
+	uint8_t latency = RCC_FlashLatency(hclk);
+	uint8_t old_latency = (FLASH->ACR >> FLASH_ACR_LATENCY) & 0x7;
+
+	if (RCC_SetFlash((latency > old_latency) ? latency : old_latency) != DRV_OK)
+		return DRV_ERROR;
+
+	uint32_t cfgr = RCC->CFGR;
+
+	cfgr &= ~((0xFU << RCC_CFGR_HPRE) | (0x7U << RCC_CFGR_PPRE1) | (0x7U << RCC_CFGR_PPRE2));
+	cfgr |= ((uint32_t)hpre << RCC_CFGR_HPRE) | ((uint32_t)ppre1 << RCC_CFGR_PPRE1) |
+			((uint32_t)ppre2 << RCC_CFGR_PPRE2);
+
+	RCC->CFGR = cfgr;
+
+	if (RCC_SelectSysClk(2) != DRV_OK){
+		SystemCoreClockUpdate();
+		return DRV_ERROR;
+	}
+
+	drv_status status = DRV_OK;
+
+	// slower than before: the extra wait states can go now. If they don't,
+	// the old ones are still enough for the new clock, only reported
+	if (latency < old_latency && RCC_SetFlash(latency) != DRV_OK)
+		status = DRV_ERROR;
+
+	SystemCoreClockUpdate();
+
+	return status;
+
+} /* End RCC_ClockConfig() */
+
+
+void RCC_ClockReset(void){
+
+	RCC->CR |= (1 << RCC_CR_HSION);
+	RCC_WaitFlag(&RCC->CR, RCC_CR_HSIRDY, 1);
+
+	RCC_SelectSysClk(0);
+
+	RCC->CFGR &= ~((0xFU << RCC_CFGR_HPRE) | (0x7U << RCC_CFGR_PPRE1) | (0x7U << RCC_CFGR_PPRE2));
+
+	RCC->CR &= ~((1 << RCC_CR_PLLON) | (1 << RCC_CR_HSEON));
+
+	// 16 MHz: 0 wait state, the ART stays on
+	RCC_SetFlash(0);
+
+	SystemCoreClockUpdate();
+
+} /* End RCC_ClockReset() */
+
+
+/*
+ * After STOP the core runs on HSI, HSE and PLL are off (section 5.3.4)
+ * but PLLCFGR, the prescalers of CFGR and the wait states are kept:
+ * HSE and PLL are started again as they were, nothing is computed or
+ * checked, the wait states are already right for the old clock
+ *
+ * FromHSI: the PLL input moves from HSE to HSI with M scaled by
+ * HSI / HSE, same VCO and same SYSCLK without the start up of the
+ * crystal (about 2 ms), but with the 1 % accuracy of HSI. The next
+ * RCC_ClockConfig() goes back to HSE
+ * */
+drv_status RCC_ClockResume(uint32_t SavedCR, uint32_t SavedCFGR, uint8_t FromHSI){
+
+	uint8_t source = (SavedCFGR >> RCC_CFGR_SWS) & 0x3;
+	uint32_t pllcfgr = RCC->PLLCFGR;
+	uint32_t m = (pllcfgr >> RCC_PLLCFGR_PLLM) & 0x3F;
+	drv_status status = DRV_OK;
+
+	/*
+	 * Same VCO input from HSI: M = HSI_VALUE / (HSE_VALUE / M), only
+	 * when it is exact and in the range of PLLM (2..63)
+	 * */
+	if (FromHSI && source == 2 && (pllcfgr & (1U << RCC_PLLCFGR_PLLSRC)) && m != 0 &&
+		(HSE_VALUE % m) == 0){
+
+		uint32_t vco_in = HSE_VALUE / m;
+		uint32_t m_hsi = HSI_VALUE / vco_in;
+
+		if ((HSI_VALUE % vco_in) == 0 && m_hsi >= 2 && m_hsi <= 63){
+
+			pllcfgr &= ~((0x3FU << RCC_PLLCFGR_PLLM) | (1U << RCC_PLLCFGR_PLLSRC));
+			RCC->PLLCFGR = pllcfgr | (m_hsi << RCC_PLLCFGR_PLLM);
+
+			SavedCR &= ~(1U << RCC_CR_HSEON);
+
+		}
+
+	}
+
+	if (SavedCR & (1U << RCC_CR_HSEON)){
+
+		RCC->CR |= (1 << RCC_CR_HSEON);
+
+		status = RCC_WaitFlag(&RCC->CR, RCC_CR_HSERDY, 1);
+
+	}
+
+	if (status == DRV_OK && (SavedCR & (1U << RCC_CR_PLLON))){
+
+		RCC->CR |= (1 << RCC_CR_PLLON);
+
+		status = RCC_WaitFlag(&RCC->CR, RCC_CR_PLLRDY, 1);
+
+	}
+
+	if (status == DRV_OK && source != 0)
+		status = RCC_SelectSysClk(source);
+
+	// on error the core stays on HSI: SystemCoreClock must say so
+	SystemCoreClockUpdate();
+
+	return status;
+
+} /* End RCC_ClockResume() */
+
+
+/*
+ * No global variable here: .data and .bss are not initialized yet
+ * (SystemCoreClock is written by RCC_ClockConfig() but the startup
+ * updates it again after the copy). The code is compiled with the
+ * hard float ABI, the FPU must be on before any float instruction
+ * */
+void SystemInit(void){
+
+	SCB_CPACR |= SCB_CPACR_FPU_FULL;
+
+#if (RCC_STARTUP_168MHZ == 1)
+	RCC_ClockConfig(&RCC_Clock168MHz);
+#endif
+
+} /* End SystemInit() */
@@ -0,0 +1,122 @@
+
+#pragma once
+
+#include "stm32f407G.h"
+
+/*
+ * Clock values of the discovery board
+ *
+ * 	- HSI: internal RC oscillator, 16 MHz (reset default)
+ * 	- HSE: external crystal X2, 8 MHz on stm32f407 discovery
+ * */
+#define HSI_VALUE 16000000U
+#define HSE_VALUE 8000000U
+
+/*
+ * Current core clock (HCLK) in Hz, same name as in CMSIS
+ * (system_stm32f4xx.c) so code written for CMSIS can use it
+ * */
+extern uint32_t SystemCoreClock;
+
+/*
+ * Clock tree (section 6.2, figure 21)
+ *
+ * 	SYSCLK = PLL_in / M * N / P, 48 MHz domain (USB, SDIO, RNG) = PLL_in / M * N / Q
+ * 		- PLL_in / M: 1..2 MHz (2 MHz gives less jitter)
+ * 		- PLL_in / M * N (VCO): 100..432 MHz, N 50..432, M 2..63
+ * 		- P 2, 4, 6 or 8, Q 2..15 (48 MHz at most, exact for USB)
+ * 	HCLK = SYSCLK / AHB (168 MHz max), PCLK1 = HCLK / APB1 (42 MHz max),
+ * 	PCLK2 = HCLK / APB2 (84 MHz max)
+ *
+ * 	Flash wait states (table 10, 2.7..3.6 V): one per 30 MHz of HCLK,
+ * 	5 at 168 MHz. They must be set BEFORE a faster clock is selected,
+ * 	and only lowered AFTER a slower one. The ART accelerator (prefetch,
+ * 	instruction and data caches) hides most of them: code in a loop
+ * 	runs from the cache with 0 wait states
+ *
+ * 	RCC_ClockConfig():
+ * 		1. PLL M / N / P / Q computed (RCC_PLLCompute()) and limits checked
+ * 		2. HSE started (timeout: no crystal -> DRV_ERROR, clock unchanged)
+ * 		3. regulator in scale 1 (needed above 144 MHz)
+ * 		4. back to HSI while the PLL is changed
+ * 		5. PLL on, wait states, ART, AHB / APB prescalers, switch to PLL
+ * 		6. SystemCoreClock updated
+ *
+ * 	The peripherals compute their dividers from the RCC_GetxxxValue()
+ * 	functions at init: init them after the clock configuration
+ * */
+
+/*
+ * 1 -> SystemInit() (called by Reset_Handler before .data / .bss are
+ * initialized) configures RCC_Clock168MHz, so the rest of the startup
+ * already runs at 168 MHz. 0 -> the board stays on HSI 16 MHz.
+ * Without the crystal (HSE) the configuration fails and HSI stays
+ * */
+#define RCC_STARTUP_168MHZ 1
+
+#define RCC_SYSCLK_MAX  168000000U
+#define RCC_HCLK_MAX    168000000U
+#define RCC_PCLK1_MAX   42000000U
+#define RCC_PCLK2_MAX   84000000U
+#define RCC_USB_CLK     48000000U
+
+// ------------ Coding states for the clock configuration ------------
+
+typedef enum RCC_PLLSource {RCC_PLL_HSI, RCC_PLL_HSE} rcc_pll_src;
+
+
+typedef struct{
+
+	uint8_t RCC_PLLSource;
+	uint32_t RCC_SysClk;        // PLL output, Hz
+	uint16_t RCC_AHBDiv;        // 1, 2, 4, 8, 16, 64, 128, 256, 512
+	uint8_t RCC_APB1Div;        // 1, 2, 4, 8, 16
+	uint8_t RCC_APB2Div;        // 1, 2, 4, 8, 16
+
+} RCC_ClockConfig_t;
+
+
+typedef struct{
+
+	uint8_t M;
+	uint16_t N;
+	uint8_t P;
+	uint8_t Q;
+
+} RCC_PLL_t;
+
+
+// HSE 8 MHz -> 168 MHz, APB1 42 MHz, APB2 84 MHz, 48 MHz for USB
+extern const RCC_ClockConfig_t RCC_Clock168MHz;
+
+// ================== API ==================
+
+uint32_t RCC_GetSYSCLKValue(void);
+uint32_t RCC_GetHCLKValue(void);
+uint32_t RCC_GetPCLK1Value(void);
+uint32_t RCC_GetPCLK2Value(void);
+
+// Clock of the timers of APB1 (TIM2..7, 12..14) and APB2 (TIM1, 8..11)
+uint32_t RCC_GetTIMCLK1Value(void);
+uint32_t RCC_GetTIMCLK2Value(void);
+
+void SystemCoreClockUpdate(void);
+
+// Reset_Handler, before main(): FPU on, clock of RCC_STARTUP_168MHZ
+void SystemInit(void);
+
+// M / N / P / Q for SysClk from InputHz, Q for 48 MHz when possible
+drv_status RCC_PLLCompute(uint32_t InputHz, uint32_t SysClk, RCC_PLL_t *pPLL);
+
+// Flash wait states for a HCLK (Hz)
+uint8_t RCC_FlashLatency(uint32_t HClk);
+
+drv_status RCC_ClockConfig(const RCC_ClockConfig_t *pConfig);
+
+// Back to the reset clock: HSI 16 MHz, PLL off, no prescaler, 0 wait state
+void RCC_ClockReset(void);
+
+// After STOP: HSE / PLL / SYSCLK source of the saved RCC_CR and RCC_CFGR,
+// FromHSI = 1: the PLL restarts on HSI (same VCO input), no wait for the
+// crystal. DRV_ERROR: left on HSI, SystemCoreClock updated anyway
+drv_status RCC_ClockResume(uint32_t SavedCR, uint32_t SavedCFGR, uint8_t FromHSI);
@@ -0,0 +1,373 @@
+#include <stdio.h>
+#include <errno.h>
+#include "retarget.h"
+
+// stdio is global, so is the retarget
+static Retarget_Handle_t *retarget;
+
+
+// =============== Chunk handling ===============
+
+/*
+ * Who starts a chunk:
+ *
+ * 	- the application, inside Retarget_Write() / Retarget_Flush()
+ * 	- the completion ISR of the backend (Retarget_TxDone()), but only
+ * 	  when the application is not inside the retarget (in_write = 0),
+ * 	  so the ISR never swaps the halves under a memcpy
+ *
+ * 	When the application leaves, it checks again if a chunk is waiting,
+ * 	in case the completion came while in_write was 1
+ * */
+
+static void Retarget_StartChunk(Retarget_Handle_t *pHandle){
+
+	uint32_t len = pHandle->fill;
+
+	pHandle->flush_pending = 0;
+
+	if (len == 0)
+		return;
+
+	uint8_t *pChunk = &pHandle->pBuffer[pHandle->active * pHandle->HalfSize];
+
+	// all the state is updated before Send(), the completion may come early
+	pHandle->active ^= 1;
+	pHandle->fill = 0;
+	pHandle->chunks++;
+	pHandle->bytes_out += len;
+	pHandle->in_flight = 1;
+
+	if (!pHandle->Backend.Send(pHandle->Backend.pContext, pChunk, len))
+		pHandle->in_flight = 0;   // synchronous backend, already consumed
+
+} /* End Retarget_StartChunk() */
+
+
+static void Retarget_Leave(Retarget_Handle_t *pHandle){
+
+	pHandle->in_write = 0;
+	RB_BARRIER();
+
+	if (pHandle->flush_pending && !pHandle->in_flight)
+		Retarget_StartChunk(pHandle);
+
+} /* End Retarget_Leave() */
+
+// =========================================================
+
+
+drv_status Retarget_Init(Retarget_Handle_t *pHandle){
+
+	if (pHandle->pBuffer == 0 || pHandle->BufferSize < 2 ||
+		pHandle->Backend.Send == 0)
+		return DRV_ERROR;
+
+	// a DMA transfer is limited to 65535 items (NDTR is 16 bits)
+	pHandle->HalfSize = pHandle->BufferSize / 2;
+
+	if (pHandle->HalfSize > 0xFFFF)
+		pHandle->HalfSize = 0xFFFF;
+
+	pHandle->active = 0;
+	pHandle->fill = 0;
+	pHandle->in_flight = 0;
+	pHandle->flush_pending = 0;
+	pHandle->in_write = 0;
+	pHandle->bytes_out = 0;
+	pHandle->bytes_lost = 0;
+	pHandle->chunks = 0;
+
+	retarget = pHandle;
+
+	/*
+	 * newlib has its own buffer on stdout (flushed byte by byte to
+	 * _write() with line buffering), remove it: the buffering is done here
+	 * */
+	setvbuf(stdout, NULL, _IONBF, 0);
+
+	return DRV_OK;
+
+} /* End Retarget_Init() */
+
+
+uint32_t Retarget_Write(const uint8_t *pData, uint32_t Len){
+
+	Retarget_Handle_t *pHandle = retarget;
+
+	if (pHandle == 0)
+		return Len;
+
+	pHandle->in_write = 1;
+	RB_BARRIER();
+
+	uint32_t done = 0;
+
+	while (done < Len){
+
+		uint32_t room = pHandle->HalfSize - pHandle->fill;
+
+		if (room == 0){
+
+			if (!pHandle->in_flight){
+				Retarget_StartChunk(pHandle);
+				continue;
+			}
+
+			// full and the other half is busy: it goes out on TxDone
+			pHandle->flush_pending = 1;
+
+			if (pHandle->Policy == RETARGET_POLICY_BLOCK){
+
+				// let the ISR start the full half, then go on
+				pHandle->in_write = 0;
+				while (pHandle->in_flight && pHandle->fill == pHandle->HalfSize);
+				pHandle->in_write = 1;
+				RB_BARRIER();
+
+			} else if (pHandle->Policy == RETARGET_POLICY_OVERWRITE){
+
+				pHandle->bytes_lost += pHandle->fill;
+				pHandle->fill = 0;
+
+			} else {
+
+				pHandle->bytes_lost += Len - done;
+				break;
+
+			} /* End if-else policy */
+
+			continue;
+
+		} /* End if room == 0 */
+
+		uint32_t n = (Len - done < room) ? (Len - done) : room;
+
+		memcpy(&pHandle->pBuffer[pHandle->active * pHandle->HalfSize + pHandle->fill],
+			   &pData[done], n);
+
+		if (pHandle->Buffering == RETARGET_BUF_LINE &&
+			memchr(&pData[done], '\n', n) != 0)
+			pHandle->flush_pending = 1;
+
+		pHandle->fill += n;
+		done += n;
+
+	} /* End while */
+
+	if (pHandle->Buffering == RETARGET_BUF_NONE)
+		pHandle->flush_pending = 1;
+
+	if (pHandle->flush_pending && !pHandle->in_flight)
+		Retarget_StartChunk(pHandle);
+
+	Retarget_Leave(pHandle);
+
+	// the caller never retries: lost bytes are counted, not reported
+	return Len;
+
+} /* End Retarget_Write() */
+
+
+void Retarget_Flush(void){
+
+	Retarget_Handle_t *pHandle = retarget;
+
+	if (pHandle == 0)
+		return;
+
+	pHandle->in_write = 1;
+	RB_BARRIER();
+
+	pHandle->flush_pending = 1;
+
+	if (!pHandle->in_flight)
+		Retarget_StartChunk(pHandle);
+
+	Retarget_Leave(pHandle);
+
+} /* End Retarget_Flush() */
+
+
+void Retarget_TxDone(void){
+
+	Retarget_Handle_t *pHandle = retarget;
+
+	pHandle->in_flight = 0;
+
+	if (!pHandle->in_write && pHandle->flush_pending)
+		Retarget_StartChunk(pHandle);
+
+} /* End Retarget_TxDone() */
+
+
+uint32_t Retarget_Read(uint8_t *pData, uint32_t Len){
+
+	Retarget_Handle_t *pHandle = retarget;
+
+	if (pHandle == 0 || pHandle->Backend.Read == 0)
+		return 0;
+
+	return pHandle->Backend.Read(pHandle->Backend.pContext, pData, Len);
+
+} /* End Retarget_Read() */
+
+
+// =============== newlib hooks (replace the weak ones of syscalls.c) ===============
+
+int _write(int file, char *ptr, int len){
+
+	if (file != 1 && file != 2){
+		errno = EBADF;
+		return -1;
+	}
+
+	Retarget_Write((const uint8_t*)ptr, len);
+
+	// stderr is never kept in the buffer
+	if (file == 2)
+		Retarget_Flush();
+
+	return len;
+
+} /* End _write() */
+
+
+int _read(int file, char *ptr, int len){
+
+	if (file != 0){
+		errno = EBADF;
+		return -1;
+	}
+
+	if (retarget == 0 || retarget->Backend.Read == 0)
+		return 0;   // end of file
+
+	// scanf() needs at least one byte, 0 would mean end of file
+	uint32_t n;
+
+	while ((n = Retarget_Read((uint8_t*)ptr, len)) == 0);
+
+	return n;
+
+} /* End _read() */
+
+
+// =============== USART DMA backend ===============
+
+static USART_TxDesc_t retarget_usart_desc;
+
+static uint8_t retarget_usart_rx_storage[64];
+static RingBuffer_t retarget_usart_rx;
+
+static void Retarget_UsartTxDone(USART_TxDesc_t *pDesc){
+
+	Retarget_TxDone();
+
+} /* End Retarget_UsartTxDone() */
+
+static uint8_t Retarget_UsartSend(void *pContext, const uint8_t *pData, uint32_t Len){
+
+	retarget_usart_desc.pData = pData;
+	retarget_usart_desc.Len = (uint16_t)Len;
+	retarget_usart_desc.Done = Retarget_UsartTxDone;
+
+	// refused (double buffer mode running): the chunk is lost
+	if (USART_DMA_Submit((USART_DMA_Handle_t*)pContext, &retarget_usart_desc) != DRV_OK)
+		return 0;
+
+	return 1;
+
+} /* End Retarget_UsartSend() */
+
+static uint32_t Retarget_UsartRead(void *pContext, uint8_t *pData, uint32_t Len){
+
+	return RingBuffer_Read(&retarget_usart_rx, pData, Len);
+
+} /* End Retarget_UsartRead() */
+
+void Retarget_UsartRxCallback(USART_DMA_Handle_t *pHandle,
+							  const uint8_t *pData, uint16_t Len){
+
+	uint32_t written = RingBuffer_Write(&retarget_usart_rx, pData, Len);
+
+	if (written < Len)
+		pHandle->rx_overwritten += Len - written;
+
+} /* End Retarget_UsartRxCallback() */
+
+void Retarget_UsartDmaBackend(Retarget_Handle_t *pHandle,
+							  USART_DMA_Handle_t *pUSARTDMAHandle){
+
+	RingBuffer_Init(&retarget_usart_rx, retarget_usart_rx_storage,
+					sizeof(retarget_usart_rx_storage));
+
+	pHandle->Backend.Send = Retarget_UsartSend;
+	pHandle->Backend.Read = Retarget_UsartRead;
+	pHandle->Backend.pContext = pUSARTDMAHandle;
+
+} /* End Retarget_UsartDmaBackend() */
+
+
+// =============== ITM backend ===============
+
+static uint8_t Retarget_ItmSend(void *pContext, const uint8_t *pData, uint32_t Len){
+
+	// no debugger listening: nothing to wait for
+	if (!(ITM->TCR & ITM_TCR_ITMENA) || !(ITM->TER & 1))
+		return 0;
+
+	for (uint32_t i = 0; i < Len; ++i){
+
+		while (ITM->STIM[0] == 0);                 // FIFO full
+		*(__vo uint8_t*)&ITM->STIM[0] = pData[i];  // 8 bit write = 1 byte packet
+
+	}
+
+	return 0;
+
+} /* End Retarget_ItmSend() */
+
+void Retarget_ItmBackend(Retarget_Handle_t *pHandle){
+
+	pHandle->Backend.Send = Retarget_ItmSend;
+	pHandle->Backend.Read = 0;
+	pHandle->Backend.pContext = 0;
+
+} /* End Retarget_ItmBackend() */
+
+
+// =============== RAM log backend ===============
+
+static uint8_t Retarget_RamLogSend(void *pContext, const uint8_t *pData, uint32_t Len){
+
+	Retarget_RamLog_t *pLog = (Retarget_RamLog_t*)pContext;
+
+	for (uint32_t i = 0; i < Len; ++i){
+
+		pLog->pLog[pLog->head++] = (char)pData[i];
+
+		if (pLog->head == pLog->Size){
+			pLog->head = 0;
+			pLog->wrapped = 1;
+		}
+
+	} /* End for */
+
+	return 0;
+
+} /* End Retarget_RamLogSend() */
+
+void Retarget_RamLogBackend(Retarget_Handle_t *pHandle, Retarget_RamLog_t *pLog,
+							char *pStorage, uint32_t Size){
+
+	pLog->pLog = pStorage;
+	pLog->Size = Size;
+	pLog->head = 0;
+	pLog->wrapped = 0;
+
+	pHandle->Backend.Send = Retarget_RamLogSend;
+	pHandle->Backend.Read = 0;
+	pHandle->Backend.pContext = pLog;
+
+} /* End Retarget_RamLogBackend() */
@@ -0,0 +1,153 @@
+
+#pragma once
+
+#include "stm32f407G.h"
+#include "ring_buffer.h"
+#include "usart_dma.h"
+
+/*
+ * Goal: printf() / scanf() without stalling the caller
+ *
+ * The _write() of syscalls.c calls __io_putchar() once per byte, so a
+ * printf() costs the time of the whole line on the wire. Here _write()
+ * and _read() are redefined (the ones of syscalls.c are weak):
+ *
+ * 	- the output is copied in a staging buffer and sent in one chunk
+ * 	  to a backend (USART DMA, ITM or a RAM log)
+ * 	- the staging memory is split in 2 halves: one is filled while
+ * 	  the other one is being sent by the backend
+ * 	- when the half being filled is full and the other one is still
+ * 	  in flight, the policy decides (the caller never waits, except
+ * 	  with RETARGET_POLICY_BLOCK):
+ * 		- DROP: the new bytes are lost
+ * 		- OVERWRITE: the bytes waiting in the buffer are lost,
+ * 		  the new ones take their place
+ *
+ * When is the buffer sent (Buffering):
+ * 	- RETARGET_BUF_NONE: at the end of every _write() (every printf)
+ * 	- RETARGET_BUF_LINE: when a '\n' was written
+ * 	- RETARGET_BUF_FULL: only when full, or by Retarget_Flush()
+ *
+ * A chunk which could not start because the backend was busy is started
+ * by the backend completion (Retarget_TxDone()), no polling needed
+ *
+ * Usage:
+ *
+ * 		static uint8_t stdio_buf[512];
+ * 		Retarget_Handle_t stdio;
+ *
+ * 		stdio.pBuffer = stdio_buf;
+ * 		stdio.BufferSize = sizeof(stdio_buf);
+ * 		stdio.Buffering = RETARGET_BUF_LINE;
+ * 		stdio.Policy = RETARGET_POLICY_DROP;
+ * 		Retarget_UsartDmaBackend(&stdio, &usart2_dma);
+ * 		Retarget_Init(&stdio);
+ *
+ * 		printf("adc = %d\n", value);   // returns as soon as it is copied
+ *
+ * */
+
+// ------------ Coding states for the retarget configuration ------------
+
+typedef enum Retarget_Buffering {RETARGET_BUF_NONE, RETARGET_BUF_LINE,
+								 RETARGET_BUF_FULL} retarget_buffering;
+
+typedef enum Retarget_Policy {RETARGET_POLICY_DROP, RETARGET_POLICY_OVERWRITE,
+							  RETARGET_POLICY_BLOCK} retarget_policy;
+
+
+/*
+ * Backend: where the chunks go
+ *
+ * 	- Send() starts the output of [pData, pData + Len) and returns
+ * 		- 1 when the transfer goes on in the background: the backend
+ * 		  must call Retarget_TxDone() once the buffer can be reused
+ * 		- 0 when the data was already fully consumed (ITM, RAM log)
+ * 	- Read() is non blocking and returns the nb of bytes copied,
+ * 	  it can be 0 for an output only backend
+ * */
+typedef struct{
+
+	uint8_t (*Send)(void *pContext, const uint8_t *pData, uint32_t Len);
+	uint32_t (*Read)(void *pContext, uint8_t *pData, uint32_t Len);
+	void *pContext;
+
+} Retarget_Backend_t;
+
+
+typedef struct{
+
+	// Filled by the user
+	uint8_t *pBuffer;
+	uint32_t BufferSize;       // split in 2 halves
+	uint8_t Buffering;
+	uint8_t Policy;
+	Retarget_Backend_t Backend;
+
+	// Filled by the driver
+	uint32_t HalfSize;
+	uint8_t active;            // half being filled
+	uint32_t fill;             // bytes in the active half
+	__vo uint8_t in_flight;    // the other half is being sent
+	__vo uint8_t flush_pending;
+	__vo uint8_t in_write;     // the application is inside the retarget
+
+	__vo uint32_t bytes_out;   // statistics
+	__vo uint32_t bytes_lost;
+	__vo uint32_t chunks;
+
+} Retarget_Handle_t;
+
+
+// ------------ RAM log backend ------------
+
+/*
+ * Circular log in RAM, the oldest text is overwritten
+ * Read it with the debugger (Memory view) or after a reset
+ * if the section is not cleared at startup
+ * */
+typedef struct{
+
+	char *pLog;
+	uint32_t Size;
+	uint32_t head;      // next write position
+	uint8_t wrapped;    // 1 once the log was full one time
+
+} Retarget_RamLog_t;
+
+
+// ================== API ==================
+
+drv_status Retarget_Init(Retarget_Handle_t *pHandle);
+
+// Start the active buffer now, if the backend is free
+void Retarget_Flush(void);
+
+// Called by an asynchronous backend once the chunk is sent (ISR context)
+void Retarget_TxDone(void);
+
+uint32_t Retarget_Write(const uint8_t *pData, uint32_t Len);
+
+uint32_t Retarget_Read(uint8_t *pData, uint32_t Len);
+
+
+// Backends, to call before Retarget_Init()
+
+/*
+ * USART DMA: TX through USART_DMA_Submit() (USART_DMA_TxInit() done before)
+ * RX: give Retarget_UsartRxCallback to USART_DMA_RxStart(), the bytes are
+ * copied in an internal ring read by scanf() (RxAutoRelease = ON, bytes
+ * which don't fit in the ring are counted in rx_overwritten)
+ * */
+void Retarget_UsartDmaBackend(Retarget_Handle_t *pHandle,
+							  USART_DMA_Handle_t *pUSARTDMAHandle);
+
+void Retarget_UsartRxCallback(USART_DMA_Handle_t *pHandle,
+							  const uint8_t *pData, uint16_t Len);
+
+// ITM stimulus port 0 (SWO), output only
+void Retarget_ItmBackend(Retarget_Handle_t *pHandle);
+
+// RAM log, output only
+void Retarget_RamLogBackend(Retarget_Handle_t *pHandle, Retarget_RamLog_t *pLog,
+							char *pStorage, uint32_t Size);
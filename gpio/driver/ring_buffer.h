@@ -0,0 +1,158 @@
+
+/*
+ * Goal: single producer / single consumer ring buffer
+ * used between an ISR and the application (no lock needed)
+ *
+ * 	- the size must be a power of 2, so the index wrap is
+ * 	  a simple mask (idx & (size-1)) instead of a modulo
+ * 	- head and tail are free running counters:
+ * 		- head is only written by the producer
+ * 		- tail is only written by the consumer
+ * 		- used bytes = head - tail (correct even after overflow
+ * 		  of the 32 bit counters, thanks to unsigned arithmetic)
+ * 	- the data is written before head is moved (and read before tail
+ * 	  is moved), the "dmb" makes sure the other side never sees the
+ * 	  new index before the data
+ *
+ * */
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include "stm32f407G.h"
+
+typedef struct{
+
+	uint8_t *buffer;       // storage given by the user
+	uint32_t mask;         // size - 1
+	__vo uint32_t head;    // next write position (producer)
+	__vo uint32_t tail;    // next read position (consumer)
+
+} RingBuffer_t;
+
+#define RB_BARRIER() __asm volatile ("dmb" : : : "memory")
+
+#define RB_IS_POWER_OF_2(x) (((x) != 0) && (((x) & ((x) - 1)) == 0))
+
+
+static inline drv_status RingBuffer_Init(RingBuffer_t *rb,
+										 uint8_t *storage, uint32_t size){
+
+	if (!RB_IS_POWER_OF_2(size))
+		return DRV_ERROR;
+
+	rb->buffer = storage;
+	rb->mask = size - 1;
+	rb->head = 0;
+	rb->tail = 0;
+
+	return DRV_OK;
+
+} /* End RingBuffer_Init() */
+
+static inline uint32_t RingBuffer_Used(const RingBuffer_t *rb){
+
+	return rb->head - rb->tail;
+
+} /* End RingBuffer_Used() */
+
+static inline uint32_t RingBuffer_Free(const RingBuffer_t *rb){
+
+	return (rb->mask + 1) - (rb->head - rb->tail);
+
+} /* End RingBuffer_Free() */
+
+
+// ------------------ Single byte (ISR side) ------------------
+
+static inline uint8_t RingBuffer_Put(RingBuffer_t *rb, uint8_t data){
+
+	uint32_t head = rb->head;
+
+	if ((head - rb->tail) > rb->mask)
+		return 0; // full
+
+	rb->buffer[head & rb->mask] = data;
+	RB_BARRIER();
+	rb->head = head + 1;
+
+	return 1;
+
+} /* End RingBuffer_Put() */
+
+static inline uint8_t RingBuffer_Get(RingBuffer_t *rb, uint8_t *data){
+
+	uint32_t tail = rb->tail;
+
+	if (rb->head == tail)
+		return 0; // empty
+
+	RB_BARRIER();
+	*data = rb->buffer[tail & rb->mask];
+	RB_BARRIER();
+	rb->tail = tail + 1;
+
+	return 1;
+
+} /* End RingBuffer_Get() */
+
+
+// ------------------ Bulk (application side) ------------------
+
+/*
+ * Copy as many bytes as possible (at most 2 memcpy, one before
+ * and one after the wrap), return the nb of bytes really copied
+ * */
+
+static inline uint32_t RingBuffer_Write(RingBuffer_t *rb,
+										const uint8_t *data, uint32_t len){
+
+	uint32_t head = rb->head;
+	uint32_t free_space = (rb->mask + 1) - (head - rb->tail);
+
+	if (len > free_space)
+		len = free_space;
+
+	uint32_t idx = head & rb->mask;
+	uint32_t first = (rb->mask + 1) - idx;
+
+	if (first > len)
+		first = len;
+
+	memcpy(&rb->buffer[idx], data, first);
+	memcpy(&rb->buffer[0], data + first, len - first);
+
+	RB_BARRIER();
+	rb->head = head + len;
+
+	return len;
+
+} /* End RingBuffer_Write() */
+
+static inline uint32_t RingBuffer_Read(RingBuffer_t *rb,
+									   uint8_t *data, uint32_t len){
+
+	uint32_t tail = rb->tail;
+	uint32_t used = rb->head - tail;
+
+	if (len > used)
+		len = used;
+
+	RB_BARRIER(); // don't read the data before head
+
+	uint32_t idx = tail & rb->mask;
+	uint32_t first = (rb->mask + 1) - idx;
+
+	if (first > len)
+		first = len;
+
+	memcpy(data, &rb->buffer[idx], first);
+	memcpy(data + first, &rb->buffer[0], len - first);
+
+	RB_BARRIER();
+	rb->tail = tail + len;
+
+	return len;
+
+} /* End RingBuffer_Read() */
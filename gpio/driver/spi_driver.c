@@ -0,0 +1,465 @@
+#include "spi_driver.h"
+#include "gpio_driver.h"
+#include "nvic_driver.h"
+#include "clock_gate.h"
+#include "dvfs.h"
+
+
+// =============== Clock, reset and DMA requests of each SPI ===============
+
+/*
+ * 	- on_apb2 / bit: position in RCC_APBxENR and RCC_APBxRSTR
+ * 	  (sections 7.3.13, 7.3.14, 7.3.5 and 7.3.6)
+ * 	- DMA streams: tables 42 and 43 of the reference manual, the
+ * 	  streams are chosen so they don't overlap the USART2 ones
+ * */
+
+typedef struct{
+	SPI_RegDef_t *base;
+	uint8_t on_apb2;
+	uint8_t bit;
+	DMA_RegDef_t *dma;
+	uint8_t rx_stream;
+	uint8_t tx_stream;
+	uint8_t channel;
+} SPI_Map;
+
+static const SPI_Map spi_map[] = {
+	{SPI1, 1, 12, DMA2, 2, 3, 3},
+	{SPI2, 0, 14, DMA1, 3, 4, 0},
+	{SPI3, 0, 15, DMA1, 0, 7, 0}
+};
+
+#define NB_SPI (sizeof(spi_map)/sizeof(spi_map[0]))
+
+// Clocks held by the driver (clock_gate.h)
+static uint32_t spi_clk_held[2];          // [on_apb2], until SPI_DeInit()
+static uint32_t spi_cs_port_held;         // CS pins, not tied to one SPI
+
+static const SPI_Map *SPI_FindMap(SPI_RegDef_t *pSPIx){
+
+	for (int i = 0; i < NB_SPI; ++i) {
+		if (spi_map[i].base == pSPIx)
+			return &spi_map[i];
+	}
+
+	return 0;
+
+} /* End SPI_FindMap() */
+
+
+// SPI1 on APB2, SPI2 / SPI3 on APB1
+static uint32_t SPI_GetPCLK(const SPI_Map *map){
+
+	return map->on_apb2 ? RCC_GetPCLK2Value() : RCC_GetPCLK1Value();
+
+} /* End SPI_GetPCLK() */
+
+
+// BR can't be changed while a frame is going out, SPE off meanwhile
+static void SPI_WriteBR(SPI_RegDef_t *pSPIx, uint8_t Prescaler){
+
+	while (pSPIx->SR & (1 << SPI_SR_BSY));
+
+	pSPIx->CR1 &= ~(1 << SPI_CR1_SPE);
+	pSPIx->CR1 = (pSPIx->CR1 & ~(0x7 << SPI_CR1_BR)) | ((uint32_t)(Prescaler & 0x7) << SPI_CR1_BR);
+	pSPIx->CR1 |= (1 << SPI_CR1_SPE);
+
+} /* End SPI_WriteBR() */
+
+
+// Dummy frames for pTx = 0 / pRx = 0 (16 bits, also fine for 8 bits frames)
+static const uint16_t spi_dummy_tx = 0xFFFF;
+static uint16_t spi_dummy_rx;
+
+
+// Chip select through BSRR: bits 0..15 set the pin, bits 16..31 reset it
+static inline void SPI_CSLow(SPI_Transaction_t *pTrans){
+
+	if (pTrans->pCSPort)
+		pTrans->pCSPort->BSRR = (1U << (pTrans->CSPin + 16));
+
+} /* End SPI_CSLow() */
+
+static inline void SPI_CSHigh(SPI_Transaction_t *pTrans){
+
+	if (pTrans->pCSPort)
+		pTrans->pCSPort->BSRR = (1U << pTrans->CSPin);
+
+} /* End SPI_CSHigh() */
+
+
+/*
+ * DMA_Start() refuses a CCM buffer (mem_sections.h) or a stream still
+ * enabled: nothing stays started and CS goes back high
+ * */
+static drv_status SPI_StartTransaction(SPI_Handle_t *pSPIHandle, SPI_Transaction_t *pTrans){
+
+	/*
+	 * 1. A missing buffer is replaced by one dummy item, the memory
+	 *    address then must not move (MINC off)
+	 * */
+	DMA_SetMemoryIncrement(&pSPIHandle->rx_dma, pTrans->pRx ? ON : OFF);
+	DMA_SetMemoryIncrement(&pSPIHandle->tx_dma, pTrans->pTx ? ON : OFF);
+
+	uint32_t rx_addr = pTrans->pRx ? (uint32_t)pTrans->pRx : (uint32_t)&spi_dummy_rx;
+	uint32_t tx_addr = pTrans->pTx ? (uint32_t)pTrans->pTx : (uint32_t)&spi_dummy_tx;
+
+	SPI_CSLow(pTrans);
+
+	/*
+	 * 2. RX stream first (section 28.3.9): once the TX stream runs,
+	 *    every frame sent brings one frame back
+	 * */
+	drv_status status = DMA_Start(&pSPIHandle->rx_dma, (uint32_t)&pSPIHandle->pSPIx->DR,
+								  rx_addr, 0, pTrans->Len);
+
+	if (status == DRV_OK){
+
+		status = DMA_Start(&pSPIHandle->tx_dma, (uint32_t)&pSPIHandle->pSPIx->DR,
+						   tx_addr, 0, pTrans->Len);
+
+		if (status != DRV_OK)
+			DMA_Stop(&pSPIHandle->rx_dma);
+
+	}
+
+	if (status != DRV_OK)
+		SPI_CSHigh(pTrans);
+
+	return status;
+
+} /* End SPI_StartTransaction() */
+
+
+/*
+ * The RX stream ends after the TX one, its transfer complete
+ * is the end of the transaction (last frame clocked in)
+ * */
+static void SPI_RxCallback(DMA_Handle_t *pDMAHandle, uint8_t event){
+
+	SPI_Handle_t *pSPIHandle = (SPI_Handle_t*)pDMAHandle->pContext;
+	SPI_Transaction_t *pDone = pSPIHandle->pHead;
+
+	if (pDone == 0 || event == DMA_EVENT_HALF_TRANSFER)
+		return;
+
+	if (event == DMA_EVENT_ERROR){
+
+		DMA_Stop(&pSPIHandle->tx_dma);
+		DMA_Stop(&pSPIHandle->rx_dma);
+
+		pDone->Status = DRV_ERROR;
+		pSPIHandle->errors++;
+		SPI_CSHigh(pDone);
+
+	} else {
+
+		pDone->Status = DRV_OK;
+		pSPIHandle->transactions++;
+		pSPIHandle->frames += pDone->Len;
+
+		if (pDone->KeepCS != ON)
+			SPI_CSHigh(pDone);
+
+	} /* End if-else error */
+
+	// chain the next transaction before calling Done, a refused one ends in error
+	SPI_Transaction_t *pRefused = pDone->pNext;
+	SPI_Transaction_t *pNext = pRefused;
+
+	while (pNext && SPI_StartTransaction(pSPIHandle, pNext) != DRV_OK){
+		pNext->Status = DRV_ERROR;
+		pSPIHandle->errors++;
+		pNext = pNext->pNext;
+	}
+
+	pSPIHandle->pHead = pNext;
+
+	if (pNext == 0)
+		pSPIHandle->pTail = 0;
+
+	if (pDone->Done)
+		pDone->Done(pDone);
+
+	// the refused ones, in the queue order
+	while (pRefused != pNext){
+
+		SPI_Transaction_t *pFollow = pRefused->pNext;
+
+		if (pRefused->Done)
+			pRefused->Done(pRefused);
+
+		pRefused = pFollow;
+
+	} /* End while refused */
+
+} /* End SPI_RxCallback() */
+
+
+static void SPI_TxCallback(DMA_Handle_t *pDMAHandle, uint8_t event){
+
+	// the end of the transaction is seen on the RX side, only errors here
+	if (event == DMA_EVENT_ERROR)
+		SPI_RxCallback(&((SPI_Handle_t*)pDMAHandle->pContext)->rx_dma, event);
+
+} /* End SPI_TxCallback() */
+
+
+static void SPI_DMAConfig(DMA_Handle_t *pDMA, SPI_Handle_t *pSPIHandle,
+						  const SPI_Map *map, uint8_t stream, uint8_t dir){
+
+	uint8_t size = (pSPIHandle->SPI_Config.SPI_FrameSize == SPI_FRAME_16BITS) ?
+				   DMA_SIZE_HALFWORD : DMA_SIZE_BYTE;
+
+	pDMA->pDMAx = map->dma;
+	pDMA->Stream = stream;
+	pDMA->DMA_Config.DMA_Channel = map->channel;
+	pDMA->DMA_Config.DMA_Direction = dir;
+	pDMA->DMA_Config.DMA_PeriphInc = OFF;
+	pDMA->DMA_Config.DMA_MemInc = ON;
+	pDMA->DMA_Config.DMA_PeriphDataSize = size;
+	pDMA->DMA_Config.DMA_MemDataSize = size;
+	pDMA->DMA_Config.DMA_Circular = OFF;
+	pDMA->DMA_Config.DMA_DoubleBuffer = OFF;
+	// RX above TX: a late RX read is an overrun, a late TX write only a gap
+	pDMA->DMA_Config.DMA_Priority = (dir == DMA_DIR_PERIPH_TO_MEM) ?
+									DMA_PRIO_VERY_HIGH : DMA_PRIO_HIGH;
+	pDMA->DMA_Config.DMA_HalfTransferIT = OFF;
+	pDMA->DMA_Config.DMA_FIFOMode = OFF;
+	pDMA->pContext = pSPIHandle;
+
+} /* End SPI_DMAConfig() */
+
+// =========================================================
+
+
+void SPI_PeriClockControl(SPI_RegDef_t *pSPIx, uint8_t ON_OFF){
+
+	const SPI_Map *map = SPI_FindMap(pSPIx);
+
+	if (map == 0)
+		return;
+
+	CLK_PeriClockControl(map->on_apb2 ? CLK_APB2 : CLK_APB1, map->bit, ON_OFF);
+
+} /* End SPI_PeriClockControl() */
+
+
+void SPI_DeInit(SPI_RegDef_t *pSPIx){
+
+	// same principle as GPIOx_RESET(): set then clear the reset bit
+	const SPI_Map *map = SPI_FindMap(pSPIx);
+
+	if (map == 0)
+		return;
+
+	__vo uint32_t *rstr = map->on_apb2 ? &RCC->APB2RSTR : &RCC->APB1RSTR;
+
+	*rstr |= (1 << map->bit);
+	*rstr &= ~(1 << map->bit);
+
+	CLK_Drop(&spi_clk_held[map->on_apb2], map->on_apb2 ? CLK_APB2 : CLK_APB1, map->bit);
+
+} /* End SPI_DeInit() */
+
+
+drv_status SPI_Init(SPI_Handle_t *pSPIHandle){
+
+	SPI_RegDef_t *pSPIx = pSPIHandle->pSPIx;
+	SPI_Config_t *pConf = &pSPIHandle->SPI_Config;
+
+	const SPI_Map *map = SPI_FindMap(pSPIx);
+
+	if (map == 0)
+		return DRV_ERROR;
+
+	pSPIHandle->pHead = 0;
+	pSPIHandle->pTail = 0;
+	pSPIHandle->transactions = 0;
+	pSPIHandle->frames = 0;
+	pSPIHandle->errors = 0;
+
+	// divider 2 << BR
+	pSPIHandle->SckHz = SPI_GetPCLK(map) >> ((pConf->SPI_Prescaler & 0x7) + 1);
+
+	CLK_Hold(&spi_clk_held[map->on_apb2], map->on_apb2 ? CLK_APB2 : CLK_APB1, map->bit);
+
+	/*
+	 * 1. CR1 (SPE off while configuring, section 28.3.3)
+	 * 	- master, software NSS: SSM = 1 and SSI = 1, otherwise the
+	 * 	  SPI sees NSS low and falls back to slave (mode fault)
+	 * */
+	uint32_t cr1 = (1 << SPI_CR1_MSTR) | (1 << SPI_CR1_SSM) | (1 << SPI_CR1_SSI);
+
+	cr1 |= ((uint32_t)(pConf->SPI_Prescaler & 0x7) << SPI_CR1_BR);
+	cr1 |= ((uint32_t)(pConf->SPI_Mode & 0x3) << SPI_CR1_CPHA); // CPHA bit 0, CPOL bit 1
+
+	if (pConf->SPI_FrameSize == SPI_FRAME_16BITS)
+		cr1 |= (1 << SPI_CR1_DFF);
+
+	if (pConf->SPI_LSBFirst == ON)
+		cr1 |= (1 << SPI_CR1_LSBFIRST);
+
+	pSPIx->CR1 = cr1;
+
+	// 2. The DMA streams, same ceiling for both (same IRQ level in the plan)
+	SPI_DMAConfig(&pSPIHandle->rx_dma, pSPIHandle, map, map->rx_stream, DMA_DIR_PERIPH_TO_MEM);
+	pSPIHandle->rx_dma.Callback = SPI_RxCallback;
+
+	SPI_DMAConfig(&pSPIHandle->tx_dma, pSPIHandle, map, map->tx_stream, DMA_DIR_MEM_TO_PERIPH);
+	pSPIHandle->tx_dma.Callback = SPI_TxCallback;
+
+	drv_status status = DMA_Init(&pSPIHandle->rx_dma);
+
+	if (status == DRV_OK){
+
+		status = DMA_Init(&pSPIHandle->tx_dma);
+
+		if (status != DRV_OK)
+			DMA_Release(&pSPIHandle->rx_dma);
+
+	}
+
+	// no SPI without its streams: its clock reference goes back
+	if (status != DRV_OK){
+		CLK_Drop(&spi_clk_held[map->on_apb2], map->on_apb2 ? CLK_APB2 : CLK_APB1, map->bit);
+		return status;
+	}
+
+	pSPIHandle->ceiling = NVIC_GetCeiling(DMA_GetIRQNumber(map->dma, map->rx_stream));
+
+	/*
+	 * 3. DMA requests always on: nothing happens as long as
+	 *    the streams are disabled
+	 * */
+	pSPIx->CR2 = (1 << SPI_CR2_RXDMAEN) | (1 << SPI_CR2_TXDMAEN);
+
+	pSPIx->CR1 |= (1 << SPI_CR1_SPE);
+
+	return DRV_OK;
+
+} /* End SPI_Init() */
+
+
+drv_status SPI_SetPrescaler(SPI_Handle_t *pSPIHandle, uint8_t Prescaler){
+
+	const SPI_Map *map = SPI_FindMap(pSPIHandle->pSPIx);
+
+	if (map == 0)
+		return DRV_ERROR;
+
+	if (!SPI_Idle(pSPIHandle))
+		return DRV_BUSY;
+
+	SPI_WriteBR(pSPIHandle->pSPIx, Prescaler);
+
+	pSPIHandle->SPI_Config.SPI_Prescaler = Prescaler;
+	pSPIHandle->SckHz = SPI_GetPCLK(map) >> ((Prescaler & 0x7) + 1);
+
+	return DRV_OK;
+
+} /* End SPI_SetPrescaler() */
+
+
+void SPI_CSPinInit(GPIO_RegDef_t *pGPIOx, uint8_t PinNumber){
+
+	GPIO_Handle_t cs;
+
+	GPIO_ClockHold(pGPIOx, &spi_cs_port_held);
+
+	// high first, so the pin never goes low when it becomes an output
+	pGPIOx->BSRR = (1U << PinNumber);
+
+	cs.gpio_reg_x = pGPIOx;
+	cs.gpio_pin_conf.GPIO_PinNumber = PinNumber;
+	cs.gpio_pin_conf.GPIO_PinMode = OUT;
+	cs.gpio_pin_conf.GPIO_PinSpeed = VERY;
+	cs.gpio_pin_conf.GPIO_PinOPType = PUSH_PULL;
+	cs.gpio_pin_conf.GPIO_PinPuPdControl = NO_PULLUP;
+	cs.gpio_pin_conf.GPIO_PinAltFunMode = 0;
+
+	GPIO_Init(&cs);
+
+} /* End SPI_CSPinInit() */
+
+
+drv_status SPI_Submit(SPI_Handle_t *pSPIHandle, SPI_Transaction_t *pTrans){
+
+	if (pTrans->Len == 0)
+		return DRV_ERROR;
+
+	drv_status status = DRV_OK;
+
+	pTrans->pNext = 0;
+	pTrans->Status = DRV_BUSY;
+
+	uint32_t state = IRQ_EnterCritical(pSPIHandle->ceiling);
+
+	if (pSPIHandle->pTail){
+
+		// a transaction is running, the ISR will start this one
+		pSPIHandle->pTail->pNext = pTrans;
+		pSPIHandle->pTail = pTrans;
+
+	} else {
+
+		pSPIHandle->pHead = pTrans;
+		pSPIHandle->pTail = pTrans;
+
+		status = SPI_StartTransaction(pSPIHandle, pTrans);
+
+		// refused: not left in the queue, no DMA interrupt will end it
+		if (status != DRV_OK){
+			pSPIHandle->pHead = 0;
+			pSPIHandle->pTail = 0;
+			pTrans->Status = DRV_ERROR;
+		}
+
+	} /* End if-else queue empty */
+
+	IRQ_ExitCritical(state);
+
+	return status;
+
+} /* End SPI_Submit() */
+
+
+uint8_t SPI_Idle(SPI_Handle_t *pSPIHandle){
+
+	return pSPIHandle->pHead == 0;
+
+} /* End SPI_Idle() */
+
+
+/*
+ * Clock change (dvfs.h): SCK = PCLK / divider moves with PCLK. The
+ * divider becomes the smallest one which keeps SCK at or below the
+ * SCK chosen at init (SckHz), the device on the bus is never clocked
+ * faster than its limit. Only with an empty queue
+ * */
+drv_status SPI_DVFSNotify(uint8_t Event, void *pContext){
+
+	SPI_Handle_t *pSPIHandle = pContext;
+	const SPI_Map *map = SPI_FindMap(pSPIHandle->pSPIx);
+
+	if (map == 0)
+		return DRV_ERROR;
+
+	if (Event == DVFS_PRE_CHANGE)
+		return SPI_Idle(pSPIHandle) ? DRV_OK : DRV_BUSY;
+
+	if (Event != DVFS_POST_CHANGE)
+		return DRV_OK;
+
+	uint32_t pclk = SPI_GetPCLK(map);
+	uint8_t br = SPI_DIV2;
+
+	while (br < SPI_DIV256 && (pclk >> (br + 1)) > pSPIHandle->SckHz)
+		br++;
+
+	SPI_WriteBR(pSPIHandle->pSPIx, br);
+
+	return DRV_OK;
+
+} /* End SPI_DVFSNotify() */
@@ -0,0 +1,126 @@
+
+#pragma once
+
+#include "stm32f407G.h"
+#include "dma_driver.h"
+
+/*
+ * SPI master driver, full duplex transfers done by the DMA
+ *
+ * 	- every transfer is a transaction (SPI_Transaction_t): chip select,
+ * 	  TX buffer, RX buffer, length, completion callback
+ * 	- SPI_Submit() links the transaction at the end of the queue, the
+ * 	  DMA ISR starts the next one as soon as the previous one ends, so
+ * 	  several devices / commands are chained without the CPU
+ * 	- the chip select is driven through BSRR (one store, no
+ * 	  read-modify-write), low before the transfer, high after it,
+ * 	  unless KeepCS is ON (example: command then data of the same device)
+ * 	- pTx = 0 sends 0xFF, pRx = 0 drops what is received
+ * 	- a buffer the DMA can't reach (CCM, stack) is refused: SPI_Submit()
+ * 	  returns the error when the queue was empty, otherwise Done is
+ * 	  called with Status = DRV_ERROR and the next transaction starts
+ * 	- NSS is managed by software (SSM = SSI = 1), so any GPIO can be a CS
+ *
+ * Pins: GPIO_Init() in ALT mode, SPI1/SPI2 -> AF5, SPI3 -> AF6
+ * 	(Discovery: SPI1 = PA5 SCK, PA6 MISO, PA7 MOSI, LIS3DSH CS = PE3)
+ * 	CS pins: SPI_CSPinInit()
+ *
+ * IRQ handlers of the 2 streams (see table in spi_driver.c), example SPI1:
+ *
+ * 		void DMA2_Stream2_IRQHandler(void){ DMA_IRQHandling(&spi1.rx_dma); }
+ * 		void DMA2_Stream3_IRQHandler(void){ DMA_IRQHandling(&spi1.tx_dma); }
+ *
+ * */
+
+// ------------ Coding states for SPI configuration ------------
+
+// BR[2:0] in CR1, fSCK = fPCLK / divider
+typedef enum SPI_Prescaler {SPI_DIV2, SPI_DIV4, SPI_DIV8, SPI_DIV16,
+							SPI_DIV32, SPI_DIV64, SPI_DIV128, SPI_DIV256} spi_prescaler;
+
+typedef enum SPI_FrameSize {SPI_FRAME_8BITS, SPI_FRAME_16BITS} spi_frame;
+
+// CPOL / CPHA
+typedef enum SPI_Mode {SPI_MODE_0, SPI_MODE_1, SPI_MODE_2, SPI_MODE_3} spi_mode;
+
+
+typedef struct{
+
+	uint8_t SPI_Prescaler;
+	uint8_t SPI_FrameSize;
+	uint8_t SPI_Mode;
+	uint8_t SPI_LSBFirst;     // ON / OFF
+
+} SPI_Config_t;
+
+
+typedef struct SPI_Transaction SPI_Transaction_t;
+
+typedef void (*spi_done_t)(SPI_Transaction_t *pTrans);
+
+struct SPI_Transaction{
+
+	GPIO_RegDef_t *pCSPort;    // 0 -> no chip select
+	uint8_t CSPin;
+	uint8_t KeepCS;            // ON: CS stays low after this transaction
+
+	const void *pTx;           // 0 -> 0xFF sent
+	void *pRx;                 // 0 -> received data dropped
+	uint16_t Len;              // nb of frames (bytes or half words)
+
+	spi_done_t Done;           // can be 0, called from the DMA ISR
+	void *pContext;
+
+	// Filled by the driver
+	drv_status Status;
+	SPI_Transaction_t *pNext;
+
+};
+
+
+typedef struct{
+
+	SPI_RegDef_t *pSPIx;
+	// SPI1, SPI2 or SPI3
+
+	SPI_Config_t SPI_Config;
+
+	// Filled by the driver
+	DMA_Handle_t tx_dma;
+	DMA_Handle_t rx_dma;
+
+	SPI_Transaction_t *__vo pHead;   // transaction in flight
+	SPI_Transaction_t *__vo pTail;
+
+	uint32_t ceiling;
+
+	uint32_t SckHz;                  // SCK of the prescaler, kept across clock changes
+
+	__vo uint32_t transactions;      // statistics
+	__vo uint32_t frames;
+	__vo uint32_t errors;
+
+} SPI_Handle_t;
+
+
+// ================== API ==================
+
+void SPI_PeriClockControl(SPI_RegDef_t *pSPIx, uint8_t ON_OFF);
+
+drv_status SPI_Init(SPI_Handle_t *pSPIHandle);
+
+void SPI_DeInit(SPI_RegDef_t *pSPIx);
+
+// Only when the queue is empty
+drv_status SPI_SetPrescaler(SPI_Handle_t *pSPIHandle, uint8_t Prescaler);
+
+// Output, push pull, very high speed, set high (inactive)
+void SPI_CSPinInit(GPIO_RegDef_t *pGPIOx, uint8_t PinNumber);
+
+drv_status SPI_Submit(SPI_Handle_t *pSPIHandle, SPI_Transaction_t *pTrans);
+
+// 1 when no transaction is queued or in flight
+uint8_t SPI_Idle(SPI_Handle_t *pSPIHandle);
+
+// dvfs_callback_t, pContext = the SPI_Handle_t: SCK not above SckHz after a clock change
+drv_status SPI_DVFSNotify(uint8_t Event, void *pContext);
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "stm32f407G.h"
+#include "rcc_driver.h"
+
+/*
+ * Goal: reset to main() time, the power-on readiness of the board
+ *
+ * 	Reset_Handler (startup_stm32f407vgtx.s) starts the DWT cycle
+ * 	counter as its first job and stores it twice:
+ *
+ * 		- Startup_ClockCycles: at the end of SystemInit(), spent on
+ * 		  HSI 16 MHz (HSE start up and PLL lock are most of it)
+ * 		- Startup_Cycles: just before main(), after the copy of the
+ * 		  init regions, the clearing of .bss and the constructors
+ *
+ * 	The cycles after SystemInit() are at SystemCoreClock. Read the
+ * 	values before any DWT_CycleCounterInit(), which clears CYCCNT
+ * 	but not these variables
+ *
+ * */
+
+extern uint32_t Startup_Cycles;
+extern uint32_t Startup_ClockCycles;
+
+// Reset to main(), in us
+static inline uint32_t Startup_GetTimeUs(void){
+
+	uint32_t init_cycles = Startup_Cycles - Startup_ClockCycles;
+
+	return Startup_ClockCycles / (HSI_VALUE / 1000000U) +
+		   init_cycles / (SystemCoreClock / 1000000U);
+
+} /* End Startup_GetTimeUs() */
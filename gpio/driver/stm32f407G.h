@@ -22,6 +22,11 @@
 #define SRAM2_BASEADDR	0x2001C000U
 #define ROM_BASEADDR	0x1FFF0000U
 #define SRAM 			SRAM1_BASEADDR
+#define CCMRAM_BASEADDR	0x10000000U
+#define CCMRAM_SIZE		0x10000U
+
+// CCM is on the D-bus of the core only: no DMA, no code execution
+#define IS_CCM_ADDR(addr) (((uint32_t)(addr) - CCMRAM_BASEADDR) < CCMRAM_SIZE)
 
 /*
  * See table 3 in chapter 2 "Memory and bus architecture"
@@ -162,6 +167,119 @@ typedef struct{
 /* Instantiate RCC struct at RCC specific address */
 #define RCC ((RCC_RegDef_t*)RCC_BASEADDR)
 
+// RCC bits used by the clock configuration (section 7.3)
+#define RCC_CR_HSION        0
+#define RCC_CR_HSIRDY       1
+#define RCC_CR_HSEON        16
+#define RCC_CR_HSERDY       17
+#define RCC_CR_HSEBYP       18
+#define RCC_CR_CSSON        19
+#define RCC_CR_PLLON        24
+#define RCC_CR_PLLRDY       25
+
+#define RCC_PLLCFGR_PLLM    0    // 6 bits
+#define RCC_PLLCFGR_PLLN    6    // 9 bits
+#define RCC_PLLCFGR_PLLP    16   // 2 bits: 00 -> /2 .. 11 -> /8
+#define RCC_PLLCFGR_PLLSRC  22
+#define RCC_PLLCFGR_PLLQ    24   // 4 bits
+
+#define RCC_CFGR_SW         0    // 2 bits: 00 HSI, 01 HSE, 10 PLL
+#define RCC_CFGR_SWS        2
+#define RCC_CFGR_HPRE       4    // 4 bits
+#define RCC_CFGR_PPRE1      10   // 3 bits
+#define RCC_CFGR_PPRE2      13   // 3 bits
+
+#define RCC_APB1ENR_PWREN   28
+
+// Backup domain (section 7.3.20) and LSI (section 7.3.21)
+#define RCC_BDCR_RTCSEL     8    // 2 bits: 00 none, 01 LSE, 10 LSI, 11 HSE / x
+#define RCC_BDCR_RTCEN      15
+#define RCC_BDCR_BDRST      16
+#define RCC_CSR_LSION       0
+#define RCC_CSR_LSIRDY      1
+
+// ============= Flash interface (section 3.9) =============
+
+/*
+ * Not the flash memory (FLASH_BASEADDR) but its controller:
+ * wait states and ART accelerator (prefetch + caches)
+ * */
+#define FLASH_INTF_BASEADDR (AHB1PERIPH_BASEADDR + 0x3C00)
+
+typedef struct{
+  __vo uint32_t ACR;           /* Address offset: 0x00 */
+  __vo uint32_t KEYR;          /* Address offset: 0x04 */
+  __vo uint32_t OPTKEYR;       /* Address offset: 0x08 */
+  __vo uint32_t SR;            /* Address offset: 0x0C */
+  __vo uint32_t CR;            /* Address offset: 0x10 */
+  __vo uint32_t OPTCR;         /* Address offset: 0x14 */
+} FLASH_RegDef_t;
+
+#define FLASH ((FLASH_RegDef_t*)FLASH_INTF_BASEADDR)
+
+#define FLASH_ACR_LATENCY   0    // 3 bits, wait states
+#define FLASH_ACR_PRFTEN    8
+#define FLASH_ACR_ICEN      9
+#define FLASH_ACR_DCEN      10
+#define FLASH_ACR_ICRST     11
+#define FLASH_ACR_DCRST     12
+
+// ============= Power controller (section 5.4) =============
+
+#define PWR_BASEADDR (APB1PERIPH_BASEADDR + 0x7000)
+
+typedef struct{
+  __vo uint32_t CR;            /* Address offset: 0x00 */
+  __vo uint32_t CSR;           /* Address offset: 0x04 */
+} PWR_RegDef_t;
+
+#define PWR ((PWR_RegDef_t*)PWR_BASEADDR)
+
+#define PWR_CR_LPDS         0
+#define PWR_CR_PDDS         1
+#define PWR_CR_CWUF         2
+#define PWR_CR_CSBF         3
+#define PWR_CR_FPDS         9
+#define PWR_CR_VOS          14
+
+#define PWR_CR_DBP          8
+
+#define PWR_CSR_WUF         0
+#define PWR_CSR_SBF         1
+#define PWR_CSR_EWUP        8
+#define PWR_CSR_VOSRDY      14
+
+// ============= Real time clock (section 26.6) =============
+
+#define RTC_BASEADDR (APB1PERIPH_BASEADDR + 0x2800)
+
+typedef struct{
+  __vo uint32_t TR;            /* Address offset: 0x00 */
+  __vo uint32_t DR;            /* Address offset: 0x04 */
+  __vo uint32_t CR;            /* Address offset: 0x08 */
+  __vo uint32_t ISR;           /* Address offset: 0x0C */
+  __vo uint32_t PRER;          /* Address offset: 0x10 */
+  __vo uint32_t WUTR;          /* Address offset: 0x14 */
+  __vo uint32_t CALIBR;        /* Address offset: 0x18 */
+  __vo uint32_t ALRMAR;        /* Address offset: 0x1C */
+  __vo uint32_t ALRMBR;        /* Address offset: 0x20 */
+  __vo uint32_t WPR;           /* Address offset: 0x24 */
+  __vo uint32_t SSR;           /* Address offset: 0x28 */
+} RTC_RegDef_t;
+
+#define RTC ((RTC_RegDef_t*)RTC_BASEADDR)
+
+#define RTC_CR_WUCKSEL      0    // 3 bits: 000 RTCCLK / 16
+#define RTC_CR_WUTE         10
+#define RTC_CR_WUTIE        14
+#define RTC_ISR_WUTWF       2
+#define RTC_ISR_WUTF        10
+#define RTC_WPR_KEY1        0xCA
+#define RTC_WPR_KEY2        0x53
+
+// EXTI line of the RTC wakeup timer (section 12.2.5)
+#define EXTI_LINE_RTC_WKUP  22
+
 // ======================= Interrupt ======================= 
 
 // Address of the EXTI peripheral
@@ -201,7 +319,637 @@ typedef struct {
 // Instantiate SYSCFG struct at SYSCFG specific address
 #define SYSCFG ((SYSCFG_RegDef_t*)SYSCFG_BASEADDR)
 
-// ======================= END SYSCFG ======================= 
+// ======================= END SYSCFG =======================
+
+// ======================= USART =======================
+
+/*
+  USART2, USART3, UART4 and UART5 are on APB1 bus,
+  USART1 and USART6 are on APB2 bus
+  (see memory map in the reference manual, page 65)
+*/
+
+#define USART2_BASEADDR (APB1PERIPH_BASEADDR + 0x4400)
+#define USART3_BASEADDR (APB1PERIPH_BASEADDR + 0x4800)
+#define UART4_BASEADDR  (APB1PERIPH_BASEADDR + 0x4C00)
+#define UART5_BASEADDR  (APB1PERIPH_BASEADDR + 0x5000)
+#define USART1_BASEADDR (APB2PERIPH_BASEADDR + 0x1000)
+#define USART6_BASEADDR (APB2PERIPH_BASEADDR + 0x1400)
+
+// For registers, see 30.6.8 USART register map
+typedef struct {
+  __vo uint32_t SR;            /* Address offset: 0x00 */
+  __vo uint32_t DR;            /* Address offset: 0x04 */
+  __vo uint32_t BRR;           /* Address offset: 0x08 */
+  __vo uint32_t CR1;           /* Address offset: 0x0C */
+  __vo uint32_t CR2;           /* Address offset: 0x10 */
+  __vo uint32_t CR3;           /* Address offset: 0x14 */
+  __vo uint32_t GTPR;          /* Address offset: 0x18 */
+
+} USART_RegDef_t;
+
+#define USART1 ((USART_RegDef_t*)USART1_BASEADDR)
+#define USART2 ((USART_RegDef_t*)USART2_BASEADDR)
+#define USART3 ((USART_RegDef_t*)USART3_BASEADDR)
+#define UART4  ((USART_RegDef_t*)UART4_BASEADDR)
+#define UART5  ((USART_RegDef_t*)UART5_BASEADDR)
+#define USART6 ((USART_RegDef_t*)USART6_BASEADDR)
+
+// Bit positions used by the driver (section 30.6)
+#define USART_SR_PE      0
+#define USART_SR_FE      1
+#define USART_SR_NF      2
+#define USART_SR_ORE     3
+#define USART_SR_IDLE    4
+#define USART_SR_RXNE    5
+#define USART_SR_TC      6
+#define USART_SR_TXE     7
+
+#define USART_CR1_RE     2
+#define USART_CR1_TE     3
+#define USART_CR1_IDLEIE 4
+#define USART_CR1_RXNEIE 5
+#define USART_CR1_TCIE   6
+#define USART_CR1_TXEIE  7
+#define USART_CR1_PS     9
+#define USART_CR1_PCE    10
+#define USART_CR1_M      12
+#define USART_CR1_UE     13
+#define USART_CR1_OVER8  15
+
+#define USART_CR2_STOP   12
+
+#define USART_CR3_EIE    0
+#define USART_CR3_DMAR   6
+#define USART_CR3_DMAT   7
+#define USART_CR3_RTSE   8
+#define USART_CR3_CTSE   9
+
+// ======================= SPI =======================
+
+/*
+  SPI2 and SPI3 are on APB1 bus, SPI1 is on APB2 bus
+  (see memory map in the reference manual, page 65)
+*/
+
+#define SPI2_BASEADDR (APB1PERIPH_BASEADDR + 0x3800)
+#define SPI3_BASEADDR (APB1PERIPH_BASEADDR + 0x3C00)
+#define SPI1_BASEADDR (APB2PERIPH_BASEADDR + 0x3000)
+
+// For registers, see 28.5.10 SPI register map
+typedef struct {
+  __vo uint32_t CR1;           /* Address offset: 0x00 */
+  __vo uint32_t CR2;           /* Address offset: 0x04 */
+  __vo uint32_t SR;            /* Address offset: 0x08 */
+  __vo uint32_t DR;            /* Address offset: 0x0C */
+  __vo uint32_t CRCPR;         /* Address offset: 0x10 */
+  __vo uint32_t RXCRCR;        /* Address offset: 0x14 */
+  __vo uint32_t TXCRCR;        /* Address offset: 0x18 */
+  __vo uint32_t I2SCFGR;       /* Address offset: 0x1C */
+  __vo uint32_t I2SPR;         /* Address offset: 0x20 */
+
+} SPI_RegDef_t;
+
+#define SPI1 ((SPI_RegDef_t*)SPI1_BASEADDR)
+#define SPI2 ((SPI_RegDef_t*)SPI2_BASEADDR)
+#define SPI3 ((SPI_RegDef_t*)SPI3_BASEADDR)
+
+// Bit positions used by the driver (section 28.5)
+#define SPI_CR1_CPHA     0
+#define SPI_CR1_CPOL     1
+#define SPI_CR1_MSTR     2
+#define SPI_CR1_BR       3
+#define SPI_CR1_SPE      6
+#define SPI_CR1_LSBFIRST 7
+#define SPI_CR1_SSI      8
+#define SPI_CR1_SSM      9
+#define SPI_CR1_DFF      11
+
+#define SPI_CR2_RXDMAEN  0
+#define SPI_CR2_TXDMAEN  1
+#define SPI_CR2_SSOE     2
+
+#define SPI_SR_RXNE      0
+#define SPI_SR_TXE       1
+#define SPI_SR_MODF      5
+#define SPI_SR_OVR       6
+#define SPI_SR_BSY       7
+
+// ======================= I2C =======================
+
+/*
+  I2C1, I2C2 and I2C3 are on APB1 bus
+  (see memory map in the reference manual, page 65)
+*/
+
+#define I2C1_BASEADDR (APB1PERIPH_BASEADDR + 0x5400)
+#define I2C2_BASEADDR (APB1PERIPH_BASEADDR + 0x5800)
+#define I2C3_BASEADDR (APB1PERIPH_BASEADDR + 0x5C00)
+
+// For registers, see 27.6.11 I2C register map
+typedef struct {
+  __vo uint32_t CR1;           /* Address offset: 0x00 */
+  __vo uint32_t CR2;           /* Address offset: 0x04 */
+  __vo uint32_t OAR1;          /* Address offset: 0x08 */
+  __vo uint32_t OAR2;          /* Address offset: 0x0C */
+  __vo uint32_t DR;            /* Address offset: 0x10 */
+  __vo uint32_t SR1;           /* Address offset: 0x14 */
+  __vo uint32_t SR2;           /* Address offset: 0x18 */
+  __vo uint32_t CCR;           /* Address offset: 0x1C */
+  __vo uint32_t TRISE;         /* Address offset: 0x20 */
+  __vo uint32_t FLTR;          /* Address offset: 0x24 */
+
+} I2C_RegDef_t;
+
+#define I2C1 ((I2C_RegDef_t*)I2C1_BASEADDR)
+#define I2C2 ((I2C_RegDef_t*)I2C2_BASEADDR)
+#define I2C3 ((I2C_RegDef_t*)I2C3_BASEADDR)
+
+// Bit positions used by the driver (section 27.6)
+#define I2C_CR1_PE       0
+#define I2C_CR1_START    8
+#define I2C_CR1_STOP     9
+#define I2C_CR1_ACK      10
+#define I2C_CR1_POS      11
+#define I2C_CR1_SWRST    15
+
+#define I2C_CR2_FREQ     0
+#define I2C_CR2_ITERREN  8
+#define I2C_CR2_ITEVTEN  9
+#define I2C_CR2_ITBUFEN  10
+#define I2C_CR2_DMAEN    11
+#define I2C_CR2_LAST     12
+
+#define I2C_SR1_SB       0
+#define I2C_SR1_ADDR     1
+#define I2C_SR1_BTF      2
+#define I2C_SR1_STOPF    4
+#define I2C_SR1_RXNE     6
+#define I2C_SR1_TXE      7
+#define I2C_SR1_BERR     8
+#define I2C_SR1_ARLO     9
+#define I2C_SR1_AF       10
+#define I2C_SR1_OVR      11
+#define I2C_SR1_TIMEOUT  14
+
+#define I2C_SR2_MSL      0
+#define I2C_SR2_BUSY     1
+
+#define I2C_CCR_DUTY     14
+#define I2C_CCR_FS       15
+
+// ======================= Timers =======================
+
+/*
+  TIM2..TIM7 and TIM12..TIM14 are on APB1 bus,
+  TIM1, TIM8 and TIM9..TIM11 are on APB2 bus
+  (see memory map in the reference manual, page 65)
+
+  All the timers share the same register layout, a register (or bit)
+  missing on a simple timer reads 0 (example: BDTR only on TIM1/TIM8)
+*/
+
+#define TIM2_BASEADDR  (APB1PERIPH_BASEADDR + 0x0000)
+#define TIM3_BASEADDR  (APB1PERIPH_BASEADDR + 0x0400)
+#define TIM4_BASEADDR  (APB1PERIPH_BASEADDR + 0x0800)
+#define TIM5_BASEADDR  (APB1PERIPH_BASEADDR + 0x0C00)
+#define TIM6_BASEADDR  (APB1PERIPH_BASEADDR + 0x1000)
+#define TIM7_BASEADDR  (APB1PERIPH_BASEADDR + 0x1400)
+#define TIM12_BASEADDR (APB1PERIPH_BASEADDR + 0x1800)
+#define TIM13_BASEADDR (APB1PERIPH_BASEADDR + 0x1C00)
+#define TIM14_BASEADDR (APB1PERIPH_BASEADDR + 0x2000)
+#define TIM1_BASEADDR  (APB2PERIPH_BASEADDR + 0x0000)
+#define TIM8_BASEADDR  (APB2PERIPH_BASEADDR + 0x0400)
+#define TIM9_BASEADDR  (APB2PERIPH_BASEADDR + 0x4000)
+#define TIM10_BASEADDR (APB2PERIPH_BASEADDR + 0x4400)
+#define TIM11_BASEADDR (APB2PERIPH_BASEADDR + 0x4800)
+
+// For registers, see 17.4.21 TIM1&TIM8 register map (same offsets for all)
+typedef struct {
+  __vo uint32_t CR1;           /* Address offset: 0x00 */
+  __vo uint32_t CR2;           /* Address offset: 0x04 */
+  __vo uint32_t SMCR;          /* Address offset: 0x08 */
+  __vo uint32_t DIER;          /* Address offset: 0x0C */
+  __vo uint32_t SR;            /* Address offset: 0x10 */
+  __vo uint32_t EGR;           /* Address offset: 0x14 */
+  __vo uint32_t CCMR1;         /* Address offset: 0x18 */
+  __vo uint32_t CCMR2;         /* Address offset: 0x1C */
+  __vo uint32_t CCER;          /* Address offset: 0x20 */
+  __vo uint32_t CNT;           /* Address offset: 0x24 */
+  __vo uint32_t PSC;           /* Address offset: 0x28 */
+  __vo uint32_t ARR;           /* Address offset: 0x2C */
+  __vo uint32_t RCR;           /* Address offset: 0x30 */
+  __vo uint32_t CCR[4];        /* Address offset: 0x34 - 0x40 */
+  __vo uint32_t BDTR;          /* Address offset: 0x44 */
+  __vo uint32_t DCR;           /* Address offset: 0x48 */
+  __vo uint32_t DMAR;          /* Address offset: 0x4C */
+  __vo uint32_t OR;            /* Address offset: 0x50 */
+
+} TIM_RegDef_t;
+
+#define TIM1  ((TIM_RegDef_t*)TIM1_BASEADDR)
+#define TIM2  ((TIM_RegDef_t*)TIM2_BASEADDR)
+#define TIM3  ((TIM_RegDef_t*)TIM3_BASEADDR)
+#define TIM4  ((TIM_RegDef_t*)TIM4_BASEADDR)
+#define TIM5  ((TIM_RegDef_t*)TIM5_BASEADDR)
+#define TIM6  ((TIM_RegDef_t*)TIM6_BASEADDR)
+#define TIM7  ((TIM_RegDef_t*)TIM7_BASEADDR)
+#define TIM8  ((TIM_RegDef_t*)TIM8_BASEADDR)
+#define TIM9  ((TIM_RegDef_t*)TIM9_BASEADDR)
+#define TIM10 ((TIM_RegDef_t*)TIM10_BASEADDR)
+#define TIM11 ((TIM_RegDef_t*)TIM11_BASEADDR)
+#define TIM12 ((TIM_RegDef_t*)TIM12_BASEADDR)
+#define TIM13 ((TIM_RegDef_t*)TIM13_BASEADDR)
+#define TIM14 ((TIM_RegDef_t*)TIM14_BASEADDR)
+
+// Bit positions (section 17.4 and 18.4)
+#define TIM_CR1_CEN      0
+#define TIM_CR1_UDIS     1
+#define TIM_CR1_URS      2
+#define TIM_CR1_OPM      3
+#define TIM_CR1_DIR      4
+#define TIM_CR1_ARPE     7
+
+#define TIM_CR2_CCDS     3
+#define TIM_CR2_MMS      4
+
+#define TIM_DIER_UIE     0
+#define TIM_DIER_CC1IE   1
+#define TIM_DIER_UDE     8
+#define TIM_DIER_CC1DE   9
+
+#define TIM_SR_UIF       0
+#define TIM_SR_CC1IF     1
+
+#define TIM_EGR_UG       0
+
+#define TIM_CCMR_CCS     0   // + 8 for channel 2 / 4
+#define TIM_CCMR_OCPE    3
+#define TIM_CCMR_OCM     4
+#define TIM_CCMR_ICF     4
+
+#define TIM_CCER_CCE     0   // + 4 * (channel - 1)
+#define TIM_CCER_CCP     1
+#define TIM_CCER_CCNP    3
+
+#define TIM_BDTR_MOE     15
+
+#define TIM_DCR_DBA      0   // first register of a burst, in words from CR1
+#define TIM_DCR_DBL      8   // transfers per burst - 1
+
+// ======================= ADC =======================
+
+/*
+  3 ADCs on APB2 bus, plus a common part (shared clock prescaler,
+  multi ADC modes), see chapter 13 in the reference manual
+*/
+
+#define ADC1_BASEADDR       (APB2PERIPH_BASEADDR + 0x2000)
+#define ADC2_BASEADDR       (APB2PERIPH_BASEADDR + 0x2100)
+#define ADC3_BASEADDR       (APB2PERIPH_BASEADDR + 0x2200)
+#define ADC_COMMON_BASEADDR (APB2PERIPH_BASEADDR + 0x2300)
+
+// For registers, see 13.13.18 ADC register map
+typedef struct {
+  __vo uint32_t SR;            /* Address offset: 0x00 */
+  __vo uint32_t CR1;           /* Address offset: 0x04 */
+  __vo uint32_t CR2;           /* Address offset: 0x08 */
+  __vo uint32_t SMPR1;         /* Address offset: 0x0C */
+  __vo uint32_t SMPR2;         /* Address offset: 0x10 */
+  __vo uint32_t JOFR[4];       /* Address offset: 0x14 - 0x20 */
+  __vo uint32_t HTR;           /* Address offset: 0x24 */
+  __vo uint32_t LTR;           /* Address offset: 0x28 */
+  __vo uint32_t SQR1;          /* Address offset: 0x2C */
+  __vo uint32_t SQR2;          /* Address offset: 0x30 */
+  __vo uint32_t SQR3;          /* Address offset: 0x34 */
+  __vo uint32_t JSQR;          /* Address offset: 0x38 */
+  __vo uint32_t JDR[4];        /* Address offset: 0x3C - 0x48 */
+  __vo uint32_t DR;            /* Address offset: 0x4C */
+
+} ADC_RegDef_t;
+
+typedef struct {
+  __vo uint32_t CSR;           /* Address offset: 0x300 */
+  __vo uint32_t CCR;           /* Address offset: 0x304 */
+  __vo uint32_t CDR;           /* Address offset: 0x308 */
+
+} ADC_Common_RegDef_t;
+
+#define ADC1 ((ADC_RegDef_t*)ADC1_BASEADDR)
+#define ADC2 ((ADC_RegDef_t*)ADC2_BASEADDR)
+#define ADC3 ((ADC_RegDef_t*)ADC3_BASEADDR)
+#define ADC_COMMON ((ADC_Common_RegDef_t*)ADC_COMMON_BASEADDR)
+
+// Bit positions used by the driver (section 13.13)
+#define ADC_SR_EOC       1
+#define ADC_SR_OVR       5
+
+#define ADC_CR1_SCAN     8
+#define ADC_CR1_RES      24
+#define ADC_CR1_OVRIE    26
+
+#define ADC_CR2_ADON     0
+#define ADC_CR2_CONT     1
+#define ADC_CR2_DMA      8
+#define ADC_CR2_DDS      9
+#define ADC_CR2_EOCS     10
+#define ADC_CR2_EXTSEL   24
+#define ADC_CR2_EXTEN    28
+#define ADC_CR2_SWSTART  30
+
+#define ADC_SQR1_L       20
+
+#define ADC_CCR_ADCPRE   16
+#define ADC_CCR_VBATE    22
+#define ADC_CCR_TSVREFE  23
+
+// ======================= DMA =======================
+
+/*
+  2 DMA controllers on AHB1, each with 8 streams
+  (see chapter 10 in the reference manual)
+
+  	- LISR/HISR: flags of stream 0..3 / 4..7
+  	- LIFCR/HIFCR: write 1 to clear the flags
+  	- each stream has 6 registers, at 0x10 + 0x18 * stream nb
+*/
+
+#define DMA1_BASEADDR (AHB1PERIPH_BASEADDR + 0x6000)
+#define DMA2_BASEADDR (AHB1PERIPH_BASEADDR + 0x6400)
+
+typedef struct {
+  __vo uint32_t CR;            /* Address offset: 0x10 + 0x18 * x */
+  __vo uint32_t NDTR;          /* Address offset: 0x14 + 0x18 * x */
+  __vo uint32_t PAR;           /* Address offset: 0x18 + 0x18 * x */
+  __vo uint32_t M0AR;          /* Address offset: 0x1C + 0x18 * x */
+  __vo uint32_t M1AR;          /* Address offset: 0x20 + 0x18 * x */
+  __vo uint32_t FCR;           /* Address offset: 0x24 + 0x18 * x */
+
+} DMA_Stream_RegDef_t;
+
+typedef struct {
+  __vo uint32_t LISR;          /* Address offset: 0x00 */
+  __vo uint32_t HISR;          /* Address offset: 0x04 */
+  __vo uint32_t LIFCR;         /* Address offset: 0x08 */
+  __vo uint32_t HIFCR;         /* Address offset: 0x0C */
+  DMA_Stream_RegDef_t STREAM[8];
+
+} DMA_RegDef_t;
+
+#define DMA1 ((DMA_RegDef_t*)DMA1_BASEADDR)
+#define DMA2 ((DMA_RegDef_t*)DMA2_BASEADDR)
+
+// Stream CR bits (section 10.5.5)
+#define DMA_SxCR_EN      0
+#define DMA_SxCR_DMEIE   1
+#define DMA_SxCR_TEIE    2
+#define DMA_SxCR_HTIE    3
+#define DMA_SxCR_TCIE    4
+#define DMA_SxCR_PFCTRL  5
+#define DMA_SxCR_DIR     6
+#define DMA_SxCR_CIRC    8
+#define DMA_SxCR_PINC    9
+#define DMA_SxCR_MINC    10
+#define DMA_SxCR_PSIZE   11
+#define DMA_SxCR_MSIZE   13
+#define DMA_SxCR_PL      16
+#define DMA_SxCR_DBM     18
+#define DMA_SxCR_CT      19
+#define DMA_SxCR_PBURST  21
+#define DMA_SxCR_MBURST  23
+#define DMA_SxCR_CHSEL   25
+
+// Stream FCR bits (section 10.5.10)
+#define DMA_SxFCR_FTH    0
+#define DMA_SxFCR_DMDIS  2
+#define DMA_SxFCR_FS     3
+#define DMA_SxFCR_FEIE   7
+
+/*
+  Flags of one stream inside LISR/HISR (section 10.5.1),
+  the group of a stream starts at bit 0, 6, 16 or 22
+*/
+#define DMA_FLAG_FEIF    (1U << 0)
+#define DMA_FLAG_DMEIF   (1U << 2)
+#define DMA_FLAG_TEIF    (1U << 3)
+#define DMA_FLAG_HTIF    (1U << 4)
+#define DMA_FLAG_TCIF    (1U << 5)
+#define DMA_FLAG_ALL     (0x3DU)
+
+// ======================= NVIC (processor side) =======================
+
+/*
+  The NVIC is not a peripheral of the MCU, it belongs to the
+  ARM cortex M4 processor, so its addresses are found in the
+  generic user guide (Table 4-2 NVIC register summary)
+  and not in the reference manual
+
+  - ISER, ICER, ISPR, ICPR, IABR: 8 registers each, 1 bit per IRQ
+  - IPR: 1 byte per IRQ, only the upper 4 bits are implemented
+         on the stm32f4 (see NVIC_PRIO_BITS below)
+*/
+
+#define NVIC_BASEADDR (0xE000E100U)
+
+typedef struct {
+  __vo uint32_t ISER[8];        /* Address offset: 0x000 */
+       uint32_t RESERVED0[24];
+  __vo uint32_t ICER[8];        /* Address offset: 0x080 */
+       uint32_t RESERVED1[24];
+  __vo uint32_t ISPR[8];        /* Address offset: 0x100 */
+       uint32_t RESERVED2[24];
+  __vo uint32_t ICPR[8];        /* Address offset: 0x180 */
+       uint32_t RESERVED3[24];
+  __vo uint32_t IABR[8];        /* Address offset: 0x200 */
+       uint32_t RESERVED4[56];
+  __vo uint8_t  IPR[240];       /* Address offset: 0x300, byte accessible */
+
+} NVIC_RegDef_t;
+
+#define NVIC ((NVIC_RegDef_t*)NVIC_BASEADDR)
+
+// Number of priority bits implemented in the IPR bytes (stm32f4 -> 4)
+#define NVIC_PRIO_BITS 4
+
+// ======================= SCB (processor side) =======================
+
+/*
+  System control block, see section 4.3 of the generic user guide
+  AIRCR holds the priority grouping (PRIGROUP), every write
+  to it must carry the key 0x05FA in the upper 16 bits
+*/
+
+#define SCB_BASEADDR (0xE000ED00U)
+
+typedef struct {
+  __vo uint32_t CPUID;          /* Address offset: 0x00 */
+  __vo uint32_t ICSR;           /* Address offset: 0x04 */
+  __vo uint32_t VTOR;           /* Address offset: 0x08 */
+  __vo uint32_t AIRCR;          /* Address offset: 0x0C */
+  __vo uint32_t SCR;            /* Address offset: 0x10 */
+  __vo uint32_t CCR;            /* Address offset: 0x14 */
+  __vo uint8_t  SHPR[12];       /* Address offset: 0x18, system handlers priority */
+  __vo uint32_t SHCSR;          /* Address offset: 0x24 */
+
+} SCB_RegDef_t;
+
+#define SCB ((SCB_RegDef_t*)SCB_BASEADDR)
+
+// Coprocessor access control: CP10 / CP11 full access turns the FPU on
+#define SCB_CPACR                (*(__vo uint32_t*)0xE000ED88U)
+#define SCB_CPACR_FPU_FULL       ((0x3U << 20) | (0x3U << 22))
+
+// System control register: WFI enters deep sleep (stop / standby) with SLEEPDEEP
+#define SCB_SCR_SLEEPDEEP        (1U << 2)
+
+#define SCB_AIRCR_VECTKEY        (0x05FAU << 16)
+#define SCB_AIRCR_PRIGROUP_POS   8
+#define SCB_AIRCR_PRIGROUP_MASK  (0x7U << SCB_AIRCR_PRIGROUP_POS)
+
+// ======================= SysTick (processor side) =======================
+
+/*
+  24 bits down counter of the core, see section 4.5 of the generic
+  user guide. It counts from LOAD down to 0, then reloads and raises
+  the SysTick exception (TICKINT). CLKSOURCE = 1: HCLK, 0: HCLK / 8
+*/
+
+#define SYSTICK_BASEADDR   (0xE000E010U)
+
+typedef struct {
+  __vo uint32_t CTRL;           /* Address offset: 0x00 */
+  __vo uint32_t LOAD;           /* Address offset: 0x04 */
+  __vo uint32_t VAL;            /* Address offset: 0x08 */
+  __vo uint32_t CALIB;          /* Address offset: 0x0C */
+
+} SysTick_RegDef_t;
+
+#define SYSTICK ((SysTick_RegDef_t*)SYSTICK_BASEADDR)
+
+#define SYSTICK_CTRL_ENABLE     0
+#define SYSTICK_CTRL_TICKINT    1
+#define SYSTICK_CTRL_CLKSOURCE  2
+#define SYSTICK_CTRL_COUNTFLAG  16
+#define SYSTICK_LOAD_MAX        0x00FFFFFFU
+
+// ======================= DWT (processor side) =======================
+
+/*
+  Data watchpoint and trace unit, its CYCCNT register counts
+  every core clock cycle, we use it to measure execution time
+  (more precise than toggling a pin + logic analyzer)
+
+  - the unit must first be enabled with TRCENA in CoreDebug DEMCR
+  - see ARMv7-M architecture reference manual, section C1.8
+*/
+
+#define DWT_BASEADDR       (0xE0001000U)
+#define COREDEBUG_DEMCR    (*(__vo uint32_t*)0xE000EDFCU)
+#define COREDEBUG_DEMCR_TRCENA (1U << 24)
+
+typedef struct {
+  __vo uint32_t CTRL;           /* Address offset: 0x00 */
+  __vo uint32_t CYCCNT;         /* Address offset: 0x04 */
+
+} DWT_RegDef_t;
+
+#define DWT ((DWT_RegDef_t*)DWT_BASEADDR)
+
+#define DWT_CTRL_CYCCNTENA (1U << 0)
+
+// ======================= ITM (processor side) =======================
+
+/*
+  Instrumentation trace macrocell: a write to a stimulus port goes out
+  on the SWO pin (PB3), the debugger shows it in the "SWV ITM Data Console"
+
+  - the port is usable only when the debugger enabled it (TCR ITMENA
+    and the bit of the port in TER), otherwise the write is lost
+  - a read of STIM[x] gives 1 when the port FIFO can take a new value
+  - see ARMv7-M architecture reference manual, section C1.7
+*/
+
+#define ITM_BASEADDR       (0xE0000000U)
+
+typedef struct {
+  __vo uint32_t STIM[256];      /* Address offset: 0x000 - 0x3FC */
+  uint32_t RESERVED0[640];
+  __vo uint32_t TER;            /* Address offset: 0xE00 */
+  uint32_t RESERVED1[31];
+  __vo uint32_t TCR;            /* Address offset: 0xE80 */
+
+} ITM_RegDef_t;
+
+#define ITM ((ITM_RegDef_t*)ITM_BASEADDR)
+
+#define ITM_TCR_ITMENA     (1U << 0)
+
+// ======================= IRQ numbers =======================
+
+/*
+  Position of each peripheral interrupt in the vector table,
+  see table 61 "Vector table for STM32F405xx/07xx" in the reference manual
+  (the same order is found in the startup file)
+*/
+
+#define IRQ_NO_WWDG            0
+#define IRQ_NO_PVD             1
+#define IRQ_NO_RTC_WKUP        3
+#define IRQ_NO_EXTI0           6
+#define IRQ_NO_EXTI1           7
+#define IRQ_NO_EXTI2           8
+#define IRQ_NO_EXTI3           9
+#define IRQ_NO_EXTI4           10
+#define IRQ_NO_DMA1_STREAM0    11
+#define IRQ_NO_DMA1_STREAM1    12
+#define IRQ_NO_DMA1_STREAM2    13
+#define IRQ_NO_DMA1_STREAM3    14
+#define IRQ_NO_DMA1_STREAM4    15
+#define IRQ_NO_DMA1_STREAM5    16
+#define IRQ_NO_DMA1_STREAM6    17
+#define IRQ_NO_ADC             18
+#define IRQ_NO_EXTI9_5         23
+#define IRQ_NO_TIM1_BRK_TIM9   24
+#define IRQ_NO_TIM1_UP_TIM10   25
+#define IRQ_NO_TIM1_TRG_COM_TIM11 26
+#define IRQ_NO_TIM1_CC         27
+#define IRQ_NO_TIM2            28
+#define IRQ_NO_TIM3            29
+#define IRQ_NO_TIM4            30
+#define IRQ_NO_I2C1_EV         31
+#define IRQ_NO_I2C1_ER         32
+#define IRQ_NO_I2C2_EV         33
+#define IRQ_NO_I2C2_ER         34
+#define IRQ_NO_SPI1            35
+#define IRQ_NO_SPI2            36
+#define IRQ_NO_USART1          37
+#define IRQ_NO_USART2          38
+#define IRQ_NO_USART3          39
+#define IRQ_NO_EXTI15_10       40
+#define IRQ_NO_RTC_ALARM       41
+#define IRQ_NO_TIM8_BRK_TIM12  43
+#define IRQ_NO_TIM8_UP_TIM13   44
+#define IRQ_NO_TIM8_TRG_COM_TIM14 45
+#define IRQ_NO_TIM8_CC         46
+#define IRQ_NO_DMA1_STREAM7    47
+#define IRQ_NO_TIM5            50
+#define IRQ_NO_SPI3            51
+#define IRQ_NO_UART4           52
+#define IRQ_NO_UART5           53
+#define IRQ_NO_TIM6_DAC        54
+#define IRQ_NO_TIM7            55
+#define IRQ_NO_DMA2_STREAM0    56
+#define IRQ_NO_DMA2_STREAM1    57
+#define IRQ_NO_DMA2_STREAM2    58
+#define IRQ_NO_DMA2_STREAM3    59
+#define IRQ_NO_DMA2_STREAM4    60
+#define IRQ_NO_DMA2_STREAM5    68
+#define IRQ_NO_DMA2_STREAM6    69
+#define IRQ_NO_DMA2_STREAM7    70
+#define IRQ_NO_USART6          71
+#define IRQ_NO_I2C3_EV         72
+#define IRQ_NO_I2C3_ER         73
+#define IRQ_NO_FPU             81
 
 // GENRIC MACROS used in different places
 // such as comparison, ...
@@ -209,6 +957,22 @@ typedef struct {
 #define ON 1
 #define OFF 0
 
+/*
+ Bit banding: each bit of the peripheral region (0x40000000 - 0x400FFFFF)
+ has its own 32 bit alias word in 0x42000000 - 0x43FFFFFF
+
+ 	alias = 0x42000000 + (byte offset * 32) + (bit nb * 4)
+
+ Writing the alias sets/clears one bit in a single store, so the
+ change is atomic (no read-modify-write that an ISR could interrupt)
+*/
+#define BITBAND_PERIPH(reg_addr, bit) \
+	(*(__vo uint32_t*)(0x42000000U + \
+	 (((uint32_t)(reg_addr) - PERIPH_BASEADDR) * 32U) + ((bit) * 4U)))
+
+// Return status of the driver API functions
+typedef enum DRV_Status {DRV_OK, DRV_ERROR, DRV_BUSY} drv_status;
+
 
 uint8_t GPIO_BASEADDR_TO_CODE(GPIO_RegDef_t *pGPIOx);
 
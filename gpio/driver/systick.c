@@ -0,0 +1,80 @@
+#include "systick.h"
+#include "rcc_driver.h"
+#include "dvfs.h"
+#include "mem_sections.h"
+
+
+static uint32_t systick_hz;
+
+static __ccm_bss __vo uint32_t systick_ticks;
+
+
+static drv_status SysTick_SetReload(void){
+
+	uint32_t load = SystemCoreClock / systick_hz;
+
+	if (load < 2 || load - 1 > SYSTICK_LOAD_MAX)
+		return DRV_ERROR;
+
+	SYSTICK->LOAD = load - 1;
+	SYSTICK->VAL = 0;    // any write clears the counter, next tick is a full one
+
+	return DRV_OK;
+
+} /* End SysTick_SetReload() */
+
+
+drv_status SysTick_Init(uint32_t TickHz){
+
+	if (TickHz == 0)
+		return DRV_ERROR;
+
+	SYSTICK->CTRL = 0;
+
+	systick_hz = TickHz;
+	systick_ticks = 0;
+
+	if (SysTick_SetReload() != DRV_OK)
+		return DRV_ERROR;
+
+	SYSTICK->CTRL = (1 << SYSTICK_CTRL_CLKSOURCE) | (1 << SYSTICK_CTRL_TICKINT) |
+					(1 << SYSTICK_CTRL_ENABLE);
+
+	return DRV_OK;
+
+} /* End SysTick_Init() */
+
+
+uint32_t SysTick_GetTicks(void){
+
+	return systick_ticks;
+
+} /* End SysTick_GetTicks() */
+
+
+void SysTick_DelayMs(uint32_t Ms){
+
+	uint32_t ticks = (uint32_t)(((uint64_t)Ms * systick_hz + 999) / 1000);
+	uint32_t start = systick_ticks;
+
+	// + 1: the tick in progress is only a part of one
+	while ((systick_ticks - start) < ticks + 1);
+
+} /* End SysTick_DelayMs() */
+
+
+void SysTick_IRQHandling(void){
+
+	systick_ticks++;
+
+} /* End SysTick_IRQHandling() */
+
+
+drv_status SysTick_DVFSNotify(uint8_t Event, void *pContext){
+
+	if (Event != DVFS_POST_CHANGE || systick_hz == 0)
+		return DRV_OK;
+
+	return SysTick_SetReload();
+
+} /* End SysTick_DVFSNotify() */
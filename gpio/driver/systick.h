@@ -0,0 +1,34 @@
+#pragma once
+
+#include "stm32f407G.h"
+
+/*
+ * Time base from the SysTick of the core: a tick counter incremented
+ * TickHz times per second, and delays which stay right when the clock
+ * changes (dvfs.h)
+ *
+ * 	- SysTick counts HCLK cycles (CLKSOURCE = 1): LOAD = HCLK / TickHz - 1,
+ * 	  24 bits, so at 168 MHz TickHz must be 11 Hz at least
+ * 	- SysTick_DVFSNotify() computes LOAD again after a clock change,
+ * 	  the tick keeps its period (the tick running during the switch
+ * 	  is a bit longer or shorter)
+ * 	- the user must call SysTick_IRQHandling() from the exception
+ * 	  handler of the startup file:
+ *
+ * 		void SysTick_Handler(void){ SysTick_IRQHandling(); }
+ *
+ * */
+
+// ================== API ==================
+
+drv_status SysTick_Init(uint32_t TickHz);
+
+uint32_t SysTick_GetTicks(void);
+
+// Waits Ms milliseconds (at least), needs TickHz >= 1000
+void SysTick_DelayMs(uint32_t Ms);
+
+void SysTick_IRQHandling(void);
+
+// dvfs_callback_t, pContext unused
+drv_status SysTick_DVFSNotify(uint8_t Event, void *pContext);
@@ -0,0 +1,143 @@
+#include <string.h>
+#include "telemetry.h"
+#include "dwt_counter.h"
+
+
+static const uint8_t telemetry_type_size[] = {
+	[TELEMETRY_U8]  = 1, [TELEMETRY_I8]  = 1,
+	[TELEMETRY_U16] = 2, [TELEMETRY_I16] = 2,
+	[TELEMETRY_U32] = 4, [TELEMETRY_I32] = 4,
+	[TELEMETRY_F32] = 4
+};
+
+#define NB_TELEMETRY_TYPES (sizeof(telemetry_type_size)/sizeof(telemetry_type_size[0]))
+
+
+uint8_t Telemetry_TypeSize(uint8_t Type){
+
+	return (Type < NB_TELEMETRY_TYPES) ? telemetry_type_size[Type] : 0;
+
+} /* End Telemetry_TypeSize() */
+
+
+uint16_t Telemetry_CRC16(uint16_t crc, const uint8_t *pData, uint32_t Len){
+
+	/*
+	 * CRC-16/CCITT-FALSE, 4 bits at a time: a 16 entries table
+	 * (32 bytes of flash) instead of 256 entries (512 bytes),
+	 * for 2 lookups per byte instead of 8 shift/xor steps
+	 * */
+	static const uint16_t crc_nibble[16] = {
+		0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+		0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF
+	};
+
+	for (uint32_t i = 0; i < Len; ++i){
+
+		crc = (crc << 4) ^ crc_nibble[(crc >> 12) ^ (pData[i] >> 4)];
+		crc = (crc << 4) ^ crc_nibble[(crc >> 12) ^ (pData[i] & 0x0F)];
+
+	}
+
+	return crc;
+
+} /* End Telemetry_CRC16() */
+
+
+uint32_t Telemetry_COBSEncode(const uint8_t *pSrc, uint32_t Len, uint8_t *pDst){
+
+	/*
+	 * Each 0x00 is replaced by the distance to the next 0x00
+	 * (code byte), a block of 254 non zero bytes gets code 0xFF
+	 * and no implicit zero. The delimiter is not written here.
+	 * */
+	uint32_t code_pos = 0;
+	uint32_t out = 1;
+	uint8_t code = 1;
+
+	for (uint32_t i = 0; i < Len; ++i){
+
+		if (pSrc[i] == 0){
+
+			pDst[code_pos] = code;
+			code_pos = out++;
+			code = 1;
+
+		} else {
+
+			pDst[out++] = pSrc[i];
+			code++;
+
+			if (code == 0xFF){
+				pDst[code_pos] = code;
+				code_pos = out++;
+				code = 1;
+			}
+
+		} /* End if-else zero */
+
+	} /* End for */
+
+	pDst[code_pos] = code;
+
+	return out;
+
+} /* End Telemetry_COBSEncode() */
+
+
+void Telemetry_Init(Telemetry_Handle_t *pHandle){
+
+	pHandle->seq = 0;
+	pHandle->records = 0;
+	pHandle->bytes = 0;
+	pHandle->rejected = 0;
+
+	DWT_CycleCounterInit();
+
+} /* End Telemetry_Init() */
+
+
+drv_status Telemetry_Send(Telemetry_Handle_t *pHandle, uint8_t Channel,
+						  uint8_t Type, const void *pSamples, uint8_t Count){
+
+	uint32_t payload = (uint32_t)Telemetry_TypeSize(Type) * Count;
+
+	if (payload == 0 || payload > TELEMETRY_MAX_PAYLOAD){
+		pHandle->rejected++;
+		return DRV_ERROR;
+	}
+
+	uint8_t record[TELEMETRY_HEADER_SIZE + TELEMETRY_MAX_PAYLOAD + TELEMETRY_CRC_SIZE];
+	uint8_t frame[TELEMETRY_MAX_FRAME];
+
+	// 1. Header + payload (the Cortex-M4 is little endian, copied as is)
+	uint32_t timestamp = DWT_GetCycles();
+
+	record[0] = pHandle->seq++;
+	record[1] = Channel;
+	record[2] = Type;
+	record[3] = Count;
+	memcpy(&record[4], &timestamp, 4);
+	memcpy(&record[TELEMETRY_HEADER_SIZE], pSamples, payload);
+
+	uint32_t len = TELEMETRY_HEADER_SIZE + payload;
+
+	// 2. CRC
+	uint16_t crc = Telemetry_CRC16(0xFFFF, record, len);
+
+	record[len++] = (uint8_t)crc;
+	record[len++] = (uint8_t)(crc >> 8);
+
+	// 3. COBS + delimiter
+	uint32_t frame_len = Telemetry_COBSEncode(record, len, frame);
+
+	frame[frame_len++] = 0x00;
+
+	pHandle->Output(frame, frame_len);
+
+	pHandle->records++;
+	pHandle->bytes += frame_len;
+
+	return DRV_OK;
+
+} /* End Telemetry_Send() */
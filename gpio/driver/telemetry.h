@@ -0,0 +1,86 @@
+
+#pragma once
+
+#include "stm32f407G.h"
+
+/*
+ * Goal: binary telemetry instead of printf() text
+ *
+ * "ch3 t=123456 v=-1234\n" is ~20 bytes for a 2 bytes sample, and
+ * formatting it costs thousands of cycles. Here the samples are sent
+ * raw, many samples of one channel in one record:
+ *
+ * 	Record (before framing), little endian:
+ *
+ * 		| seq | channel | type | count | timestamp (4) | payload | crc16 (2) |
+ *
+ * 		- seq: +1 at every record, the host sees the lost ones
+ * 		- type: size and sign of each sample (telemetry_type)
+ * 		- count: nb of samples in the payload
+ * 		- timestamp: DWT cycle counter when the record was built
+ * 		- crc16: CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF)
+ * 		  of everything before it
+ *
+ * 	Framing: COBS (Consistent Overhead Byte Stuffing)
+ * 		- removes every 0x00 from the record, for 1 byte of overhead
+ * 		  (per 254 bytes), then 0x00 ends the frame
+ * 		- the host resynchronises on the next 0x00 after an error,
+ * 		  printf text in the same stream is dropped by the CRC check
+ *
+ * 	With 16 samples of int16 per record: 8 + 32 + 2 + 2 = 44 bytes on
+ * 	the link, 2.75 bytes per sample
+ *
+ * The frames go to Output(), usually Retarget_Write() (retarget.h)
+ * so they use the same buffered backend as printf (USART DMA, ITM...)
+ *
+ * Host side: tools/telemetry_decode.py
+ *
+ * */
+
+#define TELEMETRY_HEADER_SIZE  8
+#define TELEMETRY_CRC_SIZE     2
+#define TELEMETRY_MAX_PAYLOAD  240   // record <= 254 bytes: 1 COBS overhead byte
+
+// record + COBS overhead + 0x00 delimiter
+#define TELEMETRY_MAX_FRAME (TELEMETRY_HEADER_SIZE + TELEMETRY_MAX_PAYLOAD + \
+							 TELEMETRY_CRC_SIZE + 2)
+
+// ------------ Coding states for the sample type ------------
+
+typedef enum Telemetry_Type {TELEMETRY_U8, TELEMETRY_I8, TELEMETRY_U16, TELEMETRY_I16,
+							 TELEMETRY_U32, TELEMETRY_I32, TELEMETRY_F32} telemetry_type;
+
+
+typedef struct{
+
+	// Filled by the user
+	uint32_t (*Output)(const uint8_t *pData, uint32_t Len);
+
+	// Filled by the driver
+	uint8_t seq;
+
+	uint32_t records;         // statistics
+	uint32_t bytes;
+	uint32_t rejected;        // bad type or too many samples
+
+} Telemetry_Handle_t;
+
+
+// ================== API ==================
+
+void Telemetry_Init(Telemetry_Handle_t *pHandle);
+
+/*
+ * Send Count samples of one channel in one frame
+ * Not reentrant: call it from one context only (main loop or one ISR)
+ * */
+drv_status Telemetry_Send(Telemetry_Handle_t *pHandle, uint8_t Channel,
+						  uint8_t Type, const void *pSamples, uint8_t Count);
+
+// Size in bytes of one sample of this type (0 for an unknown type)
+uint8_t Telemetry_TypeSize(uint8_t Type);
+
+// Building blocks, also usable alone
+uint16_t Telemetry_CRC16(uint16_t crc, const uint8_t *pData, uint32_t Len);
+
+uint32_t Telemetry_COBSEncode(const uint8_t *pSrc, uint32_t Len, uint8_t *pDst);
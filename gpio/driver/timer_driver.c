@@ -0,0 +1,653 @@
+#include "timer_driver.h"
+#include "gpio_driver.h"
+#include "rcc_driver.h"
+#include "nvic_driver.h"
+#include "dvfs.h"
+#include "clock_gate.h"
+
+
+// =============== Clock, IRQ and pins of each timer ===============
+
+/*
+ * 	- on_apb2 / bit: position in RCC_APBxENR and RCC_APBxRSTR
+ * 	  (sections 7.3.13, 7.3.14, 7.3.5 and 7.3.6)
+ * 	- irq: update event IRQ (vector table, section 12.2)
+ * 	- af: alternate function of the channel pins (datasheet, table 9)
+ * 	- channels: number of capture / compare channels
+ * */
+
+typedef struct{
+	TIM_RegDef_t *base;
+	uint8_t on_apb2;
+	uint8_t bit;
+	uint8_t irq;
+	uint8_t af;
+	uint8_t channels;
+	uint8_t bits32;
+	uint8_t advanced;
+} TIM_Map;
+
+static const TIM_Map tim_map[] = {
+	{TIM1,  1,  0, IRQ_NO_TIM1_UP_TIM10,      1, 4, 0, 1},
+	{TIM2,  0,  0, IRQ_NO_TIM2,               1, 4, 1, 0},
+	{TIM3,  0,  1, IRQ_NO_TIM3,               2, 4, 0, 0},
+	{TIM4,  0,  2, IRQ_NO_TIM4,               2, 4, 0, 0},
+	{TIM5,  0,  3, IRQ_NO_TIM5,               2, 4, 1, 0},
+	{TIM6,  0,  4, IRQ_NO_TIM6_DAC,           0, 0, 0, 0},
+	{TIM7,  0,  5, IRQ_NO_TIM7,               0, 0, 0, 0},
+	{TIM8,  1,  1, IRQ_NO_TIM8_UP_TIM13,      3, 4, 0, 1},
+	{TIM9,  1, 16, IRQ_NO_TIM1_BRK_TIM9,      3, 2, 0, 0},
+	{TIM10, 1, 17, IRQ_NO_TIM1_UP_TIM10,      3, 1, 0, 0},
+	{TIM11, 1, 18, IRQ_NO_TIM1_TRG_COM_TIM11, 3, 1, 0, 0},
+	{TIM12, 0,  6, IRQ_NO_TIM8_BRK_TIM12,     9, 2, 0, 0},
+	{TIM13, 0,  7, IRQ_NO_TIM8_UP_TIM13,      9, 1, 0, 0},
+	{TIM14, 0,  8, IRQ_NO_TIM8_TRG_COM_TIM14, 9, 1, 0, 0}
+};
+
+#define NB_TIM (sizeof(tim_map)/sizeof(tim_map[0]))
+
+// Clocks held by the driver until TIM_DeInit() (clock_gate.h)
+static uint32_t tim_clk_held[2];          // [on_apb2]
+static uint32_t tim_port_held[NB_TIM];    // GPIO ports of the timer pins
+
+
+/*
+ * TIMx_UP DMA requests (tables 42 and 43), only the 16 bits timers
+ * (see timer_driver.h for TIM2 / TIM5)
+ * */
+
+typedef struct{
+	TIM_RegDef_t *base;
+	DMA_RegDef_t *dma;
+	uint8_t stream;
+	uint8_t channel;
+} TIM_DMAMap;
+
+static const TIM_DMAMap tim_dma_map[] = {
+	{TIM1, DMA2, 5, 6},
+	{TIM3, DMA1, 2, 5},
+	{TIM4, DMA1, 6, 2},
+	{TIM8, DMA2, 1, 7}
+};
+
+#define NB_TIM_DMA (sizeof(tim_dma_map)/sizeof(tim_dma_map[0]))
+
+// TIMx_CH1 DMA requests (table 42), used by the input capture
+static const TIM_DMAMap tim_cc1_dma_map[] = {
+	{TIM2, DMA1, 5, 3},
+	{TIM3, DMA1, 4, 5},
+	{TIM4, DMA1, 0, 2},
+	{TIM5, DMA1, 2, 6}
+};
+
+#define NB_TIM_CC1_DMA (sizeof(tim_cc1_dma_map)/sizeof(tim_cc1_dma_map[0]))
+
+static const TIM_Map *TIM_FindMap(TIM_RegDef_t *pTIMx){
+
+	for (int i = 0; i < NB_TIM; ++i) {
+		if (tim_map[i].base == pTIMx)
+			return &tim_map[i];
+	}
+
+	return 0;
+
+} /* End TIM_FindMap() */
+
+
+static drv_status TIM_FindDMA(const TIM_DMAMap *pMap, uint32_t Nb,
+							  TIM_RegDef_t *pTIMx, DMA_Handle_t *pDMAHandle){
+
+	for (int i = 0; i < Nb; ++i) {
+
+		if (pMap[i].base == pTIMx){
+			pDMAHandle->pDMAx = pMap[i].dma;
+			pDMAHandle->Stream = pMap[i].stream;
+			pDMAHandle->DMA_Config.DMA_Channel = pMap[i].channel;
+			return DRV_OK;
+		}
+
+	} /* End for */
+
+	return DRV_ERROR;
+
+} /* End TIM_FindDMA() */
+
+
+/*
+ * End of a table
+ * 	- one shot: the stream is stopped, no more requests (UDE off)
+ * 	- double buffer: CT already points to the table now played,
+ * 	  the other one was just played and comes next
+ * */
+static void TIM_DMACallback(DMA_Handle_t *pDMAHandle, uint8_t event){
+
+	TIM_Handle_t *pTIMHandle = (TIM_Handle_t*)pDMAHandle->pContext;
+
+	if (event == DMA_EVENT_ERROR){
+		pTIMHandle->pTIMx->DIER &= ~(1 << TIM_DIER_UDE);
+		pTIMHandle->dma_errors++;
+		return;
+	}
+
+	if (event != DMA_EVENT_TRANSFER_COMPLETE)
+		return;
+
+	const uint16_t *pDone = pTIMHandle->pFrame[0];
+
+	if (pTIMHandle->DMAMode == TIM_DMA_ONESHOT)
+		pTIMHandle->pTIMx->DIER &= ~(1 << TIM_DIER_UDE);
+	else if (pTIMHandle->DMAMode == TIM_DMA_DOUBLE)
+		pDone = pTIMHandle->pFrame[DMA_GetCurrentTarget(pDMAHandle) ^ 1];
+
+	pTIMHandle->frames++;
+
+	if (pTIMHandle->FrameDone)
+		pTIMHandle->FrameDone(pTIMHandle, pDone);
+
+} /* End TIM_DMACallback() */
+
+// =========================================================
+
+
+void TIM_PeriClockControl(TIM_RegDef_t *pTIMx, uint8_t ON_OFF){
+
+	const TIM_Map *map = TIM_FindMap(pTIMx);
+
+	if (map == 0)
+		return;
+
+	CLK_PeriClockControl(map->on_apb2 ? CLK_APB2 : CLK_APB1, map->bit, ON_OFF);
+
+} /* End TIM_PeriClockControl() */
+
+
+void TIM_ClockHold(TIM_RegDef_t *pTIMx){
+
+	const TIM_Map *map = TIM_FindMap(pTIMx);
+
+	if (map == 0)
+		return;
+
+	CLK_Hold(&tim_clk_held[map->on_apb2], map->on_apb2 ? CLK_APB2 : CLK_APB1, map->bit);
+
+} /* End TIM_ClockHold() */
+
+
+void TIM_PortHold(TIM_RegDef_t *pTIMx, GPIO_RegDef_t *pGPIOx){
+
+	const TIM_Map *map = TIM_FindMap(pTIMx);
+
+	if (map != 0)
+		GPIO_ClockHold(pGPIOx, &tim_port_held[map - tim_map]);
+
+} /* End TIM_PortHold() */
+
+
+void TIM_DeInit(TIM_RegDef_t *pTIMx){
+
+	// same principle as GPIOx_RESET(): set then clear the reset bit
+	const TIM_Map *map = TIM_FindMap(pTIMx);
+
+	if (map == 0)
+		return;
+
+	__vo uint32_t *rstr = map->on_apb2 ? &RCC->APB2RSTR : &RCC->APB1RSTR;
+
+	*rstr |= (1 << map->bit);
+	*rstr &= ~(1 << map->bit);
+
+	// references of TIM_Init() / TIM_PinInit() and of the users of the timer
+	CLK_Drop(&tim_clk_held[map->on_apb2], map->on_apb2 ? CLK_APB2 : CLK_APB1, map->bit);
+	CLK_DropAll(&tim_port_held[map - tim_map], CLK_AHB1);
+
+} /* End TIM_DeInit() */
+
+
+uint32_t TIM_GetClock(TIM_RegDef_t *pTIMx){
+
+	const TIM_Map *map = TIM_FindMap(pTIMx);
+
+	if (map == 0)
+		return 0;
+
+	return map->on_apb2 ? RCC_GetTIMCLK2Value() : RCC_GetTIMCLK1Value();
+
+} /* End TIM_GetClock() */
+
+
+uint8_t TIM_GetIRQNumber(TIM_RegDef_t *pTIMx){
+
+	const TIM_Map *map = TIM_FindMap(pTIMx);
+
+	return map ? map->irq : 0;
+
+} /* End TIM_GetIRQNumber() */
+
+
+uint32_t TIM_SetFrequency(TIM_RegDef_t *pTIMx, uint32_t Frequency){
+
+	const TIM_Map *map = TIM_FindMap(pTIMx);
+
+	if (map == 0 || Frequency == 0)
+		return 0;
+
+	uint32_t clk = TIM_GetClock(pTIMx);
+	uint32_t ticks = (clk + Frequency / 2) / Frequency;
+
+	// ARR = 0 blocks the counter, 2 ticks is the shortest period
+	if (ticks < 2)
+		return 0;
+
+	/*
+	 * Smallest prescaler which lets ARR fit in the counter
+	 * (16 bits, 32 bits on TIM2 / TIM5): largest ARR, best resolution
+	 * */
+	uint32_t psc = map->bits32 ? 0 : (ticks - 1) / 65536;
+	uint32_t arr = ticks / (psc + 1) - 1;
+
+	/*
+	 * URS = 1: the UG below loads PSC and ARR without making an
+	 * update interrupt / DMA request. ARPE = 1: later ARR writes
+	 * wait for the end of the period
+	 * */
+	pTIMx->CR1 |= (1 << TIM_CR1_URS) | (1 << TIM_CR1_ARPE);
+	pTIMx->PSC = psc;
+	pTIMx->ARR = arr;
+	pTIMx->EGR = (1 << TIM_EGR_UG);
+	pTIMx->SR = 0;
+
+	return clk / ((psc + 1) * (arr + 1));
+
+} /* End TIM_SetFrequency() */
+
+
+void TIM_SetTrgo(TIM_RegDef_t *pTIMx, uint8_t Trgo){
+
+	pTIMx->CR2 = (pTIMx->CR2 & ~(0x7 << TIM_CR2_MMS)) | ((uint32_t)(Trgo & 0x7) << TIM_CR2_MMS);
+
+} /* End TIM_SetTrgo() */
+
+
+drv_status TIM_Init(TIM_Handle_t *pTIMHandle){
+
+	TIM_RegDef_t *pTIMx = pTIMHandle->pTIMx;
+	TIM_Config_t *pConf = &pTIMHandle->TIM_Config;
+
+	const TIM_Map *map = TIM_FindMap(pTIMx);
+
+	if (map == 0)
+		return DRV_ERROR;
+
+	pTIMHandle->updates = 0;
+
+	TIM_ClockHold(pTIMx);
+
+	// 1. Stopped, counting up, no interrupt while configuring
+	pTIMx->CR1 = 0;
+	pTIMx->DIER = 0;
+
+	pTIMHandle->Frequency = TIM_SetFrequency(pTIMx, pConf->TIM_Frequency);
+
+	if (pTIMHandle->Frequency == 0)
+		return DRV_ERROR;
+
+	// 2. One pulse: CEN cleared by the hardware at the update event
+	if (pConf->TIM_OnePulse == ON)
+		pTIMx->CR1 |= (1 << TIM_CR1_OPM);
+
+	// 3. Update interrupt
+	if (pConf->TIM_UpdateIT == ON){
+		pTIMx->DIER |= (1 << TIM_DIER_UIE);
+		NVIC_IRQInterruptConfig(map->irq, ON);
+	}
+
+	return DRV_OK;
+
+} /* End TIM_Init() */
+
+
+void TIM_Start(TIM_Handle_t *pTIMHandle){
+
+	pTIMHandle->pTIMx->CR1 |= (1 << TIM_CR1_CEN);
+
+} /* End TIM_Start() */
+
+
+void TIM_Stop(TIM_Handle_t *pTIMHandle){
+
+	pTIMHandle->pTIMx->CR1 &= ~(1 << TIM_CR1_CEN);
+
+} /* End TIM_Stop() */
+
+
+void TIM_StartOnePulse(TIM_Handle_t *pTIMHandle){
+
+	TIM_RegDef_t *pTIMx = pTIMHandle->pTIMx;
+
+	// a pulse in progress is not restarted
+	if (pTIMx->CR1 & (1 << TIM_CR1_CEN))
+		return;
+
+	pTIMx->CNT = 0;
+	pTIMx->CR1 |= (1 << TIM_CR1_OPM) | (1 << TIM_CR1_CEN);
+
+} /* End TIM_StartOnePulse() */
+
+
+drv_status TIM_PWMInit(TIM_Handle_t *pTIMHandle, uint8_t Channel,
+					   uint8_t Mode, uint8_t Polarity,
+					   GPIO_RegDef_t *pGPIOx, uint8_t PinNumber){
+
+	TIM_RegDef_t *pTIMx = pTIMHandle->pTIMx;
+
+	const TIM_Map *map = TIM_FindMap(pTIMx);
+
+	if (map == 0 || Channel == 0 || Channel > map->channels)
+		return DRV_ERROR;
+
+	uint8_t idx = Channel - 1;
+
+	/*
+	 * 1. CCMR1 holds channels 1 and 2, CCMR2 channels 3 and 4,
+	 *    8 bits each: CCxS = 00 (output), OCxPE = 1 (preload), OCxM
+	 * */
+	__vo uint32_t *ccmr = (idx < 2) ? &pTIMx->CCMR1 : &pTIMx->CCMR2;
+	uint8_t shift = 8 * (idx % 2);
+
+	*ccmr &= ~(0xFFU << shift);
+	*ccmr |= ((((uint32_t)(Mode & 0x7) << TIM_CCMR_OCM) | (1 << TIM_CCMR_OCPE)) << shift);
+
+	pTIMx->CCR[idx] = 0;
+
+	// 2. CCER: output enable and polarity, 4 bits per channel
+	pTIMx->CCER &= ~(0xFU << (4 * idx));
+	pTIMx->CCER |= (((1 << TIM_CCER_CCE) | ((Polarity & 0x1) << TIM_CCER_CCP)) << (4 * idx));
+
+	// 3. TIM1 / TIM8: outputs only driven once MOE = 1 (section 17.4.18)
+	if (map->advanced)
+		pTIMx->BDTR |= (1 << TIM_BDTR_MOE);
+
+	// 4. The pin
+	return TIM_PinInit(pTIMx, pGPIOx, PinNumber, NO_PULLUP);
+
+} /* End TIM_PWMInit() */
+
+
+drv_status TIM_PinInit(TIM_RegDef_t *pTIMx, GPIO_RegDef_t *pGPIOx,
+					   uint8_t PinNumber, uint8_t PuPd){
+
+	const TIM_Map *map = TIM_FindMap(pTIMx);
+
+	if (map == 0 || map->channels == 0)
+		return DRV_ERROR;
+
+	GPIO_Handle_t pin;
+
+	GPIO_ClockHold(pGPIOx, &tim_port_held[map - tim_map]);
+
+	pin.gpio_reg_x = pGPIOx;
+	pin.gpio_pin_conf.GPIO_PinNumber = PinNumber;
+	pin.gpio_pin_conf.GPIO_PinMode = ALT;
+	pin.gpio_pin_conf.GPIO_PinSpeed = HIGH;
+	pin.gpio_pin_conf.GPIO_PinOPType = PUSH_PULL;
+	pin.gpio_pin_conf.GPIO_PinPuPdControl = PuPd;
+	pin.gpio_pin_conf.GPIO_PinAltFunMode = map->af;
+
+	GPIO_Init(&pin);
+
+	return DRV_OK;
+
+} /* End TIM_PinInit() */
+
+
+drv_status TIM_ICInit(TIM_RegDef_t *pTIMx, uint8_t Channel, uint8_t Input,
+					  uint8_t Edge, uint8_t Filter){
+
+	const TIM_Map *map = TIM_FindMap(pTIMx);
+
+	if (map == 0 || Channel == 0 || Channel > map->channels ||
+		Input < TIM_IC_DIRECT || Input > TIM_IC_INDIRECT || Filter > 15)
+		return DRV_ERROR;
+
+	uint8_t idx = Channel - 1;
+
+	// 1. Channel off while its direction changes (CCxS is writable only then)
+	pTIMx->CCER &= ~(0xFU << (4 * idx));
+
+	/*
+	 * 2. CCMRx input bits: CCxS = Input, ICxPSC = 0 (every edge),
+	 *    ICxF = Filter (N samples at the same level, section 18.4.7)
+	 * */
+	__vo uint32_t *ccmr = (idx < 2) ? &pTIMx->CCMR1 : &pTIMx->CCMR2;
+	uint8_t shift = 8 * (idx % 2);
+
+	*ccmr &= ~(0xFFU << shift);
+	*ccmr |= ((((uint32_t)Input << TIM_CCMR_CCS) | ((uint32_t)Filter << TIM_CCMR_ICF)) << shift);
+
+	// 3. Edge: CCxP / CCxNP = 00 rising, 01 falling, 11 both
+	uint32_t ccer = (1 << TIM_CCER_CCE);
+
+	if (Edge == TIM_IC_FALLING)
+		ccer |= (1 << TIM_CCER_CCP);
+	else if (Edge == TIM_IC_BOTH)
+		ccer |= (1 << TIM_CCER_CCP) | (1 << TIM_CCER_CCNP);
+
+	pTIMx->CCER |= (ccer << (4 * idx));
+
+	return DRV_OK;
+
+} /* End TIM_ICInit() */
+
+
+void TIM_SetCompare(TIM_RegDef_t *pTIMx, uint8_t Channel, uint32_t Value){
+
+	if (Channel == 0 || Channel > 4)
+		return;
+
+	pTIMx->CCR[Channel - 1] = Value;
+
+} /* End TIM_SetCompare() */
+
+
+void TIM_SetDuty(TIM_Handle_t *pTIMHandle, uint8_t Channel, uint16_t Duty){
+
+	if (Duty > TIM_DUTY_MAX)
+		Duty = TIM_DUTY_MAX;
+
+	// ARR + 1 ticks per period, CCR = ARR + 1 is 100 % in mode 1
+	uint32_t period = pTIMHandle->pTIMx->ARR + 1;
+
+	TIM_SetCompare(pTIMHandle->pTIMx, Channel,
+				   (uint32_t)(((uint64_t)period * Duty) / TIM_DUTY_MAX));
+
+} /* End TIM_SetDuty() */
+
+
+drv_status TIM_GetUpdateDMA(TIM_RegDef_t *pTIMx, DMA_Handle_t *pDMAHandle){
+
+	return TIM_FindDMA(tim_dma_map, NB_TIM_DMA, pTIMx, pDMAHandle);
+
+} /* End TIM_GetUpdateDMA() */
+
+
+drv_status TIM_GetCaptureDMA(TIM_RegDef_t *pTIMx, DMA_Handle_t *pDMAHandle){
+
+	return TIM_FindDMA(tim_cc1_dma_map, NB_TIM_CC1_DMA, pTIMx, pDMAHandle);
+
+} /* End TIM_GetCaptureDMA() */
+
+
+drv_status TIM_DMAInit(TIM_Handle_t *pTIMHandle, uint8_t Channel, uint8_t Mode){
+
+	DMA_Handle_t *pDMA = &pTIMHandle->dma;
+
+	if (Channel == 0 || Channel > 4 || Mode > TIM_DMA_DOUBLE)
+		return DRV_ERROR;
+
+	if (TIM_GetUpdateDMA(pTIMHandle->pTIMx, pDMA) != DRV_OK)
+		return DRV_ERROR;
+
+	pTIMHandle->DMAMode = Mode;
+	pTIMHandle->DMAChannel = Channel;
+	pTIMHandle->frames = 0;
+	pTIMHandle->dma_errors = 0;
+
+	/*
+	 * Memory to CCRx, 16 bits both sides (direct mode), one value per
+	 * request. High priority: a late write makes a period repeat its
+	 * duty, for WS2812 a wrong bit
+	 * */
+	pDMA->DMA_Config.DMA_Direction = DMA_DIR_MEM_TO_PERIPH;
+	pDMA->DMA_Config.DMA_PeriphInc = OFF;
+	pDMA->DMA_Config.DMA_MemInc = ON;
+	pDMA->DMA_Config.DMA_PeriphDataSize = DMA_SIZE_HALFWORD;
+	pDMA->DMA_Config.DMA_MemDataSize = DMA_SIZE_HALFWORD;
+	pDMA->DMA_Config.DMA_Circular = (Mode == TIM_DMA_ONESHOT) ? OFF : ON;
+	pDMA->DMA_Config.DMA_DoubleBuffer = (Mode == TIM_DMA_DOUBLE) ? ON : OFF;
+	pDMA->DMA_Config.DMA_Priority = DMA_PRIO_HIGH;
+	pDMA->DMA_Config.DMA_HalfTransferIT = OFF;
+	pDMA->DMA_Config.DMA_FIFOMode = OFF;
+	pDMA->Callback = TIM_DMACallback;
+	pDMA->pContext = pTIMHandle;
+
+	return DMA_Init(pDMA);
+
+} /* End TIM_DMAInit() */
+
+
+drv_status TIM_DMAStart(TIM_Handle_t *pTIMHandle, const uint16_t *pBuf0,
+						const uint16_t *pBuf1, uint16_t Len){
+
+	TIM_RegDef_t *pTIMx = pTIMHandle->pTIMx;
+
+	if (Len == 0 || pBuf0 == 0 || (pTIMHandle->DMAMode == TIM_DMA_DOUBLE && pBuf1 == 0))
+		return DRV_ERROR;
+
+	if (TIM_DMABusy(pTIMHandle))
+		return DRV_BUSY;
+
+	pTIMHandle->pFrame[0] = pBuf0;
+	pTIMHandle->pFrame[1] = pBuf1;
+
+	// requests off while the stream is (re)armed, no request is lost
+	pTIMx->DIER &= ~(1 << TIM_DIER_UDE);
+
+	if (DMA_Start(&pTIMHandle->dma, (uint32_t)&pTIMx->CCR[pTIMHandle->DMAChannel - 1],
+				  (uint32_t)pBuf0, (uint32_t)pBuf1, Len) != DRV_OK)
+		return DRV_ERROR;
+
+	// first request at the next update event
+	pTIMx->DIER |= (1 << TIM_DIER_UDE);
+
+	return DRV_OK;
+
+} /* End TIM_DMAStart() */
+
+
+void TIM_DMAStop(TIM_Handle_t *pTIMHandle){
+
+	pTIMHandle->pTIMx->DIER &= ~(1 << TIM_DIER_UDE);
+
+	DMA_Release(&pTIMHandle->dma);
+
+} /* End TIM_DMAStop() */
+
+
+uint8_t TIM_DMABusy(TIM_Handle_t *pTIMHandle){
+
+	return (pTIMHandle->pTIMx->DIER & (1 << TIM_DIER_UDE)) ? 1 : 0;
+
+} /* End TIM_DMABusy() */
+
+
+void TIM_DelayUs(TIM_RegDef_t *pTIMx, uint32_t Us){
+
+	// clock held during the delay only
+	TIM_PeriClockControl(pTIMx, ON);
+
+	/*
+	 * 0.5 us ticks, so even 1 us gives ARR = 1 (ARR = 0 blocks the
+	 * counter). The delay is cut in pieces of 32767 us (16 bits ARR)
+	 * */
+	pTIMx->CR1 = (1 << TIM_CR1_OPM) | (1 << TIM_CR1_URS);
+	pTIMx->DIER = 0;
+	pTIMx->PSC = TIM_GetClock(pTIMx) / 2000000 - 1;
+
+	while (Us){
+
+		uint32_t n = (Us > 32767) ? 32767 : Us;
+
+		pTIMx->ARR = 2 * n - 1;
+		pTIMx->EGR = (1 << TIM_EGR_UG);
+		pTIMx->CR1 |= (1 << TIM_CR1_CEN);
+
+		while (pTIMx->CR1 & (1 << TIM_CR1_CEN));
+
+		Us -= n;
+
+	} /* End while */
+
+	TIM_PeriClockControl(pTIMx, OFF);
+
+} /* End TIM_DelayUs() */
+
+
+void TIM_IRQHandling(TIM_Handle_t *pTIMHandle){
+
+	TIM_RegDef_t *pTIMx = pTIMHandle->pTIMx;
+
+	// IRQ shared with another timer on TIM1, TIM6..TIM14
+	if (!(pTIMx->SR & (1 << TIM_SR_UIF)) || !(pTIMx->DIER & (1 << TIM_DIER_UIE)))
+		return;
+
+	// rc_w0 bits: writing 1 leaves the other flags untouched
+	pTIMx->SR = ~(1U << TIM_SR_UIF);
+
+	pTIMHandle->updates++;
+
+	if (pTIMHandle->Callback)
+		pTIMHandle->Callback(pTIMHandle);
+
+} /* End TIM_IRQHandling() */
+
+
+/*
+ * Clock change (dvfs.h): PSC / ARR computed again for the same
+ * TIM_Frequency, the compare values scaled by the new period so the
+ * duties stay the same. The counter restarts at 0 (UG).
+ * A DMA table in progress holds CCR values for the old period: the
+ * switch waits for its end
+ * */
+drv_status TIM_DVFSNotify(uint8_t Event, void *pContext){
+
+	TIM_Handle_t *pTIMHandle = pContext;
+	TIM_RegDef_t *pTIMx = pTIMHandle->pTIMx;
+
+	if (Event == DVFS_PRE_CHANGE)
+		return TIM_DMABusy(pTIMHandle) ? DRV_BUSY : DRV_OK;
+
+	if (Event != DVFS_POST_CHANGE || pTIMHandle->Frequency == 0)
+		return DRV_OK;
+
+	uint32_t old_period = pTIMx->ARR + 1;
+	uint32_t ccr[4];
+
+	for (uint8_t i = 0; i < 4; ++i)
+		ccr[i] = pTIMx->CCR[i];
+
+	pTIMHandle->Frequency = TIM_SetFrequency(pTIMx, pTIMHandle->TIM_Config.TIM_Frequency);
+
+	if (pTIMHandle->Frequency == 0)
+		return DRV_ERROR;
+
+	uint32_t new_period = pTIMx->ARR + 1;
+
+	for (uint8_t i = 0; i < 4; ++i)
+		pTIMx->CCR[i] = (uint32_t)(((uint64_t)ccr[i] * new_period) / old_period);
+
+	// preloaded compare values (OCxPE) loaded now, not at the next update
+	pTIMx->EGR = (1 << TIM_EGR_UG);
+
+	return DRV_OK;
+
+} /* End TIM_DVFSNotify() */
@@ -0,0 +1,220 @@
+
+#pragma once
+
+#include "stm32f407G.h"
+#include "dma_driver.h"
+
+/*
+ * Timer driver: time base, PWM outputs, update interrupt, one pulse
+ *
+ * 	Time base (section 18.3.1): the counter counts timer clock ticks
+ * 	divided by PSC+1, from 0 up to ARR, then restarts at 0 and makes
+ * 	an update event (UEV):
+ *
+ * 		f_update = f_timer / ((PSC + 1) * (ARR + 1))
+ *
+ * 	f_timer is the APB clock, x2 when the APB prescaler is not 1
+ * 	(RCC_GetTIMCLK1Value() / RCC_GetTIMCLK2Value(), derived from
+ * 	SystemCoreClock). TIM_SetFrequency() takes the smallest PSC, so
+ * 	ARR is as large as possible: best PWM duty resolution
+ *
+ * 	PWM (section 18.3.9): mode 1, the output is active while CNT < CCRx,
+ * 	duty = CCRx / (ARR + 1). CCRx is preloaded, a new duty is taken at
+ * 	the next update event, so a period is never cut. The pin is
+ * 	switched in ALT mode with the AF of the timer, after that the
+ * 	hardware does everything: no CPU, no GPIO_ToggleOutputPin()
+ *
+ * 	One pulse mode (OPM): the counter stops by itself (CEN = 0) at the
+ * 	next update event, TIM_StartOnePulse() then gives one period:
+ * 		- with a PWM channel in mode 2, a pulse of (ARR + 1 - CCRx) ticks
+ * 		  after a delay of CCRx ticks
+ * 		- TIM_DelayUs() uses it as a precise delay, instead of the
+ * 		  empty for loops (their duration depends on the compiler)
+ *
+ * 	Timers (AF, channels): TIM1/TIM8 advanced (AF1/AF3, 4 ch),
+ * 	TIM2..TIM5 (AF1/AF2, 4 ch, TIM2 and TIM5 have a 32 bits counter),
+ * 	TIM6/TIM7 basic (no channel), TIM9..TIM14 (AF3/AF9, 1 or 2 ch)
+ *
+ * 	DMA duty updates (waveforms, WS2812 LED strips): the update event
+ * 	makes a DMA request (UDE), the stream writes the next value of a
+ * 	table into CCRx, so each period gets its own duty with no CPU work.
+ * 	CCRx is preloaded: a value written during period n is used in
+ * 	period n + 1, so the output follows the table one period late
+ * 	(the first period of TIM_DMAStart() uses the CCRx of before)
+ * 		- TIM_DMA_ONESHOT: the table once, then the stream stops and
+ * 		  the last value stays in CCRx -> end the table with the idle
+ * 		  value (0 for WS2812)
+ * 		- TIM_DMA_CONTINUOUS: the table in a loop (waveform generator)
+ * 		- TIM_DMA_DOUBLE: two tables in turn (double buffer mode of the
+ * 		  DMA). FrameDone gets the table just played, it plays again
+ * 		  after the current one: refill it before the current one ends
+ * 	Tables are uint16_t, only the 16 bits timers with an UP request:
+ * 	TIM1 (DMA2 stream 5 ch 6), TIM3 (DMA1 stream 2 ch 5), TIM4 (DMA1
+ * 	stream 6 ch 2), TIM8 (DMA2 stream 1 ch 7). On TIM2 / TIM5 the APB
+ * 	bridge would copy a 16 bits write in both halves of the 32 bits CCR
+ *
+ * 	Input capture (section 18.3.6): the channel copies CNT into CCRx at
+ * 	each selected edge of its input (TI1 for CH1, or TI2 with
+ * 	TIM_IC_INDIRECT: two channels can then capture both edges of the
+ * 	same pin). The edge is timed by the hardware, the CPU can read the
+ * 	captures later, or let the DMA do it (input_capture.h)
+ *
+ * 	Discovery: LEDs PD12..PD15 = TIM4 CH1..CH4 (AF2)
+ *
+ * IRQ handler, example TIM4:
+ *
+ * 		void TIM4_IRQHandler(void){ TIM_IRQHandling(&tim4); }
+ * 		void DMA1_Stream6_IRQHandler(void){ DMA_IRQHandling(&tim4.dma); }
+ *
+ * */
+
+#define TIM_DUTY_MAX 10000    // duty in 0.01 %, 10000 -> 100 %
+
+// ------------ Coding states for timer configuration ------------
+
+// OCxM bits: PWM mode 1 (active while CNT < CCR) and 2 (the opposite)
+typedef enum TIM_PWMMode {TIM_PWM_MODE1 = 6, TIM_PWM_MODE2 = 7} tim_pwm_mode;
+
+// CCxP bit: active level of the output
+typedef enum TIM_Polarity {TIM_POL_HIGH, TIM_POL_LOW} tim_polarity;
+
+// MMS bits of CR2: what goes out on TRGO (ADC / DAC / other timers)
+typedef enum TIM_Trgo {TIM_TRGO_RESET, TIM_TRGO_ENABLE, TIM_TRGO_UPDATE} tim_trgo;
+
+// CCxS bits of an input: TIx of the same channel or of the neighbour
+typedef enum TIM_ICInput {TIM_IC_DIRECT = 1, TIM_IC_INDIRECT = 2} tim_ic_input;
+
+// CCxP / CCxNP bits of an input: edge(s) captured
+typedef enum TIM_ICEdge {TIM_IC_RISING, TIM_IC_FALLING, TIM_IC_BOTH} tim_ic_edge;
+
+// How the DMA plays the CCR tables
+typedef enum TIM_DMAMode {TIM_DMA_ONESHOT, TIM_DMA_CONTINUOUS, TIM_DMA_DOUBLE} tim_dma_mode;
+
+
+typedef struct{
+
+	uint32_t TIM_Frequency;   // update events per second (= PWM frequency)
+	uint8_t TIM_OnePulse;     // ON / OFF
+	uint8_t TIM_UpdateIT;     // ON / OFF, Callback called at each update
+
+} TIM_Config_t;
+
+
+typedef struct TIM_Handle TIM_Handle_t;
+
+typedef void (*tim_callback_t)(TIM_Handle_t *pTIMHandle);
+
+// pFrame: the table just played, called from the DMA ISR
+typedef void (*tim_frame_cb_t)(TIM_Handle_t *pTIMHandle, const uint16_t *pFrame);
+
+struct TIM_Handle{
+
+	TIM_RegDef_t *pTIMx;
+	// TIM1 .. TIM14
+
+	TIM_Config_t TIM_Config;
+
+	tim_callback_t Callback;   // called from TIM_IRQHandling()
+	void *pContext;
+
+	tim_frame_cb_t FrameDone;  // DMA duty updates only, can be 0
+
+	// Filled by the driver
+	uint32_t Frequency;        // real frequency, after rounding
+	__vo uint32_t updates;
+
+	DMA_Handle_t dma;          // DMA duty updates
+	uint8_t DMAMode;
+	uint8_t DMAChannel;
+	const uint16_t *pFrame[2]; // tables of M0AR / M1AR
+	__vo uint32_t frames;
+	__vo uint32_t dma_errors;
+
+};
+
+
+// ================== API ==================
+
+void TIM_PeriClockControl(TIM_RegDef_t *pTIMx, uint8_t ON_OFF);
+
+// Reset of the timer, gives back the clocks held by the driver for it
+void TIM_DeInit(TIM_RegDef_t *pTIMx);
+
+/*
+ * For the drivers built on a timer (ADC trigger, capture, pattern
+ * generator,...): one reference on the timer clock, and on the GPIO
+ * ports paced by it, kept until TIM_DeInit(), an Init called again
+ * takes no new one (clock_gate.h)
+ * */
+void TIM_ClockHold(TIM_RegDef_t *pTIMx);
+
+void TIM_PortHold(TIM_RegDef_t *pTIMx, GPIO_RegDef_t *pGPIOx);
+
+// Clock of the counter before the prescaler (Hz)
+uint32_t TIM_GetClock(TIM_RegDef_t *pTIMx);
+
+// IRQ of the update event (shared with another timer for TIM1, 6..14)
+uint8_t TIM_GetIRQNumber(TIM_RegDef_t *pTIMx);
+
+/*
+ * PSC / ARR for Frequency update events per second, loaded at once
+ * (UG), the counter must be stopped. Returns the real frequency,
+ * 0 if it can't be made. Also used by the ADC driver for its trigger
+ * */
+uint32_t TIM_SetFrequency(TIM_RegDef_t *pTIMx, uint32_t Frequency);
+
+void TIM_SetTrgo(TIM_RegDef_t *pTIMx, uint8_t Trgo);
+
+drv_status TIM_Init(TIM_Handle_t *pTIMHandle);
+
+void TIM_Start(TIM_Handle_t *pTIMHandle);
+
+void TIM_Stop(TIM_Handle_t *pTIMHandle);
+
+// One period only (TIM_OnePulse = ON), returns at once
+void TIM_StartOnePulse(TIM_Handle_t *pTIMHandle);
+
+// Channel 1..4 in PWM, pin in ALT mode with the AF of the timer
+drv_status TIM_PWMInit(TIM_Handle_t *pTIMHandle, uint8_t Channel,
+					   uint8_t Mode, uint8_t Polarity,
+					   GPIO_RegDef_t *pGPIOx, uint8_t PinNumber);
+
+// Pin in ALT mode with the AF of the timer (PuPd: NO_PULLUP, PULLUP,...)
+drv_status TIM_PinInit(TIM_RegDef_t *pTIMx, GPIO_RegDef_t *pGPIOx,
+					   uint8_t PinNumber, uint8_t PuPd);
+
+// Channel 1..4 as input capture, Filter 0..15 (ICxF), pin with TIM_PinInit()
+drv_status TIM_ICInit(TIM_RegDef_t *pTIMx, uint8_t Channel, uint8_t Input,
+					  uint8_t Edge, uint8_t Filter);
+
+// Duty in 0..TIM_DUTY_MAX, taken at the next update event
+void TIM_SetDuty(TIM_Handle_t *pTIMHandle, uint8_t Channel, uint16_t Duty);
+
+// Raw compare value (0..ARR+1)
+void TIM_SetCompare(TIM_RegDef_t *pTIMx, uint8_t Channel, uint32_t Value);
+
+// DMA controller, stream and channel of the TIMx_UP request
+drv_status TIM_GetUpdateDMA(TIM_RegDef_t *pTIMx, DMA_Handle_t *pDMAHandle);
+
+// DMA controller, stream and channel of the TIMx_CH1 request (TIM2..TIM5)
+drv_status TIM_GetCaptureDMA(TIM_RegDef_t *pTIMx, DMA_Handle_t *pDMAHandle);
+
+// Channel (already in PWM) fed by the DMA at each update event
+drv_status TIM_DMAInit(TIM_Handle_t *pTIMHandle, uint8_t Channel, uint8_t Mode);
+
+// pBuf1 only in TIM_DMA_DOUBLE, Len values per table, the timer must run
+drv_status TIM_DMAStart(TIM_Handle_t *pTIMHandle, const uint16_t *pBuf0,
+						const uint16_t *pBuf1, uint16_t Len);
+
+void TIM_DMAStop(TIM_Handle_t *pTIMHandle);
+
+// 1 while a table is being played
+uint8_t TIM_DMABusy(TIM_Handle_t *pTIMHandle);
+
+// Busy wait on a basic timer (TIM6 / TIM7) in one pulse mode, 1 us ticks
+void TIM_DelayUs(TIM_RegDef_t *pTIMx, uint32_t Us);
+
+void TIM_IRQHandling(TIM_Handle_t *pTIMHandle);
+
+// dvfs_callback_t, pContext = the TIM_Handle_t: same frequency and duties after a clock change
+drv_status TIM_DVFSNotify(uint8_t Event, void *pContext);
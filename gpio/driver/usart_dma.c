@@ -0,0 +1,554 @@
+#include "usart_dma.h"
+#include "nvic_driver.h"
+#include "usart_driver.h"
+#include "mem_pool.h"
+#include <string.h>
+
+
+// =============== DMA request of each USART ===============
+
+/*
+ * See table 42 (DMA1) and table 43 (DMA2) in the reference manual
+ * Example: USART2_TX -> DMA1, stream 6, channel 4
+ * */
+
+typedef struct{
+	USART_RegDef_t *base;
+	DMA_RegDef_t *dma;
+	uint8_t tx_stream;
+	uint8_t tx_channel;
+	uint8_t rx_stream;
+	uint8_t rx_channel;
+} USART_DMA_Map;
+
+static const USART_DMA_Map usart_dma_map[] = {
+	{USART1, DMA2, 7, 4, 2, 4},
+	{USART2, DMA1, 6, 4, 5, 4},
+	{USART3, DMA1, 3, 4, 1, 4},
+	{UART4,  DMA1, 4, 4, 2, 4},
+	{UART5,  DMA1, 7, 4, 0, 4},
+	{USART6, DMA2, 6, 5, 1, 5}
+};
+
+#define NB_USART_DMA (sizeof(usart_dma_map)/sizeof(usart_dma_map[0]))
+
+static const USART_DMA_Map *USART_DMA_FindMap(USART_RegDef_t *pUSARTx){
+
+	for (int i = 0; i < NB_USART_DMA; ++i) {
+		if (usart_dma_map[i].base == pUSARTx)
+			return &usart_dma_map[i];
+	}
+
+	return 0;
+
+} /* End USART_DMA_FindMap() */
+
+
+// DMA_Start() refuses a CCM buffer (mem_sections.h) or a stream still enabled
+static drv_status USART_DMA_StartDesc(USART_DMA_Handle_t *pHandle, USART_TxDesc_t *pDesc){
+
+	return DMA_Start(&pHandle->tx_dma, (uint32_t)&pHandle->pUSARTx->DR,
+					 (uint32_t)pDesc->pData, 0, pDesc->Len);
+
+} /* End USART_DMA_StartDesc() */
+
+
+/*
+ * Called by DMA_IRQHandling() of the TX stream
+ * */
+static void USART_DMA_TxCallback(DMA_Handle_t *pDMAHandle, uint8_t event){
+
+	USART_DMA_Handle_t *pHandle = (USART_DMA_Handle_t*)pDMAHandle->pContext;
+
+	// ---- Double buffer mode ----
+
+	if (pHandle->TxMode == USART_DMA_TX_DOUBLE_BUF){
+
+		if (event != DMA_EVENT_TRANSFER_COMPLETE)
+			return;
+
+		/*
+		 * At the end of a buffer the DMA switches CT by itself,
+		 * so the buffer just sent is the one CT does not point to
+		 * */
+		uint8_t free_buffer = DMA_GetCurrentTarget(pDMAHandle) ^ 1;
+
+		pHandle->tx_bytes += pHandle->DBufLen;
+
+		if (pHandle->DBufCallback)
+			pHandle->DBufCallback(pHandle, free_buffer);
+
+		return;
+
+	} /* End if double buffer */
+
+	// ---- Queue mode ----
+
+	if (event == DMA_EVENT_HALF_TRANSFER)
+		return;
+
+	USART_TxDesc_t *pDone = pHandle->pTxHead;
+
+	if (pDone == 0)
+		return;
+
+	if (event == DMA_EVENT_ERROR){
+		pDone->Status = DRV_ERROR;
+	} else {
+		pDone->Status = DRV_OK;
+		pHandle->tx_bytes += pDone->Len;
+	}
+
+	/*
+	 * Chain the next buffer before calling Done, the line never stays
+	 * idle. A buffer refused by the DMA ends with DRV_ERROR, the one
+	 * after it is tried, otherwise the queue would wait for a TC
+	 * interrupt which never comes
+	 * */
+	USART_TxDesc_t *pRefused = pDone->pNext;
+	USART_TxDesc_t *pNext = pRefused;
+
+	while (pNext && USART_DMA_StartDesc(pHandle, pNext) != DRV_OK){
+		pNext->Status = DRV_ERROR;
+		pNext = pNext->pNext;
+	}
+
+	pHandle->pTxHead = pNext;
+
+	if (pNext == 0)
+		pHandle->pTxTail = 0;
+
+	if (pDone->Done)
+		pDone->Done(pDone);
+
+	// the refused ones, in the queue order (Done may free the descriptor)
+	while (pRefused != pNext){
+
+		USART_TxDesc_t *pFollow = pRefused->pNext;
+
+		if (pRefused->Done)
+			pRefused->Done(pRefused);
+
+		pRefused = pFollow;
+
+	} /* End while refused */
+
+} /* End USART_DMA_TxCallback() */
+
+// =========================================================
+
+
+drv_status USART_DMA_TxInit(USART_DMA_Handle_t *pHandle, USART_RegDef_t *pUSARTx){
+
+	const USART_DMA_Map *map = USART_DMA_FindMap(pUSARTx);
+
+	if (map == 0)
+		return DRV_ERROR;
+
+	pHandle->pUSARTx = pUSARTx;
+	pHandle->TxMode = USART_DMA_TX_QUEUE;
+	pHandle->pTxHead = 0;
+	pHandle->pTxTail = 0;
+	pHandle->DBufCallback = 0;
+	pHandle->tx_bytes = 0;
+
+	// 1. TX stream: memory -> USART DR, 1 byte at a time
+	DMA_Handle_t *pDMA = &pHandle->tx_dma;
+
+	pDMA->pDMAx = map->dma;
+	pDMA->Stream = map->tx_stream;
+	pDMA->DMA_Config.DMA_Channel = map->tx_channel;
+	pDMA->DMA_Config.DMA_Direction = DMA_DIR_MEM_TO_PERIPH;
+	pDMA->DMA_Config.DMA_PeriphInc = OFF;
+	pDMA->DMA_Config.DMA_MemInc = ON;
+	pDMA->DMA_Config.DMA_PeriphDataSize = DMA_SIZE_BYTE;
+	pDMA->DMA_Config.DMA_MemDataSize = DMA_SIZE_BYTE;
+	pDMA->DMA_Config.DMA_Circular = OFF;
+	pDMA->DMA_Config.DMA_DoubleBuffer = OFF;
+	pDMA->DMA_Config.DMA_Priority = DMA_PRIO_HIGH;
+	pDMA->DMA_Config.DMA_HalfTransferIT = OFF;
+	pDMA->DMA_Config.DMA_FIFOMode = OFF;
+	pDMA->Callback = USART_DMA_TxCallback;
+	pDMA->pContext = pHandle;
+
+	// DRV_BUSY: the stream is taken by another driver (dma_driver.h)
+	drv_status status = DMA_Init(pDMA);
+
+	if (status != DRV_OK)
+		return status;
+
+	// the queue is shared with the stream ISR
+	pHandle->ceiling = NVIC_GetCeiling(DMA_GetIRQNumber(pDMA->pDMAx, pDMA->Stream));
+
+	/*
+	 * 2. USART side (section 30.3.13 "Continuous communication using DMA")
+	 * 	  - clear TC by writing 0 to it
+	 * 	  - DMAT: a TXE event becomes a DMA request instead of an interrupt
+	 * */
+	pUSARTx->SR &= ~(1 << USART_SR_TC);
+	pUSARTx->CR3 |= (1 << USART_CR3_DMAT);
+
+	return DRV_OK;
+
+} /* End USART_DMA_TxInit() */
+
+
+drv_status USART_DMA_Submit(USART_DMA_Handle_t *pHandle, USART_TxDesc_t *pDesc){
+
+	if (pDesc->Len == 0 || pDesc->pData == 0)
+		return DRV_ERROR;
+
+	if (pHandle->TxMode != USART_DMA_TX_QUEUE)
+		return DRV_BUSY;
+
+	drv_status status = DRV_OK;
+
+	pDesc->pNext = 0;
+	pDesc->Status = DRV_BUSY;
+
+	uint32_t state = IRQ_EnterCritical(pHandle->ceiling);
+
+	if (pHandle->pTxTail){
+
+		// a transfer is running, the ISR will start this one
+		pHandle->pTxTail->pNext = pDesc;
+		pHandle->pTxTail = pDesc;
+
+	} else {
+
+		pHandle->pTxHead = pDesc;
+		pHandle->pTxTail = pDesc;
+
+		status = USART_DMA_StartDesc(pHandle, pDesc);
+
+		// refused: not left in the queue, no TC will ever complete it
+		if (status != DRV_OK){
+			pHandle->pTxHead = 0;
+			pHandle->pTxTail = 0;
+			pDesc->Status = DRV_ERROR;
+		}
+
+	} /* End if-else queue empty */
+
+	IRQ_ExitCritical(state);
+
+	return status;
+
+} /* End USART_DMA_Submit() */
+
+
+static void USART_DMA_CopyDone(USART_TxDesc_t *pDesc){
+
+	Mem_Free(pDesc);
+
+} /* End USART_DMA_CopyDone() */
+
+
+drv_status USART_DMA_SendCopy(USART_DMA_Handle_t *pHandle,
+							  const uint8_t *pData, uint16_t Len){
+
+	if (Len == 0 || pData == 0)
+		return DRV_ERROR;
+
+	USART_TxDesc_t *pDesc = Mem_Alloc(sizeof(USART_TxDesc_t) + Len);
+
+	if (pDesc == 0)
+		return DRV_BUSY;
+
+	// the bytes right after the descriptor, same block
+	uint8_t *pBuf = (uint8_t *)(pDesc + 1);
+
+	memcpy(pBuf, pData, Len);
+
+	pDesc->pData = pBuf;
+	pDesc->Len = Len;
+	pDesc->Done = USART_DMA_CopyDone;
+	pDesc->pContext = 0;
+
+	drv_status status = USART_DMA_Submit(pHandle, pDesc);
+
+	if (status != DRV_OK)
+		Mem_Free(pDesc);
+
+	return status;
+
+} /* End USART_DMA_SendCopy() */
+
+
+uint8_t USART_DMA_TxIdle(USART_DMA_Handle_t *pHandle){
+
+	return (pHandle->TxMode == USART_DMA_TX_QUEUE) && (pHandle->pTxHead == 0);
+
+} /* End USART_DMA_TxIdle() */
+
+
+drv_status USART_DMA_StartDoubleBuffer(USART_DMA_Handle_t *pHandle,
+									   uint8_t *pBuf0, uint8_t *pBuf1,
+									   uint16_t Len, usart_dbuf_cb_t Callback){
+
+	if (Len == 0)
+		return DRV_ERROR;
+
+	if (!USART_DMA_TxIdle(pHandle))
+		return DRV_BUSY;
+
+	pHandle->TxMode = USART_DMA_TX_DOUBLE_BUF;
+	pHandle->DBufCallback = Callback;
+	pHandle->DBufLen = Len;
+
+	// DBM must be set while the stream is disabled
+	pHandle->tx_dma.DMA_Config.DMA_DoubleBuffer = ON;
+
+	drv_status status = DMA_Init(&pHandle->tx_dma);
+
+	// DMA_Start() refuses a CCM buffer (mem_sections.h)
+	if (status == DRV_OK)
+		status = DMA_Start(&pHandle->tx_dma, (uint32_t)&pHandle->pUSARTx->DR,
+						   (uint32_t)pBuf0, (uint32_t)pBuf1, Len);
+
+	if (status != DRV_OK){
+
+		// back to the queue mode
+		pHandle->tx_dma.DMA_Config.DMA_DoubleBuffer = OFF;
+		DMA_Init(&pHandle->tx_dma);
+		pHandle->TxMode = USART_DMA_TX_QUEUE;
+
+	}
+
+	return status;
+
+} /* End USART_DMA_StartDoubleBuffer() */
+
+
+void USART_DMA_StopDoubleBuffer(USART_DMA_Handle_t *pHandle){
+
+	if (pHandle->TxMode != USART_DMA_TX_DOUBLE_BUF)
+		return;
+
+	DMA_Stop(&pHandle->tx_dma);
+
+	pHandle->tx_dma.DMA_Config.DMA_DoubleBuffer = OFF;
+	DMA_Init(&pHandle->tx_dma);
+
+	pHandle->TxMode = USART_DMA_TX_QUEUE;
+
+} /* End USART_DMA_StopDoubleBuffer() */
+
+
+// =============== Circular DMA receive ===============
+
+/*
+ * Give the bytes written by the DMA since the last call to the application
+ *
+ * 	- pos = Size - NDTR is the position where the DMA writes next
+ * 	- [rx_last, pos) is new data, or [rx_last, Size) + [0, pos)
+ * 	  when the DMA went back to the start of the buffer
+ * 	- called from the DMA ISR (half / full transfer) and from the
+ * 	  USART ISR (IDLE line), both are at the same preempt level
+ * 	  so this function is never interrupted by itself
+ * */
+static void USART_DMA_RxDeliver(USART_DMA_Handle_t *pHandle,
+								uint16_t Start, uint16_t Len){
+
+	if (Len == 0)
+		return;
+
+	pHandle->rx_bytes += Len;
+
+	if (!pHandle->RxAutoRelease){
+
+		/*
+		 * The application keeps the data until USART_DMA_RxRelease(),
+		 * the DMA overwrites what is not released after one turn
+		 * */
+		uint32_t unreleased = pHandle->rx_unreleased + Len;
+
+		if (unreleased > pHandle->RxSize){
+			pHandle->rx_overwritten += unreleased - pHandle->RxSize;
+			unreleased = pHandle->RxSize;
+		}
+
+		pHandle->rx_unreleased = unreleased;
+
+	} /* End if not auto release */
+
+	if (pHandle->RxCallback)
+		pHandle->RxCallback(pHandle, &pHandle->pRxBuf[Start], Len);
+
+} /* End USART_DMA_RxDeliver() */
+
+static void USART_DMA_RxProcess(USART_DMA_Handle_t *pHandle){
+
+	uint16_t pos = pHandle->RxSize - DMA_GetRemaining(&pHandle->rx_dma);
+
+	if (pos == pHandle->RxSize)
+		pos = 0;
+
+	uint16_t last = pHandle->rx_last;
+
+	if (pos == last)
+		return;
+
+	if (pos > last){
+
+		USART_DMA_RxDeliver(pHandle, last, pos - last);
+
+	} else {
+
+		// wrap: end of the buffer, then its start
+		USART_DMA_RxDeliver(pHandle, last, pHandle->RxSize - last);
+		USART_DMA_RxDeliver(pHandle, 0, pos);
+
+	} /* End if-else wrap */
+
+	pHandle->rx_last = pos;
+
+} /* End USART_DMA_RxProcess() */
+
+
+static void USART_DMA_RxCallback(DMA_Handle_t *pDMAHandle, uint8_t event){
+
+	USART_DMA_Handle_t *pHandle = (USART_DMA_Handle_t*)pDMAHandle->pContext;
+
+	if (event == DMA_EVENT_ERROR){
+		pHandle->rx_errors++;
+		return;
+	}
+
+	// half transfer or transfer complete: the buffer is half/fully written
+	USART_DMA_RxProcess(pHandle);
+
+} /* End USART_DMA_RxCallback() */
+
+
+drv_status USART_DMA_RxStart(USART_DMA_Handle_t *pHandle, USART_RegDef_t *pUSARTx,
+							 uint8_t *pBuf, uint16_t Size, usart_rx_cb_t Callback){
+
+	const USART_DMA_Map *map = USART_DMA_FindMap(pUSARTx);
+
+	if (map == 0 || Size < 2)
+		return DRV_ERROR;
+
+	pHandle->pUSARTx = pUSARTx;
+	pHandle->pRxBuf = pBuf;
+	pHandle->RxSize = Size;
+	pHandle->RxCallback = Callback;
+	pHandle->rx_last = 0;
+	pHandle->rx_bytes = 0;
+	pHandle->rx_ore = 0;
+	pHandle->rx_errors = 0;
+	pHandle->rx_overwritten = 0;
+	pHandle->rx_unreleased = 0;
+
+	// 1. RX stream: USART DR -> memory, circular, half + full interrupts
+	DMA_Handle_t *pDMA = &pHandle->rx_dma;
+
+	pDMA->pDMAx = map->dma;
+	pDMA->Stream = map->rx_stream;
+	pDMA->DMA_Config.DMA_Channel = map->rx_channel;
+	pDMA->DMA_Config.DMA_Direction = DMA_DIR_PERIPH_TO_MEM;
+	pDMA->DMA_Config.DMA_PeriphInc = OFF;
+	pDMA->DMA_Config.DMA_MemInc = ON;
+	pDMA->DMA_Config.DMA_PeriphDataSize = DMA_SIZE_BYTE;
+	pDMA->DMA_Config.DMA_MemDataSize = DMA_SIZE_BYTE;
+	pDMA->DMA_Config.DMA_Circular = ON;
+	pDMA->DMA_Config.DMA_DoubleBuffer = OFF;
+	pDMA->DMA_Config.DMA_Priority = DMA_PRIO_VERY_HIGH; // RX can't wait
+	pDMA->DMA_Config.DMA_HalfTransferIT = ON;
+	pDMA->DMA_Config.DMA_FIFOMode = OFF;
+	pDMA->Callback = USART_DMA_RxCallback;
+	pDMA->pContext = pHandle;
+
+	// DRV_BUSY: the stream is taken by another driver (dma_driver.h)
+	drv_status status = DMA_Init(pDMA);
+
+	if (status != DRV_OK)
+		return status;
+
+	/*
+	 * rx_unreleased is shared between the ISRs and USART_DMA_RxRelease(),
+	 * take the highest ceiling of the 2 IRQs (numerically the smallest,
+	 * 0 meaning "not in the plan" -> all interrupts off)
+	 * */
+	uint32_t c_dma = NVIC_GetCeiling(DMA_GetIRQNumber(pDMA->pDMAx, pDMA->Stream));
+	uint32_t c_usart = NVIC_GetCeiling(USART_GetIRQNumber(pUSARTx));
+
+	pHandle->rx_ceiling = (c_dma < c_usart) ? c_dma : c_usart;
+
+	// 2. Start the stream before the USART requests, a CCM buffer is refused
+	status = DMA_Start(pDMA, (uint32_t)&pUSARTx->DR, (uint32_t)pBuf, 0, Size);
+
+	if (status != DRV_OK)
+		return status;
+
+	/*
+	 * 3. USART side
+	 * 	- DMAR: RXNE becomes a DMA request
+	 * 	- EIE: overrun / framing / noise raise the USART interrupt
+	 * 	  (needed because RXNEIE is off in DMA mode)
+	 * 	- IDLEIE: interrupt when the line stays idle for one frame,
+	 * 	  which is the end of a message of unknown length
+	 * */
+	(void)pUSARTx->SR;
+	(void)pUSARTx->DR;   // clear a pending IDLE / ORE
+
+	pUSARTx->CR3 |= (1 << USART_CR3_DMAR) | (1 << USART_CR3_EIE);
+	pUSARTx->CR1 |= (1 << USART_CR1_IDLEIE);
+
+	NVIC_IRQInterruptConfig(USART_GetIRQNumber(pUSARTx), ON);
+
+	return DRV_OK;
+
+} /* End USART_DMA_RxStart() */
+
+
+void USART_DMA_RxStop(USART_DMA_Handle_t *pHandle){
+
+	USART_RegDef_t *pUSARTx = pHandle->pUSARTx;
+
+	pUSARTx->CR1 &= ~(1 << USART_CR1_IDLEIE);
+	pUSARTx->CR3 &= ~((1 << USART_CR3_DMAR) | (1 << USART_CR3_EIE));
+
+	DMA_Release(&pHandle->rx_dma);
+
+} /* End USART_DMA_RxStop() */
+
+
+void USART_DMA_RxRelease(USART_DMA_Handle_t *pHandle, uint16_t Len){
+
+	uint32_t state = IRQ_EnterCritical(pHandle->rx_ceiling);
+
+	if (Len > pHandle->rx_unreleased)
+		Len = pHandle->rx_unreleased;
+
+	pHandle->rx_unreleased -= Len;
+
+	IRQ_ExitCritical(state);
+
+} /* End USART_DMA_RxRelease() */
+
+
+void USART_DMA_RxIRQHandling(USART_DMA_Handle_t *pHandle){
+
+	USART_RegDef_t *pUSARTx = pHandle->pUSARTx;
+
+	uint32_t sr = pUSARTx->SR;
+
+	if (sr & ((1 << USART_SR_IDLE) | (1 << USART_SR_ORE) |
+			  (1 << USART_SR_FE) | (1 << USART_SR_NF))){
+
+		// reading SR then DR clears IDLE, ORE, FE and NF
+		(void)pUSARTx->DR;
+
+		if (sr & (1 << USART_SR_ORE))
+			pHandle->rx_ore++;
+
+		if (sr & ((1 << USART_SR_FE) | (1 << USART_SR_NF)))
+			pHandle->rx_errors++;
+
+		if (sr & (1 << USART_SR_IDLE))
+			USART_DMA_RxProcess(pHandle);
+
+	} /* End if IDLE or error */
+
+} /* End USART_DMA_RxIRQHandling() */
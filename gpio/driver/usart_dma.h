@@ -0,0 +1,153 @@
+
+#pragma once
+
+#include "stm32f407G.h"
+#include "dma_driver.h"
+
+/*
+ * DMA transmit path for the USART
+ *
+ * With the interrupt driven driver (usart_driver.c), every byte costs
+ * one interrupt. Here the DMA moves the bytes from memory to DR, and the
+ * CPU only sees one interrupt per buffer.
+ *
+ * 2 modes (one at a time):
+ *
+ * 	1) Queue mode (zero copy)
+ * 		- the caller owns the buffer and a descriptor (USART_TxDesc_t)
+ * 		- USART_DMA_Submit() links the descriptor at the end of the queue,
+ * 		  the buffers are sent one after the other
+ * 		- the Done callback of the descriptor is called from the DMA ISR
+ * 		  once the buffer has been read by the DMA: the caller can reuse it
+ * 		- the buffer and the descriptor must stay valid until Done
+ * 		- a buffer the DMA can't read (CCM, stack) is refused: Submit
+ * 		  returns the error when the queue was empty, otherwise Done
+ * 		  is called with Status = DRV_ERROR and the queue goes on
+ *
+ * 	2) Double buffer mode (hardware DBM, for continuous streams)
+ * 		- 2 buffers of the same length, the DMA sends M0 then M1 then M0...
+ * 		- after each buffer, the callback gives the index of the buffer
+ * 		  which was just sent: the application fills it while the other
+ * 		  one is going out
+ *
+ * Receive (circular DMA + IDLE line):
+ * 	- the DMA writes without end in a circular buffer
+ * 	- half transfer, transfer complete (DMA) and IDLE line (USART)
+ * 	  interrupts give the new range of bytes to the RX callback,
+ * 	  directly inside the buffer (no copy)
+ * 	- RxAutoRelease = ON: the data is consumed when the callback returns
+ * 	  RxAutoRelease = OFF: the application calls USART_DMA_RxRelease()
+ * 	  once it is done with the bytes, rx_overwritten counts the bytes
+ * 	  overwritten by the DMA before being released
+ * 	- rx_ore counts the USART overruns (DMA too late, bytes lost)
+ * 	- the USART IRQ handler must call USART_DMA_RxIRQHandling(),
+ * 	  the RX stream IRQ handler DMA_IRQHandling(&handle.rx_dma)
+ *
+ * Setup:
+ * 	- USART_Init() with pTxBuffer = 0 (no TX ring)
+ * 	- USART_DMA_TxInit()
+ * 	- IRQ handler of the stream (see table in usart_dma.c), example:
+ *
+ * 		void DMA1_Stream6_IRQHandler(void){
+ * 			DMA_IRQHandling(&usart2_dma.tx_dma);
+ * 		}
+ *
+ * */
+
+typedef struct USART_TxDesc USART_TxDesc_t;
+
+typedef void (*usart_tx_done_t)(USART_TxDesc_t *pDesc);
+
+struct USART_TxDesc{
+
+	const uint8_t *pData;
+	uint16_t Len;              // NDTR is 16 bits -> max 65535 bytes
+	usart_tx_done_t Done;      // can be 0
+	void *pContext;            // free for the caller
+
+	// Filled by the driver
+	drv_status Status;         // DRV_OK or DRV_ERROR (DMA transfer error)
+	USART_TxDesc_t *pNext;
+
+};
+
+typedef struct USART_DMA_Handle USART_DMA_Handle_t;
+
+typedef void (*usart_dbuf_cb_t)(USART_DMA_Handle_t *pHandle, uint8_t FreeBuffer);
+
+typedef void (*usart_rx_cb_t)(USART_DMA_Handle_t *pHandle,
+							  const uint8_t *pData, uint16_t Len);
+
+typedef enum USART_DMA_TxMode {USART_DMA_TX_QUEUE,
+							   USART_DMA_TX_DOUBLE_BUF} usart_dma_txmode;
+
+struct USART_DMA_Handle{
+
+	USART_RegDef_t *pUSARTx;
+
+	DMA_Handle_t tx_dma;
+
+	uint8_t TxMode;
+
+	// queue mode
+	USART_TxDesc_t *__vo pTxHead;    // descriptor in flight
+	USART_TxDesc_t *__vo pTxTail;
+
+	// double buffer mode
+	usart_dbuf_cb_t DBufCallback;
+	uint16_t DBufLen;
+
+	uint32_t ceiling;                // BASEPRI value of the stream IRQ
+	__vo uint32_t tx_bytes;          // statistics
+
+	// receive
+	DMA_Handle_t rx_dma;
+
+	uint8_t *pRxBuf;
+	uint16_t RxSize;
+	uint8_t RxAutoRelease;           // ON / OFF, set before USART_DMA_RxStart()
+	usart_rx_cb_t RxCallback;
+
+	uint16_t rx_last;                // first byte not yet given to the callback
+	uint32_t rx_ceiling;
+	__vo uint32_t rx_unreleased;
+
+	__vo uint32_t rx_bytes;
+	__vo uint32_t rx_ore;            // USART overrun (hardware)
+	__vo uint32_t rx_errors;         // framing, noise, DMA transfer error
+	__vo uint32_t rx_overwritten;    // bytes lost because not released in time
+
+};
+
+
+// ================== API ==================
+
+drv_status USART_DMA_TxInit(USART_DMA_Handle_t *pHandle, USART_RegDef_t *pUSARTx);
+
+drv_status USART_DMA_Submit(USART_DMA_Handle_t *pHandle, USART_TxDesc_t *pDesc);
+
+/*
+ * Queue mode with a copy: descriptor + bytes in one block of the pools
+ * (Mem_Alloc(), mem_pool.h), given back from the DMA ISR once sent.
+ * The caller can reuse pData at once. DRV_BUSY when the pools are empty
+ * */
+drv_status USART_DMA_SendCopy(USART_DMA_Handle_t *pHandle,
+							  const uint8_t *pData, uint16_t Len);
+
+// 1 when no descriptor is queued or in flight
+uint8_t USART_DMA_TxIdle(USART_DMA_Handle_t *pHandle);
+
+drv_status USART_DMA_StartDoubleBuffer(USART_DMA_Handle_t *pHandle,
+									   uint8_t *pBuf0, uint8_t *pBuf1,
+									   uint16_t Len, usart_dbuf_cb_t Callback);
+
+void USART_DMA_StopDoubleBuffer(USART_DMA_Handle_t *pHandle);
+
+drv_status USART_DMA_RxStart(USART_DMA_Handle_t *pHandle, USART_RegDef_t *pUSARTx,
+							 uint8_t *pBuf, uint16_t Size, usart_rx_cb_t Callback);
+
+void USART_DMA_RxStop(USART_DMA_Handle_t *pHandle);
+
+void USART_DMA_RxRelease(USART_DMA_Handle_t *pHandle, uint16_t Len);
+
+void USART_DMA_RxIRQHandling(USART_DMA_Handle_t *pHandle);
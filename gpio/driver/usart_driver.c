@@ -0,0 +1,331 @@
+#include "usart_driver.h"
+#include "rcc_driver.h"
+#include "nvic_driver.h"
+#include "dvfs.h"
+#include "clock_gate.h"
+
+
+// =============== Clock, reset and IRQ of each USART ===============
+
+/*
+ * Instead of one function per USART (like GPIOx_CLK_ON), one table:
+ * 	- on_apb2: 0 -> RCC_APB1ENR / APB1RSTR, 1 -> RCC_APB2ENR / APB2RSTR
+ * 	- bit: position of the USART in these registers
+ * 	  (see sections 7.3.13 and 7.3.14 in the reference manual)
+ * */
+
+typedef struct{
+	USART_RegDef_t *base;
+	uint8_t on_apb2;
+	uint8_t bit;
+	uint8_t irq_number;
+} USART_Map;
+
+static const USART_Map usart_map[] = {
+	{USART1, 1, 4,  IRQ_NO_USART1},
+	{USART2, 0, 17, IRQ_NO_USART2},
+	{USART3, 0, 18, IRQ_NO_USART3},
+	{UART4,  0, 19, IRQ_NO_UART4},
+	{UART5,  0, 20, IRQ_NO_UART5},
+	{USART6, 1, 5,  IRQ_NO_USART6}
+};
+
+#define NB_USART (sizeof(usart_map)/sizeof(usart_map[0]))
+
+// Clock held by the driver until USART_DeInit() (clock_gate.h)
+static uint32_t usart_clk_held[2];        // [on_apb2]
+
+static const USART_Map *USART_FindMap(USART_RegDef_t *pUSARTx){
+
+	for (int i = 0; i < NB_USART; ++i) {
+		if (usart_map[i].base == pUSARTx)
+			return &usart_map[i];
+	}
+
+	return 0;
+
+} /* End USART_FindMap() */
+
+
+void USART_PeriClockControl(USART_RegDef_t *pUSARTx, uint8_t ON_OFF){
+
+	const USART_Map *map = USART_FindMap(pUSARTx);
+
+	if (map == 0)
+		return;
+
+	CLK_PeriClockControl(map->on_apb2 ? CLK_APB2 : CLK_APB1, map->bit, ON_OFF);
+
+} /* End USART_PeriClockControl() */
+
+
+void USART_DeInit(USART_RegDef_t *pUSARTx){
+
+	// same principle as GPIOx_RESET(): set then clear the reset bit
+	const USART_Map *map = USART_FindMap(pUSARTx);
+
+	if (map == 0)
+		return;
+
+	__vo uint32_t *rstr = map->on_apb2 ? &RCC->APB2RSTR : &RCC->APB1RSTR;
+
+	*rstr |= (1 << map->bit);
+	*rstr &= ~(1 << map->bit);
+
+	CLK_Drop(&usart_clk_held[map->on_apb2], map->on_apb2 ? CLK_APB2 : CLK_APB1, map->bit);
+
+} /* End USART_DeInit() */
+
+
+uint8_t USART_GetIRQNumber(USART_RegDef_t *pUSARTx){
+
+	const USART_Map *map = USART_FindMap(pUSARTx);
+
+	return map ? map->irq_number : 0;
+
+} /* End USART_GetIRQNumber() */
+
+// =========================================================
+
+
+void USART_SetBaudRate(USART_RegDef_t *pUSARTx, uint32_t BaudRate){
+
+	/*
+	 * See section 30.3.4 "Fractional baud rate generation"
+	 *
+	 * 	baud = fPCLK / (8 * (2 - OVER8) * USARTDIV)
+	 *
+	 * 	- with OVER8 = 0 (oversampling by 16), BRR holds USARTDIV * 16
+	 * 	  (12 bits mantissa + 4 bits fraction), so BRR = fPCLK / baud
+	 * 	- with OVER8 = 1 (oversampling by 8), the fraction has only 3 bits,
+	 * 	  but the maximum baud rate doubles (fPCLK / 8), which is needed
+	 * 	  for 921600 baud and above on a slow APB clock
+	 *
+	 * 	The + BaudRate/2 rounds to the nearest value instead of truncating
+	 * */
+
+	uint32_t pclk;
+
+	if (pUSARTx == USART1 || pUSARTx == USART6)
+		pclk = RCC_GetPCLK2Value();
+	else
+		pclk = RCC_GetPCLK1Value();
+
+	uint32_t div = (pclk + BaudRate / 2) / BaudRate; // USARTDIV * 16 (OVER8=0)
+
+	if (div >= 16){
+
+		pUSARTx->CR1 &= ~(1 << USART_CR1_OVER8);
+		pUSARTx->BRR = div;
+
+	} else {
+
+		// USARTDIV * 8 = 2 * fPCLK / baud
+		div = (2 * pclk + BaudRate / 2) / BaudRate;
+
+		pUSARTx->CR1 |= (1 << USART_CR1_OVER8);
+		pUSARTx->BRR = ((div >> 3) << 4) | (div & 0x7);
+
+	} /* End if-else oversampling */
+
+} /* End USART_SetBaudRate() */
+
+
+drv_status USART_Init(USART_Handle_t *pUSARTHandle){
+
+	USART_RegDef_t *pUSARTx = pUSARTHandle->pUSARTx;
+	USART_Config_t *pConf = &pUSARTHandle->USART_Config;
+
+	uint8_t tx_on = (pConf->USART_Mode != USART_MODE_ONLY_RX);
+	uint8_t rx_on = (pConf->USART_Mode != USART_MODE_ONLY_TX);
+
+	/*
+	 * 1. The rings, the size must be a power of 2
+	 *    A direction without storage (pTxBuffer / pRxBuffer = 0) has no
+	 *    ring and no interrupt: it is left to the DMA (usart_dma.c)
+	 * */
+	uint8_t tx_ring_on = tx_on && (pUSARTHandle->pTxBuffer != 0);
+	uint8_t rx_ring_on = rx_on && (pUSARTHandle->pRxBuffer != 0);
+
+	if (tx_ring_on && RingBuffer_Init(&pUSARTHandle->tx_ring,
+			pUSARTHandle->pTxBuffer, pUSARTHandle->TxBufferSize) != DRV_OK)
+		return DRV_ERROR;
+
+	if (rx_ring_on && RingBuffer_Init(&pUSARTHandle->rx_ring,
+			pUSARTHandle->pRxBuffer, pUSARTHandle->RxBufferSize) != DRV_OK)
+		return DRV_ERROR;
+
+	// no storage: empty ring, USART_Write() / USART_Read() give 0
+	if (!tx_ring_on)
+		memset(&pUSARTHandle->tx_ring, 0, sizeof(RingBuffer_t));
+
+	if (!rx_ring_on)
+		memset(&pUSARTHandle->rx_ring, 0, sizeof(RingBuffer_t));
+
+	pUSARTHandle->rx_dropped = 0;
+	pUSARTHandle->rx_errors = 0;
+
+	const USART_Map *map = USART_FindMap(pUSARTx);
+
+	if (map == 0)
+		return DRV_ERROR;
+
+	CLK_Hold(&usart_clk_held[map->on_apb2], map->on_apb2 ? CLK_APB2 : CLK_APB1, map->bit);
+
+	// 2. CR1: frame format and direction (UE off while configuring)
+	uint32_t cr1 = 0;
+
+	if (tx_on)
+		cr1 |= (1 << USART_CR1_TE);
+	if (rx_on)
+		cr1 |= (1 << USART_CR1_RE);
+	if (rx_ring_on)
+		cr1 |= (1 << USART_CR1_RXNEIE);
+
+	if (pConf->USART_WordLength == USART_WORDLEN_9BITS)
+		cr1 |= (1 << USART_CR1_M);
+
+	if (pConf->USART_ParityControl == USART_PARITY_EVEN)
+		cr1 |= (1 << USART_CR1_PCE);
+	else if (pConf->USART_ParityControl == USART_PARITY_ODD)
+		cr1 |= (1 << USART_CR1_PCE) | (1 << USART_CR1_PS);
+
+	pUSARTx->CR1 = cr1;
+
+	// 3. CR2: stop bits
+	pUSARTx->CR2 &= ~(0x3 << USART_CR2_STOP);
+	pUSARTx->CR2 |= (pConf->USART_NoOfStopBits << USART_CR2_STOP);
+
+	// 4. CR3: hardware flow control
+	pUSARTx->CR3 &= ~((1 << USART_CR3_CTSE) | (1 << USART_CR3_RTSE));
+
+	if (pConf->USART_HWFlowControl == USART_HW_FLOW_CTS ||
+		pConf->USART_HWFlowControl == USART_HW_FLOW_CTS_RTS)
+		pUSARTx->CR3 |= (1 << USART_CR3_CTSE);
+
+	if (pConf->USART_HWFlowControl == USART_HW_FLOW_RTS ||
+		pConf->USART_HWFlowControl == USART_HW_FLOW_CTS_RTS)
+		pUSARTx->CR3 |= (1 << USART_CR3_RTSE);
+
+	// 5. Baud rate (may also set OVER8 in CR1)
+	USART_SetBaudRate(pUSARTx, pConf->USART_Baud);
+
+	// 6. Enable the USART, then its IRQ on the NVIC side
+	// (priority comes from irq_priority_plan.h)
+	pUSARTx->CR1 |= (1 << USART_CR1_UE);
+
+	NVIC_IRQInterruptConfig(USART_GetIRQNumber(pUSARTx), ON);
+
+	return DRV_OK;
+
+} /* End USART_Init() */
+
+
+uint32_t USART_Write(USART_Handle_t *pUSARTHandle,
+					 const uint8_t *pData, uint32_t Len){
+
+	/*
+	 * Copy into the ring, then make sure TXEIE is on:
+	 * the ISR takes the bytes from the ring and turns TXEIE off
+	 * when the ring is empty
+	 *
+	 * TXEIE is written through its bit band alias, so the ISR can't
+	 * interrupt a read-modify-write of CR1 and lose a bit
+	 * */
+
+	if (pUSARTHandle->tx_ring.buffer == 0)
+		return 0;
+
+	uint32_t written = RingBuffer_Write(&pUSARTHandle->tx_ring, pData, Len);
+
+	if (written)
+		BITBAND_PERIPH(&pUSARTHandle->pUSARTx->CR1, USART_CR1_TXEIE) = 1;
+
+	return written;
+
+} /* End USART_Write() */
+
+
+uint32_t USART_Read(USART_Handle_t *pUSARTHandle,
+					uint8_t *pData, uint32_t Len){
+
+	if (pUSARTHandle->rx_ring.buffer == 0)
+		return 0;
+
+	return RingBuffer_Read(&pUSARTHandle->rx_ring, pData, Len);
+
+} /* End USART_Read() */
+
+
+uint8_t USART_TxIdle(USART_Handle_t *pUSARTHandle){
+
+	if (RingBuffer_Used(&pUSARTHandle->tx_ring) != 0)
+		return 0;
+
+	return (pUSARTHandle->pUSARTx->SR >> USART_SR_TC) & 0x1;
+
+} /* End USART_TxIdle() */
+
+
+void USART_IRQHandling(USART_Handle_t *pUSARTHandle){
+
+	USART_RegDef_t *pUSARTx = pUSARTHandle->pUSARTx;
+
+	uint32_t sr = pUSARTx->SR;
+
+	// ---- RX side ----
+
+	/*
+	 * An overrun (ORE) also raises the interrupt when RXNEIE is on,
+	 * reading SR then DR clears RXNE and the error flags
+	 * */
+	if (sr & ((1 << USART_SR_RXNE) | (1 << USART_SR_ORE))){
+
+		if (sr & ((1 << USART_SR_ORE) | (1 << USART_SR_FE) |
+				  (1 << USART_SR_NF) | (1 << USART_SR_PE)))
+			pUSARTHandle->rx_errors++;
+
+		uint8_t data = (uint8_t)pUSARTx->DR;
+
+		if (!RingBuffer_Put(&pUSARTHandle->rx_ring, data))
+			pUSARTHandle->rx_dropped++;
+
+	} /* End if RXNE */
+
+	// ---- TX side ----
+
+	if ((sr & (1 << USART_SR_TXE)) &&
+		(pUSARTx->CR1 & (1 << USART_CR1_TXEIE))){
+
+		uint8_t data;
+
+		if (RingBuffer_Get(&pUSARTHandle->tx_ring, &data))
+			pUSARTx->DR = data;
+		else
+			BITBAND_PERIPH(&pUSARTx->CR1, USART_CR1_TXEIE) = 0;
+
+	} /* End if TXE */
+
+} /* End USART_IRQHandling() */
+
+
+/*
+ * Clock change (dvfs.h): a frame being sent would be cut in two
+ * baud rates, the switch is refused (DRV_BUSY) as long as the TX
+ * side is not idle, the caller tries DVFS_SetProfile() again later.
+ * BRR is computed again from the new PCLK. A frame received during
+ * the switch is lost (rx_errors)
+ * */
+drv_status USART_DVFSNotify(uint8_t Event, void *pContext){
+
+	USART_Handle_t *pUSARTHandle = pContext;
+
+	if (Event == DVFS_PRE_CHANGE)
+		return USART_TxIdle(pUSARTHandle) ? DRV_OK : DRV_BUSY;
+
+	if (Event == DVFS_POST_CHANGE)
+		USART_SetBaudRate(pUSARTHandle->pUSARTx, pUSARTHandle->USART_Config.USART_Baud);
+
+	return DRV_OK;
+
+} /* End USART_DVFSNotify() */
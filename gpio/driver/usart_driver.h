@@ -0,0 +1,108 @@
+
+#pragma once
+
+#include "stm32f407G.h"
+#include "ring_buffer.h"
+
+/*
+ * Interrupt driven USART driver
+ *
+ * 	- USART_Write() copies the data into the TX ring and returns
+ * 	  immediately, the TXE interrupt sends the bytes one by one
+ * 	- the RXNE interrupt stores every received byte in the RX ring,
+ * 	  USART_Read() takes what is available and returns immediately
+ * 	- the user must call USART_IRQHandling() from the IRQ handler
+ * 	  of the startup file, example:
+ *
+ * 		void USART2_IRQHandler(void){
+ * 			USART_IRQHandling(&usart2_handle);
+ * 		}
+ *
+ * 	- the TX/RX pins are configured separately with GPIO_Init()
+ * 	  in ALT mode (USART1/2/3 -> AF7, UART4/5 and USART6 -> AF8)
+ *
+ * */
+
+// ------------ Coding states for USART configuration ------------
+
+typedef enum USART_Mode {USART_MODE_ONLY_TX, USART_MODE_ONLY_RX,
+						 USART_MODE_TXRX} usart_mode;
+
+// word length, bit M in CR1
+typedef enum USART_WordLength {USART_WORDLEN_8BITS,
+							   USART_WORDLEN_9BITS} usart_wordlen;
+
+// stop bits, bits STOP[13:12] in CR2 (same order as ref manual)
+typedef enum USART_StopBits {USART_STOPBITS_1, USART_STOPBITS_0_5,
+							 USART_STOPBITS_2, USART_STOPBITS_1_5} usart_stopbits;
+
+typedef enum USART_Parity {USART_PARITY_DISABLE, USART_PARITY_EVEN,
+						   USART_PARITY_ODD} usart_parity;
+
+typedef enum USART_HWFlow {USART_HW_FLOW_NONE, USART_HW_FLOW_CTS,
+						   USART_HW_FLOW_RTS, USART_HW_FLOW_CTS_RTS} usart_hwflow;
+
+
+typedef struct{
+
+	uint8_t USART_Mode;
+	uint32_t USART_Baud;
+	uint8_t USART_NoOfStopBits;
+	uint8_t USART_WordLength;
+	uint8_t USART_ParityControl;
+	uint8_t USART_HWFlowControl;
+
+} USART_Config_t;
+
+
+typedef struct{
+
+	USART_RegDef_t *pUSARTx;
+	// this can be USART1, USART2,....
+
+	USART_Config_t USART_Config;
+
+	// Storage of the rings, given by the user (size power of 2)
+	// leave at 0 for a direction handled by the DMA (usart_dma.h)
+	uint8_t *pTxBuffer;
+	uint32_t TxBufferSize;
+	uint8_t *pRxBuffer;
+	uint32_t RxBufferSize;
+
+	// Filled by the driver
+	RingBuffer_t tx_ring;
+	RingBuffer_t rx_ring;
+
+	__vo uint32_t rx_dropped;   // received while the RX ring was full
+	__vo uint32_t rx_errors;    // overrun, framing, noise, parity
+
+} USART_Handle_t;
+
+
+// ================== API ==================
+
+void USART_PeriClockControl(USART_RegDef_t *pUSARTx, uint8_t ON_OFF);
+
+drv_status USART_Init(USART_Handle_t *pUSARTHandle);
+
+void USART_DeInit(USART_RegDef_t *pUSARTx);
+
+void USART_SetBaudRate(USART_RegDef_t *pUSARTx, uint32_t BaudRate);
+
+uint8_t USART_GetIRQNumber(USART_RegDef_t *pUSARTx);
+
+// Non blocking, return the nb of bytes accepted / read
+uint32_t USART_Write(USART_Handle_t *pUSARTHandle,
+					 const uint8_t *pData, uint32_t Len);
+
+uint32_t USART_Read(USART_Handle_t *pUSARTHandle,
+					uint8_t *pData, uint32_t Len);
+
+// 1 when the TX ring is empty and the last frame left the shift register
+uint8_t USART_TxIdle(USART_Handle_t *pUSARTHandle);
+
+// dvfs_callback_t, pContext = the USART_Handle_t: BRR after a clock change,
+// the change is refused while a frame is being sent
+drv_status USART_DVFSNotify(uint8_t Event, void *pContext);
+
+void USART_IRQHandling(USART_Handle_t *pUSARTHandle);
@@ -0,0 +1,88 @@
+#include "ws2812.h"
+
+
+drv_status WS2812_Init(WS2812_Handle_t *pHandle){
+
+	TIM_Handle_t *pTIMHandle = pHandle->pTIMHandle;
+
+	if (pHandle->Mode != TIM_DMA_ONESHOT && pHandle->Mode != TIM_DMA_DOUBLE)
+		return DRV_ERROR;
+
+	pTIMHandle->TIM_Config.TIM_Frequency = WS2812_FREQ;
+	pTIMHandle->TIM_Config.TIM_OnePulse = OFF;
+	pTIMHandle->TIM_Config.TIM_UpdateIT = OFF;
+
+	if (TIM_Init(pTIMHandle) != DRV_OK)
+		return DRV_ERROR;
+
+	/*
+	 * 0.4 / 1.25 and 0.8 / 1.25 of the period, rounded. At a 16 MHz
+	 * timer clock the period is 20 ticks: 6 (375 ns) and 13 (812 ns)
+	 * */
+	uint32_t period = pTIMHandle->pTIMx->ARR + 1;
+
+	if (period < 8)
+		return DRV_ERROR;   // not enough ticks to tell 0 from 1
+
+	pHandle->T0H = (uint16_t)((period * 32 + 50) / 100);
+	pHandle->T1H = (uint16_t)((period * 64 + 50) / 100);
+	pHandle->FrameLen = WS2812_FRAME_LEN(pHandle->NbLeds);
+
+	// CCRx = 0 after the PWM init: the line is low from the start
+	if (TIM_PWMInit(pTIMHandle, pHandle->Channel, TIM_PWM_MODE1, TIM_POL_HIGH,
+					pHandle->pGPIOx, pHandle->PinNumber) != DRV_OK)
+		return DRV_ERROR;
+
+	// DRV_BUSY: the update stream is taken by another driver (dma_driver.h)
+	drv_status status = TIM_DMAInit(pTIMHandle, pHandle->Channel, pHandle->Mode);
+
+	if (status != DRV_OK)
+		return status;
+
+	TIM_Start(pTIMHandle);
+
+	return DRV_OK;
+
+} /* End WS2812_Init() */
+
+
+void WS2812_Encode(WS2812_Handle_t *pHandle, const uint8_t *pRGB, uint16_t *pFrame){
+
+	uint16_t t0 = pHandle->T0H;
+	uint16_t t1 = pHandle->T1H;
+
+	for (uint16_t led = 0; led < pHandle->NbLeds; ++led, pRGB += 3){
+
+		// wire order: green, red, blue, MSB first
+		uint32_t grb = ((uint32_t)pRGB[1] << 16) | ((uint32_t)pRGB[0] << 8) | pRGB[2];
+
+		for (int bit = WS2812_BITS_PER_LED - 1; bit >= 0; --bit)
+			*pFrame++ = ((grb >> bit) & 1) ? t1 : t0;
+
+	} /* End for LEDs */
+
+	for (int i = 0; i < WS2812_RESET_SLOTS; ++i)
+		*pFrame++ = 0;
+
+} /* End WS2812_Encode() */
+
+
+drv_status WS2812_Show(WS2812_Handle_t *pHandle, const uint16_t *pFrame){
+
+	if (pHandle->Mode != TIM_DMA_ONESHOT)
+		return DRV_ERROR;
+
+	return TIM_DMAStart(pHandle->pTIMHandle, pFrame, 0, pHandle->FrameLen);
+
+} /* End WS2812_Show() */
+
+
+drv_status WS2812_Stream(WS2812_Handle_t *pHandle, const uint16_t *pFrame0,
+						 const uint16_t *pFrame1){
+
+	if (pHandle->Mode != TIM_DMA_DOUBLE)
+		return DRV_ERROR;
+
+	return TIM_DMAStart(pHandle->pTIMHandle, pFrame0, pFrame1, pHandle->FrameLen);
+
+} /* End WS2812_Stream() */
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "stm32f407G.h"
+#include "timer_driver.h"
+
+/*
+ * WS2812 (NeoPixel) LED strip through timer PWM + DMA
+ *
+ * One wire, 800 kbit/s, each bit is one period of 1.25 us, high
+ * then low, the length of the high part gives the bit:
+ *
+ * 		0: 0.4 us high (T0H)     1: 0.8 us high (T1H)      +-150 ns
+ *
+ * 	24 bits per LED, green, red then blue, MSB first. The first LED
+ * 	keeps its 24 bits and passes the rest on. A low level of more than
+ * 	50 us (reset) latches the colors.
+ *
+ * 	One timer period = one bit: the PWM runs at 800 kHz and the DMA
+ * 	writes the duty of each bit in CCRx at the update event
+ * 	(TIM_DMAStart(), timer_driver.h). WS2812_Encode() turns the colors
+ * 	into a frame of compare values, once per frame and not at the bit
+ * 	rate, then the frame goes out with no CPU at all. The frame ends
+ * 	with WS2812_RESET_SLOTS periods at 0: the reset, and the idle level
+ * 	after a one shot frame.
+ *
+ * 	Memory: 2 bytes per bit, 48 bytes per LED (+ the reset slots)
+ *
+ * 	- TIM_DMA_ONESHOT: WS2812_Show() sends one frame
+ * 	- TIM_DMA_DOUBLE: WS2812_Stream() sends two frames in turn without
+ * 	  stop, FrameDone of the timer handle gives the frame to refill
+ *
+ * */
+
+#define WS2812_FREQ          800000U
+#define WS2812_BITS_PER_LED  24
+#define WS2812_RESET_SLOTS   64     // 80 us (some WS2812B need 280 us: 224)
+
+// nb of uint16_t of one frame
+#define WS2812_FRAME_LEN(nb_leds) ((nb_leds) * WS2812_BITS_PER_LED + WS2812_RESET_SLOTS)
+
+
+typedef struct{
+
+	TIM_Handle_t *pTIMHandle;     // pTIMx: TIM1, TIM3, TIM4 or TIM8
+	uint8_t Channel;
+	GPIO_RegDef_t *pGPIOx;        // data pin of the strip
+	uint8_t PinNumber;
+	uint16_t NbLeds;
+	uint8_t Mode;                 // TIM_DMA_ONESHOT or TIM_DMA_DOUBLE
+
+	// Filled by the driver
+	uint16_t T0H;                 // compare values of a 0 and a 1
+	uint16_t T1H;
+	uint16_t FrameLen;
+
+} WS2812_Handle_t;
+
+
+// ================== API ==================
+
+// Timer at 800 kHz, PWM channel, DMA, the line stays low
+drv_status WS2812_Init(WS2812_Handle_t *pHandle);
+
+// pRGB: 3 bytes per LED (red, green, blue), pFrame: FrameLen values
+void WS2812_Encode(WS2812_Handle_t *pHandle, const uint8_t *pRGB, uint16_t *pFrame);
+
+drv_status WS2812_Show(WS2812_Handle_t *pHandle, const uint16_t *pFrame);
+
+drv_status WS2812_Stream(WS2812_Handle_t *pHandle, const uint16_t *pFrame0,
+						 const uint16_t *pFrame1);
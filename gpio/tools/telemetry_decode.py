@@ -0,0 +1,141 @@
+#!/usr/bin/env python3
+"""
+Host side decoder of the telemetry frames sent by driver/telemetry.c
+
+Frame = COBS(record) + 0x00, record (little endian):
+
+    | seq | channel | type | count | timestamp (4) | payload | crc16 (2) |
+
+Usage:
+    python3 telemetry_decode.py capture.bin            # file (raw bytes)
+    python3 telemetry_decode.py /dev/ttyACM0 921600    # serial port (pyserial)
+
+Output: one CSV line per sample on stdout
+    channel,timestamp,index,value
+and a summary (frames, CRC errors, lost records) on stderr
+"""
+
+import struct
+import sys
+
+# same order as telemetry_type in telemetry.h
+TYPES = {
+    0: ("B", 1),  # U8
+    1: ("b", 1),  # I8
+    2: ("H", 2),  # U16
+    3: ("h", 2),  # I16
+    4: ("I", 4),  # U32
+    5: ("i", 4),  # I32
+    6: ("f", 4),  # F32
+}
+
+HEADER_SIZE = 8
+
+
+def crc16_ccitt_false(data, crc=0xFFFF):
+    for byte in data:
+        crc ^= byte << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else (crc << 1)
+            crc &= 0xFFFF
+    return crc
+
+
+def cobs_decode(frame):
+    out = bytearray()
+    i = 0
+    while i < len(frame):
+        code = frame[i]
+        if code == 0 or i + code > len(frame):
+            return None
+        out += frame[i + 1:i + code]
+        i += code
+        if code != 0xFF and i < len(frame):
+            out.append(0)
+    return bytes(out)
+
+
+def parse_record(record):
+    """Return (seq, channel, timestamp, samples) or None if invalid."""
+    if record is None or len(record) < HEADER_SIZE + 2:
+        return None
+    body, crc = record[:-2], struct.unpack("<H", record[-2:])[0]
+    if crc16_ccitt_false(body) != crc:
+        return None
+    seq, channel, typ, count, timestamp = struct.unpack("<BBBBI", body[:HEADER_SIZE])
+    if typ not in TYPES:
+        return None
+    fmt, size = TYPES[typ]
+    payload = body[HEADER_SIZE:]
+    if len(payload) != size * count:
+        return None
+    samples = struct.unpack("<%d%s" % (count, fmt), payload)
+    return seq, channel, timestamp, samples
+
+
+class Decoder:
+    def __init__(self):
+        self.buffer = bytearray()
+        self.frames = 0
+        self.errors = 0
+        self.lost = 0
+        self.last_seq = None
+
+    def feed(self, data):
+        """Yield the valid records found in data."""
+        self.buffer += data
+        while True:
+            end = self.buffer.find(b"\x00")
+            if end < 0:
+                return
+            frame = bytes(self.buffer[:end])
+            del self.buffer[:end + 1]
+            if not frame:
+                continue
+            rec = parse_record(cobs_decode(frame))
+            if rec is None:
+                self.errors += 1  # noise, text output or truncated frame
+                continue
+            self.frames += 1
+            if self.last_seq is not None:
+                self.lost += (rec[0] - self.last_seq - 1) & 0xFF
+            self.last_seq = rec[0]
+            yield rec
+
+
+def open_source(argv):
+    if len(argv) >= 3:
+        import serial  # pyserial, only needed for a live port
+        port = serial.Serial(argv[1], int(argv[2]), timeout=0.1)
+        return lambda: port.read(4096)
+    f = open(argv[1], "rb")
+    return lambda: f.read(4096) or None
+
+
+def main(argv):
+    if len(argv) < 2:
+        print(__doc__, file=sys.stderr)
+        return 1
+
+    read = open_source(argv)
+    decoder = Decoder()
+
+    print("channel,timestamp,index,value")
+    try:
+        while True:
+            data = read()
+            if data is None:
+                break
+            for seq, channel, timestamp, samples in decoder.feed(data):
+                for idx, value in enumerate(samples):
+                    print("%d,%d,%d,%s" % (channel, timestamp, idx, value))
+    except KeyboardInterrupt:
+        pass
+
+    print("frames=%d crc_errors=%d lost_records=%d"
+          % (decoder.frames, decoder.errors, decoder.lost), file=sys.stderr)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))